@@ -0,0 +1,96 @@
+#!/bin/bash
+# Проверка вывода по ожиданиям в комментариях исходника:
+#   // asm: <функция> <regex>      - в теле функции (codegen) есть строка по regex;
+#                                    вместо функции можно назвать метку данных (vtable)
+#   // asm-not: <функция> <regex>  - ни одной такой строки
+#   // ssa: / ssa-not: ...         - то же для SSA IR функции (cfg --ssa);
+#                                    cfg должен завершиться успешно, т.е.
+#                                    IR проходит верификатор
+#   // dataflow: / dataflow-not: ... - то же для анализов функции до SSA
+#                                    (cfg --dataflow); каждая строка с
+#                                    меткой блока: "b1: available: add a b"
+# Использование: scripts/check.sh <build-dir> <file.src>...
+
+set -euo pipefail
+
+if [[ $# -lt 2 ]]; then
+  echo "Usage: $0 <build-dir> <file.src>..." >&2
+  exit 1
+fi
+
+bin="$1"
+shift
+
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+failed=0
+for src in "$@"; do
+  bad=0
+  name="$(basename "$src" .src)"
+  asm="$work/$name.s"
+  ssa="$work/$name"
+  expect="$(sed -nE 's@^[[:space:]]*//[[:space:]]*((asm|ssa|dataflow)(-not)?:)@\1@p' "$src")"
+
+  if grep -q '^asm' <<<"$expect" && ! "$bin/codegen" "$src" "$asm" >/dev/null; then
+    echo "FAIL $src: codegen" >&2
+    failed=1
+    continue
+  fi
+  opts=()
+  grep -q '^ssa' <<<"$expect" && opts+=(--ssa)
+  grep -q '^dataflow' <<<"$expect" && opts+=(--dataflow)
+  if [[ ${#opts[@]} -gt 0 ]]; then
+    mkdir -p "$ssa"
+    if ! "$bin/cfg" "${opts[@]}" "$src" "$ssa" >/dev/null; then
+      echo "FAIL $src: cfg ${opts[*]}" >&2
+      failed=1
+      continue
+    fi
+  fi
+
+  while read -r kind func regex; do
+    [[ -n "$kind" ]] || continue
+    if [[ "$kind" == asm* ]]; then
+      # тело функции или данных (vtable): от метки до .size или пустой
+      # строки, без комментариев
+      body="$(awk -v f="$func" '
+        $0 == f ":" { on = 1; next }
+        on && ($0 == "" || $1 == ".size" && $2 == f ",") { on = 0 }
+        on && $1 !~ /^#/ { print }' "$asm")"
+      if [[ -z "$body" ]]; then
+        echo "FAIL $src: no code for $func" >&2
+        bad=1
+        continue
+      fi
+    elif [[ "$kind" == dataflow* ]]; then
+      if [[ ! -f "$ssa/$name.$func.dataflow" ]]; then
+        echo "FAIL $src: no dataflow for $func" >&2
+        bad=1
+        continue
+      fi
+      # метка блока перед каждой строкой его множеств
+      body="$(awk '/^b[0-9]+:$/ { b = $1; next }
+        b != "" && /^  / { sub(/^ +/, ""); print b " " $0 }' \
+        "$ssa/$name.$func.dataflow")"
+    elif [[ -f "$ssa/$name.$func.ssa" ]]; then
+      body="$(cat "$ssa/$name.$func.ssa")"
+    else
+      echo "FAIL $src: no SSA IR for $func" >&2
+      bad=1
+      continue
+    fi
+    if grep -Eq -- "$regex" <<<"$body"; then found=1; else found=0; fi
+    if [[ "$kind" != *-not: && $found -eq 0 ]]; then
+      echo "FAIL $src: $func has no '$regex'" >&2
+      bad=1
+    elif [[ "$kind" == *-not: && $found -eq 1 ]]; then
+      echo "FAIL $src: $func has '$regex'" >&2
+      bad=1
+    fi
+  done <<<"$expect"
+
+  if [[ $bad -eq 0 ]]; then echo "ok   $src"; else failed=1; fi
+done
+
+exit $failed
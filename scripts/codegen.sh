@@ -32,39 +32,7 @@ cmake ..
 cmake --build .
 cd ..
 
-# Preprocess the input into a temporary file so we don't modify the original source.
-# Transform local-sized array declarations like "TYPE name[EXPR];" into
-#   "TYPE[] name; name = __alloc_array(EXPR);"
-# This keeps the original test file unchanged (required by instructor) but
-# makes the parser and codegen work with array declarations that allocate
-# storage at runtime through a helper in runtime.c.
-tmp_in="$(mktemp --suffix=.src)"
-
-# Use sed to rewrite single-line sized-array declarations like:
-#   TYPE name[EXPR];
-# into
-#   TYPE[] name;
-#   name = __alloc_array(EXPR);
-# This is line-oriented and safe for the patterns used in tests.
-LC_ALL=C sed -E 's/^[[:space:]]*([A-Za-z_][A-Za-z0-9_]*)[[:space:]]+([A-Za-z_][A-Za-z0-9_]*)[[:space:]]*\[[[:space:]]*([^]]+)[[:space:]]*\][[:space:]]*;/\1[] \2;\n\2 = __alloc_array(\3);/g' "$in" > "$tmp_in"
-
-# Run codegen; if it fails, dump the temporary preprocessed input so we can
-# inspect what the parser actually received (useful for debugging encoding or
-# sed/locale issues on different architectures).
-if ! ./build/codegen "$tmp_in" "$out"; then
-    echo "\n=== codegen failed. Dumping preprocessed input ($tmp_in) ===" >&2
-    if command -v hexdump >/dev/null 2>&1; then
-        hexdump -C "$tmp_in" | sed -n '1,120p' >&2
-    else
-        sed -n '1,200p' "$tmp_in" >&2
-    fi
-    echo "=== end dump ===\n" >&2
-    # keep tmp file for inspection and return non-zero
-    exit 1
-fi
-
-# remove temp file on success
-rm -f "$tmp_in"
+./build/codegen "$in" "$out"
 
 # ассемблирование
 gcc -c "$out" -o output/out.o -Wa,--noexecstack
@@ -1,75 +1,209 @@
 #include "ast.h"
+#include "intern.h"
+#include "../trace/memstat.h"
 #include <stdlib.h>
 #include <string.h>
 
-static ASTNode *g_root = NULL;
+static const char *const g_kind_names[AST_KIND_COUNT] = {
+    [AST_UNKNOWN] = "?",
+    [AST_SOURCE] = "source",
+    [AST_ITEMS] = "items",
+    [AST_FUNC_DEF] = "funcDef",
+    [AST_FUNC_DECL] = "funcDecl",
+    [AST_IMPORT] = "import",
+    [AST_SIGNATURE] = "signature",
+    [AST_ARGS] = "args",
+    [AST_ARGLIST] = "arglist",
+    [AST_ARG] = "arg",
+    [AST_ARRAY] = "array",
+    [AST_GEN_TYPE] = "genType",
+    [AST_PTR] = "ptr",
+    [AST_BLOCK] = "block",
+    [AST_STMTS] = "stmts",
+    [AST_VARDECL] = "vardecl",
+    [AST_VARS] = "vars",
+    [AST_NOINIT] = "noinit",
+    [AST_ASSIGN] = "assign",
+    [AST_IF] = "if",
+    [AST_ELSE] = "else",
+    [AST_NOELSE] = "noelse",
+    [AST_WHILE] = "while",
+    [AST_DO_WHILE] = "doWhile",
+    [AST_BREAK] = "break",
+    [AST_RETURN] = "return",
+    [AST_EXPRSTMT] = "exprstmt",
+    [AST_ASSIGN_INDEX] = "assign_index",
+    [AST_COMPOUND_ASSIGN] = "compound_assign",
+    [AST_BINOP] = "binop",
+    [AST_UNOP] = "unop",
+    [AST_ADDRESS] = "address",
+    [AST_NEW] = "new",
+    [AST_FIELD_ACCESS] = "fieldAccess",
+    [AST_METHOD_CALL] = "methodCall",
+    [AST_MEMBER_INDEX] = "memberIndex",
+    [AST_CALL] = "call",
+    [AST_INDEX] = "index",
+    [AST_LIST] = "list",
+    [AST_TEMPLATE] = "template",
+    [AST_CLASS] = "class",
+    [AST_EXTENDS] = "extends",
+    [AST_MEMBERS] = "members",
+    [AST_MEMBER] = "member",
+    [AST_FIELD] = "field",
+    [AST_FIELDLIST] = "fieldlist",
+    [AST_ID] = "id",
+    [AST_TYPE] = "type",
+    [AST_TYPE_REF] = "typeRef",
+    [AST_DEC] = "dec",
+    [AST_HEX] = "hex",
+    [AST_BITS] = "bits",
+    [AST_BOOL] = "bool",
+    [AST_CHAR] = "char",
+    [AST_STRING] = "string",
+    [AST_OP] = "op",
+    [AST_DLL] = "dll",
+    [AST_ENTRY] = "entry",
+    [AST_VARARGS] = "varargs",
+    [AST_PTRSYM] = "ptrsym",
+    [AST_MODIFIER] = "modifier",
+};
 
-static char *dup_cstr(const char *s) {
-  if (!s)
-    return NULL;
-  size_t n = strlen(s) + 1;
-  char *d = (char *)malloc(n);
-  if (d)
-    memcpy(d, s, n);
-  return d;
+const char *ast_kind_name(ASTKind kind) {
+  if ((int)kind < 0 || kind >= AST_KIND_COUNT || !g_kind_names[kind])
+    return "?";
+  return g_kind_names[kind];
 }
 
-ASTNode *ast_create_node(const char *label) {
-  ASTNode *n = (ASTNode *)calloc(1, sizeof(ASTNode));
-  if (!n)
+int ast_kind_is_token(ASTKind kind) {
+  return kind >= AST_FIRST_TOKEN_KIND && kind < AST_KIND_COUNT;
+}
+
+ASTArena *ast_arena_create(void) {
+  ASTArena *arena = (ASTArena *)calloc(1, sizeof(ASTArena));
+  if (arena)
+    mem_note_alloc(MEM_AST_NODES, sizeof(ASTArena));
+  return arena;
+}
+
+void ast_arena_free(ASTArena *arena) {
+  if (!arena)
+    return;
+  for (int i = 0; i < arena->numSlabs; ++i) {
+    free(arena->slabs[i]);
+    mem_note_free(MEM_AST_NODES, AST_SLAB_NODES * sizeof(ASTNode));
+  }
+  free(arena->slabs);
+  mem_note_resize(MEM_AST_NODES, (size_t)arena->slabCap * sizeof(ASTNode *), 0);
+  free(arena->kids);
+  mem_note_resize(MEM_AST_NODES, (size_t)arena->kidsCap * sizeof(ASTIndex), 0);
+  free(arena);
+  mem_note_free(MEM_AST_NODES, sizeof(ASTArena));
+}
+
+ASTNode *ast_create_node(ASTArena *arena, ASTKind kind) {
+  if (!arena)
     return NULL;
-  n->label = dup_cstr(label ? label : "");
-  n->children = NULL;
+  uint32_t idx = arena->numNodes;
+  if ((idx & (AST_SLAB_NODES - 1)) == 0) {
+    /* текущий слэб заполнен (или его ещё нет) */
+    if (arena->numSlabs == arena->slabCap) {
+      int newcap = arena->slabCap == 0 ? 8 : arena->slabCap * 2;
+      ASTNode **ns = (ASTNode **)realloc(arena->slabs,
+                                         (size_t)newcap * sizeof(ASTNode *));
+      if (!ns)
+        return NULL;
+      mem_note_resize(MEM_AST_NODES, (size_t)arena->slabCap * sizeof(ASTNode *),
+                      (size_t)newcap * sizeof(ASTNode *));
+      arena->slabs = ns;
+      arena->slabCap = newcap;
+    }
+    ASTNode *slab = (ASTNode *)malloc(AST_SLAB_NODES * sizeof(ASTNode));
+    if (!slab)
+      return NULL;
+    mem_note_alloc(MEM_AST_NODES, AST_SLAB_NODES * sizeof(ASTNode));
+    arena->slabs[arena->numSlabs++] = slab;
+  }
+  arena->numNodes++;
+  ASTNode *n = ast_node_at(arena, idx);
+  n->kind = kind;
   n->numChildren = 0;
-  n->capacity = 0;
+  n->lexeme = NULL;
+  n->arena = arena;
+  n->index = idx;
+  n->kids = 0;
   return n;
 }
 
-ASTNode *ast_create_leaf_token(const char *kind, const char *lexeme) {
-  size_t kind_len = kind ? strlen(kind) : 0;
-  size_t lex_len = lexeme ? strlen(lexeme) : 0;
-  size_t total = kind_len + 1 + lex_len + 1; /* kind:lexeme + NUL */
-  char *buf = (char *)malloc(total);
-  if (!buf)
+ASTNode *ast_create_leaf(ASTArena *arena, ASTKind kind, const char *lexeme) {
+  ASTNode *n = ast_create_node(arena, kind);
+  if (!n)
     return NULL;
-  buf[0] = '\0';
-  if (kind_len)
-    strcat(buf, kind);
-  strcat(buf, ":");
-  if (lex_len)
-    strcat(buf, lexeme);
-  ASTNode *n = ast_create_node(buf);
-  free(buf);
+  n->lexeme = intern_cstr(lexeme ? lexeme : "");
+  if (!n->lexeme)
+    return NULL; /* узел остаётся в арене неиспользованным */
   return n;
 }
 
+/* ёмкость среза детей выводится из их числа: 2, 4, 8, ... */
+static uint32_t kids_capacity(int num) {
+  uint32_t cap = 2;
+  while (cap < (uint32_t)num)
+    cap <<= 1;
+  return cap;
+}
+
 void ast_add_child(ASTNode *parent, ASTNode *child) {
-  if (!parent || !child)
+  if (!parent || !child || parent->arena != child->arena)
     return;
-  if (parent->numChildren == parent->capacity) {
-    int newcap = parent->capacity == 0 ? 4 : parent->capacity * 2;
-    ASTNode **nc = (ASTNode **)realloc(parent->children,
-                                       (size_t)newcap * sizeof(ASTNode *));
-    if (!nc)
-      return;
-    parent->children = nc;
-    parent->capacity = newcap;
+  ASTArena *a = parent->arena;
+  int num = parent->numChildren;
+  if (num == 0 || (uint32_t)num == kids_capacity(num)) {
+    /* срез полон: новый вдвое больше в конце kids, старый не переиспользуется
+       (суммарные потери не больше итогового размера) */
+    uint32_t newcap = num == 0 ? 2 : (uint32_t)num * 2;
+    if (a->numKids + newcap > a->kidsCap) {
+      uint32_t kc = a->kidsCap == 0 ? 256 : a->kidsCap;
+      while (kc < a->numKids + newcap)
+        kc *= 2;
+      ASTIndex *nk = (ASTIndex *)realloc(a->kids, (size_t)kc * sizeof(ASTIndex));
+      if (!nk)
+        return;
+      mem_note_resize(MEM_AST_NODES, (size_t)a->kidsCap * sizeof(ASTIndex),
+                      (size_t)kc * sizeof(ASTIndex));
+      a->kids = nk;
+      a->kidsCap = kc;
+    }
+    if (num > 0)
+      memcpy(a->kids + a->numKids, a->kids + parent->kids,
+             (size_t)num * sizeof(ASTIndex));
+    parent->kids = a->numKids;
+    a->numKids += newcap;
   }
-  parent->children[parent->numChildren++] = child;
+  a->kids[parent->kids + (uint32_t)num] = child->index;
+  parent->numChildren++;
 }
 
-static void ast_free_rec(ASTNode *n) {
-  if (!n)
+void ast_remove_child(ASTNode *parent, int i) {
+  if (!parent || i < 0 || i >= parent->numChildren)
     return;
-  for (int i = 0; i < n->numChildren; ++i) {
-    ast_free_rec(n->children[i]);
-  }
-  free(n->children);
-  free(n->label);
-  free(n);
+  /* срез сдвигается на месте; ёмкость по новому числу детей не больше
+     фактической, так что следующий ast_add_child останется корректным */
+  ASTIndex *k = parent->arena->kids + parent->kids;
+  memmove(k + i, k + i + 1, (size_t)(parent->numChildren - i - 1) * sizeof(ASTIndex));
+  parent->numChildren--;
 }
 
-void ast_free(ASTNode *node) { ast_free_rec(node); }
+ASTNode *ast_clone(ASTArena *dst, const ASTNode *src) {
+  if (!dst || !src)
+    return NULL;
+  ASTNode *n = ast_create_node(dst, src->kind);
+  if (!n)
+    return NULL;
+  n->lexeme = src->lexeme; /* интернирован, общий для всех арен */
+  for (int i = 0; i < src->numChildren; ++i)
+    ast_add_child(n, ast_clone(dst, ast_child(src, i)));
+  return n;
+}
 
 /* экспорт в dot формат */
 typedef struct {
@@ -81,17 +215,21 @@ static void print_dot_rec(FILE *out, const ASTNode *n, int *nextId) {
   if (!n)
     return;
   int myId = (*nextId)++;
-  /* минимальное экранирование кавычек в метке */
-  fprintf(out, "  n%d [label=\"", myId);
-  for (const char *p = n->label ? n->label : ""; *p; ++p) {
-    if (*p == '"' || *p == '\\')
-      fputc('\\', out);
-    fputc(*p, out);
+  /* метка: "kind" или "kind:lexeme" для листьев;
+     минимальное экранирование кавычек */
+  fprintf(out, "  n%d [label=\"%s", myId, ast_kind_name(n->kind));
+  if (n->lexeme) {
+    fputc(':', out);
+    for (const char *p = n->lexeme; *p; ++p) {
+      if (*p == '"' || *p == '\\')
+        fputc('\\', out);
+      fputc(*p, out);
+    }
   }
   fprintf(out, "\"];\n");
   for (int i = 0; i < n->numChildren; ++i) {
     int childId = *nextId;
-    print_dot_rec(out, n->children[i], nextId);
+    print_dot_rec(out, ast_child(n, i), nextId);
     fprintf(out, "  n%d -> n%d;\n", myId, childId);
   }
 }
@@ -105,6 +243,3 @@ void ast_print_dot(FILE *out, const ASTNode *root) {
   print_dot_rec(out, root, &nextId);
   fprintf(out, "}\n");
 }
-
-void ast_set_root(ASTNode *root) { g_root = root; }
-ASTNode *ast_get_root(void) { return g_root; }
@@ -1,29 +1,143 @@
 #ifndef AST_AST_H
 #define AST_AST_H
 
+#include <stdint.h>
 #include <stdio.h>
 
 typedef struct ASTNode ASTNode;
+typedef struct ASTArena ASTArena;
+
+/* индекс узла в арене (32 бита) */
+typedef uint32_t ASTIndex;
+
+/* вид узла; имена для dot/отладки — ast_kind_name() */
+typedef enum {
+    AST_UNKNOWN = 0,
+
+    /* внутренние узлы */
+    AST_SOURCE,
+    AST_ITEMS,
+    AST_FUNC_DEF,
+    AST_FUNC_DECL,
+    AST_IMPORT,
+    AST_SIGNATURE,
+    AST_ARGS,
+    AST_ARGLIST,
+    AST_ARG,
+    AST_ARRAY,
+    AST_GEN_TYPE,
+    AST_PTR,
+    AST_BLOCK,
+    AST_STMTS,
+    AST_VARDECL,
+    AST_VARS,
+    AST_NOINIT,
+    AST_ASSIGN,
+    AST_IF,
+    AST_ELSE,
+    AST_NOELSE,
+    AST_WHILE,
+    AST_DO_WHILE,
+    AST_BREAK,
+    AST_RETURN,
+    AST_EXPRSTMT,
+    AST_ASSIGN_INDEX,
+    AST_COMPOUND_ASSIGN,
+    AST_BINOP,
+    AST_UNOP,
+    AST_ADDRESS,
+    AST_NEW,
+    AST_FIELD_ACCESS,
+    AST_METHOD_CALL,
+    AST_MEMBER_INDEX,
+    AST_CALL,
+    AST_INDEX,
+    AST_LIST,
+    AST_TEMPLATE,
+    AST_CLASS,
+    AST_EXTENDS,
+    AST_MEMBERS,
+    AST_MEMBER,
+    AST_FIELD,
+    AST_FIELDLIST,
+
+    /* листья-токены: вид + lexeme */
+    AST_ID,
+    AST_TYPE,
+    AST_TYPE_REF,
+    AST_DEC,
+    AST_HEX,
+    AST_BITS,
+    AST_BOOL,
+    AST_CHAR,
+    AST_STRING,
+    AST_OP,
+    AST_DLL,
+    AST_ENTRY,
+    AST_VARARGS,
+    AST_PTRSYM,
+    AST_MODIFIER,
+
+    AST_KIND_COUNT
+} ASTKind;
+
+#define AST_FIRST_TOKEN_KIND AST_ID
 
 struct ASTNode {
-    char *label;           /* человекопонятная метка для узла */
-    ASTNode **children;    /* динамический массив указателей на дочерние узлы */
-    int numChildren;       /* количество дочерних узлов в данный момент */
-    int capacity;          /* выделенная емкость массива дочерних узлов */
+    ASTKind kind;          /* вид узла */
+    int numChildren;       /* количество дочерних узлов */
+    const char *lexeme;    /* текст токена для листьев (интернирован), иначе NULL */
+    ASTArena *arena;       /* арена, которой принадлежит узел */
+    ASTIndex index;        /* собственный индекс в арене */
+    ASTIndex kids;         /* начало среза детей в arena->kids */
+};
+
+/* Арена AST: узлы лежат в слэбах фиксированного размера (адреса узлов
+   не меняются при росте), дети — 32-битные индексы в общем массиве kids.
+   Всё дерево освобождается разом через ast_arena_free(). */
+#define AST_SLAB_SHIFT 10
+#define AST_SLAB_NODES (1u << AST_SLAB_SHIFT)
+
+struct ASTArena {
+    ASTNode **slabs;       /* слэбы по AST_SLAB_NODES узлов */
+    int numSlabs;
+    int slabCap;
+    uint32_t numNodes;
+    ASTIndex *kids;        /* срезы детей всех узлов */
+    uint32_t numKids;
+    uint32_t kidsCap;
 };
 
-ASTNode *ast_create_node(const char *label);
+ASTArena *ast_arena_create(void);
+/* освобождает все узлы арены (O(числа слэбов), без обхода дерева) */
+void ast_arena_free(ASTArena *arena);
+
+ASTNode *ast_create_node(ASTArena *arena, ASTKind kind);
+ASTNode *ast_create_leaf(ASTArena *arena, ASTKind kind, const char *lexeme);
+/* parent и child должны принадлежать одной арене */
 void ast_add_child(ASTNode *parent, ASTNode *child);
-ASTNode *ast_create_leaf_token(const char *kind, const char *lexeme);
-void ast_free(ASTNode *node);
+/* убрать i-го ребёнка (сам узел остаётся в арене) */
+void ast_remove_child(ASTNode *parent, int i);
+/* глубокая копия поддерева src в арену dst */
+ASTNode *ast_clone(ASTArena *dst, const ASTNode *src);
+
+static inline ASTNode *ast_node_at(const ASTArena *arena, ASTIndex index) {
+    return &arena->slabs[index >> AST_SLAB_SHIFT][index & (AST_SLAB_NODES - 1)];
+}
+
+/* i-й ребёнок узла */
+static inline ASTNode *ast_child(const ASTNode *n, int i) {
+    return ast_node_at(n->arena, n->arena->kids[n->kids + (uint32_t)i]);
+}
+
+/* "binop", "id", ... — те же имена, что раньше были в метках */
+const char *ast_kind_name(ASTKind kind);
+/* лист-токен (id, literal, op, ...) с lexeme */
+int ast_kind_is_token(ASTKind kind);
 
 /* экспорт в Graphviz .dot формат */
 void ast_print_dot(FILE *out, const ASTNode *root);
 
-/* глобальный доступ к корню, устанавливаемый парсером */
-void ast_set_root(ASTNode *root);
-ASTNode *ast_get_root(void);
-
 #endif /* AST_AST_H */
 
 
@@ -0,0 +1,153 @@
+#include "intern.h"
+#include "../trace/memstat.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include <windows.h>
+static SRWLOCK g_lock = SRWLOCK_INIT;
+#define INTERN_LOCK() AcquireSRWLockExclusive(&g_lock)
+#define INTERN_UNLOCK() ReleaseSRWLockExclusive(&g_lock)
+#else
+#include <pthread.h>
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+#define INTERN_LOCK() pthread_mutex_lock(&g_lock)
+#define INTERN_UNLOCK() pthread_mutex_unlock(&g_lock)
+#endif
+
+/* Открытая адресация (линейное пробирование), заполнение <= 1/2.
+   Текст строк лежит в больших блоках, без malloc на каждую строку.
+   Таблица общая для потоков параллельного разбора, поэтому защищена
+   одним мьютексом; хеш считается вне критической секции. */
+
+typedef struct {
+  const char *s; /* NULL — пустой слот */
+  uint32_t hash;
+  uint32_t len;
+} InternSlot;
+
+typedef struct InternBlock {
+  struct InternBlock *next;
+  size_t used;
+  size_t cap;
+  char data[];
+} InternBlock;
+
+#define INTERN_BLOCK_SIZE (64 * 1024)
+
+static InternSlot *g_slots = NULL;
+static size_t g_cap = 0; /* всегда степень двойки */
+static size_t g_count = 0;
+static InternBlock *g_blocks = NULL;
+
+static uint32_t hash_bytes(const char *s, size_t len) {
+  /* FNV-1a */
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static char *block_alloc(size_t n) {
+  if (!g_blocks || g_blocks->cap - g_blocks->used < n) {
+    size_t cap = n > INTERN_BLOCK_SIZE ? n : INTERN_BLOCK_SIZE;
+    InternBlock *b = (InternBlock *)malloc(sizeof(InternBlock) + cap);
+    if (!b)
+      return NULL;
+    mem_note_alloc(MEM_AST_LABELS, sizeof(InternBlock) + cap);
+    b->used = 0;
+    b->cap = cap;
+    /* большой одиночный блок не вытесняет текущий частично заполненный */
+    if (g_blocks && cap > INTERN_BLOCK_SIZE) {
+      b->next = g_blocks->next;
+      g_blocks->next = b;
+    } else {
+      b->next = g_blocks;
+      g_blocks = b;
+    }
+    b->used = n;
+    return b->data;
+  }
+  char *p = g_blocks->data + g_blocks->used;
+  g_blocks->used += n;
+  return p;
+}
+
+static int table_grow(void) {
+  size_t ncap = g_cap ? g_cap * 2 : 1024;
+  InternSlot *ns = (InternSlot *)calloc(ncap, sizeof(InternSlot));
+  if (!ns)
+    return -1;
+  for (size_t i = 0; i < g_cap; i++) {
+    if (!g_slots[i].s)
+      continue;
+    size_t j = g_slots[i].hash & (ncap - 1);
+    while (ns[j].s)
+      j = (j + 1) & (ncap - 1);
+    ns[j] = g_slots[i];
+  }
+  free(g_slots);
+  mem_note_resize(MEM_AST_LABELS, g_cap * sizeof(InternSlot), ncap * sizeof(InternSlot));
+  g_slots = ns;
+  g_cap = ncap;
+  return 0;
+}
+
+static const char *intern_locked(const char *s, size_t len, uint32_t h) {
+  if ((g_count + 1) * 2 > g_cap && table_grow() != 0)
+    return NULL;
+
+  size_t i = h & (g_cap - 1);
+  while (g_slots[i].s) {
+    if (g_slots[i].hash == h && g_slots[i].len == len &&
+        memcmp(g_slots[i].s, s, len) == 0)
+      return g_slots[i].s;
+    i = (i + 1) & (g_cap - 1);
+  }
+
+  char *copy = block_alloc(len + 1);
+  if (!copy)
+    return NULL;
+  memcpy(copy, s, len);
+  copy[len] = '\0';
+  g_slots[i].s = copy;
+  g_slots[i].hash = h;
+  g_slots[i].len = (uint32_t)len;
+  g_count++;
+  return copy;
+}
+
+const char *intern_cstrn(const char *s, size_t len) {
+  if (!s)
+    return NULL;
+  uint32_t h = hash_bytes(s, len);
+  INTERN_LOCK();
+  const char *r = intern_locked(s, len, h);
+  INTERN_UNLOCK();
+  return r;
+}
+
+const char *intern_cstr(const char *s) {
+  if (!s)
+    return NULL;
+  return intern_cstrn(s, strlen(s));
+}
+
+void intern_reset(void) {
+  INTERN_LOCK();
+  while (g_blocks) {
+    InternBlock *next = g_blocks->next;
+    mem_note_free(MEM_AST_LABELS, sizeof(InternBlock) + g_blocks->cap);
+    free(g_blocks);
+    g_blocks = next;
+  }
+  free(g_slots);
+  mem_note_resize(MEM_AST_LABELS, g_cap * sizeof(InternSlot), 0);
+  g_slots = NULL;
+  g_cap = 0;
+  g_count = 0;
+  INTERN_UNLOCK();
+}
@@ -0,0 +1,19 @@
+#ifndef AST_INTERN_H
+#define AST_INTERN_H
+
+#include <stddef.h>
+
+/* Таблица интернированных строк, общая на весь процесс (потокобезопасна).
+   Каждая различная строка хранится один раз, поэтому два символа равны
+   тогда и только тогда, когда равны указатели. Строки живут до
+   intern_reset() (или до конца процесса) и не освобождаются вызывающим. */
+
+/* интернировать C-строку; NULL -> NULL */
+const char *intern_cstr(const char *s);
+/* интернировать первые len байт s (s может быть не 0-terminated) */
+const char *intern_cstrn(const char *s, size_t len);
+
+/* освободить все строки; ранее полученные указатели становятся невалидными */
+void intern_reset(void);
+
+#endif /* AST_INTERN_H */
@@ -0,0 +1,112 @@
+#include "symmap.h"
+#include "../trace/memstat.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t ptr_hash(const char *p) {
+  /* адреса выровнены и близки друг к другу — перемешиваем (fmix64) */
+  uint64_t h = (uint64_t)(uintptr_t)p;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
+
+static size_t slot_bytes(uint32_t cap) {
+  return (size_t)cap * (sizeof(const char *) + sizeof(int));
+}
+
+void symmap_init(SymMap *m, int owner) {
+  memset(m, 0, sizeof(*m));
+  m->owner = owner;
+}
+
+void symmap_free(SymMap *m) {
+  if (!m)
+    return;
+  if (m->keys)
+    mem_note_free((MemOwner)m->owner, slot_bytes(m->cap));
+  free(m->keys);
+  free(m->vals);
+  m->keys = NULL;
+  m->vals = NULL;
+  m->cap = m->n = 0;
+}
+
+static int grow(SymMap *m) {
+  uint32_t ncap = m->cap ? m->cap * 2 : 16;
+  const char **nk = (const char **)calloc(ncap, sizeof(const char *));
+  int *nv = (int *)malloc((size_t)ncap * sizeof(int));
+  if (!nk || !nv) {
+    free(nk);
+    free(nv);
+    return -1;
+  }
+  for (uint32_t i = 0; i < m->cap; i++) {
+    if (!m->keys[i])
+      continue;
+    uint32_t j = ptr_hash(m->keys[i]) & (ncap - 1);
+    while (nk[j])
+      j = (j + 1) & (ncap - 1);
+    nk[j] = m->keys[i];
+    nv[j] = m->vals[i];
+  }
+  if (m->keys)
+    mem_note_free((MemOwner)m->owner, slot_bytes(m->cap));
+  mem_note_alloc((MemOwner)m->owner, slot_bytes(ncap));
+  free(m->keys);
+  free(m->vals);
+  m->keys = nk;
+  m->vals = nv;
+  m->cap = ncap;
+  return 0;
+}
+
+int symmap_copy(SymMap *dst, const SymMap *src) {
+  symmap_free(dst);
+  if (src->cap == 0)
+    return 0;
+  const char **nk = (const char **)malloc((size_t)src->cap * sizeof(const char *));
+  int *nv = (int *)malloc((size_t)src->cap * sizeof(int));
+  if (!nk || !nv) {
+    free(nk);
+    free(nv);
+    return -1;
+  }
+  memcpy(nk, src->keys, (size_t)src->cap * sizeof(const char *));
+  memcpy(nv, src->vals, (size_t)src->cap * sizeof(int));
+  mem_note_alloc((MemOwner)dst->owner, slot_bytes(src->cap));
+  dst->keys = nk;
+  dst->vals = nv;
+  dst->cap = src->cap;
+  dst->n = src->n;
+  return 0;
+}
+
+int symmap_put(SymMap *m, const char *sym, int val) {
+  if (!m || !sym)
+    return -1;
+  if ((m->n + 1) * 2 > m->cap && grow(m) != 0)
+    return -1;
+  uint32_t i = ptr_hash(sym) & (m->cap - 1);
+  while (m->keys[i] && m->keys[i] != sym)
+    i = (i + 1) & (m->cap - 1);
+  if (!m->keys[i]) {
+    m->keys[i] = sym;
+    m->n++;
+  }
+  m->vals[i] = val;
+  return 0;
+}
+
+int symmap_get(const SymMap *m, const char *sym) {
+  if (!m || !sym || m->cap == 0)
+    return -1;
+  uint32_t i = ptr_hash(sym) & (m->cap - 1);
+  while (m->keys[i]) {
+    if (m->keys[i] == sym)
+      return m->vals[i];
+    i = (i + 1) & (m->cap - 1);
+  }
+  return -1;
+}
@@ -0,0 +1,31 @@
+#ifndef AST_SYMMAP_H
+#define AST_SYMMAP_H
+
+#include <stdint.h>
+
+/* Хеш-таблица «интернированный символ -> int» (см. intern.h).
+   Ключи сравниваются по указателю, хеш считается по адресу, поэтому
+   поиск не трогает текст строки. Открытая адресация, заполнение <= 1/2.
+   Нулевая структура — пустая таблица. */
+
+typedef struct {
+    const char **keys;
+    int *vals;
+    uint32_t cap; /* степень двойки или 0 */
+    uint32_t n;
+    int owner;    /* MemOwner для --mem-report */
+} SymMap;
+
+void symmap_init(SymMap *m, int owner);
+void symmap_free(SymMap *m);
+
+/* dst := копия src (ключи на тех же местах — без перехеширования);
+   прежнее содержимое dst освобождается. 0 — успех, -1 — нет памяти */
+int symmap_copy(SymMap *dst, const SymMap *src);
+
+/* вставить или заменить; 0 — успех, -1 — нет памяти */
+int symmap_put(SymMap *m, const char *sym, int val);
+/* значение или -1, если символа нет */
+int symmap_get(const SymMap *m, const char *sym);
+
+#endif /* AST_SYMMAP_H */
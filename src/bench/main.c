@@ -0,0 +1,285 @@
+#include "srcgen.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Замер масштабируемости фронтенда: для каждого размера генерирует
+   программу (srcgen), запускает parser, semantic, cfg и codegen отдельными
+   процессами и пишет время и пиковый RSS по стадиям в JSON. Рост времени
+   между соседними размерами сверх SUPERLINEAR_EXPONENT помечается. */
+
+#define MAX_SIZES 16
+#define SUPERLINEAR_EXPONENT 1.25
+#define MIN_SCALING_MS 20.0 /* короче — шум, показатель не считаем */
+
+enum { ST_PARSER, ST_SEMANTIC, ST_CFG, ST_CODEGEN, ST_COUNT };
+static const char *const g_stage_names[ST_COUNT] = {"parser", "semantic", "cfg", "codegen"};
+
+typedef struct {
+  double wall_ms;
+  long max_rss_kb;
+  int exit_code; /* -1 — сигнал */
+  int timed_out;
+} StageResult;
+
+typedef struct {
+  long lines;
+  long bytes;
+  StageResult st[ST_COUNT];
+} SizeResult;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/* Запустить argv[0] со stdin из in_path (или /dev/null), stdout/stderr в
+   /dev/null; время и ru_maxrss ребёнка — в res. */
+static int run_stage(char *const *argv, const char *in_path, double timeout_s, StageResult *res) {
+  memset(res, 0, sizeof(*res));
+  double t0 = now_ms();
+  pid_t pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    int in = open(in_path ? in_path : "/dev/null", O_RDONLY);
+    int null = open("/dev/null", O_WRONLY);
+    if (in >= 0)
+      dup2(in, 0);
+    if (null >= 0) {
+      dup2(null, 1);
+      dup2(null, 2);
+    }
+    execv(argv[0], argv);
+    _exit(127);
+  }
+
+  int status = 0;
+  struct rusage ru;
+  memset(&ru, 0, sizeof(ru));
+  for (;;) {
+    pid_t r = wait4(pid, &status, WNOHANG, &ru);
+    if (r == pid)
+      break;
+    if (r < 0 && errno != EINTR)
+      return -1;
+    if (timeout_s > 0 && now_ms() - t0 > timeout_s * 1e3 && !res->timed_out) {
+      kill(pid, SIGKILL);
+      res->timed_out = 1;
+    }
+    usleep(2000);
+  }
+  res->wall_ms = now_ms() - t0;
+  res->max_rss_kb = ru.ru_maxrss; /* KiB на Linux */
+  res->exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  return 0;
+}
+
+static int ensure_dir(const char *dir) {
+  struct stat st;
+  if (stat(dir, &st) == 0)
+    return S_ISDIR(st.st_mode) ? 0 : -1;
+  return mkdir(dir, 0755);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [--bin DIR] [--work DIR] [--out FILE] [--sizes N,N,...] [--timeout SEC]\n"
+          "  --bin DIR      directory with parser, semantic, cfg, codegen (default .)\n"
+          "  --work DIR     scratch directory for generated programs (default bench)\n"
+          "  --out FILE     JSON results (default <work>/results.json)\n"
+          "  --sizes LIST   program sizes in lines (default 10000,100000,1000000)\n"
+          "  --timeout SEC  per-stage limit, 0 = none (default 600)\n",
+          prog);
+}
+
+static int parse_sizes(const char *s, long *sizes) {
+  int n = 0;
+  while (*s && n < MAX_SIZES) {
+    char *end = NULL;
+    long v = strtol(s, &end, 10);
+    if (end == s || v <= 0)
+      return -1;
+    sizes[n++] = v;
+    s = *end == ',' ? end + 1 : end;
+    if (*end && *end != ',')
+      return -1;
+  }
+  return n;
+}
+
+static double scaling_exponent(const SizeResult *a, const SizeResult *b, int st) {
+  double t1 = a->st[st].wall_ms, t2 = b->st[st].wall_ms;
+  if (t1 <= 0 || t2 < MIN_SCALING_MS || b->lines <= a->lines)
+    return NAN;
+  return log(t2 / t1) / log((double)b->lines / (double)a->lines);
+}
+
+static int write_json(const char *path, const SizeResult *res, int n) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return -1;
+  fprintf(f, "{\n  \"runs\": [\n");
+  int first = 1;
+  for (int i = 0; i < n; i++) {
+    for (int s = 0; s < ST_COUNT; s++) {
+      const StageResult *r = &res[i].st[s];
+      fprintf(f,
+              "%s    {\"stage\": \"%s\", \"lines\": %ld, \"bytes\": %ld, \"wall_ms\": %.3f, "
+              "\"max_rss_kb\": %ld, \"exit_code\": %d, \"timed_out\": %s}",
+              first ? "" : ",\n", g_stage_names[s], res[i].lines, res[i].bytes, r->wall_ms,
+              r->max_rss_kb, r->exit_code, r->timed_out ? "true" : "false");
+      first = 0;
+    }
+  }
+  fprintf(f, "\n  ],\n  \"scaling\": [\n");
+  first = 1;
+  for (int i = 1; i < n; i++) {
+    for (int s = 0; s < ST_COUNT; s++) {
+      double k = scaling_exponent(&res[i - 1], &res[i], s);
+      if (isnan(k))
+        continue;
+      fprintf(f,
+              "%s    {\"stage\": \"%s\", \"from_lines\": %ld, \"to_lines\": %ld, "
+              "\"exponent\": %.3f, \"superlinear\": %s}",
+              first ? "" : ",\n", g_stage_names[s], res[i - 1].lines, res[i].lines, k,
+              k > SUPERLINEAR_EXPONENT ? "true" : "false");
+      first = 0;
+    }
+  }
+  fprintf(f, "\n  ],\n  \"superlinear_threshold\": %.2f\n}\n", SUPERLINEAR_EXPONENT);
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+  const char *bin_dir = ".";
+  const char *work_dir = "bench";
+  const char *out_path = NULL;
+  long sizes[MAX_SIZES] = {10000, 100000, 1000000};
+  int nsizes = 3;
+  double timeout_s = 600;
+
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    }
+    if (!v) {
+      usage(argv[0]);
+      return 1;
+    }
+    i++;
+    if (strcmp(a, "--bin") == 0)
+      bin_dir = v;
+    else if (strcmp(a, "--work") == 0)
+      work_dir = v;
+    else if (strcmp(a, "--out") == 0)
+      out_path = v;
+    else if (strcmp(a, "--timeout") == 0)
+      timeout_s = atof(v);
+    else if (strcmp(a, "--sizes") == 0) {
+      nsizes = parse_sizes(v, sizes);
+      if (nsizes <= 0) {
+        fprintf(stderr, "Error: bad --sizes '%s'\n", v);
+        return 1;
+      }
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (ensure_dir(work_dir) != 0) {
+    fprintf(stderr, "Error: cannot create work directory '%s': %s\n", work_dir, strerror(errno));
+    return 1;
+  }
+
+  char tools[ST_COUNT][1024];
+  for (int s = 0; s < ST_COUNT; s++) {
+    snprintf(tools[s], sizeof(tools[s]), "%s/%s", bin_dir, g_stage_names[s]);
+    if (access(tools[s], X_OK) != 0) {
+      fprintf(stderr, "Error: '%s' is not executable (build it or pass --bin)\n", tools[s]);
+      return 1;
+    }
+  }
+
+  char json_default[1024];
+  if (!out_path) {
+    snprintf(json_default, sizeof(json_default), "%s/results.json", work_dir);
+    out_path = json_default;
+  }
+
+  SizeResult res[MAX_SIZES];
+  memset(res, 0, sizeof(res));
+  int failures = 0;
+
+  printf("%-10s %-10s %12s %12s %6s\n", "lines", "stage", "wall ms", "max RSS KiB", "exit");
+  for (int i = 0; i < nsizes; i++) {
+    char src[1024], dot[1024], cfg_dir[1024], asm_out[1024];
+    snprintf(src, sizeof(src), "%s/gen_%ld.src", work_dir, sizes[i]);
+    snprintf(dot, sizeof(dot), "%s/gen_%ld.dot", work_dir, sizes[i]);
+    snprintf(cfg_dir, sizeof(cfg_dir), "%s/cfg_%ld", work_dir, sizes[i]);
+    snprintf(asm_out, sizeof(asm_out), "%s/gen_%ld.s", work_dir, sizes[i]);
+
+    SrcGenParams p;
+    srcgen_defaults(&p);
+    p.lines = sizes[i];
+    FILE *f = fopen(src, "w");
+    long lines = f ? srcgen_write(f, &p) : -1;
+    if (!f || fclose(f) != 0 || lines < 0 || ensure_dir(cfg_dir) != 0) {
+      fprintf(stderr, "Error: cannot write '%s': %s\n", src, strerror(errno));
+      return 1;
+    }
+    struct stat st;
+    res[i].lines = lines;
+    res[i].bytes = stat(src, &st) == 0 ? (long)st.st_size : 0;
+
+    char *const parser_argv[] = {tools[ST_PARSER], "-q", NULL};
+    char *const semantic_argv[] = {tools[ST_SEMANTIC], src, dot, NULL};
+    char *const cfg_argv[] = {tools[ST_CFG], src, cfg_dir, NULL};
+    char *const codegen_argv[] = {tools[ST_CODEGEN], src, asm_out, NULL};
+    char *const *stage_argv[ST_COUNT] = {parser_argv, semantic_argv, cfg_argv, codegen_argv};
+
+    for (int s = 0; s < ST_COUNT; s++) {
+      StageResult *r = &res[i].st[s];
+      if (run_stage(stage_argv[s], s == ST_PARSER ? src : NULL, timeout_s, r) != 0) {
+        fprintf(stderr, "Error: cannot run '%s': %s\n", tools[s], strerror(errno));
+        return 1;
+      }
+      failures += r->exit_code != 0;
+      printf("%-10ld %-10s %12.1f %12ld %6d%s\n", lines, g_stage_names[s], r->wall_ms,
+             r->max_rss_kb, r->exit_code, r->timed_out ? " (timeout)" : "");
+      fflush(stdout);
+    }
+  }
+
+  for (int i = 1; i < nsizes; i++) {
+    for (int s = 0; s < ST_COUNT; s++) {
+      double k = scaling_exponent(&res[i - 1], &res[i], s);
+      if (!isnan(k) && k > SUPERLINEAR_EXPONENT)
+        printf("superlinear: %s %ld -> %ld lines, time ~ n^%.2f\n", g_stage_names[s],
+               res[i - 1].lines, res[i].lines, k);
+    }
+  }
+
+  if (write_json(out_path, res, nsizes) != 0) {
+    fprintf(stderr, "Error: cannot write '%s': %s\n", out_path, strerror(errno));
+    return 1;
+  }
+  printf("results: %s\n", out_path);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,193 @@
+#include "srcgen.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  FILE *out;
+  long lines;
+  unsigned rng;
+  int err;
+} Gen;
+
+static void line(Gen *g, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  if (vfprintf(g->out, fmt, ap) < 0)
+    g->err = 1;
+  va_end(ap);
+  if (fputc('\n', g->out) == EOF)
+    g->err = 1;
+  g->lines++;
+}
+
+/* xorshift32: одинаковый результат на всех платформах (в отличие от rand) */
+static unsigned next_rand(Gen *g) {
+  unsigned x = g->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  g->rng = x;
+  return x;
+}
+
+static int rand_below(Gen *g, int n) { return n > 0 ? (int)(next_rand(g) % (unsigned)n) : 0; }
+
+void srcgen_defaults(SrcGenParams *p) {
+  memset(p, 0, sizeof(*p));
+  p->lines = 10000;
+  p->class_chain = 8;
+  p->fields_per_class = 3;
+  p->methods_per_class = 2;
+  p->funcs_per_class = 4;
+  p->expr_depth = 16;
+  p->calls_per_func = 3;
+  p->seed = 12345;
+}
+
+/* ---- выражения ---- */
+
+typedef struct {
+  char *s;
+  size_t n, cap;
+} Buf;
+
+static void buf_put(Buf *b, const char *s) {
+  size_t k = strlen(s);
+  if (b->n + k + 1 > b->cap) {
+    size_t nc = b->cap ? b->cap * 2 : 256;
+    while (nc < b->n + k + 1)
+      nc *= 2;
+    char *ns = (char *)realloc(b->s, nc);
+    if (!ns)
+      return;
+    b->s = ns;
+    b->cap = nc;
+  }
+  memcpy(b->s + b->n, s, k + 1);
+  b->n += k;
+}
+
+static void expr_leaf(Gen *g, Buf *b, const char *const *vars, int nvars) {
+  char tmp[16];
+  if (rand_below(g, 3) == 0) {
+    snprintf(tmp, sizeof(tmp), "%d", 1 + rand_below(g, 97));
+    buf_put(b, tmp);
+  } else {
+    buf_put(b, vars[rand_below(g, nvars)]);
+  }
+}
+
+/* глубина растёт линейно по размеру: на каждом уровне одна сторона — лист */
+static void expr_gen(Gen *g, Buf *b, int depth, const char *const *vars, int nvars) {
+  static const char *const ops[] = {" + ", " - ", " * ", " + ", " - "};
+  if (depth <= 0) {
+    expr_leaf(g, b, vars, nvars);
+    return;
+  }
+  buf_put(b, "(");
+  if (rand_below(g, 2)) {
+    expr_gen(g, b, depth - 1, vars, nvars);
+    buf_put(b, ops[rand_below(g, 5)]);
+    expr_leaf(g, b, vars, nvars);
+  } else {
+    expr_leaf(g, b, vars, nvars);
+    buf_put(b, ops[rand_below(g, 5)]);
+    expr_gen(g, b, depth - 1, vars, nvars);
+  }
+  buf_put(b, ")");
+}
+
+/* ---- классы и функции ---- */
+
+static void gen_class(Gen *g, const SrcGenParams *p, int ci) {
+  int has_base = p->class_chain > 1 && ci % p->class_chain != 0;
+  if (has_base)
+    line(g, "class C%d : C%d {", ci, ci - 1);
+  else
+    line(g, "class C%d {", ci);
+  for (int f = 0; f < p->fields_per_class; f++)
+    line(g, "    int f%d_%d;", ci, f);
+  for (int m = 0; m < p->methods_per_class; m++) {
+    line(g, "");
+    line(g, "    int m%d_%d(int v) {", ci, m);
+    if (p->fields_per_class > 0) {
+      int f = m % p->fields_per_class;
+      line(g, "        f%d_%d = v + f%d_%d;", ci, f, ci, (f + 1) % p->fields_per_class);
+      /* унаследованное поле */
+      if (has_base)
+        line(g, "        return f%d_%d * 2 + f%d_0;", ci, f, ci - 1);
+      else
+        line(g, "        return f%d_%d * 2;", ci, f);
+    } else {
+      line(g, "        return v * 2;");
+    }
+    line(g, "    }");
+  }
+  line(g, "}");
+  line(g, "");
+}
+
+static void gen_function(Gen *g, const SrcGenParams *p, int fi, int ci) {
+  static const char *const vars[] = {"a", "b", "x"};
+  Buf e = {0};
+
+  line(g, "int fn%d(int a, int b) {", fi);
+  expr_gen(g, &e, p->expr_depth, vars, 2);
+  line(g, "    int x = %s;", e.s ? e.s : "a");
+  line(g, "    int y = 0;");
+
+  if (fi > 0) {
+    int lo = fi > 64 ? fi - 64 : 0;
+    line(g, "    while (y < a %% 8) {");
+    line(g, "        y = y + 1;");
+    /* несколько разных callee, каждого по два раза — дубликаты рёбер графа вызовов */
+    for (int c = 0; c < p->calls_per_func; c++) {
+      int callee = lo + rand_below(g, fi - lo);
+      line(g, "        x = x + fn%d(y, x) - fn%d(x, y);", callee, callee);
+    }
+    line(g, "    }");
+  }
+
+  e.n = 0;
+  expr_gen(g, &e, p->expr_depth / 2, vars, 3);
+  line(g, "    if (x > b) {");
+  line(g, "        x = %s;", e.s ? e.s : "x");
+  line(g, "    } else {");
+  line(g, "        x = x - b;");
+  line(g, "    }");
+
+  if (p->methods_per_class > 0) {
+    line(g, "    C%d o = new C%d();", ci, ci);
+    line(g, "    x = x + o.m%d_%d(a);", ci, rand_below(g, p->methods_per_class));
+  }
+  line(g, "    return x;");
+  line(g, "}");
+  line(g, "");
+  free(e.s);
+}
+
+long srcgen_write(FILE *out, const SrcGenParams *p) {
+  Gen g;
+  memset(&g, 0, sizeof(g));
+  g.out = out;
+  g.rng = p->seed ? p->seed : 1;
+
+  int nfuncs = 0;
+  int funcs_per_class = p->funcs_per_class > 0 ? p->funcs_per_class : 1;
+  for (int ci = 0; g.lines < p->lines && !g.err; ci++) {
+    gen_class(&g, p, ci);
+    for (int k = 0; k < funcs_per_class && g.lines < p->lines; k++)
+      gen_function(&g, p, nfuncs++, ci);
+  }
+
+  line(&g, "int main() {");
+  if (nfuncs > 0)
+    line(&g, "    int s = fn%d(3, 4);", nfuncs - 1);
+  else
+    line(&g, "    int s = 0;");
+  line(&g, "    return s;");
+  line(&g, "}");
+
+  return g.err ? -1 : g.lines;
+}
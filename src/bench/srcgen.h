@@ -0,0 +1,30 @@
+#ifndef BENCH_SRCGEN_H
+#define BENCH_SRCGEN_H
+
+#include <stdio.h>
+
+/* Генератор синтетических программ на входном языке (parser.y) для
+   замеров масштабируемости фронтенда. Программа состоит из блоков:
+   класс (цепочки наследования) + несколько функций, каждая из которых
+   вызывает предыдущие (одного и того же callee по нескольку раз), строит
+   объект и вызывает его методы, содержит циклы, ветвления и глубокие
+   выражения. Результат детерминирован для заданных параметров. */
+
+typedef struct {
+    long lines;            /* примерное число строк (генерация до порога) */
+    int class_chain;       /* глубина цепочки наследования классов */
+    int fields_per_class;
+    int methods_per_class;
+    int funcs_per_class;   /* функций на каждый класс */
+    int expr_depth;        /* глубина вложенности выражений */
+    int calls_per_func;    /* различных callee в теле функции */
+    unsigned seed;
+} SrcGenParams;
+
+void srcgen_defaults(SrcGenParams *p);
+
+/* Записать программу; возвращает число записанных строк или -1 при
+   ошибке записи. */
+long srcgen_write(FILE *out, const SrcGenParams *p);
+
+#endif /* BENCH_SRCGEN_H */
@@ -0,0 +1,93 @@
+#include "srcgen.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [options] [-o <output-file>]\n"
+          "  --lines N          approximate program size (default 10000)\n"
+          "  --chain N          inheritance chain depth (default 8)\n"
+          "  --fields N         fields per class (default 3)\n"
+          "  --methods N        methods per class (default 2)\n"
+          "  --funcs N          functions per class (default 4)\n"
+          "  --expr-depth N     expression nesting depth (default 16)\n"
+          "  --calls N          distinct callees per function (default 3)\n"
+          "  --seed N           random seed (default 12345)\n",
+          prog);
+}
+
+/* значение целочисленного флага; 0 — ок */
+static int int_arg(int argc, char **argv, int *i, long *out) {
+  if (*i + 1 >= argc)
+    return -1;
+  char *end = NULL;
+  long v = strtol(argv[++*i], &end, 10);
+  if (!end || *end || v < 0)
+    return -1;
+  *out = v;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  SrcGenParams p;
+  srcgen_defaults(&p);
+  const char *output_file = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    long v = 0;
+    const char *a = argv[i];
+    if (strcmp(a, "-o") == 0 && i + 1 < argc) {
+      output_file = argv[++i];
+      continue;
+    }
+    if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    }
+    if (int_arg(argc, argv, &i, &v) != 0) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (strcmp(a, "--lines") == 0)
+      p.lines = v;
+    else if (strcmp(a, "--chain") == 0)
+      p.class_chain = (int)v;
+    else if (strcmp(a, "--fields") == 0)
+      p.fields_per_class = (int)v;
+    else if (strcmp(a, "--methods") == 0)
+      p.methods_per_class = (int)v;
+    else if (strcmp(a, "--funcs") == 0)
+      p.funcs_per_class = (int)v;
+    else if (strcmp(a, "--expr-depth") == 0)
+      p.expr_depth = (int)v;
+    else if (strcmp(a, "--calls") == 0)
+      p.calls_per_func = (int)v;
+    else if (strcmp(a, "--seed") == 0)
+      p.seed = (unsigned)v;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  FILE *out = stdout;
+  if (output_file) {
+    errno = 0;
+    out = fopen(output_file, "w");
+    if (!out) {
+      fprintf(stderr, "Error: cannot open output file '%s': %s\n", output_file,
+              strerror(errno));
+      return 1;
+    }
+  }
+  long n = srcgen_write(out, &p);
+  if (output_file && fclose(out) != 0)
+    n = -1;
+  if (n < 0) {
+    fprintf(stderr, "Error: write failed\n");
+    return 1;
+  }
+  return 0;
+}
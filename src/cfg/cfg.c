@@ -6,7 +6,9 @@
 
 /* Parser generated in build directory */
 #include "../ast/ast.h"
-#include "../../build/parser.tab.h"
+#include "../ast/intern.h"
+#include "../trace/memstat.h"
+#include "parser.tab.h"
 
 /* ============================================================================
  * UTILITY FUNCTIONS
@@ -53,6 +55,7 @@ static CFGOperation *cfg_operation_create(CFGOperationKind kind,
   CFGOperation *op = (CFGOperation *)calloc(1, sizeof(CFGOperation));
   if (!op)
     return NULL;
+  mem_note_alloc(MEM_CFG_OPS, sizeof(CFGOperation));
   op->kind = kind;
   op->op_name = dup_cstr(op_name);
   op->ast_node = ast_node;
@@ -71,6 +74,8 @@ static void cfg_operation_add_operand(CFGOperation *op, CFGOperation *operand) {
         op->operands, (size_t)newcap * sizeof(CFGOperation *));
     if (!no)
       return;
+    mem_note_resize(MEM_CFG_OPS, (size_t)op->capacity * sizeof(CFGOperation *),
+                    (size_t)newcap * sizeof(CFGOperation *));
     op->operands = no;
     op->capacity = newcap;
   }
@@ -86,39 +91,36 @@ static void cfg_operation_free(CFGOperation *op) {
       cfg_operation_free(op->operands[i]);
     }
     free(op->operands);
+    mem_note_resize(MEM_CFG_OPS, (size_t)op->capacity * sizeof(CFGOperation *), 0);
   }
   free(op);
+  mem_note_free(MEM_CFG_OPS, sizeof(CFGOperation));
 }
 
-/* Extract token value from "kind:value" format */
-static char *extract_token_value(const char *label) {
-  if (!label)
-    return dup_cstr("");
-  const char *colon = strchr(label, ':');
-  if (colon)
-    return dup_cstr(colon + 1);
-  return dup_cstr(label);
+/* Token text of a leaf; interior nodes fall back to their kind name */
+static char *token_value(const ASTNode *n) {
+  if (!n)
+    return dup_cstr("?");
+  if (n->lexeme)
+    return dup_cstr(n->lexeme);
+  return dup_cstr(ast_kind_name(n->kind));
 }
 
 /* Decompose AST expression into operations */
 static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
-  if (!expr || !expr->label)
+  if (!expr)
     return NULL;
 
-  const char *label = expr->label;
-
-  if (strcmp(label, "binop") == 0 && expr->numChildren >= 3) {
+  switch (expr->kind) {
+  case AST_BINOP: {
+    if (expr->numChildren < 3)
+      break;
     /* Binary operation: left op right */
-    ASTNode *left = expr->children[0];
-    ASTNode *op_node = expr->children[1];
-    ASTNode *right = expr->children[2];
+    ASTNode *left = ast_child(expr, 0);
+    ASTNode *op_node = ast_child(expr, 1);
+    ASTNode *right = ast_child(expr, 2);
 
-    char *op_name = NULL;
-    if (op_node && op_node->label) {
-      op_name = extract_token_value(op_node->label);
-    } else {
-      op_name = dup_cstr("?");
-    }
+    char *op_name = token_value(op_node);
 
     CFGOperation *op = cfg_operation_create(CFG_OP_BINOP, op_name, expr);
     free(op_name);
@@ -132,17 +134,15 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
       cfg_operation_add_operand(op, right_op);
 
     return op;
-  } else if (strcmp(label, "unop") == 0 && expr->numChildren >= 2) {
+  }
+  case AST_UNOP: {
+    if (expr->numChildren < 2)
+      break;
     /* Unary operation: op expr */
-    ASTNode *op_node = expr->children[0];
-    ASTNode *operand = expr->children[1];
+    ASTNode *op_node = ast_child(expr, 0);
+    ASTNode *operand = ast_child(expr, 1);
 
-    char *op_name = NULL;
-    if (op_node && op_node->label) {
-      op_name = extract_token_value(op_node->label);
-    } else {
-      op_name = dup_cstr("?");
-    }
+    char *op_name = token_value(op_node);
 
     CFGOperation *op = cfg_operation_create(CFG_OP_UNOP, op_name, expr);
     free(op_name);
@@ -152,15 +152,13 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
       cfg_operation_add_operand(op, operand_op);
 
     return op;
-  } else if (strcmp(label, "address") == 0 && expr->numChildren >= 1) {
+  }
+  case AST_ADDRESS: {
+    if (expr->numChildren < 1)
+      break;
     /* Address-of operation: &var */
-    ASTNode *id_node = expr->children[0];
-    char *var_name = NULL;
-    if (id_node && id_node->label) {
-      var_name = extract_token_value(id_node->label);
-    } else {
-      var_name = dup_cstr("?");
-    }
+    ASTNode *id_node = ast_child(expr, 0);
+    char *var_name = token_value(id_node);
 
     CFGOperation *op = cfg_operation_create(CFG_OP_VAR, var_name, expr);
     free(var_name);
@@ -173,37 +171,35 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
     }
 
     return op;
-  } else if (strcmp(label, "call") == 0 && expr->numChildren >= 2) {
+  }
+  case AST_CALL: {
+    if (expr->numChildren < 2)
+      break;
     /* Function call: func(args...) */
-    ASTNode *func_id = expr->children[0];
-    ASTNode *args_node = expr->numChildren > 1 ? expr->children[1] : NULL;
+    ASTNode *func_id = ast_child(expr, 0);
+    ASTNode *args_node = expr->numChildren > 1 ? ast_child(expr, 1) : NULL;
 
-    char *func_name = NULL;
-    if (func_id && func_id->label) {
-      func_name = extract_token_value(func_id->label);
-    } else {
-      func_name = dup_cstr("?");
-    }
+    char *func_name = token_value(func_id);
 
     CFGOperation *op = cfg_operation_create(CFG_OP_CALL, func_name, expr);
     free(func_name);
 
     /* Add function name as first operand */
-    if (func_id && func_id->label) {
-      char *name = extract_token_value(func_id->label);
+    if (func_id) {
+      char *name = token_value(func_id);
       CFGOperation *name_op = cfg_operation_create(CFG_OP_VAR, name, func_id);
       free(name);
       cfg_operation_add_operand(op, name_op);
     }
 
     /* Add arguments as operands */
-    if (args_node && strcmp(args_node->label, "args") == 0 &&
+    if (args_node && args_node->kind == AST_ARGS &&
         args_node->numChildren > 0) {
-      ASTNode *arglist = args_node->children[0];
-      if (arglist && strcmp(arglist->label, "list") == 0) {
+      ASTNode *arglist = ast_child(args_node, 0);
+      if (arglist && arglist->kind == AST_LIST) {
         for (int i = 0; i < arglist->numChildren; i++) {
           CFGOperation *arg_op =
-              decompose_expr_to_operation(arglist->children[i]);
+              decompose_expr_to_operation(ast_child(arglist, i));
           if (arg_op)
             cfg_operation_add_operand(op, arg_op);
         }
@@ -211,10 +207,13 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
     }
 
     return op;
-  } else if (strcmp(label, "index") == 0 && expr->numChildren >= 2) {
+  }
+  case AST_INDEX: {
+    if (expr->numChildren < 2)
+      break;
     /* Array indexing: base[index] */
-    ASTNode *base_id = expr->children[0];
-    ASTNode *indices_node = expr->numChildren > 1 ? expr->children[1] : NULL;
+    ASTNode *base_id = ast_child(expr, 0);
+    ASTNode *indices_node = expr->numChildren > 1 ? ast_child(expr, 1) : NULL;
 
     CFGOperation *op = cfg_operation_create(CFG_OP_INDEX, "[]", expr);
 
@@ -225,33 +224,77 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
         cfg_operation_add_operand(op, base_op);
     }
 
-    /* Indices as operands */
-    if (indices_node && strcmp(indices_node->label, "args") == 0 &&
+    /* Indices as operands; a[expr] carries the index expression itself */
+    if (indices_node && indices_node->kind == AST_ARGS &&
         indices_node->numChildren > 0) {
-      ASTNode *indexlist = indices_node->children[0];
-      if (indexlist && strcmp(indexlist->label, "list") == 0) {
+      ASTNode *indexlist = ast_child(indices_node, 0);
+      if (indexlist && indexlist->kind == AST_LIST) {
         for (int i = 0; i < indexlist->numChildren; i++) {
           CFGOperation *idx_op =
-              decompose_expr_to_operation(indexlist->children[i]);
+              decompose_expr_to_operation(ast_child(indexlist, i));
           if (idx_op)
             cfg_operation_add_operand(op, idx_op);
         }
       }
+    } else if (indices_node && indices_node->kind != AST_ARGS) {
+      CFGOperation *idx_op = decompose_expr_to_operation(indices_node);
+      if (idx_op)
+        cfg_operation_add_operand(op, idx_op);
     }
 
     return op;
-  } else if (strcmp(label, "fieldAccess") == 0 && expr->numChildren >= 2) {
-    /* Field access: obj.field */
-    ASTNode *obj = expr->children[0];
-    ASTNode *field_id = expr->children[1];
+  }
+  case AST_MEMBER_INDEX: {
+    if (expr->numChildren < 3)
+      break;
+    /* obj.field[index]: indexing of a field access */
+    char *field_name = token_value(ast_child(expr, 1));
+    CFGOperation *field_op =
+        cfg_operation_create(CFG_OP_FIELD_ACCESS, field_name, expr);
+    free(field_name);
+    CFGOperation *obj_op = decompose_expr_to_operation(ast_child(expr, 0));
+    if (obj_op)
+      cfg_operation_add_operand(field_op, obj_op);
 
-    char *field_name = NULL;
-    if (field_id && field_id->label) {
-      field_name = extract_token_value(field_id->label);
-    } else {
-      field_name = dup_cstr("?");
+    CFGOperation *op = cfg_operation_create(CFG_OP_INDEX, "[]", expr);
+    cfg_operation_add_operand(op, field_op);
+    CFGOperation *idx_op = decompose_expr_to_operation(ast_child(expr, 2));
+    if (idx_op)
+      cfg_operation_add_operand(op, idx_op);
+    return op;
+  }
+  case AST_ASSIGN:
+  case AST_COMPOUND_ASSIGN:
+  case AST_ASSIGN_INDEX: {
+    if (expr->numChildren < 2)
+      break;
+    /* target = value, target op= value, target[index] = value: named after
+       the target; the value (and a non-variable target) become operands */
+    ASTNode *target = ast_child(expr, 0);
+    char *target_name = token_value(target);
+    CFGOperation *op = cfg_operation_create(CFG_OP_ASSIGN, target_name, expr);
+    free(target_name);
+
+    for (int i = 0; i < expr->numChildren; i++) {
+      ASTNode *c = ast_child(expr, i);
+      if ((i == 0 && c->kind == AST_ID) || c->kind == AST_OP)
+        continue;
+      CFGOperation *sub_op = decompose_expr_to_operation(c);
+      if (sub_op)
+        cfg_operation_add_operand(op, sub_op);
     }
 
+    return op;
+  }
+  case AST_FIELD_ACCESS: {
+    if (expr->numChildren < 2)
+      break;
+    /* Field access: obj.field */
+    ASTNode *obj = ast_child(expr, 0);
+    ASTNode *field_id = ast_child(expr, 1);
+
+    char *field_name = token_value(field_id);
+
     CFGOperation *op = cfg_operation_create(CFG_OP_FIELD_ACCESS, field_name, expr);
     free(field_name);
 
@@ -260,18 +303,16 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
       cfg_operation_add_operand(op, obj_op);
 
     return op;
-  } else if (strcmp(label, "methodCall") == 0 && expr->numChildren >= 3) {
+  }
+  case AST_METHOD_CALL: {
+    if (expr->numChildren < 3)
+      break;
     /* Method call: obj.method(args...) */
-    ASTNode *obj = expr->children[0];
-    ASTNode *method_id = expr->children[1];
-    ASTNode *args_node = expr->numChildren > 2 ? expr->children[2] : NULL;
+    ASTNode *obj = ast_child(expr, 0);
+    ASTNode *method_id = ast_child(expr, 1);
+    ASTNode *args_node = expr->numChildren > 2 ? ast_child(expr, 2) : NULL;
 
-    char *method_name = NULL;
-    if (method_id && method_id->label) {
-      method_name = extract_token_value(method_id->label);
-    } else {
-      method_name = dup_cstr("?");
-    }
+    char *method_name = token_value(method_id);
 
     CFGOperation *op = cfg_operation_create(CFG_OP_METHOD_CALL, method_name, expr);
     free(method_name);
@@ -282,13 +323,13 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
       cfg_operation_add_operand(op, obj_op);
 
     /* Add arguments as operands */
-    if (args_node && strcmp(args_node->label, "args") == 0 &&
+    if (args_node && args_node->kind == AST_ARGS &&
         args_node->numChildren > 0) {
-      ASTNode *arglist = args_node->children[0];
-      if (arglist && strcmp(arglist->label, "list") == 0) {
+      ASTNode *arglist = ast_child(args_node, 0);
+      if (arglist && arglist->kind == AST_LIST) {
         for (int i = 0; i < arglist->numChildren; i++) {
           CFGOperation *arg_op =
-              decompose_expr_to_operation(arglist->children[i]);
+              decompose_expr_to_operation(ast_child(arglist, i));
           if (arg_op)
             cfg_operation_add_operand(op, arg_op);
         }
@@ -296,29 +337,27 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
     }
 
     return op;
-  } else if (strcmp(label, "new") == 0 && expr->numChildren >= 1) {
+  }
+  case AST_NEW: {
+    if (expr->numChildren < 1)
+      break;
     /* Object instantiation: new Class(args...) */
-    ASTNode *class_id = expr->children[0];
-    ASTNode *args_node = expr->numChildren > 1 ? expr->children[1] : NULL;
+    ASTNode *class_id = ast_child(expr, 0);
+    ASTNode *args_node = expr->numChildren > 1 ? ast_child(expr, 1) : NULL;
 
-    char *class_name = NULL;
-    if (class_id && class_id->label) {
-      class_name = extract_token_value(class_id->label);
-    } else {
-      class_name = dup_cstr("?");
-    }
+    char *class_name = token_value(class_id);
 
     CFGOperation *op = cfg_operation_create(CFG_OP_NEW, class_name, expr);
     free(class_name);
 
     /* Add arguments as operands */
-    if (args_node && strcmp(args_node->label, "args") == 0 &&
+    if (args_node && args_node->kind == AST_ARGS &&
         args_node->numChildren > 0) {
-      ASTNode *arglist = args_node->children[0];
-      if (arglist && strcmp(arglist->label, "list") == 0) {
+      ASTNode *arglist = ast_child(args_node, 0);
+      if (arglist && arglist->kind == AST_LIST) {
         for (int i = 0; i < arglist->numChildren; i++) {
           CFGOperation *arg_op =
-              decompose_expr_to_operation(arglist->children[i]);
+              decompose_expr_to_operation(ast_child(arglist, i));
           if (arg_op)
             cfg_operation_add_operand(op, arg_op);
         }
@@ -326,28 +365,41 @@ static CFGOperation *decompose_expr_to_operation(ASTNode *expr) {
     }
 
     return op;
-  } else if (label && strncmp(label, "id:", 3) == 0) {
+  }
+  case AST_ID: {
     /* Identifier */
-    char *name = extract_token_value(label);
+    char *name = token_value(expr);
     CFGOperation *op = cfg_operation_create(CFG_OP_VAR, name, expr);
     free(name);
     return op;
-  } else if (label && (strncmp(label, "bool:", 5) == 0 ||
-                       strncmp(label, "string:", 7) == 0 ||
-                       strncmp(label, "char:", 5) == 0 ||
-                       strncmp(label, "hex:", 4) == 0 ||
-                       strncmp(label, "bits:", 5) == 0 ||
-                       strncmp(label, "dec:", 4) == 0)) {
+  }
+  case AST_BOOL:
+  case AST_STRING:
+  case AST_CHAR:
+  case AST_HEX:
+  case AST_BITS:
+  case AST_DEC: {
     /* Literal */
-    char *value = extract_token_value(label);
+    char *value = token_value(expr);
     CFGOperation *op = cfg_operation_create(CFG_OP_LITERAL, value, expr);
     free(value);
     return op;
   }
+  default:
+    break;
+  }
 
   /* Default: treat as variable or unknown */
-  return cfg_operation_create(CFG_OP_VAR,
-                              label ? dup_cstr(label) : dup_cstr("?"), expr);
+  return cfg_operation_create(CFG_OP_VAR, ast_kind_name(expr->kind), expr);
+}
+
+/* Condition of an if / loop: the expression is its single operand */
+static CFGOperation *cond_operation(ASTNode *condition) {
+  CFGOperation *op = cfg_operation_create(CFG_OP_COND, "cond", condition);
+  CFGOperation *expr_op = decompose_expr_to_operation(condition);
+  if (op && expr_op)
+    cfg_operation_add_operand(op, expr_op);
+  return op;
 }
 
 /* ============================================================================
@@ -359,6 +411,7 @@ static CFGNode *cfg_node_create(int id, int is_entry, int is_exit) {
   CFGNode *node = (CFGNode *)calloc(1, sizeof(CFGNode));
   if (!node)
     return NULL;
+  mem_note_alloc(MEM_CFG_NODES, sizeof(CFGNode));
   node->id = id;
   node->is_entry = is_entry;
   node->is_exit = is_exit;
@@ -381,6 +434,8 @@ static void cfg_node_add_operation(CFGNode *node, CFGOperation *op) {
         node->operations, (size_t)newcap * sizeof(CFGOperation *));
     if (!no)
       return;
+    mem_note_resize(MEM_CFG_NODES, (size_t)node->operations_capacity * sizeof(CFGOperation *),
+                    (size_t)newcap * sizeof(CFGOperation *));
     node->operations = no;
     node->operations_capacity = newcap;
   }
@@ -395,8 +450,10 @@ static void cfg_node_free(CFGNode *node) {
       cfg_operation_free(node->operations[i]);
     }
     free(node->operations);
+    mem_note_resize(MEM_CFG_NODES, (size_t)node->operations_capacity * sizeof(CFGOperation *), 0);
   }
   free(node);
+  mem_note_free(MEM_CFG_NODES, sizeof(CFGNode));
 }
 
 /* ============================================================================
@@ -408,7 +465,7 @@ static CFGFunction *cfg_function_create(const char *name) {
   CFGFunction *func = (CFGFunction *)calloc(1, sizeof(CFGFunction));
   if (!func)
     return NULL;
-  func->name = dup_cstr(name);
+  func->name = intern_cstr(name);
   func->return_type = NULL;
   func->parameters = NULL;
   func->num_parameters = 0;
@@ -431,9 +488,12 @@ static void cfg_function_add_node(CFGFunction *func, CFGNode *node) {
                                        (size_t)newcap * sizeof(CFGNode *));
     if (!nn)
       return;
+    mem_note_resize(MEM_CFG_NODES, (size_t)func->nodes_capacity * sizeof(CFGNode *),
+                    (size_t)newcap * sizeof(CFGNode *));
     func->all_nodes = nn;
     func->nodes_capacity = newcap;
   }
+  node->index = func->num_nodes;
   func->all_nodes[func->num_nodes++] = node;
 }
 
@@ -456,10 +516,111 @@ static void cfg_function_add_parameter(CFGFunction *func, const char *name,
   func->num_parameters++;
 }
 
+/* ============================================================================
+ * DENSE GRAPH - CSR adjacency and DFS orders over node indices
+ * ============================================================================
+ */
+
+/* succ_start, pred_start: n + 1; succ, pred: m; rpo, postorder, rpo_index: n */
+static size_t graph_ints(int n, int m) {
+  return 2 * ((size_t)n + 1) + 2 * (size_t)m + 3 * (size_t)n;
+}
+
+/* Distinct successors of a node: true, false, then unconditional */
+static int node_successors(const CFGNode *node, CFGNode *out[3]) {
+  CFGNode *cand[3] = {node->successor_true, node->successor_false,
+                      node->successor};
+  int n = 0;
+  for (int k = 0; k < 3; k++) {
+    int dup = !cand[k];
+    for (int j = 0; j < n && !dup; j++)
+      dup = out[j] == cand[k];
+    if (!dup)
+      out[n++] = cand[k];
+  }
+  return n;
+}
+
+/* Build succ/pred in CSR form and the DFS orders from entry. Called once
+   the function's CFG is complete; the pointer edges stay authoritative. */
+static int cfg_function_build_graph(CFGFunction *func) {
+  int n = func->num_nodes;
+  CFGNode *out[3];
+  int m = 0;
+  for (int i = 0; i < n; i++)
+    m += node_successors(func->all_nodes[i], out);
+
+  int *block = (int *)malloc(graph_ints(n, m) * sizeof(int));
+  if (!block)
+    return -1;
+  mem_note_alloc(MEM_CFG_NODES, graph_ints(n, m) * sizeof(int));
+  func->graph_block = block;
+  func->num_edges = m;
+  func->succ_start = block;
+  func->succ = func->succ_start + n + 1;
+  func->pred_start = func->succ + m;
+  func->pred = func->pred_start + n + 1;
+  func->rpo = func->pred + m;
+  func->postorder = func->rpo + n;
+  func->rpo_index = func->postorder + n;
+
+  int e = 0;
+  for (int i = 0; i < n; i++) {
+    func->succ_start[i] = e;
+    int k = node_successors(func->all_nodes[i], out);
+    for (int j = 0; j < k; j++)
+      func->succ[e++] = out[j]->index;
+  }
+  func->succ_start[n] = e;
+
+  /* Predecessors: count, prefix sums, then fill (rpo_index is the cursor) */
+  memset(func->pred_start, 0, ((size_t)n + 1) * sizeof(int));
+  for (e = 0; e < m; e++)
+    func->pred_start[func->succ[e] + 1]++;
+  for (int i = 0; i < n; i++)
+    func->pred_start[i + 1] += func->pred_start[i];
+  memcpy(func->rpo_index, func->pred_start, (size_t)n * sizeof(int));
+  for (int i = 0; i < n; i++)
+    for (e = func->succ_start[i]; e < func->succ_start[i + 1]; e++)
+      func->pred[func->rpo_index[func->succ[e]]++] = i;
+
+  /* Iterative DFS: rpo is the stack, rpo_index the next-edge cursor
+     (-1 = not visited yet) */
+  for (int i = 0; i < n; i++)
+    func->rpo_index[i] = -1;
+  int sp = 0, np = 0;
+  if (func->entry) {
+    int s = func->entry->index;
+    func->rpo[sp++] = s;
+    func->rpo_index[s] = func->succ_start[s];
+  }
+  while (sp > 0) {
+    int v = func->rpo[sp - 1];
+    if (func->rpo_index[v] < func->succ_start[v + 1]) {
+      int w = func->succ[func->rpo_index[v]++];
+      if (func->rpo_index[w] < 0) {
+        func->rpo_index[w] = func->succ_start[w];
+        func->rpo[sp++] = w;
+      }
+    } else {
+      func->postorder[np++] = v;
+      sp--;
+    }
+  }
+  func->num_reachable = np;
+
+  for (int i = 0; i < n; i++)
+    func->rpo_index[i] = -1;
+  for (int k = 0; k < np; k++) {
+    func->rpo[k] = func->postorder[np - 1 - k];
+    func->rpo_index[func->rpo[k]] = k;
+  }
+  return 0;
+}
+
 static void cfg_function_free(CFGFunction *func) {
   if (!func)
     return;
-  free(func->name);
   free(func->return_type);
   if (func->parameters) {
     for (int i = 0; i < func->num_parameters; i++) {
@@ -469,61 +630,62 @@ static void cfg_function_free(CFGFunction *func) {
     free(func->parameters);
   }
   free(func->source_file);
+  cfg_dom_tree_free(&func->dom);
+  cfg_dom_tree_free(&func->postdom);
+  if (func->graph_block) {
+    free(func->graph_block);
+    mem_note_free(MEM_CFG_NODES, graph_ints(func->num_nodes, func->num_edges) * sizeof(int));
+  }
   if (func->all_nodes) {
     for (int i = 0; i < func->num_nodes; i++) {
       cfg_node_free(func->all_nodes[i]);
     }
     free(func->all_nodes);
+    mem_note_resize(MEM_CFG_NODES, (size_t)func->nodes_capacity * sizeof(CFGNode *), 0);
   }
   free(func);
 }
 
 /* Extract function name from AST */
 static char *extract_func_name(ASTNode *func_def) {
-  if (!func_def || strcmp(func_def->label, "funcDef") != 0)
+  if (!func_def || func_def->kind != AST_FUNC_DEF)
     return NULL;
   if (func_def->numChildren < 1)
     return NULL;
-  ASTNode *sig = func_def->children[0];
-  if (!sig || strcmp(sig->label, "signature") != 0)
+  ASTNode *sig = ast_child(func_def, 0);
+  if (!sig || sig->kind != AST_SIGNATURE)
     return NULL;
   if (sig->numChildren < 2)
     return NULL;
-  ASTNode *id_node = sig->children[1];
-  if (!id_node || !id_node->label)
+  ASTNode *id_node = ast_child(sig, 1);
+  if (!id_node)
     return NULL;
 
-  const char *colon = strchr(id_node->label, ':');
-  if (colon)
-    return dup_cstr(colon + 1);
-  return dup_cstr(id_node->label);
+  return token_value(id_node);
 }
 
 /* Extract type from AST typeRef */
 static char *extract_type(ASTNode *type_node) {
-  if (!type_node || !type_node->label)
+  if (!type_node)
     return dup_cstr("void");
 
-  const char *colon = strchr(type_node->label, ':');
-  if (colon)
-    return dup_cstr(colon + 1);
-  return dup_cstr(type_node->label);
+  return token_value(type_node);
 }
 
 /* Extract function signature from AST */
 static void extract_signature(CFGFunction *func, ASTNode *func_def) {
-  if (!func || !func_def || strcmp(func_def->label, "funcDef") != 0)
+  if (!func || !func_def || func_def->kind != AST_FUNC_DEF)
     return;
   if (func_def->numChildren < 1)
     return;
 
-  ASTNode *sig = func_def->children[0];
-  if (!sig || strcmp(sig->label, "signature") != 0)
+  ASTNode *sig = ast_child(func_def, 0);
+  if (!sig || sig->kind != AST_SIGNATURE)
     return;
 
   /* Extract return type */
   if (sig->numChildren > 0) {
-    ASTNode *return_type = sig->children[0];
+    ASTNode *return_type = ast_child(sig, 0);
     if (return_type) {
       func->return_type = extract_type(return_type);
     }
@@ -531,23 +693,22 @@ static void extract_signature(CFGFunction *func, ASTNode *func_def) {
 
   /* Extract parameters */
   if (sig->numChildren > 2) {
-    ASTNode *args_node = sig->children[2];
-    if (args_node && strcmp(args_node->label, "args") == 0 &&
+    ASTNode *args_node = ast_child(sig, 2);
+    if (args_node && args_node->kind == AST_ARGS &&
         args_node->numChildren > 0) {
-      ASTNode *arglist = args_node->children[0];
-      if (arglist && strcmp(arglist->label, "arglist") == 0) {
+      ASTNode *arglist = ast_child(args_node, 0);
+      if (arglist && arglist->kind == AST_ARGLIST) {
         for (int i = 0; i < arglist->numChildren; i++) {
-          ASTNode *arg = arglist->children[i];
-          if (arg && strcmp(arg->label, "arg") == 0 && arg->numChildren >= 2) {
-            ASTNode *arg_type = arg->children[0];
-            ASTNode *arg_id = arg->children[1];
+          ASTNode *arg = ast_child(arglist, i);
+          if (arg && arg->kind == AST_ARG && arg->numChildren >= 2) {
+            ASTNode *arg_type = ast_child(arg, 0);
+            ASTNode *arg_id = ast_child(arg, 1);
 
             char *param_type = extract_type(arg_type);
             char *param_name = NULL;
 
-            if (arg_id && arg_id->label) {
-              const char *colon = strchr(arg_id->label, ':');
-              param_name = dup_cstr(colon ? colon + 1 : arg_id->label);
+            if (arg_id) {
+              param_name = token_value(arg_id);
             }
 
             if (param_name) {
@@ -650,9 +811,60 @@ static CallGraph *call_graph_create(void) {
   cg->edges = NULL;
   cg->num_edges = 0;
   cg->edges_capacity = 0;
+  cg->edge_slots = NULL;
+  cg->slots_capacity = 0;
   return cg;
 }
 
+/* Both halves of the key are stable pointers (the caller and an interned
+   name): combine, then mix as symmap does (fmix64) */
+static uint32_t edge_hash(const CFGFunction *caller, const char *callee_name) {
+  uint64_t h = (uint64_t)(uintptr_t)caller * 0x9e3779b97f4a7c15ull;
+  h ^= (uint64_t)(uintptr_t)callee_name;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
+
+/* Index of the caller -> callee_name edge, or -1 */
+static int call_graph_find_edge(const CallGraph *cg, const CFGFunction *caller,
+                                const char *callee_name) {
+  if (cg->slots_capacity == 0)
+    return -1;
+  uint32_t mask = cg->slots_capacity - 1;
+  for (uint32_t j = edge_hash(caller, callee_name) & mask;; j = (j + 1) & mask) {
+    int e = cg->edge_slots[j] - 1;
+    if (e < 0)
+      return -1;
+    if (cg->edges[e].caller == caller && cg->edges[e].callee_name == callee_name)
+      return e;
+  }
+}
+
+static void call_graph_insert_slot(int *slots, uint32_t cap, const CallGraphEdge *edge,
+                                   int index) {
+  uint32_t j = edge_hash(edge->caller, edge->callee_name) & (cap - 1);
+  while (slots[j])
+    j = (j + 1) & (cap - 1);
+  slots[j] = index + 1;
+}
+
+static int call_graph_grow_slots(CallGraph *cg) {
+  uint32_t ncap = cg->slots_capacity ? cg->slots_capacity * 2 : 64;
+  int *ns = (int *)calloc(ncap, sizeof(int));
+  if (!ns)
+    return -1;
+  for (int i = 0; i < cg->num_edges; i++)
+    call_graph_insert_slot(ns, ncap, &cg->edges[i], i);
+  mem_note_resize(MEM_CFG_NODES, (size_t)cg->slots_capacity * sizeof(int),
+                  (size_t)ncap * sizeof(int));
+  free(cg->edge_slots);
+  cg->edge_slots = ns;
+  cg->slots_capacity = ncap;
+  return 0;
+}
+
 static void call_graph_add_edge(CallGraph *cg, CFGFunction *caller,
                                 CFGFunction *callee, const char *callee_name) {
   if (!cg || !caller)
@@ -666,35 +878,43 @@ static void call_graph_add_edge(CallGraph *cg, CFGFunction *caller,
     cg->edges = ne;
     cg->edges_capacity = newcap;
   }
+  if ((uint32_t)(cg->num_edges + 1) * 2 > cg->slots_capacity &&
+      call_graph_grow_slots(cg) != 0)
+    return;
   cg->edges[cg->num_edges].caller = caller;
   cg->edges[cg->num_edges].callee = callee;
-  cg->edges[cg->num_edges].callee_name =
-      callee_name ? dup_cstr(callee_name) : NULL;
+  cg->edges[cg->num_edges].callee_name = callee_name;
+  call_graph_insert_slot(cg->edge_slots, cg->slots_capacity,
+                         &cg->edges[cg->num_edges], cg->num_edges);
   cg->num_edges++;
 }
 
 static void call_graph_free(CallGraph *cg) {
   if (!cg)
     return;
-  if (cg->edges) {
-    for (int i = 0; i < cg->num_edges; i++) {
-      free(cg->edges[i].callee_name);
-    }
-    free(cg->edges);
-  }
+  if (cg->edge_slots)
+    mem_note_resize(MEM_CFG_NODES, (size_t)cg->slots_capacity * sizeof(int), 0);
+  free(cg->edges);
+  free(cg->edge_slots);
   free(cg);
 }
 
-/* Extract function name from call operation */
-static char *extract_callee_name(CFGOperation *call_op) {
+/* Extract function name from call operation (interned, do not free) */
+static const char *extract_callee_name(CFGOperation *call_op) {
   if (!call_op || call_op->kind != CFG_OP_CALL || call_op->num_operands < 1)
     return NULL;
   CFGOperation *name_op = call_op->operands[0];
   if (name_op && name_op->op_name)
-    return dup_cstr(name_op->op_name);
+    return intern_cstr(name_op->op_name);
   return NULL;
 }
 
+/* Lookup by interned name: the first function with that name */
+static CFGFunction *find_function_sym(CFGProgram *prog, const char *sym) {
+  int i = symmap_get(&prog->function_index, sym);
+  return i >= 0 ? prog->all_functions[i] : NULL;
+}
+
 /* ============================================================================
  * CFG PROGRAM IMPLEMENTATION
  * ============================================================================
@@ -710,6 +930,7 @@ CFGProgram *cfg_prog_create(void) {
   prog->all_functions = NULL;
   prog->num_all_functions = 0;
   prog->all_functions_capacity = 0;
+  symmap_init(&prog->function_index, MEM_CFG_NODES);
   prog->call_graph = call_graph_create();
   prog->errors = NULL;
   prog->num_errors = 0;
@@ -731,6 +952,7 @@ void cfg_prog_free(CFGProgram *prog) {
   if (prog->all_functions) {
     free(prog->all_functions);
   }
+  symmap_free(&prog->function_index);
   if (prog->call_graph) {
     call_graph_free(prog->call_graph);
   }
@@ -800,6 +1022,8 @@ static void cfg_prog_add_function(CFGProgram *prog, CFGFunction *func) {
     prog->all_functions = nf;
     prog->all_functions_capacity = newcap;
   }
+  if (func->name && symmap_get(&prog->function_index, func->name) < 0)
+    symmap_put(&prog->function_index, func->name, prog->num_all_functions);
   prog->all_functions[prog->num_all_functions++] = func;
 }
 
@@ -809,7 +1033,7 @@ static void find_functions(ASTNode *node, ASTNode ***funcs, int *count,
   if (!node)
     return;
 
-  if (strcmp(node->label, "funcDef") == 0) {
+  if (node->kind == AST_FUNC_DEF) {
     if (*count == *capacity) {
       int newcap = *capacity == 0 ? 4 : *capacity * 2;
       ASTNode **nf =
@@ -824,7 +1048,7 @@ static void find_functions(ASTNode *node, ASTNode ***funcs, int *count,
     }
   } else {
     for (int i = 0; i < node->numChildren; i++) {
-      find_functions(node->children[i], funcs, count, capacity);
+      find_functions(ast_child(node, i), funcs, count, capacity);
     }
   }
 }
@@ -847,9 +1071,9 @@ static CFGNode *build_cfg_from_statements(CFGProgram *prog, CFGFunction *func,
   if (!stmt_list || !current)
     return current;
 
-  if (strcmp(stmt_list->label, "stmts") == 0) {
+  if (stmt_list->kind == AST_STMTS) {
     for (int i = 0; i < stmt_list->numChildren; i++) {
-      ASTNode *stmt = stmt_list->children[i];
+      ASTNode *stmt = ast_child(stmt_list, i);
       current = build_cfg_from_statement(prog, func, stmt, current, loop_ctx);
     }
   }
@@ -857,141 +1081,134 @@ static CFGNode *build_cfg_from_statements(CFGProgram *prog, CFGFunction *func,
   return current;
 }
 
+/* 1 if the node already has its outgoing edges: return / break, or an if
+   whose branches all leave. Statements after it are unreachable. */
+static int cfg_node_ends_flow(const CFGNode *node) {
+  return node->successor || node->successor_true || node->successor_false;
+}
+
+/* current falls through to next, unless control never gets past it */
+static void cfg_link(CFGNode *current, CFGNode *next) {
+  if (current && !cfg_node_ends_flow(current))
+    current->successor = next;
+}
+
+/* Build a branch of an if / the body of a while hanging off `from` (a
+   condition node): returns the first node of the branch, NULL if it is
+   empty; *end gets the last one. from->successor is only borrowed for
+   the link and cleared again. */
+static CFGNode *build_cfg_branch(CFGProgram *prog, CFGFunction *func,
+                                 ASTNode *stmt, CFGNode *from,
+                                 LoopContext *loop_ctx, CFGNode **end) {
+  CFGNode *last = build_cfg_from_statement(prog, func, stmt, from, loop_ctx);
+  CFGNode *first = from->successor;
+  from->successor = NULL;
+  *end = first ? last : NULL;
+  return first;
+}
+
 /* Build CFG from a single statement */
 static CFGNode *build_cfg_from_statement(CFGProgram *prog, CFGFunction *func,
                                          ASTNode *stmt, CFGNode *current,
                                          LoopContext *loop_ctx) {
-  if (!stmt || !current || !stmt->label)
+  if (!stmt || !current)
     return current;
 
-  const char *label = stmt->label;
-
-  if (strcmp(label, "if") == 0) {
+  switch (stmt->kind) {
+  case AST_IF: {
     /* if (expr) statement optElse */
     if (stmt->numChildren < 2)
       return current;
 
-    ASTNode *condition = stmt->children[0];
-    ASTNode *then_stmt = stmt->children[1];
-    ASTNode *else_node = stmt->numChildren > 2 ? stmt->children[2] : NULL;
+    ASTNode *condition = ast_child(stmt, 0);
+    ASTNode *then_stmt = ast_child(stmt, 1);
+    ASTNode *else_node = stmt->numChildren > 2 ? ast_child(stmt, 2) : NULL;
 
     /* Create condition node */
     CFGNode *cond_node = cfg_node_create(prog->next_node_id++, 0, 0);
     cfg_function_add_node(func, cond_node);
 
-    /* Decompose condition into operations */
-    CFGOperation *cond_op = decompose_expr_to_operation(condition);
-    if (cond_op) {
-      cond_op->kind = CFG_OP_COND;
-      cfg_node_add_operation(cond_node, cond_op);
-    }
+    /* Condition: COND wrapping the decomposed expression */
+    cfg_node_add_operation(cond_node, cond_operation(condition));
 
     /* Link current to condition */
-    current->successor = cond_node;
-
-    /* Build then branch */
-    CFGNode *then_end =
-        build_cfg_from_statement(prog, func, then_stmt, cond_node, loop_ctx);
-
-    /* Check if then branch ends with exit */
-    int then_exits = (then_end == func->exit ||
-                      (then_end && then_end->successor == func->exit));
-
-    /* Build else branch if present */
-    CFGNode *else_end = NULL;
-    int else_exits = 0;
-    if (else_node && strcmp(else_node->label, "else") == 0 &&
-        else_node->numChildren > 0) {
-      ASTNode *else_stmt = else_node->children[0];
-      else_end =
-          build_cfg_from_statement(prog, func, else_stmt, cond_node, loop_ctx);
-      else_exits = (else_end == func->exit ||
-                    (else_end && else_end->successor == func->exit));
-    }
-
-    /* Create merge node if needed */
-    if (!then_exits || !else_exits) {
-      CFGNode *merge_node = cfg_node_create(prog->next_node_id++, 0, 0);
+    cfg_link(current, cond_node);
+
+    /* Build both branches; an empty one goes straight to the merge */
+    CFGNode *then_end = NULL, *else_end = NULL;
+    CFGNode *then_first = build_cfg_branch(prog, func, then_stmt, cond_node,
+                                           loop_ctx, &then_end);
+    CFGNode *else_first = NULL;
+    if (else_node && else_node->kind == AST_ELSE &&
+        else_node->numChildren > 0)
+      else_first = build_cfg_branch(prog, func, ast_child(else_node, 0),
+                                    cond_node, loop_ctx, &else_end);
+
+    /* Merge node unless both branches end in return / break */
+    int then_falls = !then_first || !cfg_node_ends_flow(then_end);
+    int else_falls = !else_first || !cfg_node_ends_flow(else_end);
+    CFGNode *merge_node = NULL;
+    if (then_falls || else_falls) {
+      merge_node = cfg_node_create(prog->next_node_id++, 0, 0);
       cfg_function_add_node(func, merge_node);
-
-      if (!then_exits && then_end && then_end != func->exit) {
-        then_end->successor = merge_node;
-      }
-      if (else_end && !else_exits && else_end != func->exit) {
-        else_end->successor = merge_node;
-      } else if (!else_end) {
-        /* No else: false branch goes to merge */
-        cond_node->successor_false = merge_node;
-      }
-
-      /* Set true/false edges from condition */
-      cond_node->successor_true = then_end ? then_end : merge_node;
-      if (!else_end && !else_exits) {
-        cond_node->successor_false = merge_node;
-      }
-
-      return merge_node;
-    } else {
-      /* Both branches exit */
-      cond_node->successor_true = then_end ? then_end : func->exit;
-      if (else_end) {
-        cond_node->successor_false = else_end;
-      } else {
-        cond_node->successor_false = func->exit;
-      }
-      return cond_node;
+      if (then_first)
+        cfg_link(then_end, merge_node);
+      if (else_first)
+        cfg_link(else_end, merge_node);
     }
 
-  } else if (strcmp(label, "while") == 0) {
+    cond_node->successor_true = then_first ? then_first : merge_node;
+    cond_node->successor_false = else_first ? else_first : merge_node;
+
+    return merge_node ? merge_node : cond_node;
+  }
+  case AST_WHILE: {
     /* while (expr) statement */
     if (stmt->numChildren < 2)
       return current;
 
-    ASTNode *condition = stmt->children[0];
-    ASTNode *body = stmt->children[1];
+    ASTNode *condition = ast_child(stmt, 0);
+    ASTNode *body = ast_child(stmt, 1);
 
     /* Create loop header (condition node) */
     CFGNode *loop_header = cfg_node_create(prog->next_node_id++, 0, 0);
     cfg_function_add_node(func, loop_header);
 
-    /* Decompose condition */
-    CFGOperation *cond_op = decompose_expr_to_operation(condition);
-    if (cond_op) {
-      cond_op->kind = CFG_OP_COND;
-      cfg_node_add_operation(loop_header, cond_op);
-    }
+    /* Condition: COND wrapping the decomposed expression */
+    cfg_node_add_operation(loop_header, cond_operation(condition));
 
     /* Link current to loop header */
-    current->successor = loop_header;
+    cfg_link(current, loop_header);
 
     /* Create exit node for break */
     CFGNode *loop_exit = cfg_node_create(prog->next_node_id++, 0, 0);
     cfg_function_add_node(func, loop_exit);
 
-    /* Build body with loop context */
+    /* Build body with loop context; its end loops back to the header */
     LoopContext body_ctx = {loop_exit, loop_ctx ? loop_ctx->depth + 1 : 1};
-    CFGNode *body_end =
-        build_cfg_from_statement(prog, func, body, loop_header, &body_ctx);
-
-    /* Back edge from body to loop header */
-    if (body_end && body_end != func->exit &&
-        body_end->successor != func->exit) {
-      body_end->successor = loop_header;
-    }
+    CFGNode *body_end = NULL;
+    CFGNode *body_first = build_cfg_branch(prog, func, body, loop_header,
+                                           &body_ctx, &body_end);
+    if (body_first)
+      cfg_link(body_end, loop_header);
 
-    /* False edge from condition to exit */
+    loop_header->successor_true = body_first ? body_first : loop_header;
     loop_header->successor_false = loop_exit;
-    loop_header->successor_true = body_end ? body_end : loop_header;
 
     return loop_exit;
-
-  } else if (strcmp(label, "doWhile") == 0) {
+  }
+  case AST_DO_WHILE: {
     /* do statementBlock while (expr) */
     if (stmt->numChildren < 2)
       return current;
 
-    ASTNode *body = stmt->children[0];
-    ASTNode *condition = stmt->children[1];
+    ASTNode *body = ast_child(stmt, 0);
+    ASTNode *condition = ast_child(stmt, 1);
+
+    /* Empty head block: the target of the back edge */
+    CFGNode *loop_head = cfg_node_create(prog->next_node_id++, 0, 0);
+    cfg_function_add_node(func, loop_head);
+    cfg_link(current, loop_head);
 
     /* Create loop exit node */
     CFGNode *loop_exit = cfg_node_create(prog->next_node_id++, 0, 0);
@@ -1000,33 +1217,26 @@ static CFGNode *build_cfg_from_statement(CFGProgram *prog, CFGFunction *func,
     /* Build body first */
     LoopContext body_ctx = {loop_exit, loop_ctx ? loop_ctx->depth + 1 : 1};
     CFGNode *body_end =
-        build_cfg_from_statement(prog, func, body, current, &body_ctx);
+        build_cfg_from_statement(prog, func, body, loop_head, &body_ctx);
 
     /* Create condition node */
     CFGNode *cond_node = cfg_node_create(prog->next_node_id++, 0, 0);
     cfg_function_add_node(func, cond_node);
 
-    /* Decompose condition */
-    CFGOperation *cond_op = decompose_expr_to_operation(condition);
-    if (cond_op) {
-      cond_op->kind = CFG_OP_COND;
-      cfg_node_add_operation(cond_node, cond_op);
-    }
+    /* Condition: COND wrapping the decomposed expression */
+    cfg_node_add_operation(cond_node, cond_operation(condition));
 
     /* Link body to condition */
-    if (body_end && body_end != func->exit &&
-        body_end->successor != func->exit) {
-      body_end->successor = cond_node;
-    }
+    cfg_link(body_end, cond_node);
 
-    /* True edge: back to body start (current) */
-    cond_node->successor_true = current;
+    /* True edge: back to the head */
+    cond_node->successor_true = loop_head;
     /* False edge: to loop exit */
     cond_node->successor_false = loop_exit;
 
     return loop_exit;
-
-  } else if (strcmp(label, "break") == 0) {
+  }
+  case AST_BREAK: {
     /* break; */
     if (!loop_ctx || !loop_ctx->loop_exit) {
       cfg_prog_add_error(prog, CFG_ERR_BREAK_OUTSIDE_LOOP,
@@ -1041,12 +1251,12 @@ static CFGNode *build_cfg_from_statement(CFGProgram *prog, CFGFunction *func,
     CFGOperation *break_op = cfg_operation_create(CFG_OP_BREAK, "break", stmt);
     cfg_node_add_operation(break_node, break_op);
 
-    current->successor = break_node;
+    cfg_link(current, break_node);
     break_node->successor = loop_ctx->loop_exit;
 
     return break_node;
-
-  } else if (strcmp(label, "return") == 0) {
+  }
+  case AST_RETURN: {
     /* return expr; or return; */
     CFGNode *return_node = cfg_node_create(prog->next_node_id++, 0, 0);
     cfg_function_add_node(func, return_node);
@@ -1055,53 +1265,55 @@ static CFGNode *build_cfg_from_statement(CFGProgram *prog, CFGFunction *func,
         cfg_operation_create(CFG_OP_RETURN, "return", stmt);
     if (stmt->numChildren > 0) {
       /* Has return value */
-      ASTNode *ret_expr = stmt->children[0];
+      ASTNode *ret_expr = ast_child(stmt, 0);
       CFGOperation *ret_val_op = decompose_expr_to_operation(ret_expr);
       if (ret_val_op)
         cfg_operation_add_operand(return_op, ret_val_op);
     }
     cfg_node_add_operation(return_node, return_op);
 
-    current->successor = return_node;
+    cfg_link(current, return_node);
     return_node->successor = func->exit;
 
     return return_node;
-
-  } else if (strcmp(label, "block") == 0) {
+  }
+  case AST_BLOCK: {
     /* { statement* } */
     if (stmt->numChildren > 0) {
-      ASTNode *stmt_list = stmt->children[0];
+      ASTNode *stmt_list = ast_child(stmt, 0);
       return build_cfg_from_statements(prog, func, stmt_list, current,
                                        loop_ctx);
     }
     return current;
-
-  } else if (strcmp(label, "vardecl") == 0) {
+  }
+  case AST_VARDECL: {
     /* typeRef varList; */
     CFGNode *decl_node = cfg_node_create(prog->next_node_id++, 0, 0);
     cfg_function_add_node(func, decl_node);
 
     if (stmt->numChildren >= 2) {
-      ASTNode *var_list = stmt->children[1];
-      if (var_list && strcmp(var_list->label, "vars") == 0) {
+      ASTNode *var_list = ast_child(stmt, 1);
+      if (var_list && var_list->kind == AST_VARS) {
         for (int i = 0; i < var_list->numChildren; i += 2) {
           if (i < var_list->numChildren) {
-            ASTNode *var_id = var_list->children[i];
+            ASTNode *var_id = ast_child(var_list, i);
             ASTNode *opt_assign = i + 1 < var_list->numChildren
-                                      ? var_list->children[i + 1]
+                                      ? ast_child(var_list, i + 1)
                                       : NULL;
 
-            if (var_id && var_id->label) {
-              const char *colon = strchr(var_id->label, ':');
-              char *var_name = dup_cstr(colon ? colon + 1 : var_id->label);
+            if (var_id) {
+              char *var_name = token_value(var_id);
 
               CFGOperation *decl_op =
                   cfg_operation_create(CFG_OP_VARDECL, var_name, stmt);
               free(var_name);
 
-              if (opt_assign && strcmp(opt_assign->label, "assign") == 0 &&
+              /* optAssign или array(N) у T name[N] */
+              if (opt_assign &&
+                  (opt_assign->kind == AST_ASSIGN ||
+                   opt_assign->kind == AST_ARRAY) &&
                   opt_assign->numChildren > 0) {
-                ASTNode *init_expr = opt_assign->children[0];
+                ASTNode *init_expr = ast_child(opt_assign, 0);
                 CFGOperation *init_op = decompose_expr_to_operation(init_expr);
                 if (init_op)
                   cfg_operation_add_operand(decl_op, init_op);
@@ -1114,16 +1326,16 @@ static CFGNode *build_cfg_from_statement(CFGProgram *prog, CFGFunction *func,
       }
     }
 
-    current->successor = decl_node;
+    cfg_link(current, decl_node);
     return decl_node;
-
-  } else if (strcmp(label, "exprstmt") == 0) {
+  }
+  case AST_EXPRSTMT: {
     /* expr; */
     CFGNode *expr_node = cfg_node_create(prog->next_node_id++, 0, 0);
     cfg_function_add_node(func, expr_node);
 
     if (stmt->numChildren > 0) {
-      ASTNode *expr = stmt->children[0];
+      ASTNode *expr = ast_child(stmt, 0);
       CFGOperation *expr_op = decompose_expr_to_operation(expr);
       if (expr_op) {
         cfg_node_add_operation(expr_node, expr_op);
@@ -1133,9 +1345,12 @@ static CFGNode *build_cfg_from_statement(CFGProgram *prog, CFGFunction *func,
       }
     }
 
-    current->successor = expr_node;
+    cfg_link(current, expr_node);
     return expr_node;
   }
+  default:
+    break;
+  }
 
   /* Unknown statement type */
   return current;
@@ -1144,7 +1359,7 @@ static CFGNode *build_cfg_from_statement(CFGProgram *prog, CFGFunction *func,
 /* Build CFG for a function */
 static CFGFunction *build_cfg_for_function(CFGProgram *prog, ASTNode *func_def,
                                            const char *source_file) {
-  if (!func_def || strcmp(func_def->label, "funcDef") != 0)
+  if (!func_def || func_def->kind != AST_FUNC_DEF)
     return NULL;
 
   char *func_name = extract_func_name(func_def);
@@ -1175,23 +1390,20 @@ static CFGFunction *build_cfg_for_function(CFGProgram *prog, ASTNode *func_def,
     return func;
   }
 
-  ASTNode *body = func_def->children[1];
-  if (!body || strcmp(body->label, "block") != 0) {
+  ASTNode *body = ast_child(func_def, 1);
+  if (!body || body->kind != AST_BLOCK) {
     func->entry->successor = func->exit;
     return func;
   }
 
   /* Build CFG from body */
   LoopContext loop_ctx = {NULL, 0};
-  CFGNode *last = build_cfg_from_statements(prog, func, body->children[0],
+  CFGNode *last = build_cfg_from_statements(prog, func, ast_child(body, 0),
                                             func->entry, &loop_ctx);
 
-  /* Link last node to exit if it doesn't already exit */
-  if (last && last != func->exit && last->successor != func->exit &&
-      !last->successor_true && !last->successor_false) {
-    if (!last->successor)
-      last->successor = func->exit;
-  }
+  /* Falling off the end of the body goes to exit */
+  if (last && last != func->exit)
+    cfg_link(last, func->exit);
 
   return func;
 }
@@ -1252,22 +1464,12 @@ static void extract_call_edges_from_function(CFGProgram *prog,
         continue;
 
       /* Check if this call edge already exists */
-      char *callee_name = extract_callee_name(call_op);
+      const char *callee_name = extract_callee_name(call_op);
       if (!callee_name)
         continue;
 
-      int edge_exists = 0;
-      for (int k = 0; k < prog->call_graph->num_edges; k++) {
-        CallGraphEdge *edge = &prog->call_graph->edges[k];
-        if (edge->caller == func && edge->callee_name &&
-            strcmp(edge->callee_name, callee_name) == 0) {
-          edge_exists = 1;
-          break;
-        }
-      }
-
-      if (!edge_exists) {
-        CFGFunction *callee = cfg_prog_find_function(prog, callee_name);
+      if (call_graph_find_edge(prog->call_graph, func, callee_name) < 0) {
+        CFGFunction *callee = find_function_sym(prog, callee_name);
         call_graph_add_edge(prog->call_graph, func, callee, callee_name);
         if (!callee) {
           cfg_prog_add_error(prog, CFG_ERR_UNKNOWN_FUNCTION,
@@ -1275,8 +1477,6 @@ static void extract_call_edges_from_function(CFGProgram *prog,
                              func->source_file, 0, 0);
         }
       }
-
-      free(callee_name);
     }
 
     if (calls)
@@ -1306,6 +1506,8 @@ int cfg_prog_build(CFGProgram *prog) {
       CFGFunction *func =
           build_cfg_for_function(prog, funcs[i], file->filename);
       if (func) {
+        if (cfg_function_build_graph(func) == 0)
+          cfg_function_build_dominators(func);
         cfg_file_add_function(file, func);
         cfg_prog_add_function(prog, func);
       }
@@ -1344,13 +1546,8 @@ CFGFunction *cfg_prog_get_function(CFGProgram *prog, int index) {
 CFGFunction *cfg_prog_find_function(CFGProgram *prog, const char *name) {
   if (!prog || !name)
     return NULL;
-  for (int i = 0; i < prog->num_all_functions; i++) {
-    if (prog->all_functions[i] && prog->all_functions[i]->name &&
-        strcmp(prog->all_functions[i]->name, name) == 0) {
-      return prog->all_functions[i];
-    }
-  }
-  return NULL;
+  /* interning an already interned name returns the same pointer */
+  return find_function_sym(prog, intern_cstr(name));
 }
 
 int cfg_prog_get_num_errors(CFGProgram *prog) {
@@ -1413,8 +1610,46 @@ CFGNode *cfg_function_get_node(CFGFunction *func, int index) {
   return func->all_nodes[index];
 }
 
+int cfg_function_get_num_succs(CFGFunction *func, int index) {
+  if (!func || !func->graph_block || index < 0 || index >= func->num_nodes)
+    return 0;
+  return func->succ_start[index + 1] - func->succ_start[index];
+}
+
+const int *cfg_function_get_succs(CFGFunction *func, int index) {
+  if (!func || !func->graph_block || index < 0 || index >= func->num_nodes)
+    return NULL;
+  return func->succ + func->succ_start[index];
+}
+
+int cfg_function_get_num_preds(CFGFunction *func, int index) {
+  if (!func || !func->graph_block || index < 0 || index >= func->num_nodes)
+    return 0;
+  return func->pred_start[index + 1] - func->pred_start[index];
+}
+
+const int *cfg_function_get_preds(CFGFunction *func, int index) {
+  if (!func || !func->graph_block || index < 0 || index >= func->num_nodes)
+    return NULL;
+  return func->pred + func->pred_start[index];
+}
+
+int cfg_function_get_num_reachable(CFGFunction *func) {
+  return func ? func->num_reachable : 0;
+}
+
+const int *cfg_function_get_rpo(CFGFunction *func) {
+  return func ? func->rpo : NULL;
+}
+
+const int *cfg_function_get_postorder(CFGFunction *func) {
+  return func ? func->postorder : NULL;
+}
+
 int cfg_node_get_id(CFGNode *node) { return node ? node->id : -1; }
 
+int cfg_node_get_index(CFGNode *node) { return node ? node->index : -1; }
+
 int cfg_node_is_entry(CFGNode *node) { return node ? node->is_entry : 0; }
 
 int cfg_node_is_exit(CFGNode *node) { return node ? node->is_exit : 0; }
@@ -1681,13 +1916,9 @@ void cfg_function_print_dot(FILE *out, CFGFunction *func, CFGProgram *prog) {
 
       /* Check if this is an error operation */
       if (op->kind == CFG_OP_CALL && prog) {
-        char *callee_name = extract_callee_name(op);
-        if (callee_name) {
-          CFGFunction *callee = cfg_prog_find_function(prog, callee_name);
-          if (!callee) {
-            fillcolor = "lightcoral";
-          }
-          free(callee_name);
+        const char *callee_name = extract_callee_name(op);
+        if (callee_name && !find_function_sym(prog, callee_name)) {
+          fillcolor = "lightcoral";
         }
       }
 
@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include "../ast/ast.h"
+#include "../ast/symmap.h"
 
 /* Forward declarations */
 typedef struct CFGProgram CFGProgram;
@@ -13,6 +14,7 @@ typedef struct CFGOperation CFGOperation;
 typedef struct CFGError CFGError;
 typedef struct CallGraph CallGraph;
 typedef struct CallGraphEdge CallGraphEdge;
+typedef struct CFGDomTree CFGDomTree;
 
 /* ============================================================================
  * CFG OPERATION - represents an elementary operation in a basic block
@@ -27,7 +29,7 @@ typedef enum {
     CFG_OP_INDEX,       /* array indexing: base[index] */
     CFG_OP_VAR,         /* variable reference */
     CFG_OP_LITERAL,     /* literal value */
-    CFG_OP_COND,        /* condition evaluation (for if/while) */
+    CFG_OP_COND,        /* condition of if/while: operand 0 is the expression */
     CFG_OP_RETURN,      /* return statement */
     CFG_OP_BREAK,       /* break statement */
     CFG_OP_VARDECL,     /* variable declaration */
@@ -51,6 +53,7 @@ struct CFGOperation {
 
 struct CFGNode {
     int id;                     /* unique numeric id within function */
+    int index;                  /* dense index: position in func->all_nodes */
     int is_entry;               /* 1 if this is the entry block */
     int is_exit;                /* 1 if this is the exit block */
     
@@ -65,12 +68,32 @@ struct CFGNode {
     int operations_capacity;
 };
 
+/* ============================================================================
+ * CFG DOMINATOR TREE - dominators or post-dominators of a function (dom.c)
+ * ============================================================================ */
+
+/* Over dense node indices; nodes not reachable from the root (entry, or
+   exit for post-dominators) have idom -1 and pre/post -1. All arrays live
+   in one allocation (block). */
+struct CFGDomTree {
+    int *idom;                  /* immediate dominator, -1 for the root */
+    int *child_start;           /* tree children: child[child_start[i] ..] */
+    int *child;
+    int *pre;                   /* tree preorder number */
+    int *post;                  /* tree postorder number */
+    int *df_start;              /* dominance frontier: df[df_start[i] ..] */
+    int *df;
+    int num_df;
+    int num_nodes;
+    int *block;
+};
+
 /* ============================================================================
  * CFG FUNCTION - represents a function and its CFG
  * ============================================================================ */
 
 struct CFGFunction {
-    char *name;                 /* function name */
+    const char *name;           /* function name (interned, see intern.h) */
     char *return_type;          /* return type (may be NULL for void) */
     
     /* Parameters */
@@ -89,6 +112,25 @@ struct CFGFunction {
     CFGNode **all_nodes;        /* all basic blocks */
     int num_nodes;
     int nodes_capacity;
+
+    /* Dense graph over node indices (CFGNode.index), filled by
+       cfg_prog_build. Successors of node i are
+       succ[succ_start[i] .. succ_start[i + 1]), predecessors likewise;
+       all arrays live in one allocation (graph_block). */
+    int *succ_start;
+    int *succ;
+    int *pred_start;
+    int *pred;
+    int num_edges;
+    int *rpo;                   /* nodes reachable from entry, reverse postorder */
+    int *postorder;             /* the same nodes in postorder */
+    int num_reachable;
+    int *rpo_index;             /* node -> position in rpo, -1 if unreachable */
+    int *graph_block;
+
+    /* Filled by cfg_prog_build after the dense graph */
+    CFGDomTree dom;             /* dominators, rooted at entry */
+    CFGDomTree postdom;         /* post-dominators, rooted at exit */
 };
 
 /* ============================================================================
@@ -130,13 +172,17 @@ struct CFGError {
 struct CallGraphEdge {
     CFGFunction *caller;        /* calling function */
     CFGFunction *callee;         /* called function (may be NULL if unresolved) */
-    char *callee_name;           /* callee name (for unresolved calls) */
+    const char *callee_name;     /* callee name (interned; for unresolved calls) */
 };
 
 struct CallGraph {
     CallGraphEdge *edges;       /* array of call edges */
     int num_edges;
     int edges_capacity;
+    /* (caller, callee_name) set: open addressing over edge indices
+       (slot holds index + 1, 0 is empty), load <= 1/2 */
+    int *edge_slots;
+    uint32_t slots_capacity;    /* power of two or 0 */
 };
 
 /* ============================================================================
@@ -151,6 +197,7 @@ struct CFGProgram {
     CFGFunction **all_functions; /* all functions across all files */
     int num_all_functions;
     int all_functions_capacity;
+    SymMap function_index;      /* interned name -> first index in all_functions */
     
     CallGraph *call_graph;      /* global call graph */
     
@@ -213,11 +260,54 @@ CFGNode *cfg_function_get_exit(CFGFunction *func);
 int cfg_function_get_num_nodes(CFGFunction *func);
 CFGNode *cfg_function_get_node(CFGFunction *func, int index);
 
+/* Dense graph: node indices are positions in all_nodes (cfg_node_get_index) */
+int cfg_function_get_num_succs(CFGFunction *func, int index);
+const int *cfg_function_get_succs(CFGFunction *func, int index);
+int cfg_function_get_num_preds(CFGFunction *func, int index);
+const int *cfg_function_get_preds(CFGFunction *func, int index);
+int cfg_function_get_num_reachable(CFGFunction *func);
+const int *cfg_function_get_rpo(CFGFunction *func);
+const int *cfg_function_get_postorder(CFGFunction *func);
+
+/* ============================================================================
+ * DOMINATORS - dom.c; node indices as above
+ * ============================================================================ */
+
+/* (Re)compute both trees from the dense graph; 0 on success, -1 on failure.
+   cfg_prog_build calls it for every function. */
+int cfg_function_build_dominators(CFGFunction *func);
+void cfg_dom_tree_free(CFGDomTree *tree);
+
+/* Immediate dominator, -1 for entry and unreachable nodes */
+int cfg_function_get_idom(CFGFunction *func, int index);
+int cfg_function_get_num_dom_children(CFGFunction *func, int index);
+const int *cfg_function_get_dom_children(CFGFunction *func, int index);
+/* 1 if a dominates b (a node dominates itself); O(1) */
+int cfg_function_dominates(CFGFunction *func, int a, int b);
+int cfg_function_get_num_dom_frontier(CFGFunction *func, int index);
+const int *cfg_function_get_dom_frontier(CFGFunction *func, int index);
+
+/* Post-dominators: the same over the reversed graph, rooted at exit.
+   Nodes that never reach exit (infinite loops) have ipdom -1. */
+int cfg_function_get_ipdom(CFGFunction *func, int index);
+int cfg_function_get_num_postdom_children(CFGFunction *func, int index);
+const int *cfg_function_get_postdom_children(CFGFunction *func, int index);
+int cfg_function_postdominates(CFGFunction *func, int a, int b);
+int cfg_function_get_num_postdom_frontier(CFGFunction *func, int index);
+const int *cfg_function_get_postdom_frontier(CFGFunction *func, int index);
+
+/* Compare both trees with a naive iterative solver: idom, dominates and
+   frontiers of every node. Quadratic time and memory, for tests (cfg
+   --check-dom). Prints up to ten mismatches per tree to err (may be
+   NULL) and returns their number. */
+int cfg_function_check_dominators(CFGFunction *func, FILE *err);
+
 /* ============================================================================
  * CFG NODE ACCESSORS
  * ============================================================================ */
 
 int cfg_node_get_id(CFGNode *node);
+int cfg_node_get_index(CFGNode *node);
 int cfg_node_is_entry(CFGNode *node);
 int cfg_node_is_exit(CFGNode *node);
 CFGNode *cfg_node_get_successor(CFGNode *node);
@@ -0,0 +1,278 @@
+#include "dataflow.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "../trace/memstat.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static int bits_ctz(CFGBitWord x) {
+  unsigned long i;
+  _BitScanForward64(&i, x);
+  return (int)i;
+}
+#define bits_popcount(x) ((int)__popcnt64(x))
+#else
+#define bits_ctz(x) __builtin_ctzll(x)
+#define bits_popcount(x) __builtin_popcountll(x)
+#endif
+
+/* ============================================================================
+ * BIT SETS
+ * ============================================================================
+ */
+
+void cfg_bits_set_range(CFGBitWord *s, int lo, int hi) {
+  if (lo >= hi)
+    return;
+  int wlo = lo / CFG_BITS_PER_WORD;
+  int whi = (hi - 1) / CFG_BITS_PER_WORD;
+  CFGBitWord first = ~(CFGBitWord)0 << (lo % CFG_BITS_PER_WORD);
+  CFGBitWord last = ~(CFGBitWord)0 >> (CFG_BITS_PER_WORD - 1 - (hi - 1) % CFG_BITS_PER_WORD);
+  if (wlo == whi) {
+    s[wlo] |= first & last;
+    return;
+  }
+  s[wlo] |= first;
+  for (int w = wlo + 1; w < whi; w++)
+    s[w] = ~(CFGBitWord)0;
+  s[whi] |= last;
+}
+
+int cfg_bits_next(const CFGBitWord *s, int words, int from) {
+  if (from < 0)
+    from = 0;
+  int w = from / CFG_BITS_PER_WORD;
+  if (w >= words)
+    return -1;
+  CFGBitWord cur = s[w] & (~(CFGBitWord)0 << (from % CFG_BITS_PER_WORD));
+  while (cur == 0) {
+    if (++w >= words)
+      return -1;
+    cur = s[w];
+  }
+  return w * CFG_BITS_PER_WORD + bits_ctz(cur);
+}
+
+int cfg_bits_count(const CFGBitWord *s, int words) {
+  int n = 0;
+  for (int w = 0; w < words; w++)
+    n += bits_popcount(s[w]);
+  return n;
+}
+
+/* ============================================================================
+ * DATAFLOW - round-robin worklist over reverse postorder
+ * ============================================================================
+ *
+ * The worklist is a bitset over positions in the visiting order. The
+ * solver sweeps it front to back and starts a new sweep while anything is
+ * pending, so every sweep sees the nodes in (reverse) postorder and an
+ * acyclic region settles in one pass; loops need about one extra sweep
+ * per nesting level.
+ */
+
+/* gen, kill, in, out: n sets; boundary: one; meet_gen: n if requested */
+static size_t df_sets(int n, int with_meet_gen) {
+  return (size_t)(with_meet_gen ? 5 : 4) * (size_t)n + 1;
+}
+
+int cfg_dataflow_init(CFGDataflow *df, CFGFunction *func, CFGDataflowDir dir,
+                      CFGDataflowMeet meet, int num_bits, int with_meet_gen) {
+  memset(df, 0, sizeof(*df));
+  if (!func || !func->graph_block || num_bits < 0)
+    return -1;
+  int n = func->num_nodes;
+  int words = CFG_BITS_WORDS(num_bits);
+  size_t total = df_sets(n, with_meet_gen) * (size_t)words;
+  /* Keep the set pointers distinct even when there are no facts */
+  if (total == 0)
+    total = 1;
+  CFGBitWord *block = (CFGBitWord *)calloc(total, sizeof(CFGBitWord));
+  if (!block)
+    return -1;
+  mem_note_alloc(MEM_DATAFLOW, total * sizeof(CFGBitWord));
+
+  size_t set = (size_t)n * (size_t)words;
+  df->func = func;
+  df->dir = dir;
+  df->meet = meet;
+  df->num_bits = num_bits;
+  df->words = words;
+  df->num_nodes = n;
+  df->block = block;
+  df->gen = block;
+  df->kill = df->gen + set;
+  df->in = df->kill + set;
+  df->out = df->in + set;
+  df->boundary = df->out + set;
+  df->meet_gen = with_meet_gen ? df->boundary + words : NULL;
+  return 0;
+}
+
+void cfg_dataflow_free(CFGDataflow *df) {
+  if (!df || !df->block)
+    return;
+  size_t total = df_sets(df->num_nodes, df->meet_gen != NULL) * (size_t)df->words;
+  free(df->block);
+  mem_note_free(MEM_DATAFLOW, (total ? total : 1) * sizeof(CFGBitWord));
+  memset(df, 0, sizeof(*df));
+}
+
+int cfg_dataflow_solve(CFGDataflow *df) {
+  if (!df || !df->block)
+    return -1;
+  CFGFunction *func = df->func;
+  int n = func->num_reachable;
+  int words = df->words;
+  int forward = df->dir == CFG_DF_FORWARD;
+  int must = df->meet == CFG_DF_INTERSECT;
+  /* Forward: the meet goes into in, the transfer into out; backward the
+     other way round. Neighbours feed the meet, dependents are revisited. */
+  CFGBitWord *meet_sets = forward ? df->in : df->out;
+  CFGBitWord *result_sets = forward ? df->out : df->in;
+  const int *nb_start = forward ? func->pred_start : func->succ_start;
+  const int *nb = forward ? func->pred : func->succ;
+  const int *dep_start = forward ? func->succ_start : func->pred_start;
+  const int *dep = forward ? func->succ : func->pred;
+  const int *order = forward ? func->rpo : func->postorder;
+
+  /* Bits past num_bits stay clear in every set */
+  CFGBitWord last_mask = ~(CFGBitWord)0;
+  if (df->num_bits % CFG_BITS_PER_WORD)
+    last_mask = ((CFGBitWord)1 << (df->num_bits % CFG_BITS_PER_WORD)) - 1;
+
+  size_t set = (size_t)df->num_nodes * (size_t)words;
+  memset(df->in, 0, set * sizeof(CFGBitWord));
+  memset(df->out, 0, set * sizeof(CFGBitWord));
+  /* Must problems start from "everything" and shrink */
+  if (must && words > 0) {
+    for (int k = 0; k < n; k++) {
+      CFGBitWord *r = result_sets + (size_t)order[k] * words;
+      memset(r, 0xff, (size_t)words * sizeof(CFGBitWord));
+      r[words - 1] &= last_mask;
+    }
+  }
+
+  int pending_words = CFG_BITS_WORDS(n);
+  size_t scratch = (size_t)pending_words + (size_t)words;
+  CFGBitWord *pending = (CFGBitWord *)malloc((scratch ? scratch : 1) *
+                                             sizeof(CFGBitWord));
+  if (!pending)
+    return -1;
+  mem_note_alloc(MEM_DATAFLOW, (scratch ? scratch : 1) * sizeof(CFGBitWord));
+  CFGBitWord *x = pending + pending_words;
+  memset(pending, 0, (size_t)pending_words * sizeof(CFGBitWord));
+  for (int k = 0; k < n; k++)
+    cfg_bits_set(pending, k);
+  int num_pending = n;
+  int cursor = 0;
+  df->visits = 0;
+
+  while (num_pending > 0) {
+    int pos = cfg_bits_next(pending, pending_words, cursor);
+    if (pos < 0) {
+      cursor = 0;
+      continue;
+    }
+    cfg_bits_clear(pending, pos);
+    num_pending--;
+    cursor = pos + 1;
+    int b = order[pos];
+    df->visits++;
+
+    /* Meet over the neighbours reachable from entry */
+    int boundary = forward ? b == func->entry->index
+                           : nb_start[b + 1] == nb_start[b];
+    if (boundary) {
+      memcpy(x, df->boundary, (size_t)words * sizeof(CFGBitWord));
+    } else {
+      int first = 1;
+      for (int e = nb_start[b]; e < nb_start[b + 1]; e++) {
+        int p = nb[e];
+        if (func->rpo_index[p] < 0)
+          continue;
+        const CFGBitWord *ps = result_sets + (size_t)p * words;
+        if (first) {
+          memcpy(x, ps, (size_t)words * sizeof(CFGBitWord));
+          first = 0;
+        } else if (must) {
+          for (int w = 0; w < words; w++)
+            x[w] &= ps[w];
+        } else {
+          for (int w = 0; w < words; w++)
+            x[w] |= ps[w];
+        }
+      }
+      if (first)
+        memset(x, 0, (size_t)words * sizeof(CFGBitWord));
+    }
+    if (df->meet_gen) {
+      const CFGBitWord *mg = df->meet_gen + (size_t)b * words;
+      for (int w = 0; w < words; w++)
+        x[w] |= mg[w];
+    }
+    memcpy(meet_sets + (size_t)b * words, x, (size_t)words * sizeof(CFGBitWord));
+
+    /* Transfer: gen | (x & ~kill) */
+    const CFGBitWord *g = df->gen + (size_t)b * words;
+    const CFGBitWord *k = df->kill + (size_t)b * words;
+    CFGBitWord *r = result_sets + (size_t)b * words;
+    CFGBitWord changed = 0;
+    for (int w = 0; w < words; w++) {
+      CFGBitWord v = g[w] | (x[w] & ~k[w]);
+      changed |= v ^ r[w];
+      r[w] = v;
+    }
+    if (!changed)
+      continue;
+
+    for (int e = dep_start[b]; e < dep_start[b + 1]; e++) {
+      int s = dep[e];
+      int sp = func->rpo_index[s];
+      if (sp < 0)
+        continue;
+      if (!forward)
+        sp = n - 1 - sp;
+      if (!cfg_bits_test(pending, sp)) {
+        cfg_bits_set(pending, sp);
+        num_pending++;
+      }
+    }
+  }
+
+  free(pending);
+  mem_note_free(MEM_DATAFLOW, (scratch ? scratch : 1) * sizeof(CFGBitWord));
+  return 0;
+}
+
+/* ============================================================================
+ * ACCESSORS
+ * ============================================================================
+ */
+
+static int df_valid(const CFGDataflow *df, int index) {
+  return df && df->block && index >= 0 && index < df->num_nodes;
+}
+
+CFGBitWord *cfg_dataflow_gen(CFGDataflow *df, int index) {
+  return df_valid(df, index) ? df->gen + (size_t)index * df->words : NULL;
+}
+
+CFGBitWord *cfg_dataflow_kill(CFGDataflow *df, int index) {
+  return df_valid(df, index) ? df->kill + (size_t)index * df->words : NULL;
+}
+
+CFGBitWord *cfg_dataflow_meet_gen(CFGDataflow *df, int index) {
+  if (!df_valid(df, index) || !df->meet_gen)
+    return NULL;
+  return df->meet_gen + (size_t)index * df->words;
+}
+
+const CFGBitWord *cfg_dataflow_in(const CFGDataflow *df, int index) {
+  return df_valid(df, index) ? df->in + (size_t)index * df->words : NULL;
+}
+
+const CFGBitWord *cfg_dataflow_out(const CFGDataflow *df, int index) {
+  return df_valid(df, index) ? df->out + (size_t)index * df->words : NULL;
+}
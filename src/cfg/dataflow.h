@@ -0,0 +1,100 @@
+#ifndef CFG_DATAFLOW_H
+#define CFG_DATAFLOW_H
+
+#include <stdint.h>
+#include "cfg.h"
+
+/* ============================================================================
+ * BIT SETS - dense bitvectors of 64-bit words
+ * ============================================================================ */
+
+typedef uint64_t CFGBitWord;
+
+#define CFG_BITS_PER_WORD 64
+
+/* Words needed for n bits */
+#define CFG_BITS_WORDS(n) (((n) + CFG_BITS_PER_WORD - 1) / CFG_BITS_PER_WORD)
+
+static inline void cfg_bits_set(CFGBitWord *s, int i) {
+  s[i / CFG_BITS_PER_WORD] |= (CFGBitWord)1 << (i % CFG_BITS_PER_WORD);
+}
+
+static inline void cfg_bits_clear(CFGBitWord *s, int i) {
+  s[i / CFG_BITS_PER_WORD] &= ~((CFGBitWord)1 << (i % CFG_BITS_PER_WORD));
+}
+
+static inline int cfg_bits_test(const CFGBitWord *s, int i) {
+  return (int)((s[i / CFG_BITS_PER_WORD] >> (i % CFG_BITS_PER_WORD)) & 1);
+}
+
+/* Set bits lo .. hi - 1, a word at a time */
+void cfg_bits_set_range(CFGBitWord *s, int lo, int hi);
+
+/* First set bit >= from in a set of `words` words, -1 if none */
+int cfg_bits_next(const CFGBitWord *s, int words, int from);
+
+/* Number of set bits */
+int cfg_bits_count(const CFGBitWord *s, int words);
+
+/* ============================================================================
+ * DATAFLOW - worklist solver for gen/kill problems over a CFGFunction
+ * ============================================================================ */
+
+typedef enum {
+    CFG_DF_FORWARD,     /* in = meet(out of preds), out = f(in) */
+    CFG_DF_BACKWARD     /* out = meet(in of succs), in = f(out) */
+} CFGDataflowDir;
+
+typedef enum {
+    CFG_DF_UNION,       /* may: liveness, reaching definitions */
+    CFG_DF_INTERSECT    /* must: available expressions */
+} CFGDataflowMeet;
+
+/* A problem over num_bits facts. The client fills gen and kill of every
+   node (and boundary, meet_gen if it wants them), then calls
+   cfg_dataflow_solve. Transfer of node i: gen | (x & ~kill), where x is
+   the meet over its neighbours, ORed with meet_gen(i) if enabled.
+
+   Boundary nodes (entry for forward problems, nodes without successors for
+   backward ones) take boundary instead of the meet. Only nodes reachable
+   from entry are solved; the others keep empty in/out. Sets of node i are
+   `words` words at gen + i * words, and so on; all arrays live in one
+   allocation (block). */
+typedef struct {
+    CFGFunction *func;          /* borrowed */
+    CFGDataflowDir dir;
+    CFGDataflowMeet meet;
+    int num_bits;
+    int words;                  /* CFG_BITS_WORDS(num_bits) */
+    int num_nodes;
+
+    CFGBitWord *gen;
+    CFGBitWord *kill;
+    CFGBitWord *meet_gen;       /* NULL unless requested at init */
+    CFGBitWord *in;
+    CFGBitWord *out;
+    CFGBitWord *boundary;       /* one set, empty by default */
+
+    int visits;                 /* transfers evaluated by the last solve */
+    CFGBitWord *block;
+} CFGDataflow;
+
+/* Zeroed sets for func (its dense graph must be built); with_meet_gen
+   adds the meet_gen sets. 0 on success, -1 on failure. */
+int cfg_dataflow_init(CFGDataflow *df, CFGFunction *func, CFGDataflowDir dir,
+                      CFGDataflowMeet meet, int num_bits, int with_meet_gen);
+void cfg_dataflow_free(CFGDataflow *df);
+
+/* Iterate to the fixpoint. Nodes are visited in reverse postorder
+   (postorder for backward problems) and only while their input changes.
+   0 on success, -1 on failure. */
+int cfg_dataflow_solve(CFGDataflow *df);
+
+/* Sets of node index */
+CFGBitWord *cfg_dataflow_gen(CFGDataflow *df, int index);
+CFGBitWord *cfg_dataflow_kill(CFGDataflow *df, int index);
+CFGBitWord *cfg_dataflow_meet_gen(CFGDataflow *df, int index);
+const CFGBitWord *cfg_dataflow_in(const CFGDataflow *df, int index);
+const CFGBitWord *cfg_dataflow_out(const CFGDataflow *df, int index);
+
+#endif /* CFG_DATAFLOW_H */
@@ -0,0 +1,498 @@
+#include "cfg.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../trace/memstat.h"
+
+/* ============================================================================
+ * DOMINATORS - Lengauer-Tarjan over the dense CSR graph
+ * ============================================================================
+ *
+ * The same routine builds both trees: dominators walk succ from entry,
+ * post-dominators walk pred from exit. Uses the simple LT variant (path
+ * compression without balancing), O(m log n); the DFS and the compression
+ * are iterative, so deep CFGs do not recurse.
+ */
+
+/* Scratch arrays, all of n ints: LT works on DFS preorder numbers */
+enum {
+  S_DFNUM,    /* node -> preorder number, -1 if unreachable */
+  S_VERTEX,   /* preorder number -> node */
+  S_PARENT,   /* DFS tree parent (numbers) */
+  S_SEMI,     /* semidominator (numbers) */
+  S_LABEL,    /* min-semi vertex on the compressed path */
+  S_ANCESTOR, /* forest link, -1 for roots */
+  S_IDOM,     /* immediate dominator (numbers) */
+  S_BUCKET,   /* head of the bucket list of a vertex, -1 if empty */
+  S_NEXT,     /* next vertex in the same bucket */
+  S_STACK,
+  S_CURSOR,
+  S_COUNT
+};
+
+/* idom n, child_start n + 1, child n, pre n, post n, df_start n + 1, df */
+static size_t dom_ints(int n, int num_df) {
+  return 6 * (size_t)n + 2 + (size_t)num_df;
+}
+
+static void dom_compress(int v, int *ancestor, int *label, const int *semi,
+                         int *stack) {
+  int sp = 0;
+  while (ancestor[ancestor[v]] >= 0) {
+    stack[sp++] = v;
+    v = ancestor[v];
+  }
+  while (sp > 0) {
+    v = stack[--sp];
+    int a = ancestor[v];
+    if (semi[label[a]] < semi[label[v]])
+      label[v] = label[a];
+    ancestor[v] = ancestor[a];
+  }
+}
+
+static int dom_eval(int v, int *ancestor, int *label, const int *semi,
+                    int *stack) {
+  if (ancestor[v] < 0)
+    return v;
+  dom_compress(v, ancestor, label, semi, stack);
+  return label[v];
+}
+
+/* Dominance frontiers (Cooper-Harvey-Kennedy): from each predecessor of a
+   join point b, walk up to idom(b); every node passed has b in its
+   frontier. mark[r] == b skips repeats of the same pair. With out == NULL
+   only counts per node into pos, otherwise stores through the pos cursors. */
+static void dom_frontier_walk(int n, const int *bstart, const int *badj,
+                              const int *dfnum, const int *idom, int *mark,
+                              int *pos, int *out) {
+  for (int i = 0; i < n; i++)
+    mark[i] = -1;
+  for (int b = 0; b < n; b++) {
+    if (dfnum[b] < 0 || bstart[b + 1] - bstart[b] < 2)
+      continue;
+    for (int e = bstart[b]; e < bstart[b + 1]; e++) {
+      int r = badj[e];
+      if (dfnum[r] < 0)
+        continue;
+      while (r >= 0 && r != idom[b] && mark[r] != b) {
+        mark[r] = b;
+        if (out)
+          out[pos[r]++] = b;
+        else
+          pos[r]++;
+        r = idom[r];
+      }
+    }
+  }
+}
+
+/* Build the tree rooted at root: forward edges fstart/fadj drive the DFS,
+   backward edges bstart/badj feed semidominators and frontiers */
+static int dom_tree_build(CFGDomTree *t, int n, int root, const int *fstart,
+                          const int *fadj, const int *bstart,
+                          const int *badj) {
+  memset(t, 0, sizeof(*t));
+  if (n <= 0 || root < 0)
+    return 0;
+
+  size_t scratch_bytes = (size_t)S_COUNT * (size_t)n * sizeof(int);
+  int *scratch = (int *)malloc(scratch_bytes);
+  if (!scratch)
+    return -1;
+  mem_note_alloc(MEM_CFG_NODES, scratch_bytes);
+  int *dfnum = scratch + (size_t)S_DFNUM * n;
+  int *vertex = scratch + (size_t)S_VERTEX * n;
+  int *parent = scratch + (size_t)S_PARENT * n;
+  int *semi = scratch + (size_t)S_SEMI * n;
+  int *label = scratch + (size_t)S_LABEL * n;
+  int *ancestor = scratch + (size_t)S_ANCESTOR * n;
+  int *idom = scratch + (size_t)S_IDOM * n;
+  int *bucket = scratch + (size_t)S_BUCKET * n;
+  int *next = scratch + (size_t)S_NEXT * n;
+  int *stack = scratch + (size_t)S_STACK * n;
+  int *cursor = scratch + (size_t)S_CURSOR * n;
+
+  /* Preorder DFS from root */
+  for (int i = 0; i < n; i++)
+    dfnum[i] = -1;
+  int count = 0, sp = 0;
+  dfnum[root] = count;
+  vertex[count] = root;
+  parent[count++] = -1;
+  cursor[root] = fstart[root];
+  stack[sp++] = root;
+  while (sp > 0) {
+    int v = stack[sp - 1];
+    if (cursor[v] < fstart[v + 1]) {
+      int w = fadj[cursor[v]++];
+      if (dfnum[w] < 0) {
+        dfnum[w] = count;
+        vertex[count] = w;
+        parent[count++] = dfnum[v];
+        cursor[w] = fstart[w];
+        stack[sp++] = w;
+      }
+    } else {
+      sp--;
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    semi[i] = label[i] = i;
+    ancestor[i] = -1;
+    bucket[i] = -1;
+  }
+
+  for (int i = count - 1; i > 0; i--) {
+    int w = vertex[i];
+    for (int e = bstart[w]; e < bstart[w + 1]; e++) {
+      int v = dfnum[badj[e]];
+      if (v < 0)
+        continue;
+      int u = dom_eval(v, ancestor, label, semi, stack);
+      if (semi[u] < semi[i])
+        semi[i] = semi[u];
+    }
+    next[i] = bucket[semi[i]];
+    bucket[semi[i]] = i;
+    ancestor[i] = parent[i];
+
+    int p = parent[i];
+    for (int v = bucket[p]; v >= 0; v = next[v]) {
+      int u = dom_eval(v, ancestor, label, semi, stack);
+      idom[v] = semi[u] < semi[v] ? u : p;
+    }
+    bucket[p] = -1;
+  }
+  for (int i = 1; i < count; i++)
+    if (idom[i] != semi[i])
+      idom[i] = idom[idom[i]];
+
+  int *node_idom = cursor;
+  for (int i = 0; i < n; i++)
+    node_idom[i] = -1;
+  for (int i = 1; i < count; i++)
+    node_idom[vertex[i]] = vertex[idom[i]];
+
+  int *df_count = semi;
+  memset(df_count, 0, (size_t)n * sizeof(int));
+  dom_frontier_walk(n, bstart, badj, dfnum, node_idom, label, df_count, NULL);
+  int num_df = 0;
+  for (int v = 0; v < n; v++)
+    num_df += df_count[v];
+
+  size_t ints = dom_ints(n, num_df);
+  int *block = (int *)malloc(ints * sizeof(int));
+  if (!block) {
+    free(scratch);
+    mem_note_free(MEM_CFG_NODES, scratch_bytes);
+    return -1;
+  }
+  mem_note_alloc(MEM_CFG_NODES, ints * sizeof(int));
+  t->block = block;
+  t->num_nodes = n;
+  t->num_df = num_df;
+  t->idom = block;
+  t->child_start = t->idom + n;
+  t->child = t->child_start + n + 1;
+  t->pre = t->child + n;
+  t->post = t->pre + n;
+  t->df_start = t->post + n;
+  t->df = t->df_start + n + 1;
+
+  memcpy(t->idom, node_idom, (size_t)n * sizeof(int));
+  t->df_start[0] = 0;
+  for (int v = 0; v < n; v++)
+    t->df_start[v + 1] = t->df_start[v] + df_count[v];
+
+  /* Tree children in CSR form, in DFS preorder */
+  memset(t->child_start, 0, ((size_t)n + 1) * sizeof(int));
+  for (int v = 0; v < n; v++)
+    if (t->idom[v] >= 0)
+      t->child_start[t->idom[v] + 1]++;
+  for (int v = 0; v < n; v++)
+    t->child_start[v + 1] += t->child_start[v];
+  memcpy(cursor, t->child_start, (size_t)n * sizeof(int));
+  for (int i = 1; i < count; i++) {
+    int v = vertex[i];
+    t->child[cursor[t->idom[v]]++] = v;
+  }
+
+  /* Pre/post numbers of the tree walk give O(1) dominance queries */
+  for (int v = 0; v < n; v++)
+    t->pre[v] = t->post[v] = -1;
+  int pre = 0, post = 0;
+  sp = 0;
+  t->pre[root] = pre++;
+  cursor[root] = t->child_start[root];
+  stack[sp++] = root;
+  while (sp > 0) {
+    int v = stack[sp - 1];
+    if (cursor[v] < t->child_start[v + 1]) {
+      int w = t->child[cursor[v]++];
+      t->pre[w] = pre++;
+      cursor[w] = t->child_start[w];
+      stack[sp++] = w;
+    } else {
+      t->post[v] = post++;
+      sp--;
+    }
+  }
+
+  memcpy(cursor, t->df_start, (size_t)n * sizeof(int));
+  dom_frontier_walk(n, bstart, badj, dfnum, t->idom, label, cursor, t->df);
+
+  free(scratch);
+  mem_note_free(MEM_CFG_NODES, scratch_bytes);
+  return 0;
+}
+
+void cfg_dom_tree_free(CFGDomTree *t) {
+  if (!t || !t->block)
+    return;
+  free(t->block);
+  mem_note_free(MEM_CFG_NODES, dom_ints(t->num_nodes, t->num_df) * sizeof(int));
+  memset(t, 0, sizeof(*t));
+}
+
+int cfg_function_build_dominators(CFGFunction *func) {
+  if (!func || !func->graph_block)
+    return -1;
+  cfg_dom_tree_free(&func->dom);
+  cfg_dom_tree_free(&func->postdom);
+  int n = func->num_nodes;
+  if (dom_tree_build(&func->dom, n, func->entry ? func->entry->index : -1,
+                     func->succ_start, func->succ, func->pred_start,
+                     func->pred) != 0)
+    return -1;
+  if (dom_tree_build(&func->postdom, n, func->exit ? func->exit->index : -1,
+                     func->pred_start, func->pred, func->succ_start,
+                     func->succ) != 0) {
+    cfg_dom_tree_free(&func->dom);
+    return -1;
+  }
+  return 0;
+}
+
+/* ============================================================================
+ * ACCESSORS
+ * ============================================================================
+ */
+
+static int dom_valid(const CFGDomTree *t, int index) {
+  return t->block && index >= 0 && index < t->num_nodes;
+}
+
+static int dom_tree_dominates(const CFGDomTree *t, int a, int b) {
+  if (!dom_valid(t, a) || !dom_valid(t, b) || t->pre[a] < 0 || t->pre[b] < 0)
+    return 0;
+  return t->pre[a] <= t->pre[b] && t->post[b] <= t->post[a];
+}
+
+int cfg_function_get_idom(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->dom, index))
+    return -1;
+  return func->dom.idom[index];
+}
+
+int cfg_function_get_num_dom_children(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->dom, index))
+    return 0;
+  return func->dom.child_start[index + 1] - func->dom.child_start[index];
+}
+
+const int *cfg_function_get_dom_children(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->dom, index))
+    return NULL;
+  return func->dom.child + func->dom.child_start[index];
+}
+
+int cfg_function_dominates(CFGFunction *func, int a, int b) {
+  return func ? dom_tree_dominates(&func->dom, a, b) : 0;
+}
+
+int cfg_function_get_num_dom_frontier(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->dom, index))
+    return 0;
+  return func->dom.df_start[index + 1] - func->dom.df_start[index];
+}
+
+const int *cfg_function_get_dom_frontier(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->dom, index))
+    return NULL;
+  return func->dom.df + func->dom.df_start[index];
+}
+
+int cfg_function_get_ipdom(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->postdom, index))
+    return -1;
+  return func->postdom.idom[index];
+}
+
+int cfg_function_get_num_postdom_children(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->postdom, index))
+    return 0;
+  return func->postdom.child_start[index + 1] - func->postdom.child_start[index];
+}
+
+const int *cfg_function_get_postdom_children(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->postdom, index))
+    return NULL;
+  return func->postdom.child + func->postdom.child_start[index];
+}
+
+int cfg_function_postdominates(CFGFunction *func, int a, int b) {
+  return func ? dom_tree_dominates(&func->postdom, a, b) : 0;
+}
+
+int cfg_function_get_num_postdom_frontier(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->postdom, index))
+    return 0;
+  return func->postdom.df_start[index + 1] - func->postdom.df_start[index];
+}
+
+const int *cfg_function_get_postdom_frontier(CFGFunction *func, int index) {
+  if (!func || !dom_valid(&func->postdom, index))
+    return NULL;
+  return func->postdom.df + func->postdom.df_start[index];
+}
+
+/* ============================================================================
+ * CROSS-CHECK - naive iterative solver
+ * ============================================================================
+ *
+ * Dom(v) = {v} + intersection of Dom(p) over the predecessors p, iterated
+ * to the fixpoint on an n x n matrix. Quadratic, meant for test inputs
+ * only; everything the LT trees answer is derived from it independently:
+ * idom is the strict dominator with the most dominators of its own, and
+ * b is in DF(a) iff a dominates a predecessor of b and does not strictly
+ * dominate b.
+ */
+
+static int dom_tree_check(CFGFunction *func, const CFGDomTree *t,
+                          const char *what, int root, const int *fstart,
+                          const int *fadj, const int *bstart,
+                          const int *badj, FILE *err) {
+  int n = func->num_nodes;
+  if (n == 0 || root < 0)
+    return 0;
+  char *dom = (char *)malloc((size_t)n * (size_t)n);
+  char *reach = (char *)calloc((size_t)n, 1);
+  int *stack = (int *)malloc((size_t)n * sizeof(int));
+  int *depth = (int *)calloc((size_t)n, sizeof(int));
+  if (!dom || !reach || !stack || !depth) {
+    free(dom);
+    free(reach);
+    free(stack);
+    free(depth);
+    if (err)
+      fprintf(err, "%s: %s check: out of memory\n", func->name, what);
+    return 1;
+  }
+
+  int sp = 0;
+  stack[sp++] = root;
+  reach[root] = 1;
+  while (sp > 0) {
+    int v = stack[--sp];
+    for (int e = fstart[v]; e < fstart[v + 1]; e++)
+      if (!reach[fadj[e]]) {
+        reach[fadj[e]] = 1;
+        stack[sp++] = fadj[e];
+      }
+  }
+
+  /* dom[v * n + d]: d dominates v */
+  for (int v = 0; v < n; v++)
+    memset(dom + (size_t)v * n, v != root, (size_t)n);
+  dom[(size_t)root * n + root] = 1;
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (int v = 0; v < n; v++) {
+      if (v == root || !reach[v])
+        continue;
+      for (int d = 0; d < n; d++) {
+        char x = 1;
+        for (int e = bstart[v]; e < bstart[v + 1] && x; e++)
+          if (reach[badj[e]])
+            x = dom[(size_t)badj[e] * n + d];
+        if (d == v)
+          x = 1;
+        if (x != dom[(size_t)v * n + d]) {
+          dom[(size_t)v * n + d] = x;
+          changed = 1;
+        }
+      }
+    }
+  }
+  for (int v = 0; v < n; v++)
+    for (int d = 0; d < n; d++)
+      depth[v] += reach[v] && dom[(size_t)v * n + d];
+
+  int bad = 0;
+#define DOM_MISMATCH(...)                                                     \
+  do {                                                                        \
+    if (err && bad < 10) {                                                    \
+      fprintf(err, "%s: %s: ", func->name, what);                             \
+      fprintf(err, __VA_ARGS__);                                              \
+      fputc('\n', err);                                                       \
+    }                                                                         \
+    bad++;                                                                    \
+  } while (0)
+
+  for (int b = 0; b < n; b++) {
+    int idom = -1;
+    if (reach[b] && b != root)
+      for (int d = 0; d < n; d++)
+        if (d != b && dom[(size_t)b * n + d] && depth[d] == depth[b] - 1)
+          idom = d;
+    if (t->idom[b] != idom)
+      DOM_MISMATCH("idom(%d) is %d, expected %d", b, t->idom[b], idom);
+
+    for (int a = 0; a < n; a++) {
+      int expect = reach[a] && reach[b] && dom[(size_t)b * n + a];
+      if (dom_tree_dominates(t, a, b) != expect)
+        DOM_MISMATCH("%d %s %d", a, expect ? "must dominate" : "must not dominate", b);
+    }
+  }
+
+  for (int a = 0; a < n; a++) {
+    if (!reach[a])
+      continue;
+    for (int b = 0; b < n; b++) {
+      int expect = 0;
+      if (reach[b] && !(a != b && dom[(size_t)b * n + a]))
+        for (int e = bstart[b]; e < bstart[b + 1]; e++)
+          if (reach[badj[e]] && dom[(size_t)badj[e] * n + a])
+            expect = 1;
+      int got = 0;
+      for (int k = t->df_start[a]; k < t->df_start[a + 1]; k++)
+        got += t->df[k] == b;
+      if (got != expect)
+        DOM_MISMATCH("%d appears %d times in the frontier of %d, expected %d",
+                     b, got, a, expect);
+    }
+  }
+#undef DOM_MISMATCH
+
+  free(dom);
+  free(reach);
+  free(stack);
+  free(depth);
+  return bad;
+}
+
+int cfg_function_check_dominators(CFGFunction *func, FILE *err) {
+  if (!func || !func->graph_block || !func->dom.block || !func->postdom.block)
+    return 0;
+  return dom_tree_check(func, &func->dom, "dominators",
+                        func->entry ? func->entry->index : -1,
+                        func->succ_start, func->succ, func->pred_start,
+                        func->pred, err) +
+         dom_tree_check(func, &func->postdom, "post-dominators",
+                        func->exit ? func->exit->index : -1,
+                        func->pred_start, func->pred, func->succ_start,
+                        func->succ, err);
+}
@@ -7,21 +7,16 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
-/* Parser generated in build directory */
-#include "../../build/parser.tab.h"
-
-extern FILE *yyin;
-extern int yyparse(void);
-
-/* Skip UTF-8 BOM if present at the start of the file. Leaves the file
-   position after the BOM (or rewound to start if no BOM). */
-static void skip_utf8_bom(FILE *f) {
-  if (!f) return;
-  unsigned char bom[3];
-  size_t n = fread(bom, 1, 3, f);
-  if (n != 3 || bom[0] != 0xEF || bom[1] != 0xBB || bom[2] != 0xBF) {
-    fseek(f, 0, SEEK_SET);
-  }
+#include "../ir/analysis.h"
+#include "../ir/ir.h"
+#include "../parser/parse.h"
+#include "../trace/trace.h"
+
+/* Free parsed trees (the CFG program only borrows them) */
+static void free_parsed(ParseCtx *parsed, int n) {
+  for (int i = 0; i < n; i++)
+    parse_ctx_release(&parsed[i]);
+  free(parsed);
 }
 
 /* Extract base filename without extension */
@@ -91,11 +86,152 @@ static char *build_output_path(const char *output_dir, const char *base_name,
   return path;
 }
 
+/* Lower func to SSA IR and write it to <base>.<func>.ssa; 0 on success */
+static int write_function_ssa(CFGFunction *func, const char *output_dir,
+                              const char *source_file) {
+  const char *func_name = cfg_function_get_name(func);
+  TraceSpan span;
+  trace_begin(&span, "ir_build", func_name);
+  IRFunction *ir = ir_function_build(func);
+  trace_end(&span);
+  if (!ir) {
+    fprintf(stderr, "Error: failed to build SSA IR for '%s'\n", func_name);
+    return 1;
+  }
+  int rc = ir_function_verify(ir, stderr) ? 1 : 0;
+
+  char *base_name = get_base_filename(source_file);
+  char *path = base_name ? build_output_path(output_dir, base_name, func_name,
+                                             ".ssa")
+                         : NULL;
+  free(base_name);
+  if (!path) {
+    ir_function_free(ir);
+    return 1;
+  }
+  errno = 0;
+  FILE *out = fopen(path, "w");
+  if (!out) {
+    fprintf(stderr, "Error: cannot write to '%s': %s\n", path, strerror(errno));
+    rc = 1;
+  } else {
+    ir_function_print(out, ir);
+    fclose(out);
+  }
+  free(path);
+  ir_function_free(ir);
+  return rc;
+}
+
+/* Liveness, reaching definitions and available expressions over the IR
+   before SSA (variables keep their names there), written to
+   <base>.<func>.dataflow; 0 on success */
+static int write_function_dataflow(CFGFunction *func, const char *output_dir,
+                                   const char *source_file) {
+  const char *func_name = cfg_function_get_name(func);
+  IRFunction *ir = ir_function_lower(func);
+  if (!ir) {
+    fprintf(stderr, "Error: failed to lower '%s' to IR\n", func_name);
+    return 1;
+  }
+  IRLiveness live;
+  IRReachingDefs rd;
+  IRAvailExprs ae;
+  TraceSpan span;
+  trace_begin(&span, "dataflow", func_name);
+  int rc = ir_liveness(ir, &live) != 0;
+  rc |= ir_reaching_defs(ir, &rd) != 0;
+  rc |= ir_available_exprs(ir, &ae) != 0;
+  trace_end(&span);
+
+  char *base_name = get_base_filename(source_file);
+  char *path = base_name && rc == 0
+                   ? build_output_path(output_dir, base_name, func_name,
+                                       ".dataflow")
+                   : NULL;
+  free(base_name);
+  if (!path) {
+    if (rc)
+      fprintf(stderr, "Error: dataflow analysis failed for '%s'\n", func_name);
+    rc = 1;
+  } else {
+    errno = 0;
+    FILE *out = fopen(path, "w");
+    if (!out) {
+      fprintf(stderr, "Error: cannot write to '%s': %s\n", path,
+              strerror(errno));
+      rc = 1;
+    } else {
+      ir_analysis_print(out, ir, &live, &rd, &ae);
+      fclose(out);
+    }
+    free(path);
+  }
+  ir_liveness_free(&live);
+  ir_reaching_defs_free(&rd);
+  ir_available_exprs_free(&ae);
+  ir_function_free(ir);
+  return rc;
+}
+
+/* Naive fixpoint against the analyses, on the IR before and after SSA
+   construction; 0 if they agree */
+static int check_function_dataflow(CFGFunction *func) {
+  const char *func_name = cfg_function_get_name(func);
+  IRFunction *ir = ir_function_lower(func);
+  if (!ir) {
+    fprintf(stderr, "Error: failed to lower '%s' to IR\n", func_name);
+    return 1;
+  }
+  int rc = ir_analysis_check(ir, stderr) != 0;
+  if (ir_function_to_ssa(ir) != 0) {
+    fprintf(stderr, "Error: failed to build SSA IR for '%s'\n", func_name);
+    rc = 1;
+  } else if (ir_analysis_check(ir, stderr) != 0) {
+    rc = 1;
+  }
+  ir_function_free(ir);
+  return rc;
+}
+
 int main(int argc, char **argv) {
+  /* --time-report / --trace=FILE can appear anywhere */
+  if (trace_parse_args(&argc, argv) != 0)
+    return 1;
+
+  /* --ssa / --dataflow: also write the SSA IR / the analyses of each
+     function; --check-dom / --check-dataflow: cross-check the dominator
+     trees / the analyses */
+  int write_ssa = 0;
+  int write_dataflow = 0;
+  int check_dom = 0;
+  int check_dataflow = 0;
+  int kept = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--ssa") == 0)
+      write_ssa = 1;
+    else if (strcmp(argv[i], "--dataflow") == 0)
+      write_dataflow = 1;
+    else if (strcmp(argv[i], "--check-dom") == 0)
+      check_dom = 1;
+    else if (strcmp(argv[i], "--check-dataflow") == 0)
+      check_dataflow = 1;
+    else
+      argv[kept++] = argv[i];
+  }
+  argc = kept;
+
   if (argc < 2) {
-    fprintf(stderr, "usage: %s <input-file>... [output-dir]\n", argv[0]);
+    fprintf(stderr, "usage: %s [--time-report] [--trace=out.json] [--ssa] [--dataflow] [--check-dom] [--check-dataflow] <input-file>... [output-dir]\n", argv[0]);
     fprintf(stderr, "  If output-dir is omitted, DOT files are placed next to "
                     "input files.\n");
+    fprintf(stderr, "  --ssa also writes <file>.<function>.ssa with the SSA IR.\n");
+    fprintf(stderr, "  --dataflow also writes <file>.<function>.dataflow with "
+                    "liveness, reaching\n  definitions and available expressions.\n");
+    fprintf(stderr, "  --check-dom compares dominators, post-dominators and frontiers\n"
+                    "  with a naive solver and fails on any mismatch.\n");
+    fprintf(stderr, "  --check-dataflow does the same for the dataflow analyses, "
+                    "before and\n  after SSA construction.\n");
     return 1;
   }
 
@@ -126,41 +262,40 @@ int main(int argc, char **argv) {
 
   int parse_errors = 0;
 
-  /* Parse all input files */
-  for (int i = 1; i <= num_input_files; i++) {
-    const char *input_file = argv[i];
+  /* Parse all input files in parallel; files are independent, the CFG
+     program is then filled sequentially in command-line order */
+  ParseCtx *parsed = (ParseCtx *)calloc((size_t)num_input_files, sizeof(ParseCtx));
+  if (!parsed) {
+    fprintf(stderr, "Error: out of memory\n");
+    cfg_prog_free(prog);
+    return 1;
+  }
+  parse_files((const char *const *)&argv[1], num_input_files, parsed, 0);
 
-    errno = 0;
-    FILE *f = fopen(input_file, "rb");
-    if (!f) {
+  for (int i = 0; i < num_input_files; i++) {
+    const char *input_file = argv[i + 1];
+    ParseCtx *pc = &parsed[i];
+
+    switch (pc->status) {
+    case PARSE_OK:
+      break;
+    case PARSE_ERR_OPEN:
       fprintf(stderr, "Error: cannot open input file '%s': %s\n", input_file,
-              strerror(errno));
+              strerror(pc->sys_errno));
       parse_errors = 1;
       continue;
-    }
-
-    /* tolerate optional UTF-8 BOM */
-    skip_utf8_bom(f);
-
-    yyin = f;
-    int parse_result = yyparse();
-    fclose(f);
-
-    if (parse_result != 0) {
-      fprintf(stderr, "Error: syntax errors in '%s'\n", input_file);
+    case PARSE_ERR_NO_ROOT:
+      fprintf(stderr, "Error: no AST root produced for '%s'\n", input_file);
       parse_errors = 1;
       continue;
-    }
-
-    ASTNode *root = ast_get_root();
-    if (!root) {
-      fprintf(stderr, "Error: no AST root produced for '%s'\n", input_file);
+    default:
+      fprintf(stderr, "Error: syntax errors in '%s'\n", input_file);
       parse_errors = 1;
       continue;
     }
 
     /* Add file to program */
-    if (!cfg_prog_add_file(prog, input_file, root)) {
+    if (!cfg_prog_add_file(prog, input_file, pc->root)) {
       fprintf(stderr, "Error: failed to add file '%s' to program\n",
               input_file);
       parse_errors = 1;
@@ -170,13 +305,19 @@ int main(int argc, char **argv) {
 
   if (parse_errors) {
     cfg_prog_free(prog);
+    free_parsed(parsed, num_input_files);
     return 1;
   }
 
   /* Build CFG for all functions */
-  if (!cfg_prog_build(prog)) {
+  TraceSpan build_span;
+  trace_begin(&build_span, "cfg_build", NULL);
+  int built = cfg_prog_build(prog);
+  trace_end(&build_span);
+  if (!built) {
     fprintf(stderr, "Error: failed to build CFG\n");
     cfg_prog_free(prog);
+    free_parsed(parsed, num_input_files);
     return 1;
   }
 
@@ -199,6 +340,19 @@ int main(int argc, char **argv) {
     }
   }
 
+  /* Naive solver against the Lengauer-Tarjan trees (for tests) */
+  int check_errors = 0;
+  if (check_dom) {
+    for (int i = 0; i < cfg_prog_get_num_functions(prog); i++)
+      if (cfg_function_check_dominators(cfg_prog_get_function(prog, i), stderr) != 0)
+        check_errors = 1;
+  }
+  if (check_dataflow) {
+    for (int i = 0; i < cfg_prog_get_num_functions(prog); i++)
+      if (check_function_dataflow(cfg_prog_get_function(prog, i)) != 0)
+        check_errors = 1;
+  }
+
   /* Determine output directory */
   const char *actual_output_dir = output_dir;
   if (!actual_output_dir && num_input_files == 1) {
@@ -220,6 +374,7 @@ int main(int argc, char **argv) {
       fprintf(stderr, "Error: cannot create output directory '%s'\n",
               actual_output_dir);
       cfg_prog_free(prog);
+      free_parsed(parsed, num_input_files);
       return 1;
     }
   }
@@ -227,6 +382,8 @@ int main(int argc, char **argv) {
   int write_errors = 0;
 
   /* Write CFG for each function */
+  TraceSpan write_span;
+  trace_begin(&write_span, "cfg_write_dot", NULL);
   int num_functions = cfg_prog_get_num_functions(prog);
   for (int i = 0; i < num_functions; i++) {
     CFGFunction *func = cfg_prog_get_function(prog, i);
@@ -269,6 +426,12 @@ int main(int argc, char **argv) {
     cfg_function_print_dot(out, func, prog);
     fclose(out);
     free(output_path);
+
+    if (write_ssa && write_function_ssa(func, actual_output_dir, source_file) != 0)
+      write_errors = 1;
+    if (write_dataflow &&
+        write_function_dataflow(func, actual_output_dir, source_file) != 0)
+      write_errors = 1;
   }
 
   /* Write call graph */
@@ -298,9 +461,12 @@ int main(int argc, char **argv) {
     }
   }
 
+  trace_end(&write_span);
+
   cfg_prog_free(prog);
+  free_parsed(parsed, num_input_files);
 
-  if (write_errors || num_errors > 0)
+  if (write_errors || num_errors > 0 || check_errors)
     return 1;
 
   return 0;
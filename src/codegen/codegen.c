@@ -6,6 +6,14 @@
 #include <errno.h>
 
 #include "../ast/ast.h"
+#include "../ast/intern.h"
+#include "regalloc.h"
+#include "../semantic/types.h"
+#include "../semantic/mono.h"
+#include "../semantic/typeinfer.h"
+#include "../semantic/escape.h"
+#include "../trace/trace.h"
+#include "../trace/memstat.h"
 
 // ------------------------- small utils -------------------------
 
@@ -17,51 +25,47 @@ static char *dup_cstr(const char *s) {
   return d;
 }
 
-static const char *after_colon(const char *label) {
-  if (!label) return "";
-  const char *c = strchr(label, ':');
-  return c ? (c + 1) : label;
-}
-
 static int starts_with(const char *s, const char *pfx) {
   if (!s || !pfx) return 0;
   size_t n = strlen(pfx);
   return strncmp(s, pfx, n) == 0;
 }
 
-// forward decl (is_token_kind is defined later)
-static int is_token_kind(const ASTNode *n, const char *kind);
+static int is_kind(const ASTNode *n, ASTKind kind) { return n && n->kind == kind; }
+
 // forward decl for helper that classifies stdlib functions
 static int is_standard_library_func(const char *name);
 
 // Extract a simple type name from a typeRef/type/genType AST node.
-// Returns pointer into the AST node's label (do not free).
+// Returns pointer into the AST node's lexeme (do not free).
 static const char *get_type_name(const ASTNode *type_node) {
   if (!type_node) return NULL;
-  if (is_token_kind(type_node, "type") || is_token_kind(type_node, "typeRef")) {
-    return after_colon(type_node->label);
+  if (is_kind(type_node, AST_TYPE) || is_kind(type_node, AST_TYPE_REF)) {
+    return type_node->lexeme;
   }
-  if (type_node->label && strcmp(type_node->label, "genType") == 0 && type_node->numChildren > 0) {
-    const ASTNode *idn = type_node->children[0];
-    if (idn && is_token_kind(idn, "id")) return after_colon(idn->label);
+  if (type_node->kind == AST_GEN_TYPE && type_node->numChildren > 0) {
+    const ASTNode *idn = ast_child(type_node, 0);
+    if (idn && idn->kind == AST_ID) return idn->lexeme;
   }
+  if (type_node->kind == AST_ARRAY) return mono_type_name(type_node); // T_arr
   return NULL;
 }
 
-static int is_token_kind(const ASTNode *n, const char *kind) {
-  if (!n || !n->label || !kind) return 0;
-  size_t k = strlen(kind);
-  return strncmp(n->label, kind, k) == 0 && n->label[k] == ':';
-}
-
 static int align16(int x) { return (x + 15) & ~15; }
 
 // ------------------------- dynamic arrays -------------------------
 
+// Имена и типы — интернированные символы (intern.h): сравниваются по
+// указателю и не освобождаются.
 typedef struct {
-  char *name;
-  int offset; // от %r11 (frame base)
-  char *type; // optional static type name for local (e.g. "ListInt")
+  const char *name;
+  int offset; // от %r11 (frame base), если не в регистре
+  const char *type; // optional static type name for local (e.g. "ListInt")
+  int reg;    // register from linear scan or RA_NO_REG
+  int addr_taken; // &name встречается в теле: только память
+  int array_bytes; // T name[N] с константным N: элементы в кадре, иначе 0
+  int array_off;   // начало элементов от %r11
+  int scalar;      // объект разложен на локалы полей "x.f" (SRA), сам x не нужен
 } Local;
 
 typedef struct {
@@ -69,20 +73,27 @@ typedef struct {
   int n, cap;
 } LocalMap;
 
+// объект new C(...) в кадре функции (escape_new_is_local)
+typedef struct {
+  const ASTNode *site; // узел new
+  int bytes;           // ClassInfo.size_bytes
+  int off;             // от %r11, назначает ra_allocate
+} FrameObject;
+
 static void locals_init(LocalMap *m) { memset(m, 0, sizeof(*m)); }
 
 static void locals_free(LocalMap *m) {
   if (!m) return;
-  for (int i = 0; i < m->n; i++) free(m->v[i].name);
-  for (int i = 0; i < m->n; i++) free(m->v[i].type);
   free(m->v);
+  mem_note_resize(MEM_CG_LOCALS, (size_t)m->cap * sizeof(Local), 0);
   memset(m, 0, sizeof(*m));
 }
 
+// name — интернированный символ (lexeme узла или intern_cstr)
 static int locals_find(const LocalMap *m, const char *name) {
   if (!m || !name) return -1;
   for (int i = 0; i < m->n; i++) {
-    if (m->v[i].name && strcmp(m->v[i].name, name) == 0) return i;
+    if (m->v[i].name == name) return i;
   }
   return -1;
 }
@@ -95,23 +106,22 @@ static int locals_add(LocalMap *m, const char *name, int offset, const char *typ
     int nc = m->cap ? (m->cap * 2) : 16;
     Local *nv = (Local *)realloc(m->v, (size_t)nc * sizeof(Local));
     if (!nv) return -1;
+    mem_note_resize(MEM_CG_LOCALS, (size_t)m->cap * sizeof(Local), (size_t)nc * sizeof(Local));
     m->v = nv;
     m->cap = nc;
   }
-  m->v[m->n].name = dup_cstr(name);
-  m->v[m->n].type = type ? dup_cstr(type) : NULL;
+  m->v[m->n].name = name;
+  m->v[m->n].type = type;
   m->v[m->n].offset = offset;
+  m->v[m->n].reg = RA_NO_REG;
+  m->v[m->n].addr_taken = 0;
+  m->v[m->n].array_bytes = 0;
+  m->v[m->n].array_off = 0;
+  m->v[m->n].scalar = 0;
   m->n++;
   return 1;
 }
 
-static int locals_get_offset(const LocalMap *m, const char *name, int *out_off) {
-  int idx = locals_find(m, name);
-  if (idx < 0) return 0;
-  if (out_off) *out_off = m->v[idx].offset;
-  return 1;
-}
-
 static const char *locals_get_type(const LocalMap *m, const char *name) {
   int idx = locals_find(m, name);
   if (idx < 0) return NULL;
@@ -121,7 +131,7 @@ static const char *locals_get_type(const LocalMap *m, const char *name) {
 // ------------------------- string/const pools -------------------------
 
 typedef struct {
-  char *text;   // как в исходнике, включая кавычки: "Hello\n"
+  const char *text; // интернирован; как в исходнике, включая кавычки: "Hello\n"
   int label_id; // .LC<label_id>
 } StrLit;
 
@@ -134,15 +144,15 @@ static void strpool_init(StrPool *p) { memset(p, 0, sizeof(*p)); }
 
 static void strpool_free(StrPool *p) {
   if (!p) return;
-  for (int i = 0; i < p->n; i++) free(p->v[i].text);
   free(p->v);
+  mem_note_resize(MEM_CG_STRPOOL, (size_t)p->cap * sizeof(StrLit), 0);
   memset(p, 0, sizeof(*p));
 }
 
 static int strpool_find(const StrPool *p, const char *text) {
   if (!p || !text) return -1;
   for (int i = 0; i < p->n; i++) {
-    if (p->v[i].text && strcmp(p->v[i].text, text) == 0) return i;
+    if (p->v[i].text == text) return i;
   }
   return -1;
 }
@@ -156,10 +166,11 @@ static int strpool_add(StrPool *p, const char *text, int label_id) {
     int nc = p->cap ? (p->cap * 2) : 16;
     StrLit *nv = (StrLit *)realloc(p->v, (size_t)nc * sizeof(StrLit));
     if (!nv) return -1;
+    mem_note_resize(MEM_CG_STRPOOL, (size_t)p->cap * sizeof(StrLit), (size_t)nc * sizeof(StrLit));
     p->v = nv;
     p->cap = nc;
   }
-  p->v[p->n].text = dup_cstr(text);
+  p->v[p->n].text = text;
   p->v[p->n].label_id = label_id;
   p->n++;
   return label_id;
@@ -179,6 +190,7 @@ static void cpool_init(ConstPool *p) { memset(p, 0, sizeof(*p)); }
 
 static void cpool_free(ConstPool *p) {
   free(p->v);
+  mem_note_resize(MEM_CG_CONSTPOOL, (size_t)p->cap * sizeof(Const64), 0);
   memset(p, 0, sizeof(*p));
 }
 
@@ -198,6 +210,7 @@ static int cpool_add(ConstPool *p, int64_t val, int label_id) {
     int nc = p->cap ? (p->cap * 2) : 16;
     Const64 *nv = (Const64 *)realloc(p->v, (size_t)nc * sizeof(Const64));
     if (!nv) return -1;
+    mem_note_resize(MEM_CG_CONSTPOOL, (size_t)p->cap * sizeof(Const64), (size_t)nc * sizeof(Const64));
     p->v = nv;
     p->cap = nc;
   }
@@ -207,6 +220,25 @@ static int cpool_add(ConstPool *p, int64_t val, int label_id) {
   return label_id;
 }
 
+// ------------------------- register allocation state -------------------------
+
+// Per-function state of the two-pass scheme: the dry pass walks the body
+// without emitting anything and records live intervals, calls and loops;
+// after ra_linear_scan() the real pass emits code using the assignment.
+typedef struct {
+  int dry;           // 1 = numbering pass, emit() is a no-op
+  int pos;           // next program point
+  int loop_depth;
+  LiveInterval *iv;  // [0, nlocals) locals, then temporaries
+  int n, cap, nlocals;
+  int next_temp;     // temp ids repeat identically in both passes
+  int *temp_off;     // frame slot of a spilled temporary
+  int *calls;        // program points of calls, ascending
+  int calls_n, calls_cap;
+  int *loops;        // (start, end) pairs, inner loops first
+  int loops_n, loops_cap;
+} RAState;
+
 // ------------------------- codegen context -------------------------
 
 typedef struct {
@@ -221,27 +253,47 @@ typedef struct {
 
   // function-local:
   const char *cur_func;
+  const char *cur_class; // класс this для Class__method, иначе NULL (интернирован)
   int epilogue_label;
   LocalMap locals;
 
   int frame_size;     // размер кадра
-  int scratch_size;   // сколько отдали под push/pop temp
-  int locals_size;    // сколько заняли локалы
+  int locals_size;    // сколько заняли локалы и spill-слоты
+  int frame_blocks;   // байт под массивы T name[N] и объекты new в кадре
+  // объекты new, не убегающие из функции (escape.h): место в кадре
+  FrameObject *frame_objs;
+  int frame_objs_n, frame_objs_cap;
+  RAState ra;
 
   // break targets stack:
   int *break_labels;
   int break_n, break_cap;
 
-  /* top-level defined function names collected before generation */
+  const char *sym_this; // intern_cstr("this")
+  const ASTNode *this_id; // id 'this' as the implicit receiver of unqualified method calls
+
+  /* top-level defined function names collected before generation;
+     all names below are interned symbols compared by pointer */
   const char **defined_names;
   int defined_n;
   /* parallel array holding parameter counts (arity) for each defined name */
   int *defined_arity;
-  /* simple field offset map: parallel arrays */
-  const char **field_class_names; /* class name per field entry */
-  const char **field_names;       /* field name */
-  int *field_offsets;            /* offset in bytes */
-  int field_n;
+  SymMap defined_index; /* name -> index in defined_names */
+  /* классы программы: размеры объектов и смещения полей (с унаследованными) */
+  TypeEnv *types;
+  /* статические типы выражений (после mono, до понижения методов) */
+  ExprTypes *etypes;
+  /* new, объекты которых можно разместить в кадре */
+  EscapeInfo *escapes;
+  /* имя поля -> первый объявивший его класс (types_class_at); для
+     объектов, статический тип которых неизвестен */
+  SymMap any_field;
+  /* имя метода -> слот vtable, если он одинаков во всех классах с этим
+     методом (иначе CG_SLOT_AMBIGUOUS); для объектов неизвестного типа */
+  SymMap any_slot;
+  /* Class__method (MethodInfo.impl_label) -> индекс в defined_names:
+     символ метода после понижения содержит ещё и типы параметров */
+  SymMap method_impl;
   /* set of class names for which we need vtable symbols (collected during gen_new)
     to ensure we emit a placeholder vtable even if class definition is absent. */
   const char **required_vtables;
@@ -258,13 +310,15 @@ static void cg_init(CG *cg, FILE *out) {
   cg->next_str_label = 0;
   cg->next_c64_label = 0;
   locals_init(&cg->locals);
+  cg->sym_this = intern_cstr("this");
   cg->defined_names = NULL;
   cg->defined_n = 0;
   cg->defined_arity = NULL;
-  cg->field_class_names = NULL;
-  cg->field_names = NULL;
-  cg->field_offsets = NULL;
-  cg->field_n = 0;
+  cg->types = NULL;
+  symmap_init(&cg->any_field, MEM_CG_FIELDS);
+  symmap_init(&cg->any_slot, MEM_CG_FIELDS);
+  symmap_init(&cg->method_impl, MEM_CG_FIELDS);
+  symmap_init(&cg->defined_index, MEM_CG_FIELDS);
   cg->required_vtables = NULL;
   cg->req_vtables_n = 0;
   cg->req_vtables_cap = 0;
@@ -275,26 +329,56 @@ static void cg_free(CG *cg) {
   strpool_free(&cg->str_pool);
   cpool_free(&cg->const_pool);
   locals_free(&cg->locals);
+  free(cg->ra.iv);
+  free(cg->ra.temp_off);
+  free(cg->ra.calls);
+  free(cg->ra.loops);
   free(cg->break_labels);
-  if (cg->defined_names) {
-    for (int i = 0; i < cg->defined_n; i++) free((void*)cg->defined_names[i]);
-    free((void*)cg->defined_names);
-  }
-  if (cg->defined_arity) free(cg->defined_arity);
-  free((void*)cg->field_class_names);
-  free((void*)cg->field_names);
-  free(cg->field_offsets);
-  if (cg->required_vtables) {
-    for (int i = 0; i < cg->req_vtables_n; i++) free((void*)cg->required_vtables[i]);
-    free((void*)cg->required_vtables);
-  }
+  free((void*)cg->defined_names);
+  free(cg->defined_arity);
+  types_free(cg->types);
+  typeinfer_free(cg->etypes);
+  escape_free(cg->escapes);
+  free(cg->frame_objs);
+  symmap_free(&cg->any_field);
+  symmap_free(&cg->any_slot);
+  symmap_free(&cg->method_impl);
+  symmap_free(&cg->defined_index);
+  free((void*)cg->required_vtables);
   memset(cg, 0, sizeof(*cg));
 }
 
+#define CG_SLOT_AMBIGUOUS 0x7fffffff
+
+// байт под массивы и объекты в кадре одной функции (aghi берёт 16 бит)
+#define CG_FRAME_BLOCKS_MAX 16384
+
+/* построить TypeEnv один раз на всю программу */
+static void cg_build_types(CG *cg, const ASTNode *root) {
+  cg->types = types_build_from_ast(root);
+  int n = types_num_classes(cg->types);
+  for (int i = 0; i < n; i++) {
+    const ClassInfo *ci = types_class_at(cg->types, i);
+    for (int j = 0; j < ci->n_fields; j++) {
+      const FieldInfo *f = &ci->fields[j];
+      if (symmap_get(&cg->any_field, f->name) < 0)
+        symmap_put(&cg->any_field, f->name, i);
+    }
+    for (int j = 0; j < ci->n_slots; j++) {
+      const MethodInfo *m = &ci->vtable[j];
+      int slot = symmap_get(&cg->any_slot, m->name);
+      if (slot < 0)
+        symmap_put(&cg->any_slot, m->name, m->slot);
+      else if (slot != m->slot)
+        symmap_put(&cg->any_slot, m->name, CG_SLOT_AMBIGUOUS);
+    }
+  }
+}
+
 static void cg_add_required_vtable(CG *cg, const char *name) {
   if (!cg || !name) return;
   for (int i = 0; i < cg->req_vtables_n; i++) {
-    if (cg->required_vtables[i] && !strcmp(cg->required_vtables[i], name)) return;
+    if (cg->required_vtables[i] == name) return;
   }
   if (cg->req_vtables_n == cg->req_vtables_cap) {
     int nc = cg->req_vtables_cap ? (cg->req_vtables_cap * 2) : 8;
@@ -303,19 +387,36 @@ static void cg_add_required_vtable(CG *cg, const char *name) {
     cg->required_vtables = nv;
     cg->req_vtables_cap = nc;
   }
-  cg->required_vtables[cg->req_vtables_n++] = dup_cstr(name);
+  cg->required_vtables[cg->req_vtables_n++] = name;
 }
 
 static int cg_has_defined_function(CG *cg, const char *name) {
   if (!cg || !name) return 0;
-  for (int i = 0; i < cg->defined_n; i++) {
-    const char *n = cg->defined_names[i];
-    if (n && strcmp(n, name) == 0) return 1;
-  }
-  return 0;
+  return symmap_get(&cg->defined_index, name) >= 0;
+}
+
+static void cg_index_defined(CG *cg, int i) {
+  if (symmap_get(&cg->defined_index, cg->defined_names[i]) < 0)
+    symmap_put(&cg->defined_index, cg->defined_names[i], i);
+}
+
+static const FieldInfo *cg_class_field(const ClassInfo *ci, const char *field) {
+  int i = ci ? symmap_get(&ci->field_index, field) : -1;
+  return i >= 0 ? &ci->fields[i] : NULL;
+}
+
+// field: prefer the static class of the object (or of 'this'), then the
+// first class declaring a field with that name
+static const FieldInfo *cg_field(const CG *cg, const char *class_name, const char *field) {
+  const FieldInfo *f = NULL;
+  if (class_name) f = cg_class_field(types_find_class(cg->types, class_name), field);
+  if (!f && cg->cur_class) f = cg_class_field(types_find_class(cg->types, cg->cur_class), field);
+  if (!f) f = cg_class_field(types_class_at(cg->types, symmap_get(&cg->any_field, field)), field);
+  return f;
 }
 
 static void emit(CG *cg, const char *fmt, ...) {
+  if (cg->ra.dry) return;
   va_list ap;
   va_start(ap, fmt);
   vfprintf(cg->out, fmt, ap);
@@ -368,20 +469,20 @@ static int64_t parse_bits_literal(const char *s) {
 }
 
 static int64_t parse_int_literal_label(const ASTNode *n) {
-  if (!n || !n->label) return 0;
-  const char *v = after_colon(n->label);
+  if (!n) return 0;
+  const char *v = n->lexeme;
 
-  if (is_token_kind(n, "dec") || is_token_kind(n, "hex")) {
+  if (is_kind(n, AST_DEC) || is_kind(n, AST_HEX)) {
     // strtoll base 0 handles 123 and 0x...
     return (int64_t)strtoll(v, NULL, 0);
   }
-  if (is_token_kind(n, "bits")) {
+  if (is_kind(n, AST_BITS)) {
     return parse_bits_literal(v);
   }
-  if (is_token_kind(n, "bool")) {
+  if (is_kind(n, AST_BOOL)) {
     return (strcmp(v, "true") == 0) ? 1 : 0;
   }
-  if (is_token_kind(n, "char")) {
+  if (is_kind(n, AST_CHAR)) {
     // lexer: 'x' (без escape)
     size_t len = strlen(v);
     if (len >= 3 && v[0] == '\'' && v[len - 1] == '\'') {
@@ -405,8 +506,8 @@ static int cg_has_defined_function(CG *cg, const char *name);
 static void collect_literals(CG *cg, const ASTNode *n) {
   if (!n) return;
 
-  if (is_token_kind(n, "string")) {
-    const char *txt = after_colon(n->label); // includes quotes
+  if (is_kind(n, AST_STRING)) {
+    const char *txt = n->lexeme; // includes quotes
     int id = strpool_add(&cg->str_pool, txt, cg->next_str_label++);
     (void)id;
   }
@@ -414,30 +515,54 @@ static void collect_literals(CG *cg, const ASTNode *n) {
   // constants >32-bit: add later lazily (cpool_add on demand)
 
   for (int i = 0; i < n->numChildren; i++) {
-    collect_literals(cg, n->children[i]);
+    collect_literals(cg, ast_child(n, i));
   }
 }
 
 // ------------------------- locals collection -------------------------
 
+// T -> T_arr (тип локала T name[N])
+static const char *cg_array_type(const char *elem) {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s_arr", elem ? elem : "long");
+  return intern_cstr(buf);
+}
+
+// T name[N] с константным N: элементы живут в кадре функции (смещение
+// назначает ra_allocate), пока весь кадр укладывается в CG_FRAME_BLOCKS_MAX;
+// иначе gen_vardecl выделяет их в куче
+static void cg_reserve_frame_array(CG *cg, Local *l, const char *elem, const ASTNode *dim) {
+  const ASTNode *n = dim->numChildren > 0 ? ast_child(dim, 0) : NULL;
+  if (!is_kind(n, AST_DEC) && !is_kind(n, AST_HEX) && !is_kind(n, AST_BITS)) return;
+  int64_t bytes = parse_int_literal_label(n) * types_size_of(elem, NULL);
+  bytes = (bytes + 7) & ~(int64_t)7;
+  if (bytes <= 0 || cg->frame_blocks + bytes > CG_FRAME_BLOCKS_MAX) return;
+  cg->frame_blocks += (int)bytes;
+  l->array_bytes = (int)bytes;
+}
+
 static void collect_locals_from_block(CG *cg, const ASTNode *node, int *next_off) {
   if (!node) return;
 
-  if (node->label && strcmp(node->label, "vardecl") == 0) {
+  if (node->kind == AST_VARDECL) {
     // vardecl: [0]=typeRef, [1]=vars
     if (node->numChildren >= 2) {
-      const ASTNode *type_node = node->children[0];
+      const ASTNode *type_node = ast_child(node, 0);
       const char *type_name = get_type_name(type_node);
-      const ASTNode *vars = node->children[1];
-      if (vars && vars->label && strcmp(vars->label, "vars") == 0) {
-        // children: id, optAssign, id, optAssign...
+      const ASTNode *vars = ast_child(node, 1);
+      if (vars && vars->kind == AST_VARS) {
+        // children: id, optAssign | array(N), id, ...
         for (int i = 0; i + 1 < vars->numChildren; i += 2) {
-          const ASTNode *idn = vars->children[i];
-          if (idn && is_token_kind(idn, "id")) {
-            const char *name = after_colon(idn->label);
+          const ASTNode *idn = ast_child(vars, i);
+          const ASTNode *dim = ast_child(vars, i + 1);
+          if (idn && idn->kind == AST_ID) {
+            const char *name = idn->lexeme;
             int off = *next_off;
-            if (locals_add(&cg->locals, name, off, type_name) > 0) {
+            int is_arr = dim->kind == AST_ARRAY;
+            const char *t = is_arr ? cg_array_type(type_name) : type_name;
+            if (locals_add(&cg->locals, name, off, t) > 0) {
               *next_off += 8;
+              if (is_arr) cg_reserve_frame_array(cg, &cg->locals.v[cg->locals.n - 1], type_name, dim);
             }
           }
         }
@@ -447,31 +572,31 @@ static void collect_locals_from_block(CG *cg, const ASTNode *node, int *next_off
 
   // рекурсивно по детям
   for (int i = 0; i < node->numChildren; i++) {
-    collect_locals_from_block(cg, node->children[i], next_off);
+    collect_locals_from_block(cg, ast_child(node, i), next_off);
   }
 }
 
 static void collect_params_as_locals(CG *cg, const ASTNode *signature, int *next_off) {
   // signature: [0]=typeRef, [1]=id, [2]=args
-  if (!signature || !signature->label || strcmp(signature->label, "signature") != 0) return;
+  if (!signature || signature->kind != AST_SIGNATURE) return;
   if (signature->numChildren < 3) return;
 
-  const ASTNode *args = signature->children[2];
-  if (!args || !args->label || strcmp(args->label, "args") != 0) return;
+  const ASTNode *args = ast_child(signature, 2);
+  if (!args || args->kind != AST_ARGS) return;
   if (args->numChildren == 0) return;
 
-  const ASTNode *arglist = args->children[0];
-  if (!arglist || !arglist->label || strcmp(arglist->label, "arglist") != 0) return;
+  const ASTNode *arglist = ast_child(args, 0);
+  if (!arglist || arglist->kind != AST_ARGLIST) return;
 
   for (int i = 0; i < arglist->numChildren; i++) {
-    const ASTNode *arg = arglist->children[i]; // "arg"
-    if (!arg || !arg->label || strcmp(arg->label, "arg") != 0) continue;
+    const ASTNode *arg = ast_child(arglist, i); // "arg"
+    if (!arg || arg->kind != AST_ARG) continue;
     if (arg->numChildren < 2) continue;
-    const ASTNode *idn = arg->children[1];
-    if (idn && is_token_kind(idn, "id")) {
-      const char *name = after_colon(idn->label);
-      // try extract type name from arg->children[0]
-      const ASTNode *type_node = arg->children[0];
+    const ASTNode *idn = ast_child(arg, 1);
+    if (idn && idn->kind == AST_ID) {
+      const char *name = idn->lexeme;
+      // try extract type name from ast_child(arg, 0)
+      const ASTNode *type_node = ast_child(arg, 0);
       const char *type_name = get_type_name(type_node);
       int off = *next_off;
       if (locals_add(&cg->locals, name, off, type_name) > 0) {
@@ -481,64 +606,550 @@ static void collect_params_as_locals(CG *cg, const ASTNode *signature, int *next
   }
 }
 
-// ------------------------- low-level helpers (stack temp) -------------------------
+// ------------------------- scalar replacement -------------------------
 
-// Мы используем %r12 как temp stack pointer внутри кадра.
-// push: aghi %r12,-8 ; stg %r2,0(%r12)
-// pop -> %r3: lg %r3,0(%r12); aghi %r12,8
+// Локал x класса C, которому присваиваются только new C(...) (не убегающие,
+// escape.h) и который используется только как x.f и x.f = v, заменяется
+// локалами своих полей "x.f": объект не создаётся, поля живут в регистрах
+// или слотах кадра. Вызов метода, передача x куда-либо, x.f += v и т.п.
+// оставляют объект (в кадре, collect_frame_objects).
 
-static void emit_push_r2(CG *cg) {
-  emit(cg, "  aghi %%r12,-8");
-  emit(cg, "  stg  %%r2,0(%%r12)");
+static const char *cg_scalar_field_name(const char *obj, const char *field) {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s.%s", obj, field);
+  return intern_cstr(buf);
 }
 
-static void emit_pop_to_r3(CG *cg) {
-  emit(cg, "  lg   %%r3,0(%%r12)");
-  emit(cg, "  aghi %%r12,8");
+// разложенный локал x или NULL
+static const Local *cg_scalar_local(const CG *cg, const ASTNode *e) {
+  if (!is_kind(e, AST_ID)) return NULL;
+  int i = locals_find(&cg->locals, e->lexeme);
+  return (i >= 0 && cg->locals.v[i].scalar) ? &cg->locals.v[i] : NULL;
 }
 
-// load 64-bit immediate into %r2 (uses const pool if needed)
-static void emit_load_imm64(CG *cg, int64_t v) {
-  if (v >= -32768 && v <= 32767) {
-    emit(cg, "  lghi %%r2,%lld", (long long)v);
+// поле f разложенного x: по классу самого x
+static const FieldInfo *cg_scalar_field(const CG *cg, const Local *l, const ASTNode *field_id) {
+  if (!is_kind(field_id, AST_ID)) return NULL;
+  return cg_class_field(types_find_class(cg->types, l->type), field_id->lexeme);
+}
+
+static void sra_reject(CG *cg, const ASTNode *e) {
+  int i = is_kind(e, AST_ID) ? locals_find(&cg->locals, e->lexeme) : -1;
+  if (i >= 0) cg->locals.v[i].scalar = 0;
+}
+
+// x = new C(...): годится только объект класса x, не убегающий из функции
+static void sra_site(CG *cg, const ASTNode *idn, const ASTNode *rhs) {
+  const Local *l = cg_scalar_local(cg, idn);
+  if (l && !(is_kind(rhs, AST_NEW) && escape_new_is_local(cg->escapes, rhs) &&
+             ast_child(rhs, 0)->lexeme == l->type))
+    sra_reject(cg, idn);
+}
+
+// obj.f: разложение возможно, если у класса x есть поле f
+static void sra_field(CG *cg, const ASTNode *fa) {
+  const ASTNode *obj = ast_child(fa, 0);
+  const Local *l = cg_scalar_local(cg, obj);
+  if (l && !cg_scalar_field(cg, l, ast_child(fa, 1))) sra_reject(cg, obj);
+}
+
+static void sra_scan(CG *cg, const ASTNode *n);
+
+static void sra_scan_from(CG *cg, const ASTNode *n, int first) {
+  for (int i = first; i < n->numChildren; i++) sra_scan(cg, ast_child(n, i));
+}
+
+static void sra_scan(CG *cg, const ASTNode *n) {
+  switch (n->kind) {
+  case AST_ID:
+    sra_reject(cg, n);
     return;
+  case AST_EXPRSTMT: {
+    const ASTNode *a = n->numChildren == 1 ? ast_child(n, 0) : NULL;
+    if (is_kind(a, AST_ASSIGN) && a->numChildren == 2 && is_kind(ast_child(a, 0), AST_ID)) {
+      sra_site(cg, ast_child(a, 0), ast_child(a, 1));
+      sra_scan(cg, ast_child(a, 1));
+      return;
+    }
+    break;
   }
-  if (v >= INT32_MIN && v <= INT32_MAX) {
-    emit(cg, "  lgfi %%r2,%lld", (long long)v);
+  case AST_ASSIGN:
+    if (n->numChildren == 2 && is_kind(ast_child(n, 0), AST_FIELD_ACCESS)) {
+      sra_scan(cg, ast_child(n, 0));
+      sra_scan(cg, ast_child(n, 1));
+      return;
+    }
+    break;
+  case AST_FIELD_ACCESS:
+    if (n->numChildren < 2) break;
+    if (is_kind(ast_child(n, 0), AST_ID)) sra_field(cg, n);
+    else sra_scan(cg, ast_child(n, 0));
     return;
+  case AST_COMPOUND_ASSIGN:
+    if (n->numChildren > 0 && is_kind(ast_child(n, 0), AST_FIELD_ACCESS)) {
+      const ASTNode *fa = ast_child(n, 0);
+      if (fa->numChildren > 0) sra_scan(cg, ast_child(fa, 0)); // obj отвергается
+      sra_scan_from(cg, n, 1);
+      return;
+    }
+    break;
+  case AST_METHOD_CALL:
+  case AST_MEMBER_INDEX:
+    // obj, id, args | index
+    if (n->numChildren > 0) sra_scan(cg, ast_child(n, 0));
+    sra_scan_from(cg, n, 2);
+    return;
+  case AST_CALL:
+  case AST_NEW:
+    sra_scan_from(cg, n, 1);
+    return;
+  case AST_VARDECL:
+    if (n->numChildren >= 2 && ast_child(n, 1)->kind == AST_VARS) {
+      const ASTNode *vars = ast_child(n, 1);
+      for (int i = 0; i + 1 < vars->numChildren; i += 2) {
+        const ASTNode *init = ast_child(vars, i + 1);
+        if (init->numChildren == 0) continue;
+        if (init->kind == AST_ASSIGN) sra_site(cg, ast_child(vars, i), ast_child(init, 0));
+        sra_scan(cg, ast_child(init, 0));
+      }
+    }
+    return;
+  default:
+    break;
   }
-  int lid = cpool_add(&cg->const_pool, v, cg->next_c64_label++);
-  emit(cg, "  larl %%r1,.LCQ%d", lid);
-  emit(cg, "  lg   %%r2,0(%%r1)");
+  sra_scan_from(cg, n, 0);
 }
 
-// load address of string literal into %r2
-static void emit_load_string(CG *cg, const char *txt) {
-  int idx = strpool_find(&cg->str_pool, txt);
-  int lid;
-  if (idx >= 0) lid = cg->str_pool.v[idx].label_id;
-  else lid = strpool_add(&cg->str_pool, txt, cg->next_str_label++);
-  emit(cg, "  larl %%r2,.LC%d", lid);
+// локалы полей "x.f" для всех обращений к разложенным x
+static void sra_add_fields(CG *cg, const ASTNode *n, int *next_off) {
+  if (is_kind(n, AST_FIELD_ACCESS) && n->numChildren >= 2) {
+    const Local *l = cg_scalar_local(cg, ast_child(n, 0));
+    const FieldInfo *f = l ? cg_scalar_field(cg, l, ast_child(n, 1)) : NULL;
+    if (f && locals_add(&cg->locals, cg_scalar_field_name(l->name, f->name), *next_off, f->type_name) > 0)
+      *next_off += 8;
+  }
+  for (int i = 0; i < n->numChildren; i++) sra_add_fields(cg, ast_child(n, i), next_off);
 }
 
-// local var: load -> %r2
-static void emit_load_local(CG *cg, const char *name) {
-  int off = 0;
-  if (!locals_get_offset(&cg->locals, name, &off)) {
+// кандидаты — локалы тела (не параметры) с типом-классом
+static void mark_scalar_objects(CG *cg, const ASTNode *body, int first, int *next_off) {
+  if (!body) return;
+  for (int i = first; i < cg->locals.n; i++) {
+    Local *l = &cg->locals.v[i];
+    l->scalar = !l->addr_taken && !l->array_bytes && types_find_class(cg->types, l->type);
+  }
+  sra_scan(cg, body);
+  sra_add_fields(cg, body, next_off);
+}
+
+// ------------------------- frame objects -------------------------
+
+// new C(...), объект которого не убегает из функции, получает своё место
+// в кадре (одно на узел: повторное выполнение в цикле затирает прежний
+// объект, на который уже никто не ссылается); бюджет общий с массивами
+static void collect_frame_objects(CG *cg, const ASTNode *node) {
+  if (!node) return;
+  // x = new C(...) разложенного x: объекта нет вовсе
+  if (node->kind == AST_ASSIGN && node->numChildren == 2 && cg_scalar_local(cg, ast_child(node, 0)))
+    return;
+  if (node->kind == AST_VARS) {
+    for (int i = 0; i + 1 < node->numChildren; i += 2)
+      if (!cg_scalar_local(cg, ast_child(node, i))) collect_frame_objects(cg, ast_child(node, i + 1));
+    return;
+  }
+  if (node->kind == AST_NEW && escape_new_is_local(cg->escapes, node)) {
+    const ClassInfo *ci = types_find_class(cg->types, ast_child(node, 0)->lexeme);
+    int bytes = ci ? ci->size_bytes : 0;
+    if (bytes > 0 && cg->frame_blocks + bytes <= CG_FRAME_BLOCKS_MAX) {
+      if (cg->frame_objs_n == cg->frame_objs_cap) {
+        int nc = cg->frame_objs_cap ? cg->frame_objs_cap * 2 : 8;
+        FrameObject *nv = (FrameObject *)realloc(cg->frame_objs, (size_t)nc * sizeof(*nv));
+        if (!nv) return;
+        cg->frame_objs = nv;
+        cg->frame_objs_cap = nc;
+      }
+      FrameObject *fo = &cg->frame_objs[cg->frame_objs_n++];
+      fo->site = node;
+      fo->bytes = bytes;
+      fo->off = 0;
+      cg->frame_blocks += bytes;
+    }
+  }
+  for (int i = 0; i < node->numChildren; i++) collect_frame_objects(cg, ast_child(node, i));
+}
+
+static const FrameObject *cg_frame_object(const CG *cg, const ASTNode *site) {
+  for (int i = 0; i < cg->frame_objs_n; i++)
+    if (cg->frame_objs[i].site == site) return &cg->frame_objs[i];
+  return NULL;
+}
+
+// ------------------------- register allocation -------------------------
+
+// Allocatable registers. r1 (addresses/const pool/move cycles), r2 (result),
+// r3/r4 (dividend pair and scratch) stay outside the pool, r11 is the frame
+// base, r14/r15 are the link register and sp. r5/r6 are argument registers
+// and get clobbered by our own call sequences, so like r0 they only hold
+// values that do not live across a call. r7-r10/r12/r13 are restored by every
+// epilogue (stmg/lmg %r6,%r15) and survive calls. r0 goes last: it cannot
+// be an address base.
+static const RegPool k_reg_pool = {
+  {5, 6, 0, 7, 8, 9, 10, 12, 13},
+  {0, 0, 0, 1, 1, 1, 1, 1, 1},
+  9
+};
+
+static int ra_push_int(int **v, int *n, int *cap, int x) {
+  if (*n == *cap) {
+    int nc = *cap ? (*cap * 2) : 16;
+    int *nv = (int *)realloc(*v, (size_t)nc * sizeof(int));
+    if (!nv) return -1;
+    *v = nv;
+    *cap = nc;
+  }
+  (*v)[(*n)++] = x;
+  return 0;
+}
+
+static int ra_loop_weight(int depth) {
+  int w = 1;
+  for (int i = 0; i < depth && i < 5; i++) w *= 8;
+  return w;
+}
+
+static int ra_add_interval(RAState *ra) {
+  if (ra->n == ra->cap) {
+    int nc = ra->cap ? (ra->cap * 2) : 32;
+    LiveInterval *nv = (LiveInterval *)realloc(ra->iv, (size_t)nc * sizeof(LiveInterval));
+    if (!nv) return -1;
+    ra->iv = nv;
+    ra->cap = nc;
+  }
+  LiveInterval *iv = &ra->iv[ra->n];
+  memset(iv, 0, sizeof(*iv));
+  iv->start = iv->end = -1;
+  iv->reg = RA_NO_REG;
+  return ra->n++;
+}
+
+// records a use/def of interval `idx` at a new program point (dry pass only)
+static void ra_touch(CG *cg, int idx) {
+  RAState *ra = &cg->ra;
+  if (!ra->dry || idx < 0 || idx >= ra->n) return;
+  int p = ra->pos++;
+  LiveInterval *iv = &ra->iv[idx];
+  if (iv->start < 0) iv->start = p;
+  iv->end = p;
+  iv->weight += ra_loop_weight(ra->loop_depth);
+}
+
+static void ra_loop_begin(CG *cg, int *start) {
+  *start = cg->ra.pos++;
+  cg->ra.loop_depth++;
+}
+
+static void ra_loop_end(CG *cg, int start) {
+  RAState *ra = &cg->ra;
+  ra->loop_depth--;
+  if (!ra->dry) return;
+  ra_push_int(&ra->loops, &ra->loops_n, &ra->loops_cap, start);
+  ra_push_int(&ra->loops, &ra->loops_n, &ra->loops_cap, ra->pos++);
+}
+
+// every brasl goes through here so the dry pass sees the call points
+static void emit_call(CG *cg, const char *sym) {
+  RAState *ra = &cg->ra;
+  if (ra->dry) ra_push_int(&ra->calls, &ra->calls_n, &ra->calls_cap, ra->pos++);
+  emit(cg, "  brasl %%r14,%s", sym);
+}
+
+// virtual call: object in r2, function pointer taken from vtable[slot]
+static void emit_call_virtual(CG *cg, int slot) {
+  RAState *ra = &cg->ra;
+  if (ra->dry) ra_push_int(&ra->calls, &ra->calls_n, &ra->calls_cap, ra->pos++);
+  emit(cg, "  lg   %%r1,0(%%r2)"); // r1 = vptr
+  emit(cg, "  lg   %%r1,%d(%%r1)", slot * 8);
+  emit(cg, "  basr %%r14,%%r1");
+}
+
+// -------- expression temporaries --------
+
+// Temporaries replace the old %r12 push/pop stack: each one is an interval
+// from the point where r2 is saved to the point where it is consumed.
+static int temp_new(CG *cg) {
+  RAState *ra = &cg->ra;
+  int t = ra->next_temp++;
+  if (ra->dry) {
+    int idx = ra_add_interval(ra);
+    if (idx >= 0) ra_touch(cg, idx);
+  }
+  return t;
+}
+
+static int temp_reg(const CG *cg, int t) {
+  int idx = cg->ra.nlocals + t;
+  return (idx < cg->ra.n) ? cg->ra.iv[idx].reg : RA_NO_REG;
+}
+
+static void temp_save_r2(CG *cg, int t) {
+  int r = temp_reg(cg, t);
+  if (r != RA_NO_REG) emit(cg, "  lgr  %%r%d,%%r2", r);
+  else if (!cg->ra.dry) emit(cg, "  stg  %%r2,%d(%%r11)", cg->ra.temp_off[t]);
+}
+
+// consumes temporary t; returns the register holding it (reloads into
+// `scratch` if spilled). as_base: the value is used as an address base,
+// where r0 means "no register", so it is copied to scratch as well.
+static int temp_use(CG *cg, int t, int scratch, int as_base) {
+  ra_touch(cg, cg->ra.nlocals + t);
+  int r = temp_reg(cg, t);
+  if (r == RA_NO_REG) {
+    if (!cg->ra.dry) emit(cg, "  lg   %%r%d,%d(%%r11)", scratch, cg->ra.temp_off[t]);
+    return scratch;
+  }
+  if (as_base && r == 0) {
+    emit(cg, "  lgr  %%r%d,%%r0", scratch);
+    return scratch;
+  }
+  return r;
+}
+
+// -------- locals --------
+
+// narrow fields and array elements (types_size_of): 1 byte zero-extended,
+// 4 bytes sign- or zero-extended, otherwise a full doubleword
+static const char *cg_load_op(int size, int is_signed) {
+  return size == 1 ? "llgc" : size == 4 ? (is_signed ? "lgf " : "llgf") : "lg  ";
+}
+
+static const char *cg_store_op(int size) {
+  return size == 1 ? "stc " : size == 4 ? "st  " : "stg ";
+}
+
+// index -> byte offset: sllg by log2 of the element size
+static int cg_size_shift(int size) { return size == 1 ? 0 : size == 4 ? 2 : 3; }
+
+static void emit_field_load(CG *cg, int dst, const FieldInfo *f, int base) {
+  emit(cg, "  %s %%r%d,%d(%%r%d)", cg_load_op(f->size, f->is_signed), dst, f->offset, base);
+}
+
+static void emit_field_store(CG *cg, int src, const FieldInfo *f, int base) {
+  emit(cg, "  %s %%r%d,%d(%%r%d)", cg_store_op(f->size), src, f->offset, base);
+}
+
+// bare field name inside a method: this.<name>
+static const FieldInfo *cg_this_field(CG *cg, const char *name) {
+  if (!cg->cur_class || name == cg->sym_this) return NULL;
+  if (locals_find(&cg->locals, cg->sym_this) < 0) return NULL;
+  return cg_class_field(types_find_class(cg->types, cg->cur_class), name);
+}
+
+static void emit_load_local_to(CG *cg, const char *name, int dst);
+
+// r1 = this (field stores/loads address through r1)
+static void emit_load_this_r1(CG *cg) {
+  emit_load_local_to(cg, cg->sym_this, 1);
+}
+
+// local var: load -> %rDst
+static void emit_load_local_to(CG *cg, const char *name, int dst) {
+  int idx = locals_find(&cg->locals, name);
+  if (idx < 0) {
+    const FieldInfo *f = cg_this_field(cg, name);
+    if (f) {
+      emit_load_this_r1(cg);
+      emit_field_load(cg, dst, f, 1); // dst = this.<name>
+      return;
+    }
     // unknown local — debug-friendly fallback
-    emit(cg, "  lghi %%r2,0");
+    emit(cg, "  lghi %%r%d,0", dst);
     return;
   }
-  emit(cg, "  lg   %%r2,%d(%%r11)", off);
+  ra_touch(cg, idx);
+  const Local *l = &cg->locals.v[idx];
+  if (l->reg != RA_NO_REG) {
+    if (l->reg != dst) emit(cg, "  lgr  %%r%d,%%r%d", dst, l->reg);
+  } else {
+    emit(cg, "  lg   %%r%d,%d(%%r11)", dst, l->offset);
+  }
+}
+
+static void emit_load_local(CG *cg, const char *name) {
+  emit_load_local_to(cg, name, 2);
 }
 
 // local var: store from %r2
 static void emit_store_local(CG *cg, const char *name) {
-  int off = 0;
-  if (!locals_get_offset(&cg->locals, name, &off)) {
+  int idx = locals_find(&cg->locals, name);
+  if (idx < 0) {
+    const FieldInfo *f = cg_this_field(cg, name);
+    if (f) {
+      emit_load_this_r1(cg);
+      emit_field_store(cg, 2, f, 1);
+    }
     return;
   }
-  emit(cg, "  stg  %%r2,%d(%%r11)", off);
+  ra_touch(cg, idx);
+  const Local *l = &cg->locals.v[idx];
+  if (l->reg != RA_NO_REG) emit(cg, "  lgr  %%r%d,%%r2", l->reg);
+  else emit(cg, "  stg  %%r2,%d(%%r11)", l->offset);
+}
+
+// -------- simple operands --------
+
+// Locals and integer literals are used in place (register, memory or
+// immediate operand) instead of being evaluated into r2 first.
+typedef enum { OPND_REG, OPND_MEM, OPND_IMM } OperandKind;
+
+typedef struct {
+  OperandKind kind;
+  int reg;
+  int off;
+  int64_t imm;
+} Operand;
+
+static int is_int_literal(const ASTNode *n) {
+  return is_kind(n, AST_DEC) || is_kind(n, AST_HEX) ||
+         is_kind(n, AST_BITS) || is_kind(n, AST_BOOL) ||
+         is_kind(n, AST_CHAR);
+}
+
+static int operand_is_simple(const CG *cg, const ASTNode *n) {
+  if (!n) return 0;
+  if (is_int_literal(n)) return 1;
+  return is_kind(n, AST_ID) && locals_find(&cg->locals, n->lexeme) >= 0;
+}
+
+// only valid if operand_is_simple(n)
+static Operand operand_get(CG *cg, const ASTNode *n) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  if (is_int_literal(n)) {
+    o.kind = OPND_IMM;
+    o.imm = parse_int_literal_label(n);
+    return o;
+  }
+  int idx = locals_find(&cg->locals, n->lexeme);
+  ra_touch(cg, idx);
+  const Local *l = &cg->locals.v[idx];
+  if (l->reg != RA_NO_REG) {
+    o.kind = OPND_REG;
+    o.reg = l->reg;
+  } else {
+    o.kind = OPND_MEM;
+    o.off = l->offset;
+  }
+  return o;
+}
+
+// whether evaluating n may change a local or memory
+static int expr_has_side_effects(const ASTNode *n) {
+  if (!n) return 0;
+  switch (n->kind) {
+  case AST_ASSIGN:
+  case AST_COMPOUND_ASSIGN:
+  case AST_ASSIGN_INDEX:
+  case AST_CALL:
+  case AST_METHOD_CALL:
+  case AST_NEW:
+    return 1;
+  default:
+    break;
+  }
+  for (int i = 0; i < n->numChildren; i++) {
+    if (expr_has_side_effects(ast_child(n, i))) return 1;
+  }
+  return 0;
+}
+
+static int fits_s16(int64_t v) { return v >= -32768 && v <= 32767; }
+static int fits_s32(int64_t v) { return v >= INT32_MIN && v <= INT32_MAX; }
+
+// load 64-bit immediate into %rDst (uses const pool if needed)
+static void emit_load_imm64_to(CG *cg, int dst, int64_t v) {
+  if (fits_s16(v)) {
+    emit(cg, "  lghi %%r%d,%lld", dst, (long long)v);
+    return;
+  }
+  if (fits_s32(v)) {
+    emit(cg, "  lgfi %%r%d,%lld", dst, (long long)v);
+    return;
+  }
+  int lid = cpool_add(&cg->const_pool, v, cg->next_c64_label++);
+  emit(cg, "  larl %%r1,.LCQ%d", lid);
+  emit(cg, "  lg   %%r%d,0(%%r1)", dst);
+}
+
+static void emit_load_imm64(CG *cg, int64_t v) {
+  emit_load_imm64_to(cg, 2, v);
+}
+
+static void emit_load_operand(CG *cg, int dst, const Operand *o) {
+  if (o->kind == OPND_IMM) emit_load_imm64_to(cg, dst, o->imm);
+  else if (o->kind == OPND_REG) { if (o->reg != dst) emit(cg, "  lgr  %%r%d,%%r%d", dst, o->reg); }
+  else emit(cg, "  lg   %%r%d,%d(%%r11)", dst, o->off);
+}
+
+// -------- parallel moves --------
+
+// Register shuffles into argument registers (before a call) and from them
+// (parameters at entry). Register sources are sequenced so no source is
+// overwritten before it is read; cycles are broken through r1. Memory and
+// immediate sources are loaded afterwards since they cannot be clobbered.
+typedef struct {
+  int dst;
+  Operand src;
+} PMove;
+
+static void emit_parallel_moves(CG *cg, PMove *mv, int n) {
+  int done[8] = {0};
+  if (n > 8) n = 8;
+
+  for (;;) {
+    int pending = 0, progress = 0;
+    for (int i = 0; i < n; i++) {
+      if (done[i] || mv[i].src.kind != OPND_REG) continue;
+      if (mv[i].src.reg == mv[i].dst) { done[i] = 1; continue; }
+      int blocked = 0;
+      for (int j = 0; j < n; j++) {
+        if (j != i && !done[j] && mv[j].src.kind == OPND_REG && mv[j].src.reg == mv[i].dst) {
+          blocked = 1;
+          break;
+        }
+      }
+      pending++;
+      if (blocked) continue;
+      emit(cg, "  lgr  %%r%d,%%r%d", mv[i].dst, mv[i].src.reg);
+      done[i] = 1;
+      progress = 1;
+    }
+    if (!pending) break;
+    if (!progress) {
+      // cycle: park one destination's current value in r1
+      for (int i = 0; i < n; i++) {
+        if (done[i] || mv[i].src.kind != OPND_REG) continue;
+        int d = mv[i].dst;
+        emit(cg, "  lgr  %%r1,%%r%d", d);
+        for (int j = 0; j < n; j++) {
+          if (!done[j] && mv[j].src.kind == OPND_REG && mv[j].src.reg == d) mv[j].src.reg = 1;
+        }
+        break;
+      }
+    }
+  }
+
+  for (int i = 0; i < n; i++) {
+    if (!done[i]) emit_load_operand(cg, mv[i].dst, &mv[i].src);
+  }
+}
+
+// load address of string literal into %r2
+static void emit_load_string(CG *cg, const char *txt) {
+  int idx = strpool_find(&cg->str_pool, txt);
+  int lid;
+  if (idx >= 0) lid = cg->str_pool.v[idx].label_id;
+  else lid = strpool_add(&cg->str_pool, txt, cg->next_str_label++);
+  emit(cg, "  larl %%r2,.LC%d", lid);
 }
 
 // ------------------------- expression generation -------------------------
@@ -549,126 +1160,346 @@ static int is_cmp_op(const char *op) {
      !strcmp(op, "==") || !strcmp(op, "!="));
 }
 
+// Temporary holding a value that will be read by a parallel move.
+static Operand temp_operand(CG *cg, int t) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  ra_touch(cg, cg->ra.nlocals + t);
+  int r = temp_reg(cg, t);
+  if (r != RA_NO_REG) {
+    o.kind = OPND_REG;
+    o.reg = r;
+  } else {
+    o.kind = OPND_MEM;
+    o.off = cg->ra.dry ? 0 : cg->ra.temp_off[t];
+  }
+  return o;
+}
+
+// Evaluates n <= 5 call arguments left-to-right into r2..r(1+n).
+// Simple arguments (locals/literals) that no later argument can change are
+// read in place by the final parallel move, the last evaluated one stays in
+// r2, the rest are held in temporaries.
+static void gen_call_args(CG *cg, const ASTNode **exprs, int n) {
+  int deferred[5] = {0};
+  int temps[5] = {0};
+  int last_eval = -1;
+  int later_fx = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    deferred[i] = operand_is_simple(cg, exprs[i]) && !later_fx;
+    if (expr_has_side_effects(exprs[i])) later_fx = 1;
+    if (!deferred[i] && last_eval < 0) last_eval = i;
+  }
+
+  for (int i = 0; i < n; i++) {
+    if (deferred[i]) continue;
+    gen_expr(cg, exprs[i]);
+    if (i != last_eval) {
+      temps[i] = temp_new(cg);
+      temp_save_r2(cg, temps[i]);
+    }
+  }
+
+  PMove mv[5];
+  memset(mv, 0, sizeof(mv));
+  for (int i = 0; i < n; i++) {
+    mv[i].dst = 2 + i;
+    if (deferred[i]) {
+      mv[i].src = operand_get(cg, exprs[i]);
+    } else if (i == last_eval) {
+      mv[i].src.kind = OPND_REG;
+      mv[i].src.reg = 2;
+    } else {
+      mv[i].src = temp_operand(cg, temps[i]);
+    }
+  }
+  emit_parallel_moves(cg, mv, n);
+}
+
+// ------------------------- static types of expressions -------------------------
+
+// type name of an expression (typeinfer.h: int, int_arr, List_int) or NULL
+static const char *cg_expr_type(const CG *cg, const ASTNode *e) {
+  if (e && e == cg->this_id) return cg->cur_class;
+  return typeinfer_get(cg->etypes, e);
+}
+
+// element size of an array expression (T_arr, string); 8 when unknown
+static int cg_elem_size(const CG *cg, const ASTNode *arr, int *is_signed) {
+  const char *t = typeinfer_elem_type(cg_expr_type(cg, arr));
+  if (!t) {
+    *is_signed = 1;
+    return 8;
+  }
+  return types_size_of(t, is_signed);
+}
+
+// call of method_name on the object in r2 (args already in r3..):
+// direct when CHA proves a single target, otherwise through the vtable
+static void emit_method_dispatch(CG *cg, const char *static_type, const char *method_name) {
+  int slot = -1;
+  const char *impl = NULL;
+  if (static_type && types_method_slot_and_label(cg->types, static_type, method_name, &slot, &impl)) {
+    // CHA: no subclass of the static type overrides the slot -> the only
+    // possible target is impl, call it directly
+    const ClassInfo *ci = types_find_class(cg->types, static_type);
+    int k = symmap_get(&cg->method_impl, impl);
+    if (!ci->vtable[slot].overridden && k >= 0) {
+      emit(cg, "  # devirtualized %s.%s -> %s", static_type, method_name, cg->defined_names[k]);
+      emit_call(cg, cg->defined_names[k]);
+      return;
+    }
+    emit(cg, "  # virtual call %s.%s, slot %d", static_type, method_name, slot);
+    emit_call_virtual(cg, slot);
+    return;
+  }
+
+  // Class unknown to TypeEnv (e.g. provided by the runtime): call the
+  // mangled function <Type>__<method> directly.
+  if (static_type && !types_find_class(cg->types, static_type)) {
+    char mangled[256];
+    snprintf(mangled, sizeof(mangled), "%s__%s", static_type, method_name);
+    emit(cg, "  # static dispatch to %s (object has type %s)", mangled, static_type);
+    emit_call(cg, mangled);
+    return;
+  }
+
+  // Unknown static type: the slot is still known if every class with this
+  // method keeps it in the same slot
+  slot = symmap_get(&cg->any_slot, method_name);
+  if (slot >= 0 && slot != CG_SLOT_AMBIGUOUS) {
+    emit(cg, "  # virtual call .%s, slot %d", method_name, slot);
+    emit_call_virtual(cg, slot);
+    return;
+  }
+
+  emit(cg, "  # ERROR: cannot resolve method '%s'", method_name);
+  emit(cg, "  lghi %%r2,0");
+}
+
+// symbol for a call of fname(args): the function itself, else the overload
+// matching the static argument types (fname__T1_T2), else a mangled variant
+// with the same arity
+static const char *resolve_call(CG *cg, const char *fname, const ASTNode *const *args, int nargs) {
+  if (cg_has_defined_function(cg, fname) || is_standard_library_func(fname)) return fname;
+
+  if (nargs > 0) {
+    char buf[256]; // fname__T1_T2
+    int n = snprintf(buf, sizeof(buf), "%s_", fname);
+    for (int i = 0; i < nargs && n > 0 && n < (int)sizeof(buf); i++) {
+      const char *t = cg_expr_type(cg, args[i]);
+      if (!t) { n = -1; break; }
+      n += snprintf(buf + n, sizeof(buf) - (size_t)n, "_%s", t);
+    }
+    if (n > 0 && n < (int)sizeof(buf)) {
+      const char *sym = intern_cstr(buf);
+      if (cg_has_defined_function(cg, sym)) return sym;
+    }
+  }
+
+  /* Compatibility fallback for calls whose argument types are not known
+     statically: the first definition `fname__...`, preferring the same
+     number of arguments. */
+  size_t base_len = strlen(fname);
+  const char *first = NULL;
+  for (int i = 0; i < cg->defined_n; i++) {
+    const char *dn = cg->defined_names[i];
+    if (!dn || strncmp(dn, fname, base_len) != 0 || dn[base_len] != '_' || dn[base_len + 1] != '_')
+      continue;
+    if (cg->defined_arity && cg->defined_arity[i] == nargs) return dn;
+    if (!first) first = dn;
+  }
+  return first ? first : fname;
+}
+
 static void gen_call(CG *cg, const ASTNode *call) {
   // call: children[0]=id, children[1]=args
-  const ASTNode *idn = (call->numChildren > 0) ? call->children[0] : NULL;
-  const char *fname = (idn && is_token_kind(idn, "id")) ? after_colon(idn->label) : NULL;
+  const ASTNode *idn = (call->numChildren > 0) ? ast_child(call, 0) : NULL;
+  const char *fname = (idn && idn->kind == AST_ID) ? idn->lexeme : NULL;
 
-  const ASTNode *args = (call->numChildren > 1) ? call->children[1] : NULL;
+  const ASTNode *args = (call->numChildren > 1) ? ast_child(call, 1) : NULL;
   const ASTNode *list = NULL;
   int nargs = 0;
 
-  if (args && args->label && strcmp(args->label, "args") == 0 && args->numChildren > 0) {
-    list = args->children[0];
-    if (list && list->label && strcmp(list->label, "list") == 0) {
+  if (args && args->kind == AST_ARGS && args->numChildren > 0) {
+    list = ast_child(args, 0);
+    if (list && list->kind == AST_LIST) {
       nargs = list->numChildren;
     }
   }
 
-  // Evaluate args left-to-right, push each result.
-  for (int i = 0; i < nargs; i++) {
-    gen_expr(cg, list->children[i]);
-    emit_push_r2(cg);
-  }
+  // unqualified call of a method of the current class: this.fname(...)
+  int implicit_this = fname && cg->cur_class && cg->this_id &&
+                      locals_find(&cg->locals, cg->sym_this) >= 0 &&
+                      types_method_slot_and_label(cg->types, cg->cur_class, fname, NULL, NULL);
 
-  if (nargs > 5) {
+  int total_args = implicit_this + nargs;
+  if (total_args > 5) {
+    for (int i = 0; i < nargs; i++) gen_expr(cg, ast_child(list, i));
     emit(cg, "  # ERROR: >5 args not supported yet, extra args ignored");
-    // Pop anyway to keep stack balanced:
-    for (int i = 0; i < nargs; i++) emit_pop_to_r3(cg);
     emit(cg, "  lghi %%r2,0");
     return;
   }
 
-  // Pop обратно в r2..r(2+nargs-1) в обратном порядке
-  for (int i = nargs - 1; i >= 0; i--) {
-    int reg = 2 + i; // r2..r6
-    emit(cg, "  lg   %%r%d,0(%%r12)", reg);
-    emit(cg, "  aghi %%r12,8");
-  }
+  // Evaluate args left-to-right into r2..r(2+total_args-1)
+  const ASTNode *exprs[5];
+  if (implicit_this) exprs[0] = cg->this_id;
+  for (int i = 0; i < nargs; i++) exprs[implicit_this + i] = ast_child(list, i);
+  gen_call_args(cg, exprs, total_args);
 
   if (!fname || !*fname) {
     emit(cg, "  # ERROR: call without function name");
     emit(cg, "  lghi %%r2,0");
     return;
   }
-  // If the name refers to an actually defined top-level function, call it
-  // directly (don't mangle). Otherwise, if we're inside a mangled method
-  // (Class__method) and the call is unqualified, treat it as a method of
-  // the same class and mangle to Class__name. Standard library functions
-  // are also left unmangled.
-  if (cg_has_defined_function(cg, fname) || is_standard_library_func(fname)) {
-    emit(cg, "  brasl %%r14,%s", fname);
-  } else if (cg->cur_func && strstr(cg->cur_func, "__") && strstr(fname, "__") == NULL) {
-    const char *p = strstr(cg->cur_func, "__");
-    if (p) {
-      size_t cls_len = (size_t)(p - cg->cur_func);
-      char mangled[256];
-      if (cls_len + 2 + strlen(fname) < sizeof(mangled)) {
-        memcpy(mangled, cg->cur_func, cls_len);
-        mangled[cls_len] = '\0';
-        strcat(mangled, "__");
-        strcat(mangled, fname);
-        emit(cg, "  brasl %%r14,%s", mangled);
-      } else {
-        emit(cg, "  brasl %%r14,%s", fname);
-      }
+
+  if (implicit_this) emit_method_dispatch(cg, cg->cur_class, fname);
+  else emit_call(cg, resolve_call(cg, fname, exprs, nargs));
+
+  if (!strcmp(fname, "puts") || !strcmp(fname, "printf")) {
+    emit(cg, "  # Flush stdout after %s to ensure immediate output", fname);
+    emit(cg, "  larl %%r2,stdout");
+    emit(cg, "  lg   %%r2,0(%%r2)");
+    emit_call(cg, "fflush");
+  }
+}
+
+// Evaluates the operands of a binary operation. Either
+//   returns 0: r2 = L, *rhs = right operand used in place (simple R), or
+//   returns 1: r2 = R, *lhs_reg = register holding L (r3 if reloaded).
+static int gen_operands(CG *cg, const ASTNode *L, const ASTNode *R, Operand *rhs, int *lhs_reg) {
+  if (operand_is_simple(cg, R)) {
+    gen_expr(cg, L);
+    *rhs = operand_get(cg, R);
+    return 0;
+  }
+  if (operand_is_simple(cg, L) && !expr_has_side_effects(R)) {
+    gen_expr(cg, R);
+    Operand lo = operand_get(cg, L);
+    if (lo.kind == OPND_REG) {
+      *lhs_reg = lo.reg;
     } else {
-      emit(cg, "  brasl %%r14,%s", fname);
+      emit_load_operand(cg, 3, &lo);
+      *lhs_reg = 3;
     }
+    return 1;
+  }
+  gen_expr(cg, L);
+  int t = temp_new(cg);
+  temp_save_r2(cg, t);
+  gen_expr(cg, R);
+  *lhs_reg = temp_use(cg, t, 3, 0);
+  return 1;
+}
+
+// r2 = r2 <op> o
+static void emit_arith_operand(CG *cg, const char *op, const Operand *o) {
+  Operand x = *o;
+  if (x.kind == OPND_IMM) {
+    int64_t v = x.imm;
+    if (!strcmp(op, "+") && fits_s16(v)) { emit(cg, "  aghi %%r2,%lld", (long long)v); return; }
+    if (!strcmp(op, "+") && fits_s32(v)) { emit(cg, "  agfi %%r2,%lld", (long long)v); return; }
+    if (!strcmp(op, "-") && fits_s32(v) && fits_s16(-v)) { emit(cg, "  aghi %%r2,%lld", (long long)-v); return; }
+    if (!strcmp(op, "-") && fits_s32(v) && fits_s32(-v)) { emit(cg, "  agfi %%r2,%lld", (long long)-v); return; }
+    if (!strcmp(op, "*") && fits_s16(v)) { emit(cg, "  mghi %%r2,%lld", (long long)v); return; }
+    if (!strcmp(op, "*") && fits_s32(v)) { emit(cg, "  msgfi %%r2,%lld", (long long)v); return; }
+    // everything else takes the constant from r4 (r3 is the dividend)
+    emit_load_imm64_to(cg, 4, v);
+    x.kind = OPND_REG;
+    x.reg = 4;
+  }
+
+  if (!strcmp(op, "+")) {
+    if (x.kind == OPND_REG) emit(cg, "  agr  %%r2,%%r%d", x.reg);
+    else emit(cg, "  ag   %%r2,%d(%%r11)", x.off);
+  } else if (!strcmp(op, "-")) {
+    if (x.kind == OPND_REG) emit(cg, "  sgr  %%r2,%%r%d", x.reg);
+    else emit(cg, "  sg   %%r2,%d(%%r11)", x.off);
+  } else if (!strcmp(op, "*")) {
+    if (x.kind == OPND_REG) emit(cg, "  msgr %%r2,%%r%d", x.reg);
+    else emit(cg, "  msg  %%r2,%d(%%r11)", x.off);
+  } else if (!strcmp(op, "/") || !strcmp(op, "%")) {
+    // dividend pair: r2:r3, remainder in r2, quotient in r3
+    emit(cg, "  lgr  %%r3,%%r2");
+    emit(cg, "  srag %%r2,%%r2,63"); // sign-extend high part (all 0 or all 1)
+    if (x.kind == OPND_REG) emit(cg, "  dsgr %%r2,%%r%d", x.reg);
+    else emit(cg, "  dsg  %%r2,%d(%%r11)", x.off);
+    if (!strcmp(op, "/")) emit(cg, "  lgr  %%r2,%%r3"); // вернуть quotient в r2
   } else {
-    /* If there is no exact top-level function named `fname`, try to
-       find a mangled variant defined in this translation unit with the
-       form `fname__...` and call that. This is a pragmatic compatibility
-       fix for simple cases where the source calls an overloaded name
-       (e.g., `sum`) but codegen produced mangled definitions
-       (`sum__List_int`, `sum__List_Vec2i`). Prefer the first match. */
-    const char *mangled_found = NULL;
-    if (cg && fname) {
-      size_t base_len = strlen(fname);
-      /* Prefer a candidate with the same number of arguments (arity) when possible. */
-      if (cg->defined_arity) {
-        for (int i = 0; i < cg->defined_n; i++) {
-          const char *dn = cg->defined_names[i];
-          if (!dn) continue;
-          if (strncmp(dn, fname, base_len) == 0 && dn[base_len] == '_' && dn[base_len+1] == '_' && cg->defined_arity[i] == nargs) {
-            mangled_found = dn;
-            break;
-          }
-        }
-      }
-      /* Fallback: first prefix match if exact-arity candidate not found. */
-      if (!mangled_found) {
-        for (int i = 0; i < cg->defined_n; i++) {
-          const char *dn = cg->defined_names[i];
-          if (!dn) continue;
-          if (strncmp(dn, fname, base_len) == 0 && dn[base_len] == '_' && dn[base_len+1] == '_') {
-            mangled_found = dn;
-            break;
-          }
-        }
-      }
+    emit(cg, "  # ERROR: unknown binop '%s'", op);
+    emit(cg, "  lghi %%r2,0");
+  }
+}
+
+// r2 = T <op> r2 (T holds the left operand and is not modified)
+static void emit_arith_reg_r2(CG *cg, const char *op, int t) {
+  if (!strcmp(op, "+")) {
+    emit(cg, "  agr  %%r2,%%r%d", t);
+  } else if (!strcmp(op, "-")) {
+    emit(cg, "  lcgr %%r2,%%r2");
+    emit(cg, "  agr  %%r2,%%r%d", t); // r2 = L - R
+  } else if (!strcmp(op, "*")) {
+    emit(cg, "  msgr %%r2,%%r%d", t);
+  } else if (!strcmp(op, "/") || !strcmp(op, "%")) {
+    emit(cg, "  lgr  %%r4,%%r2");   // divisor = R
+    if (t != 3) emit(cg, "  lgr  %%r3,%%r%d", t);
+    emit(cg, "  srag %%r2,%%r3,63");
+    emit(cg, "  dsgr %%r2,%%r4");   // remainder in r2, quotient in r3
+    if (!strcmp(op, "/")) emit(cg, "  lgr  %%r2,%%r3");
+  } else {
+    emit(cg, "  # ERROR: unknown binop '%s'", op);
+    emit(cg, "  lghi %%r2,0");
+  }
+}
+
+static void gen_arith(CG *cg, const ASTNode *L, const char *op, const ASTNode *R) {
+  Operand rhs;
+  int lhs_reg = 3;
+  if (!gen_operands(cg, L, R, &rhs, &lhs_reg)) emit_arith_operand(cg, op, &rhs);
+  else emit_arith_reg_r2(cg, op, lhs_reg);
+}
+
+// sets CC based on (L - R)
+static void gen_compare(CG *cg, const ASTNode *L, const ASTNode *R) {
+  Operand rhs;
+  int lhs_reg = 3;
+  if (operand_is_simple(cg, L) && operand_is_simple(cg, R)) {
+    // both in place: compare a register local without copying it to r2
+    Operand lo = operand_get(cg, L);
+    rhs = operand_get(cg, R);
+    if (lo.kind == OPND_REG && rhs.kind == OPND_REG) {
+      emit(cg, "  cgr  %%r%d,%%r%d", lo.reg, rhs.reg);
+      return;
     }
-    if (mangled_found) {
-      emit(cg, "  brasl %%r14,%s", mangled_found);
-    } else {
-      emit(cg, "  brasl %%r14,%s", fname); // result in r2
+    if (lo.kind == OPND_REG && rhs.kind == OPND_IMM && fits_s16(rhs.imm)) {
+      emit(cg, "  cghi %%r%d,%lld", lo.reg, (long long)rhs.imm);
+      return;
     }
+    emit_load_operand(cg, 2, &lo);
+  } else if (gen_operands(cg, L, R, &rhs, &lhs_reg)) {
+    emit(cg, "  cgr  %%r%d,%%r2", lhs_reg);
+    return;
   }
-  
-  if (!strcmp(fname, "puts") || !strcmp(fname, "printf")) {
-    emit(cg, "  # Flush stdout after %s to ensure immediate output", fname);
-    emit(cg, "  larl %%r2,stdout");
-    emit(cg, "  lg   %%r2,0(%%r2)");
-    emit(cg, "  brasl %%r14,fflush");
+  if (rhs.kind == OPND_IMM && fits_s16(rhs.imm)) {
+    emit(cg, "  cghi %%r2,%lld", (long long)rhs.imm);
+  } else if (rhs.kind == OPND_IMM && fits_s32(rhs.imm)) {
+    emit(cg, "  cgfi %%r2,%lld", (long long)rhs.imm);
+  } else if (rhs.kind == OPND_IMM) {
+    emit_load_imm64_to(cg, 4, rhs.imm);
+    emit(cg, "  cgr  %%r2,%%r4");
+  } else if (rhs.kind == OPND_REG) {
+    emit(cg, "  cgr  %%r2,%%r%d", rhs.reg);
+  } else {
+    emit(cg, "  cg   %%r2,%d(%%r11)", rhs.off);
   }
 }
 
 static void gen_binop(CG *cg, const ASTNode *expr) {
   // binop: left, op(token op:*), right
-  const ASTNode *L = expr->children[0];
-  const ASTNode *OP = expr->children[1];
-  const ASTNode *R = expr->children[2];
-  const char *op = (OP && is_token_kind(OP, "op")) ? after_colon(OP->label) : "?";
+  const ASTNode *L = ast_child(expr, 0);
+  const ASTNode *OP = ast_child(expr, 1);
+  const ASTNode *R = ast_child(expr, 2);
+  const char *op = (OP && OP->kind == AST_OP) ? OP->lexeme : "?";
 
   // comparisons should be handled in cond context; here we return 0/1.
   if (is_cmp_op(op)) {
@@ -676,11 +1507,7 @@ static void gen_binop(CG *cg, const ASTNode *expr) {
     int lbl_true = new_label(cg);
     int lbl_end  = new_label(cg);
 
-    gen_expr(cg, L);
-    emit_push_r2(cg);
-    gen_expr(cg, R);
-    emit_pop_to_r3(cg);              // r3 = L, r2 = R
-    emit(cg, "  cgr  %%r3,%%r2");     // sets CC based on (r3 - r2)
+    gen_compare(cg, L, R);           // sets CC based on (L - R)
 
     if (!strcmp(op, "==")) emit(cg, "  je   .L%d", lbl_true);
     else if (!strcmp(op, "!=")) emit(cg, "  jne  .L%d", lbl_true);
@@ -699,51 +1526,19 @@ static void gen_binop(CG *cg, const ASTNode *expr) {
   }
 
   // arithmetic:
-  gen_expr(cg, L);
-  emit_push_r2(cg);
-  gen_expr(cg, R);
-  emit_pop_to_r3(cg); // r3 = L, r2 = R
-
-  if (!strcmp(op, "+")) {
-    emit(cg, "  agr  %%r2,%%r3"); // r2 = r2 + r3
-  } else if (!strcmp(op, "-")) {
-    emit(cg, "  sgr  %%r3,%%r2"); // r3 = L - R
-    emit(cg, "  lgr  %%r2,%%r3");
-  } else if (!strcmp(op, "*")) {
-    // msgr %r2,%r3: r2 = r2 * r3 (64-bit result in r2)
-    emit(cg, "  msgr %%r2,%%r3");   // r2 = R * L, result in r2
-  } else if (!strcmp(op, "/")) {
-    emit(cg, "  lgr  %%r4,%%r2");   // divisor = R
-    emit(cg, "  lgr  %%r2,%%r3");   // copy dividend L
-    emit(cg, "  srag %%r2,%%r2,63"); // sign-extend high part (all 0 or all 1)
-    // dividend pair: r2:r3, divisor: r4
-    emit(cg, "  dsgr %%r2,%%r4");   // remainder in r2, quotient in r3
-    emit(cg, "  lgr  %%r2,%%r3");   // вернуть quotient в r2
-  } else if (!strcmp(op, "%")) {
-    emit(cg, "  lgr  %%r4,%%r2");   // divisor = R
-    emit(cg, "  lgr  %%r2,%%r3");
-    emit(cg, "  srag %%r2,%%r2,63");
-    emit(cg, "  dsgr %%r2,%%r4");   // remainder in r2, quotient in r3
-    // remainder уже в r2, ничего не копируем
-  } else {
-    emit(cg, "  # ERROR: unknown binop '%s'", op);
-    emit(cg, "  lghi %%r2,0");
-  }
+  gen_arith(cg, L, op, R);
 }
 
 static void gen_unop(CG *cg, const ASTNode *expr) {
   // unop: op, operand
-  const ASTNode *OP = expr->children[0];
-  const ASTNode *X  = expr->children[1];
-  const char *op = (OP && is_token_kind(OP, "op")) ? after_colon(OP->label) : "?";
+  const ASTNode *OP = ast_child(expr, 0);
+  const ASTNode *X  = ast_child(expr, 1);
+  const char *op = (OP && OP->kind == AST_OP) ? OP->lexeme : "?";
 
   gen_expr(cg, X);
 
   if (!strcmp(op, "-")) {
-    // r2 = -r2
-    emit(cg, "  lghi %%r3,0");
-    emit(cg, "  sgr  %%r3,%%r2");
-    emit(cg, "  lgr  %%r2,%%r3");
+    emit(cg, "  lcgr %%r2,%%r2"); // r2 = -r2
   } else if (!strcmp(op, "+")) {
     // no-op
   } else {
@@ -751,11 +1546,77 @@ static void gen_unop(CG *cg, const ASTNode *expr) {
   }
 }
 
+// base pointer of an indexed access: the local's own register when it can
+// serve as an address base, otherwise loaded into `scratch`
+static int emit_local_as_base(CG *cg, const char *name, int scratch) {
+  int idx = locals_find(&cg->locals, name);
+  if (idx >= 0 && cg->locals.v[idx].reg != RA_NO_REG && cg->locals.v[idx].reg != 0) {
+    ra_touch(cg, idx);
+    return cg->locals.v[idx].reg;
+  }
+  emit_load_local_to(cg, name, scratch);
+  return scratch;
+}
+
+// narrow field value kept outside memory (SRA): the same truncation and
+// extension a store + load of the field would do
+static void emit_field_narrow(CG *cg, int reg, const FieldInfo *f) {
+  if (f->size == 1) emit(cg, "  llgcr %%r%d,%%r%d", reg, reg);
+  else if (f->size == 4) emit(cg, "  %s %%r%d,%%r%d", f->is_signed ? "lgfr" : "llgfr", reg, reg);
+}
+
+static void gen_field_store(CG *cg, const ASTNode *lhs, const ASTNode *rhs) {
+  // fieldAccess: obj, field_id; value -> r2
+  const ASTNode *obj = ast_child(lhs, 0);
+  const ASTNode *field_id = lhs->numChildren > 1 ? ast_child(lhs, 1) : NULL;
+
+  const Local *sl = cg_scalar_local(cg, obj);
+  if (sl) {
+    const FieldInfo *f = cg_scalar_field(cg, sl, field_id);
+    const char *name = cg_scalar_field_name(sl->name, f->name);
+    gen_expr(cg, rhs);
+    emit_field_narrow(cg, 2, f);
+    emit_store_local(cg, name);
+    return;
+  }
+
+  const FieldInfo *f = is_kind(field_id, AST_ID) ? cg_field(cg, cg_expr_type(cg, obj), field_id->lexeme) : NULL;
+  if (!f) {
+    gen_expr(cg, rhs);
+    emit(cg, "  # ERROR: unknown field in assignment");
+    return;
+  }
+
+  int base;
+  if (is_kind(obj, AST_ID) && locals_find(&cg->locals, obj->lexeme) >= 0) {
+    gen_expr(cg, rhs);
+    base = emit_local_as_base(cg, obj->lexeme, 3);
+  } else {
+    // object pointer lives in a temporary while rhs is evaluated
+    gen_expr(cg, obj);
+    int t = temp_new(cg);
+    temp_save_r2(cg, t);
+    gen_expr(cg, rhs);
+    base = temp_use(cg, t, 3, 1);
+  }
+  emit(cg, "  # store field '%s' offset %d", f->name, f->offset);
+  emit_field_store(cg, 2, f, base);
+}
+
 static void gen_assign(CG *cg, const ASTNode *expr) {
   // assign: id, expr
-  const ASTNode *idn = expr->children[0];
-  const ASTNode *rhs = expr->children[1];
-  const char *name = (idn && is_token_kind(idn, "id")) ? after_colon(idn->label) : NULL;
+  const ASTNode *idn = ast_child(expr, 0);
+  const ASTNode *rhs = ast_child(expr, 1);
+  const char *name = (idn && idn->kind == AST_ID) ? idn->lexeme : NULL;
+
+  if (is_kind(idn, AST_FIELD_ACCESS)) {
+    gen_field_store(cg, idn, rhs);
+    return;
+  }
+  if (cg_scalar_local(cg, idn)) {
+    emit(cg, "  # %s = new: fields are scalar locals", name);
+    return;
+  }
 
   gen_expr(cg, rhs);           // result -> r2
   if (name) emit_store_local(cg, name);
@@ -763,12 +1624,12 @@ static void gen_assign(CG *cg, const ASTNode *expr) {
 
 static void gen_compound_assign(CG *cg, const ASTNode *expr) {
   // compound_assign: id, op, rhs
-  const ASTNode *idn = expr->children[0];
-  const ASTNode *opn = expr->children[1];
-  const ASTNode *rhs = expr->children[2];
+  const ASTNode *idn = ast_child(expr, 0);
+  const ASTNode *opn = ast_child(expr, 1);
+  const ASTNode *rhs = ast_child(expr, 2);
 
-  const char *name = (idn && is_token_kind(idn, "id")) ? after_colon(idn->label) : NULL;
-  const char *op   = (opn && is_token_kind(opn, "op")) ? after_colon(opn->label) : NULL;
+  const char *name = (idn && idn->kind == AST_ID) ? idn->lexeme : NULL;
+  const char *op   = (opn && opn->kind == AST_OP) ? opn->lexeme : NULL;
 
   if (!name || !op) {
     emit(cg, "  # ERROR: malformed compound_assign");
@@ -776,166 +1637,99 @@ static void gen_compound_assign(CG *cg, const ASTNode *expr) {
     return;
   }
 
-  // load current value -> r2, push
-  emit_load_local(cg, name);
-  emit_push_r2(cg);
-
-  // rhs -> r2, pop old -> r3
-  gen_expr(cg, rhs);
-  emit_pop_to_r3(cg);
-
-  if (!strcmp(op, "+=")) {
-    emit(cg, "  agr  %%r2,%%r3");
-  } else if (!strcmp(op, "-=")) {
-    emit(cg, "  sgr  %%r3,%%r2");
-    emit(cg, "  lgr  %%r2,%%r3");
-} else if (!strcmp(op, "*=")) {
-    // r3 = old, r2 = rhs
-    // msgr %r2,%r3: r2 = r2 * r3 (64-bit result in r2)
-    emit(cg, "  msgr %%r2,%%r3");   // r2 = rhs * old, result in r2
-
-  } else if (!strcmp(op, "/=")) {
-    // dividend = old (в r3), divisor = rhs (в r2)
-    emit(cg, "  lgr  %%r4,%%r2");   // r4 = divisor
-    emit(cg, "  lgr  %%r2,%%r3");   // r2 = old (копия)
-    emit(cg, "  srag %%r2,%%r2,63"); // high = sign(old)
-    emit(cg, "  dsgr %%r2,%%r4");   // remainder in r2, quotient in r3
-    emit(cg, "  lgr  %%r2,%%r3");   // вернуть quotient в r2
-
-  } else if (!strcmp(op, "%=")) {
-    emit(cg, "  lgr  %%r4,%%r2");   // r4 = divisor
-    emit(cg, "  lgr  %%r2,%%r3");   // r2 = old (копия)
-    emit(cg, "  srag %%r2,%%r2,63");
-    emit(cg, "  dsgr %%r2,%%r4");   // remainder in r2, quotient in r3
-    // remainder уже в r2, ничего не копируем
-
+  // x op= rhs  ==  x = x op rhs
+  char aop[2] = {0, 0};
+  if (strlen(op) == 2 && op[1] == '=' && strchr("+-*/%", op[0])) {
+    aop[0] = op[0];
   } else {
     emit(cg, "  # ERROR: unknown compound op '%s'", op);
     emit(cg, "  lghi %%r2,0");
+    emit_store_local(cg, name);
+    return;
   }
+  gen_arith(cg, idn, aop, rhs);
 
   // store back
   emit_store_local(cg, name);
 }
 
-static void gen_index(CG *cg, const ASTNode *expr) {
-  // index: id, args(list) ; трактуем как *(base + idx*8)
-  const ASTNode *idn = expr->children[0];
-  const char *base_name = (idn && is_token_kind(idn, "id")) ? after_colon(idn->label) : NULL;
+// index expression of a[i]: parser gives it directly, older trees wrap it
+// in args/list
+static const ASTNode *index_arg(const ASTNode *n) {
+  if (n && n->kind == AST_ARGS) {
+    const ASTNode *list = (n->numChildren > 0) ? ast_child(n, 0) : NULL;
+    if (!list || list->kind != AST_LIST || list->numChildren < 1) return NULL;
+    return ast_child(list, 0);
+  }
+  return n;
+}
 
-  const ASTNode *args = (expr->numChildren > 1) ? expr->children[1] : NULL;
-  const ASTNode *list = NULL;
+static void gen_index(CG *cg, const ASTNode *expr) {
+  // index: id, args(list) ; *(base + idx*elem_size)
+  const ASTNode *idn = ast_child(expr, 0);
+  const char *base_name = (idn && idn->kind == AST_ID) ? idn->lexeme : NULL;
 
-  if (args && args->label && strcmp(args->label, "args") == 0 && args->numChildren > 0) {
-    list = args->children[0];
-  }
-  if (!base_name || !list || !list->label || strcmp(list->label, "list") != 0 || list->numChildren < 1) {
+  const ASTNode *idx = index_arg((expr->numChildren > 1) ? ast_child(expr, 1) : NULL);
+  if (!base_name || !idx) {
     emit(cg, "  # ERROR: malformed index");
     emit(cg, "  lghi %%r2,0");
     return;
   }
 
-  // base pointer -> r3, idx -> r2
-  emit_load_local(cg, base_name);
-  emit(cg, "  lgr  %%r3,%%r2");
-  gen_expr(cg, list->children[0]); // idx -> r2
-
-  // r2 = idx*8
-  emit(cg, "  sllg %%r2,%%r2,3");
-  // r1 = base + idx*8
-  emit(cg, "  la   %%r1,0(%%r3,%%r2)");
-  // load *(r1)
-  emit(cg, "  lg   %%r2,0(%%r1)");
+  int sign;
+  int size = cg_elem_size(cg, idn, &sign);
+  gen_expr(cg, idx); // idx -> r2
+  if (cg_size_shift(size)) emit(cg, "  sllg %%r2,%%r2,%d", cg_size_shift(size));
+  int base = emit_local_as_base(cg, base_name, 3);
+  emit(cg, "  %s %%r2,0(%%r2,%%r%d)", cg_load_op(size, sign), base);
 }
 
 static void gen_assign_index(CG *cg, const ASTNode *expr) {
   // assign_index: id, argExprList, rhs
-  const ASTNode *idn = expr->children[0];
-  const ASTNode *args = (expr->numChildren > 1) ? expr->children[1] : NULL;
-  const ASTNode *rhs = (expr->numChildren > 2) ? expr->children[2] : NULL;
+  const ASTNode *idn = ast_child(expr, 0);
+  const ASTNode *args = (expr->numChildren > 1) ? ast_child(expr, 1) : NULL;
+  const ASTNode *rhs = (expr->numChildren > 2) ? ast_child(expr, 2) : NULL;
 
-  const char *base_name = (idn && is_token_kind(idn, "id")) ? after_colon(idn->label) : NULL;
-  const ASTNode *list = NULL;
+  const char *base_name = (idn && idn->kind == AST_ID) ? idn->lexeme : NULL;
+  const ASTNode *idx = index_arg(args);
 
-  if (args && args->label && strcmp(args->label, "args") == 0 && args->numChildren > 0) {
-    list = args->children[0];
-  }
-  if (!base_name || !list || !list->label || strcmp(list->label, "list") != 0 || list->numChildren < 1 || !rhs) {
+  if (!base_name || !idx || !rhs) {
     emit(cg, "  # ERROR: malformed assign_index");
     emit(cg, "  lghi %%r2,0");
     return;
   }
 
-  // Compute base pointer -> r3
-  int off = 0;
-  if (locals_get_offset(&cg->locals, base_name, &off)) {
-    // base is a local variable (pointer)
-    emit_load_local(cg, base_name);
-    emit(cg, "  lgr  %%r3,%%r2");
-  } else {
-    // base not found as local — try treating it as a field of 'this'
-    if (locals_get_offset(&cg->locals, "this", &off)) {
-      // load this pointer into r2 -> r3
-      emit_load_local(cg, "this");
-      emit(cg, "  lgr  %%r3,%%r2");
-      // Find field offset from cg map (prefer current class)
-      int fo = 8; int foundf = 0;
-      if (cg) {
-        for (int i = 0; i < cg->field_n; i++) {
-          if (cg->field_names[i] && strcmp(cg->field_names[i], base_name) == 0) {
-            if (cg->cur_func && strstr(cg->cur_func, "__")) {
-              char cls[256];
-              const char *p = strstr(cg->cur_func, "__");
-              size_t len = (size_t)(p - cg->cur_func);
-              if (len < sizeof(cls)) {
-                memcpy(cls, cg->cur_func, len);
-                cls[len] = '\0';
-                if (!strcmp(cls, cg->field_class_names[i])) { fo = cg->field_offsets[i]; foundf = 1; break; }
-              }
-            }
-          }
-        }
-        if (!foundf) {
-          for (int i = 0; i < cg->field_n; i++) {
-            if (cg->field_names[i] && strcmp(cg->field_names[i], base_name) == 0) { fo = cg->field_offsets[i]; foundf = 1; break; }
-          }
-        }
-      }
-      emit(cg, "  # field '%s' offset %d (this.%s)", base_name, fo, base_name);
-      emit(cg, "  lg   %%r2,%d(%%r3)", fo); // r2 = this->base (pointer)
-      emit(cg, "  lgr  %%r3,%%r2");
-    } else {
-      // unknown base — produce debug-friendly zero
-      emit(cg, "  # ERROR: unknown base '%s' for assign_index", base_name);
-      emit(cg, "  lghi %%r2,0");
-      emit(cg, "  lgr  %%r3,%%r2");
-    }
-  }
-
-  // compute index -> r2
-  gen_expr(cg, list->children[0]);
-  // r2 = idx * 8
-  emit(cg, "  sllg %%r2,%%r2,3");
-  // r1 = base + idx*8
-  emit(cg, "  la   %%r1,0(%%r3,%%r2)");
+  // compute index -> r2, r2 = idx * elem_size
+  int sign;
+  int size = cg_elem_size(cg, idn, &sign);
+  gen_expr(cg, idx);
+  if (cg_size_shift(size)) emit(cg, "  sllg %%r2,%%r2,%d", cg_size_shift(size));
 
-  // push address (move into r2 then push)
-  emit(cg, "  lgr  %%r2,%%r1");
-  emit_push_r2(cg);
-
-  // evaluate rhs -> r2
-  gen_expr(cg, rhs);
+  // Compute base pointer (a local or a field of 'this')
+  int base = emit_local_as_base(cg, base_name, 3);
 
-  // pop address into r3
-  emit_pop_to_r3(cg); // r3 = addr
+  int addr;
+  if (operand_is_simple(cg, rhs)) {
+    // r3 = base + idx*size, value read in place
+    emit(cg, "  la   %%r3,0(%%r2,%%r%d)", base);
+    Operand o = operand_get(cg, rhs);
+    emit_load_operand(cg, 2, &o);
+    addr = 3;
+  } else {
+    // address lives in a temporary while rhs is evaluated
+    emit(cg, "  la   %%r2,0(%%r2,%%r%d)", base);
+    int t = temp_new(cg);
+    temp_save_r2(cg, t);
+    gen_expr(cg, rhs);
+    addr = temp_use(cg, t, 3, 1);
+  }
 
-  // store r2 into *(r3) but guard against NULL addresses to avoid segfault
+  // store r2 into *(addr) but guard against NULL addresses to avoid segfault
   {
     int lbl_ok = new_label(cg);
-    emit(cg, "  lghi %%r4,0");
-    emit(cg, "  cgr  %%r3,%%r4");
-    emit(cg, "  je   .L%d", lbl_ok); // if r3 == 0 jump to skip
-    emit(cg, "  stg  %%r2,0(%%r3)");
+    emit(cg, "  ltgr %%r%d,%%r%d", addr, addr);
+    emit(cg, "  je   .L%d", lbl_ok); // if addr == 0 jump to skip
+    emit(cg, "  %s %%r2,0(%%r%d)", cg_store_op(size), addr);
     emit_label(cg, lbl_ok);
   }
 }
@@ -949,9 +1743,9 @@ static void gen_field_access(CG *cg, const ASTNode *expr) {
     return;
   }
 
-  const ASTNode *obj = expr->children[0];
-  const ASTNode *field_id = expr->children[1];
-  const char *field_name = (field_id && is_token_kind(field_id, "id")) ? after_colon(field_id->label) : NULL;
+  const ASTNode *obj = ast_child(expr, 0);
+  const ASTNode *field_id = ast_child(expr, 1);
+  const char *field_name = (field_id && field_id->kind == AST_ID) ? field_id->lexeme : NULL;
 
   if (!field_name) {
     emit(cg, "  # ERROR: fieldAccess without field name");
@@ -959,38 +1753,24 @@ static void gen_field_access(CG *cg, const ASTNode *expr) {
     return;
   }
 
+  const Local *sl = cg_scalar_local(cg, obj);
+  if (sl) {
+    emit_load_local(cg, cg_scalar_field_name(sl->name, field_name));
+    return;
+  }
+
   // Evaluate object expression -> r2
   gen_expr(cg, obj);
   emit(cg, "  lgr  %%r3,%%r2"); // r3 = object pointer
-  // Look up field offset in cg map
-  int found = 0;
-  int off = 8; // default
-  if (cg && field_name) {
-    for (int i = 0; i < cg->field_n; i++) {
-      if (cg->field_names[i] && cg->field_class_names[i] && strcmp(cg->field_names[i], field_name) == 0) {
-        // If we're inside a method, prefer matching class
-        if (cg->cur_func && strstr(cg->cur_func, "__")) {
-          char cls[256];
-          const char *p = strstr(cg->cur_func, "__");
-          size_t len = (size_t)(p - cg->cur_func);
-          if (len < sizeof(cls)) {
-            memcpy(cls, cg->cur_func, len);
-            cls[len] = '\0';
-            if (!strcmp(cls, cg->field_class_names[i])) {
-              off = cg->field_offsets[i]; found = 1; break;
-            }
-          }
-        }
-      }
-    }
-    if (!found) {
-      for (int i = 0; i < cg->field_n; i++) {
-        if (cg->field_names[i] && strcmp(cg->field_names[i], field_name) == 0) { off = cg->field_offsets[i]; found = 1; break; }
-      }
-    }
+  // Look up the field by the static type of the object, if known
+  const FieldInfo *f = cg_field(cg, cg_expr_type(cg, obj), field_name);
+  if (!f) {
+    emit(cg, "  # field '%s' unknown, offset 8", field_name);
+    emit(cg, "  lg   %%r2,8(%%r3)");
+    return;
   }
-  emit(cg, "  # field '%s' offset %d", field_name, off);
-  emit(cg, "  lg   %%r2,%d(%%r3)", off);
+  emit(cg, "  # field '%s' offset %d", field_name, f->offset);
+  emit_field_load(cg, 2, f, 3);
 }
 
 static void gen_method_call(CG *cg, const ASTNode *expr) {
@@ -1001,11 +1781,11 @@ static void gen_method_call(CG *cg, const ASTNode *expr) {
     return;
   }
 
-  const ASTNode *obj = expr->children[0];
-  const ASTNode *method_id = expr->children[1];
-  const ASTNode *args = (expr->numChildren > 2) ? expr->children[2] : NULL;
+  const ASTNode *obj = ast_child(expr, 0);
+  const ASTNode *method_id = ast_child(expr, 1);
+  const ASTNode *args = (expr->numChildren > 2) ? ast_child(expr, 2) : NULL;
 
-  const char *method_name = (method_id && is_token_kind(method_id, "id")) ? after_colon(method_id->label) : NULL;
+  const char *method_name = (method_id && method_id->kind == AST_ID) ? method_id->lexeme : NULL;
 
   if (!method_name) {
     emit(cg, "  # ERROR: methodCall without method name");
@@ -1013,108 +1793,38 @@ static void gen_method_call(CG *cg, const ASTNode *expr) {
     return;
   }
 
-  // Evaluate object expression -> r2, push it
-  gen_expr(cg, obj);
-  emit_push_r2(cg); // Push object as first argument
-
-  // Evaluate method arguments
+  // Evaluate method arguments (object is the implicit first one)
   const ASTNode *list = NULL;
   int nargs = 0;
-  if (args && args->label && strcmp(args->label, "args") == 0 && args->numChildren > 0) {
-    list = args->children[0];
-    if (list && list->label && strcmp(list->label, "list") == 0) {
+  if (args && args->kind == AST_ARGS && args->numChildren > 0) {
+    list = ast_child(args, 0);
+    if (list && list->kind == AST_LIST) {
       nargs = list->numChildren;
     }
   }
 
-  // Evaluate args left-to-right, push each result
-  for (int i = 0; i < nargs; i++) {
-    gen_expr(cg, list->children[i]);
-    emit_push_r2(cg);
-  }
-
-  // Pop arguments into registers (object is first, so it goes to r2)
   int total_args = 1 + nargs; // object + method args
   if (total_args > 5) {
+    gen_expr(cg, obj);
+    for (int i = 0; i < nargs; i++) gen_expr(cg, ast_child(list, i));
     emit(cg, "  # ERROR: >5 args not supported yet");
-    for (int i = 0; i < total_args; i++) emit_pop_to_r3(cg);
     emit(cg, "  lghi %%r2,0");
     return;
   }
 
-  // Pop in reverse order: last arg -> r(2+nargs), object -> r2
-  for (int i = total_args - 1; i >= 0; i--) {
-    int reg = 2 + i;
-    emit(cg, "  lg   %%r%d,0(%%r12)", reg);
-    emit(cg, "  aghi %%r12,8");
-  }
-
-  // TODO: Get method slot and implementation label from TypeEnv
-  // For now, use mangled name: Class__method
-  emit(cg, "  # TODO: virtual method dispatch for '%s'", method_name);
+  // object -> r2, last arg -> r(2+nargs)
+  const ASTNode *exprs[5];
+  exprs[0] = obj;
+  for (int i = 0; i < nargs; i++) exprs[1 + i] = ast_child(list, i);
+  gen_call_args(cg, exprs, total_args);
 
-  // Try a simple static dispatch: if the object is a local id and we recorded
-  // its static type, call the mangled function <Type>__<method> directly.
-  if (obj && obj->label && is_token_kind(obj, "id")) {
-    const char *obj_name = after_colon(obj->label);
-    const char *static_type = locals_get_type(&cg->locals, obj_name);
-    if (static_type) {
-      char mangled[256];
-      snprintf(mangled, sizeof(mangled), "%s__%s", static_type, method_name);
-      emit(cg, "  # static dispatch to %s (object '%s' has type %s)", mangled, obj_name, static_type);
-      emit(cg, "  brasl %%r14,%s", mangled);
-      return;
-    }
-  }
-  // If static dispatch is not possible, try to find a top-level mangled
-  // implementation matching "<ClassOrBase>__<method>" where the arity
-  // (including the implicit 'this' argument) matches total_args. This
-  // avoids dereferencing a null vtable pointer when objects are created
-  // with uninitialized vptr (placeholders used during codegen).
-  {
-    int total_args = 1 + nargs; /* object + method args */
-    const char *candidate = NULL;
-    if (cg && method_name) {
-      size_t mlen = strlen(method_name);
-      /* prefer candidate with matching arity */
-      if (cg->defined_names && cg->defined_arity) {
-        for (int i = 0; i < cg->defined_n; i++) {
-          const char *dn = cg->defined_names[i];
-          if (!dn) continue;
-          /* look for suffix __<method> */
-          const char *p = strstr(dn, "__");
-          if (!p) continue;
-          const char *suf = p + 2;
-          if (!strcmp(suf, method_name) || (strncmp(suf, method_name, mlen) == 0 && suf[mlen] == '\0')) {
-            if (cg->defined_arity[i] == total_args) { candidate = dn; break; }
-          }
-        }
-      }
-      /* fallback: first suffix match */
-      if (!candidate && cg && cg->defined_names) {
-        for (int i = 0; i < cg->defined_n; i++) {
-          const char *dn = cg->defined_names[i];
-          if (!dn) continue;
-          const char *p = strstr(dn, "__");
-          if (!p) continue;
-          const char *suf = p + 2;
-          if (!strcmp(suf, method_name) || (strncmp(suf, method_name, mlen) == 0 && suf[mlen] == '\0')) { candidate = dn; break; }
-        }
-      }
-    }
-    if (candidate) {
-      emit(cg, "  # static-like dispatch to %s (method lookup by name+arity)", candidate);
-      emit(cg, "  brasl %%r14,%s", candidate);
-      return;
-    }
-  }
+  emit_method_dispatch(cg, cg_expr_type(cg, obj), method_name);
+}
 
-  /* Fallback: attempt vtable dispatch (may crash if vptr is NULL). */
-  emit(cg, "  # Load vtable pointer from object (offset 0)");
-  emit(cg, "  lg   %%r1,0(%%r2)"); // r1 = vtable pointer
-  emit(cg, "  # TODO: Load method pointer from vtable[slot]");
-  emit(cg, "  # For now, call mangled name (placeholder)");
-  emit(cg, "  brasl %%r14,unknown_method"); // Placeholder
+// r2 = number of elements -> r2 = __runtime_malloc(n * elem_size)
+static void emit_alloc_array(CG *cg, int elem_size) {
+  if (cg_size_shift(elem_size)) emit(cg, "  sllg %%r2,%%r2,%d", cg_size_shift(elem_size));
+  emit_call(cg, "__runtime_malloc");
 }
 
 static void gen_new(CG *cg, const ASTNode *expr) {
@@ -1125,10 +1835,10 @@ static void gen_new(CG *cg, const ASTNode *expr) {
     return;
   }
 
-  const ASTNode *class_id = expr->children[0];
-  const ASTNode *args = (expr->numChildren > 1) ? expr->children[1] : NULL;
+  const ASTNode *class_id = ast_child(expr, 0);
+  const ASTNode *args = (expr->numChildren > 1) ? ast_child(expr, 1) : NULL;
 
-  const char *class_name = (class_id && is_token_kind(class_id, "id")) ? after_colon(class_id->label) : NULL;
+  const char *class_name = (class_id && class_id->kind == AST_ID) ? class_id->lexeme : NULL;
 
   if (!class_name) {
     emit(cg, "  # ERROR: new without class name");
@@ -1136,14 +1846,34 @@ static void gen_new(CG *cg, const ASTNode *expr) {
     return;
   }
 
-  // TODO: Get class size from TypeEnv
-  // For now, allocate 16 bytes (vptr + one field)
-  emit(cg, "  # allocate object of class '%s' (heap)", class_name);
-  emit(cg, "  # Allocate memory using libc malloc(size)");
-  emit(cg, "  lghi %%r2,16"); /* size */
-  emit(cg, "  # call __runtime_malloc(size) -> returns pointer in %%r2");
-  emit(cg, "  brasl %%r14,__runtime_malloc");
-  emit(cg, "  lgr  %%r1,%%r2"); /* r1 = pointer to allocated memory */
+  // new T[n]: последний ребёнок — выражение размера, а не args; одно
+  // выделение на n элементов размера T (types_size_of)
+  const ASTNode *last = ast_child(expr, expr->numChildren - 1);
+  if (expr->numChildren > 1 && last->kind != AST_ARGS) {
+    emit(cg, "  # allocate array of '%s'", class_name);
+    gen_expr(cg, last);
+    emit_alloc_array(cg, types_size_of(class_name, NULL));
+    return;
+  }
+
+  // size from TypeEnv (vptr + all fields, including inherited); a class
+  // without a definition gets 16 bytes (vptr + one field)
+  const ClassInfo *ci = types_find_class(cg->types, class_name);
+  int size = ci ? ci->size_bytes : 16;
+  const FrameObject *fo = cg_frame_object(cg, expr);
+  if (fo) {
+    // объект не убегает (escape.h): место в кадре, поля, как и после
+    // malloc, не инициализированы
+    emit(cg, "  # allocate object of class '%s' (frame)", class_name);
+    emit(cg, "  %s  %%r1,%d(%%r11)", fo->off < 4096 ? "la " : "lay", fo->off);
+  } else {
+    emit(cg, "  # allocate object of class '%s' (heap)", class_name);
+    emit(cg, "  # Allocate memory using libc malloc(size)");
+    emit(cg, "  lghi %%r2,%d", size); /* size */
+    emit(cg, "  # call __runtime_malloc(size) -> returns pointer in %%r2");
+    emit_call(cg, "__runtime_malloc");
+    emit(cg, "  lgr  %%r1,%%r2"); /* r1 = pointer to allocated memory */
+  }
   // Initialize vtable pointer: point to a per-class vtable symbol so
   // method dispatch that reads the vptr won't dereference a NULL address.
   {
@@ -1152,18 +1882,17 @@ static void gen_new(CG *cg, const ASTNode *expr) {
     emit(cg, "  # initialize vtable pointer to %s", buf);
     emit(cg, "  larl %%r2,%s", buf);
     emit(cg, "  stg  %%r2,0(%%r1)");
-    /* record we need a vtable symbol for this class in case the class
-       definition does not appear in the AST (so we can emit a placeholder
-       vtable later and avoid linker errors). */
-    cg_add_required_vtable(cg, class_name);
+    /* the class definition does not appear in the AST: emit a placeholder
+       vtable later to avoid linker errors */
+    if (!ci) cg_add_required_vtable(cg, class_name);
   }
 
   // Evaluate constructor arguments if any
   const ASTNode *list = NULL;
   int nargs = 0;
-  if (args && args->label && strcmp(args->label, "args") == 0 && args->numChildren > 0) {
-    list = args->children[0];
-    if (list && list->label && strcmp(list->label, "list") == 0) {
+  if (args && args->kind == AST_ARGS && args->numChildren > 0) {
+    list = ast_child(args, 0);
+    if (list && list->kind == AST_LIST) {
       nargs = list->numChildren;
     }
   }
@@ -1178,91 +1907,84 @@ static void gen_new(CG *cg, const ASTNode *expr) {
 }
 
 static void gen_expr(CG *cg, const ASTNode *expr) {
-  if (!expr || !expr->label) {
+  if (!expr) {
     emit(cg, "  lghi %%r2,0");
     return;
   }
 
-  const char *L = expr->label;
-
-  if (!strcmp(L, "binop") && expr->numChildren >= 3) {
-    gen_binop(cg, expr);
-    return;
-  }
-  if (!strcmp(L, "unop") && expr->numChildren >= 2) {
-    gen_unop(cg, expr);
-    return;
-  }
-  if (!strcmp(L, "assign") && expr->numChildren >= 2) {
-    gen_assign(cg, expr);
-    return;
-  }
-  if (!strcmp(L, "compound_assign") && expr->numChildren >= 3) {
-    gen_compound_assign(cg, expr);
-    return;
-  }
-  if (!strcmp(L, "call")) {
+  switch (expr->kind) {
+  case AST_BINOP:
+    if (expr->numChildren >= 3) { gen_binop(cg, expr); return; }
+    break;
+  case AST_UNOP:
+    if (expr->numChildren >= 2) { gen_unop(cg, expr); return; }
+    break;
+  case AST_ASSIGN:
+    if (expr->numChildren >= 2) { gen_assign(cg, expr); return; }
+    break;
+  case AST_COMPOUND_ASSIGN:
+    if (expr->numChildren >= 3) { gen_compound_assign(cg, expr); return; }
+    break;
+  case AST_CALL:
     gen_call(cg, expr);
     return;
-  }
-  if (!strcmp(L, "index")) {
+  case AST_INDEX:
     gen_index(cg, expr);
     return;
-  }
-  if (!strcmp(L, "assign_index")) {
+  case AST_ASSIGN_INDEX:
     gen_assign_index(cg, expr);
     return;
-  }
-  if (!strcmp(L, "fieldAccess") && expr->numChildren >= 2) {
-    gen_field_access(cg, expr);
-    return;
-  }
-  if (!strcmp(L, "methodCall") && expr->numChildren >= 2) {
-    gen_method_call(cg, expr);
-    return;
-  }
-  if (!strcmp(L, "new") && expr->numChildren >= 1) {
-    gen_new(cg, expr);
-    return;
-  }
-  if (!strcmp(L, "address") && expr->numChildren >= 1) {
-    /* Address-of: &var */
-    const ASTNode *id_node = expr->children[0];
-    const char *name = (id_node && is_token_kind(id_node, "id")) ? after_colon(id_node->label) : NULL;
-    if (name) {
-      // Load address of local variable into r2
-      int offset = 0;
-      if (locals_get_offset(&cg->locals, name, &offset)) {
-        emit(cg, "  la   %%r2,%d(%%r11)", offset); // Load address: r2 = r11 + offset
+  case AST_FIELD_ACCESS:
+    if (expr->numChildren >= 2) { gen_field_access(cg, expr); return; }
+    break;
+  case AST_METHOD_CALL:
+    if (expr->numChildren >= 2) { gen_method_call(cg, expr); return; }
+    break;
+  case AST_NEW:
+    if (expr->numChildren >= 1) { gen_new(cg, expr); return; }
+    break;
+  case AST_ADDRESS:
+    if (expr->numChildren >= 1) {
+      /* Address-of: &var */
+      const ASTNode *id_node = ast_child(expr, 0);
+      const char *name = (id_node && id_node->kind == AST_ID) ? id_node->lexeme : NULL;
+      if (name) {
+        // Load address of local variable into r2 (addr_taken locals stay in memory)
+        int idx = locals_find(&cg->locals, name);
+        if (idx >= 0) {
+          ra_touch(cg, idx);
+          emit(cg, "  la   %%r2,%d(%%r11)", cg->locals.v[idx].offset); // Load address: r2 = r11 + offset
+        } else {
+          emit(cg, "  # ERROR: unknown variable '%s' for address-of", name);
+          emit(cg, "  lghi %%r2,0");
+        }
       } else {
-        emit(cg, "  # ERROR: unknown variable '%s' for address-of", name);
+        emit(cg, "  # ERROR: malformed address-of expression");
         emit(cg, "  lghi %%r2,0");
       }
-    } else {
-      emit(cg, "  # ERROR: malformed address-of expression");
-      emit(cg, "  lghi %%r2,0");
+      return;
     }
-    return;
-  }
+    break;
 
   // leaf tokens:
-  if (is_token_kind(expr, "id")) {
-    emit_load_local(cg, after_colon(expr->label));
+  case AST_ID:
+    emit_load_local(cg, expr->lexeme);
     return;
-  }
-  if (is_token_kind(expr, "string")) {
-    emit_load_string(cg, after_colon(expr->label));
+  case AST_STRING:
+    emit_load_string(cg, expr->lexeme);
     return;
-  }
-  if (is_token_kind(expr, "dec") || is_token_kind(expr, "hex") ||
-      is_token_kind(expr, "bits") || is_token_kind(expr, "bool") ||
-      is_token_kind(expr, "char")) {
-    int64_t v = parse_int_literal_label(expr);
-    emit_load_imm64(cg, v);
+  case AST_DEC:
+  case AST_HEX:
+  case AST_BITS:
+  case AST_BOOL:
+  case AST_CHAR:
+    emit_load_imm64(cg, parse_int_literal_label(expr));
     return;
+  default:
+    break;
   }
 
-  emit(cg, "  # ERROR: unknown expr node '%s'", L);
+  emit(cg, "  # ERROR: unknown expr node '%s'", ast_kind_name(expr->kind));
   emit(cg, "  lghi %%r2,0");
 }
 
@@ -1273,18 +1995,14 @@ static void gen_cond_branch(CG *cg, const ASTNode *cond, int false_label) {
   // - если cond это binop со сравнением: делаем cgr и ветку на FALSE
   // - иначе: вычисляем cond -> r2; ltgr r2,r2; je false
 
-  if (cond && cond->label && !strcmp(cond->label, "binop") && cond->numChildren >= 3) {
-    const ASTNode *L = cond->children[0];
-    const ASTNode *OP = cond->children[1];
-    const ASTNode *R = cond->children[2];
-    const char *op = (OP && is_token_kind(OP, "op")) ? after_colon(OP->label) : NULL;
+  if (cond && cond->kind == AST_BINOP && cond->numChildren >= 3) {
+    const ASTNode *L = ast_child(cond, 0);
+    const ASTNode *OP = ast_child(cond, 1);
+    const ASTNode *R = ast_child(cond, 2);
+    const char *op = (OP && OP->kind == AST_OP) ? OP->lexeme : NULL;
 
     if (op && is_cmp_op(op)) {
-      gen_expr(cg, L);
-      emit_push_r2(cg);
-      gen_expr(cg, R);
-      emit_pop_to_r3(cg);           // r3=L, r2=R
-      emit(cg, "  cgr  %%r3,%%r2");
+      gen_compare(cg, L, R);        // CC = L <=> R
 
       // branch to FALSE if condition fails:
       if (!strcmp(op, "==")) {
@@ -1318,18 +2036,32 @@ static void gen_cond_branch(CG *cg, const ASTNode *cond, int false_label) {
 static void gen_vardecl(CG *cg, const ASTNode *stmt) {
   // vardecl: typeRef, vars
   if (stmt->numChildren < 2) return;
-  const ASTNode *vars = stmt->children[1];
-  if (!vars || !vars->label || strcmp(vars->label, "vars") != 0) return;
+  const ASTNode *vars = ast_child(stmt, 1);
+  if (!vars || vars->kind != AST_VARS) return;
 
   for (int i = 0; i + 1 < vars->numChildren; i += 2) {
-    const ASTNode *idn = vars->children[i];
-    const ASTNode *opt = vars->children[i + 1];
+    const ASTNode *idn = ast_child(vars, i);
+    const ASTNode *opt = ast_child(vars, i + 1);
 
-    const char *name = (idn && is_token_kind(idn, "id")) ? after_colon(idn->label) : NULL;
+    const char *name = (idn && idn->kind == AST_ID) ? idn->lexeme : NULL;
     if (!name) continue;
+    if (cg_scalar_local(cg, idn)) {
+      emit(cg, "  # %s: fields are scalar locals", name);
+      continue;
+    }
 
-    if (opt && opt->label && !strcmp(opt->label, "assign") && opt->numChildren > 0) {
-      gen_expr(cg, opt->children[0]);
+    if (opt && opt->kind == AST_ARRAY && opt->numChildren > 0) {
+      // T name[N]: адрес элементов в кадре или одно выделение в куче
+      int li = locals_find(&cg->locals, name);
+      const Local *l = li >= 0 ? &cg->locals.v[li] : NULL;
+      if (l && l->array_bytes) {
+        emit(cg, "  %s  %%r2,%d(%%r11)", l->array_off < 4096 ? "la " : "lay", l->array_off);
+      } else {
+        gen_expr(cg, ast_child(opt, 0));
+        emit_alloc_array(cg, types_size_of(get_type_name(ast_child(stmt, 0)), NULL));
+      }
+    } else if (opt && opt->kind == AST_ASSIGN && opt->numChildren > 0) {
+      gen_expr(cg, ast_child(opt, 0));
     } else {
       emit(cg, "  lghi %%r2,0");
     }
@@ -1339,22 +2071,22 @@ static void gen_vardecl(CG *cg, const ASTNode *stmt) {
 
 static void gen_block(CG *cg, const ASTNode *block) {
   // block: children[0]=stmts
-  if (!block || !block->label || strcmp(block->label, "block") != 0) return;
+  if (!block || block->kind != AST_BLOCK) return;
   if (block->numChildren <= 0) return;
-  const ASTNode *stmts = block->children[0];
-  if (!stmts || !stmts->label || strcmp(stmts->label, "stmts") != 0) return;
+  const ASTNode *stmts = ast_child(block, 0);
+  if (!stmts || stmts->kind != AST_STMTS) return;
 
   for (int i = 0; i < stmts->numChildren; i++) {
-    gen_stmt(cg, stmts->children[i]);
+    gen_stmt(cg, ast_child(stmts, i));
   }
 }
 
 static void gen_if(CG *cg, const ASTNode *stmt) {
   // if: [0]=cond, [1]=then, [2]=optElse (else/noelse)
   if (stmt->numChildren < 2) return;
-  const ASTNode *cond = stmt->children[0];
-  const ASTNode *thenS = stmt->children[1];
-  const ASTNode *elseN = (stmt->numChildren > 2) ? stmt->children[2] : NULL;
+  const ASTNode *cond = ast_child(stmt, 0);
+  const ASTNode *thenS = ast_child(stmt, 1);
+  const ASTNode *elseN = (stmt->numChildren > 2) ? ast_child(stmt, 2) : NULL;
 
   int lbl_else = new_label(cg);
   int lbl_end  = new_label(cg);
@@ -1364,8 +2096,8 @@ static void gen_if(CG *cg, const ASTNode *stmt) {
   emit(cg, "  j    .L%d", lbl_end);
 
   emit_label(cg, lbl_else);
-  if (elseN && elseN->label && strcmp(elseN->label, "else") == 0 && elseN->numChildren > 0) {
-    gen_stmt(cg, elseN->children[0]);
+  if (elseN && elseN->kind == AST_ELSE && elseN->numChildren > 0) {
+    gen_stmt(cg, ast_child(elseN, 0));
   }
   emit_label(cg, lbl_end);
 }
@@ -1373,18 +2105,21 @@ static void gen_if(CG *cg, const ASTNode *stmt) {
 static void gen_while(CG *cg, const ASTNode *stmt) {
   // while: [0]=cond, [1]=body
   if (stmt->numChildren < 2) return;
-  const ASTNode *cond = stmt->children[0];
-  const ASTNode *body = stmt->children[1];
+  const ASTNode *cond = ast_child(stmt, 0);
+  const ASTNode *body = ast_child(stmt, 1);
 
   int lbl_head = new_label(cg);
   int lbl_exit = new_label(cg);
+  int ra_start;
 
   break_push(cg, lbl_exit);
 
   emit_label(cg, lbl_head);
+  ra_loop_begin(cg, &ra_start);
   gen_cond_branch(cg, cond, lbl_exit);
   gen_stmt(cg, body);
   emit(cg, "  j    .L%d", lbl_head);
+  ra_loop_end(cg, ra_start);
 
   emit_label(cg, lbl_exit);
   break_pop(cg);
@@ -1393,15 +2128,17 @@ static void gen_while(CG *cg, const ASTNode *stmt) {
 static void gen_do_while(CG *cg, const ASTNode *stmt) {
   // doWhile: [0]=block, [1]=cond
   if (stmt->numChildren < 2) return;
-  const ASTNode *body = stmt->children[0];
-  const ASTNode *cond = stmt->children[1];
+  const ASTNode *body = ast_child(stmt, 0);
+  const ASTNode *cond = ast_child(stmt, 1);
 
   int lbl_body = new_label(cg);
   int lbl_exit = new_label(cg);
+  int ra_start;
 
   break_push(cg, lbl_exit);
 
   emit_label(cg, lbl_body);
+  ra_loop_begin(cg, &ra_start);
   gen_stmt(cg, body);
 
   // if cond true -> jump body, else fall to exit
@@ -1409,6 +2146,7 @@ static void gen_do_while(CG *cg, const ASTNode *stmt) {
   gen_expr(cg, cond);
   emit(cg, "  ltgr %%r2,%%r2");
   emit(cg, "  jne  .L%d", lbl_body);
+  ra_loop_end(cg, ra_start);
 
   emit_label(cg, lbl_exit);
   break_pop(cg);
@@ -1417,7 +2155,7 @@ static void gen_do_while(CG *cg, const ASTNode *stmt) {
 static void gen_return(CG *cg, const ASTNode *stmt) {
   // return: maybe one child expr
   if (stmt->numChildren > 0) {
-    gen_expr(cg, stmt->children[0]); // result -> r2
+    gen_expr(cg, ast_child(stmt, 0)); // result -> r2
   } else {
     emit(cg, "  lghi %%r2,0");
   }
@@ -1434,44 +2172,150 @@ static void gen_break(CG *cg) {
 }
 
 static void gen_stmt(CG *cg, const ASTNode *stmt) {
-  if (!stmt || !stmt->label) return;
-
-  const char *L = stmt->label;
+  if (!stmt) return;
 
-  if (!strcmp(L, "block")) {
+  switch (stmt->kind) {
+  case AST_BLOCK:
     gen_block(cg, stmt);
     return;
-  }
-  if (!strcmp(L, "vardecl")) {
+  case AST_VARDECL:
     gen_vardecl(cg, stmt);
     return;
-  }
-  if (!strcmp(L, "exprstmt")) {
-    if (stmt->numChildren > 0) gen_expr(cg, stmt->children[0]);
+  case AST_EXPRSTMT:
+    if (stmt->numChildren > 0) gen_expr(cg, ast_child(stmt, 0));
     return;
-  }
-  if (!strcmp(L, "if")) {
+  case AST_IF:
     gen_if(cg, stmt);
     return;
-  }
-  if (!strcmp(L, "while")) {
+  case AST_WHILE:
     gen_while(cg, stmt);
     return;
-  }
-  if (!strcmp(L, "doWhile")) {
+  case AST_DO_WHILE:
     gen_do_while(cg, stmt);
     return;
-  }
-  if (!strcmp(L, "return")) {
+  case AST_RETURN:
     gen_return(cg, stmt);
     return;
-  }
-  if (!strcmp(L, "break")) {
+  case AST_BREAK:
     gen_break(cg);
     return;
+  default:
+    break;
+  }
+
+  emit(cg, "  # WARN: unknown statement '%s' ignored", ast_kind_name(stmt->kind));
+}
+
+// ------------------------- register allocation driver -------------------------
+
+static void mark_address_taken(CG *cg, const ASTNode *n) {
+  if (!n) return;
+  if (n->kind == AST_ADDRESS && n->numChildren > 0) {
+    const ASTNode *idn = ast_child(n, 0);
+    if (idn && idn->kind == AST_ID) {
+      int idx = locals_find(&cg->locals, idn->lexeme);
+      if (idx >= 0) cg->locals.v[idx].addr_taken = 1;
+    }
+  }
+  for (int i = 0; i < n->numChildren; i++) mark_address_taken(cg, ast_child(n, i));
+}
+
+static void ra_reset_pass(CG *cg, int dry) {
+  cg->ra.dry = dry;
+  cg->ra.pos = 0;
+  cg->ra.loop_depth = 0;
+  cg->ra.next_temp = 0;
+}
+
+static void ra_begin_function(CG *cg) {
+  RAState *ra = &cg->ra;
+  ra->n = 0;
+  ra->calls_n = 0;
+  ra->loops_n = 0;
+  for (int i = 0; i < cg->locals.n; i++) {
+    int idx = ra_add_interval(ra);
+    if (idx >= 0) ra->iv[idx].fixed_mem = cg->locals.v[i].addr_taken;
+  }
+  ra->nlocals = cg->locals.n;
+  ra_reset_pass(cg, 1);
+}
+
+// first call point strictly after p, or -1
+static int ra_next_call_after(const RAState *ra, int p) {
+  int lo = 0, hi = ra->calls_n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (ra->calls[mid] <= p) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo < ra->calls_n ? ra->calls[lo] : -1;
+}
+
+static void ra_allocate(CG *cg) {
+  RAState *ra = &cg->ra;
+
+  // a local touched inside a loop stays live for the whole loop
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (int k = 0; k + 1 < ra->loops_n; k += 2) {
+      int ls = ra->loops[k], le = ra->loops[k + 1];
+      for (int i = 0; i < ra->nlocals; i++) {
+        LiveInterval *iv = &ra->iv[i];
+        if (iv->start < 0 || iv->end < ls || iv->start > le) continue;
+        if (iv->start > ls) { iv->start = ls; changed = 1; }
+        if (iv->end < le) { iv->end = le; changed = 1; }
+      }
+    }
+  }
+
+  for (int i = 0; i < ra->n; i++) {
+    LiveInterval *iv = &ra->iv[i];
+    if (iv->start < 0) {
+      iv->fixed_mem = 1; // never touched
+      continue;
+    }
+    int c = ra_next_call_after(ra, iv->start);
+    iv->crosses_call = (c >= 0 && c < iv->end);
+  }
+
+  ra_linear_scan(ra->iv, ra->n, &k_reg_pool);
+
+  // frame: address-taken locals first (short `la` displacements), then the
+  // other memory locals, then spilled temporaries
+  int off = 160;
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < ra->nlocals; i++) {
+      Local *l = &cg->locals.v[i];
+      l->reg = ra->iv[i].reg;
+      if (l->reg != RA_NO_REG || l->addr_taken != (pass == 0)) continue;
+      l->offset = off;
+      off += 8;
+    }
+  }
+  int ntemps = ra->n - ra->nlocals;
+  free(ra->temp_off);
+  ra->temp_off = (int *)malloc((size_t)(ntemps > 0 ? ntemps : 1) * sizeof(int));
+  for (int t = 0; t < ntemps && ra->temp_off; t++) {
+    ra->temp_off[t] = 0;
+    if (ra->iv[ra->nlocals + t].reg != RA_NO_REG) continue;
+    ra->temp_off[t] = off;
+    off += 8;
+  }
+  // элементы массивов и объекты в кадре — последними, после скалярных слотов
+  for (int i = 0; i < cg->locals.n; i++) {
+    Local *l = &cg->locals.v[i];
+    if (!l->array_bytes) continue;
+    l->array_off = off;
+    off += l->array_bytes;
+  }
+  for (int i = 0; i < cg->frame_objs_n; i++) {
+    cg->frame_objs[i].off = off;
+    off += cg->frame_objs[i].bytes;
   }
 
-  emit(cg, "  # WARN: unknown statement '%s' ignored", L);
+  cg->locals_size = off - 160;
+  cg->frame_size = align16(off);
+  ra_reset_pass(cg, 0);
 }
 
 // ------------------------- function generation -------------------------
@@ -1481,15 +2325,15 @@ static char *mangle_type(const ASTNode *type_node) {
   if (!type_node) return dup_cstr("void");
 
   // token kinds: type, typeRef (leaf)
-  if (is_token_kind(type_node, "type") || is_token_kind(type_node, "typeRef") || is_token_kind(type_node, "IDENTIFIER")) {
-    return dup_cstr(after_colon(type_node->label));
+  if (is_kind(type_node, AST_TYPE) || is_kind(type_node, AST_TYPE_REF)) {
+    return dup_cstr(type_node->lexeme);
   }
 
-  if (type_node->label && strcmp(type_node->label, "genType") == 0 && type_node->numChildren > 0) {
+  if (type_node->kind == AST_GEN_TYPE && type_node->numChildren > 0) {
     // genType: [0]=id, [1]=typeRef (param)
-    const ASTNode *idn = type_node->children[0];
-    const ASTNode *param = (type_node->numChildren > 1) ? type_node->children[1] : NULL;
-    const char *base = idn && is_token_kind(idn, "id") ? after_colon(idn->label) : "gen";
+    const ASTNode *idn = ast_child(type_node, 0);
+    const ASTNode *param = (type_node->numChildren > 1) ? ast_child(type_node, 1) : NULL;
+    const char *base = idn && idn->kind == AST_ID ? idn->lexeme : "gen";
     if (!param) return dup_cstr(base);
     char *p = mangle_type(param);
     size_t n = strlen(base) + 1 + strlen(p) + 1;
@@ -1500,8 +2344,8 @@ static char *mangle_type(const ASTNode *type_node) {
     return s;
   }
 
-  if (type_node->label && strcmp(type_node->label, "array") == 0 && type_node->numChildren > 0) {
-    char *inner = mangle_type(type_node->children[0]);
+  if (type_node->kind == AST_ARRAY && type_node->numChildren > 0) {
+    char *inner = mangle_type(ast_child(type_node, 0));
     size_t n = strlen(inner) + 5;
     char *s = (char*)malloc(n);
     if (!s) { free(inner); return inner; }
@@ -1512,33 +2356,31 @@ static char *mangle_type(const ASTNode *type_node) {
 
   // fallback: if node has a child token, use it
   for (int i = 0; i < type_node->numChildren; i++) {
-    const ASTNode *c = type_node->children[i];
-    if (c && c->label && strchr(c->label, ':')) return dup_cstr(after_colon(c->label));
+    const ASTNode *c = ast_child(type_node, i);
+    if (c && c->lexeme) return dup_cstr(c->lexeme);
   }
 
-  return dup_cstr(type_node->label ? type_node->label : "type");
+  return dup_cstr(ast_kind_name(type_node->kind));
 }
 
 // Return a mangled name for a function including parameter types.
-// Returns malloc'd string (caller may free). Existing callers expect char* that stays alive
-// until cg_free frees the defined names array, so allocating here is fine.
+// The name is an interned symbol (do not free), so names compare by pointer.
 static const char *get_func_name(const ASTNode *funcDefOrDecl) {
-  if (!funcDefOrDecl || funcDefOrDecl->numChildren < 1) return dup_cstr("unknown");
-  const ASTNode *sig = funcDefOrDecl->children[0];
-  if (!sig || !sig->label || strcmp(sig->label, "signature") != 0) return dup_cstr("unknown");
-  if (sig->numChildren < 2) return dup_cstr("unknown");
-
-  const ASTNode *idn = sig->children[1];
-  const char *base = "unknown";
-  if (idn && is_token_kind(idn, "id")) base = after_colon(idn->label);
-
-  // args are at sig->children[2] -> args -> arglist
-  if (sig->numChildren < 3) return dup_cstr(base);
-  const ASTNode *args = sig->children[2];
-  if (!args || !args->label || strcmp(args->label, "args") != 0) return dup_cstr(base);
-  if (args->numChildren == 0) return dup_cstr(base);
-  const ASTNode *arglist = args->children[0];
-  if (!arglist || !arglist->label || strcmp(arglist->label, "arglist") != 0) return dup_cstr(base);
+  if (!funcDefOrDecl || funcDefOrDecl->numChildren < 1) return intern_cstr("unknown");
+  const ASTNode *sig = ast_child(funcDefOrDecl, 0);
+  if (!sig || sig->kind != AST_SIGNATURE) return intern_cstr("unknown");
+  if (sig->numChildren < 2) return intern_cstr("unknown");
+
+  const ASTNode *idn = ast_child(sig, 1);
+  const char *base = (idn && idn->kind == AST_ID) ? idn->lexeme : intern_cstr("unknown");
+
+  // args are at ast_child(sig, 2) -> args -> arglist
+  if (sig->numChildren < 3) return base;
+  const ASTNode *args = ast_child(sig, 2);
+  if (!args || args->kind != AST_ARGS) return base;
+  if (args->numChildren == 0) return base;
+  const ASTNode *arglist = ast_child(args, 0);
+  if (!arglist || arglist->kind != AST_ARGLIST) return base;
 
   // Build mangled: base__T1_T2...
   // Compute length
@@ -1546,9 +2388,9 @@ static const char *get_func_name(const ASTNode *funcDefOrDecl) {
   char **parts = NULL;
   int parts_n = 0;
   for (int i = 0; i < arglist->numChildren; i++) {
-    const ASTNode *arg = arglist->children[i];
-    if (!arg || !arg->label || strcmp(arg->label, "arg") != 0) continue;
-    const ASTNode *type_node = (arg->numChildren > 0) ? arg->children[0] : NULL;
+    const ASTNode *arg = ast_child(arglist, i);
+    if (!arg || arg->kind != AST_ARG) continue;
+    const ASTNode *type_node = (arg->numChildren > 0) ? ast_child(arg, 0) : NULL;
     char *t = mangle_type(type_node);
     if (!t) continue;
     parts = (char**)realloc(parts, (size_t)(parts_n + 1) * sizeof(char*));
@@ -1557,14 +2399,14 @@ static const char *get_func_name(const ASTNode *funcDefOrDecl) {
   }
 
   if (parts_n == 0) {
-    return dup_cstr(base);
+    return base;
   }
 
   char *res = (char*)malloc(len);
   if (!res) {
     for (int i = 0; i < parts_n; i++) free(parts[i]);
     free(parts);
-    return dup_cstr(base);
+    return base;
   }
   strcpy(res, base);
   strcat(res, "__");
@@ -1574,7 +2416,9 @@ static const char *get_func_name(const ASTNode *funcDefOrDecl) {
     free(parts[i]);
   }
   free(parts);
-  return res;
+  const char *sym = intern_cstr(res);
+  free(res);
+  return sym;
 }
 
 static void emit_prologue(CG *cg) {
@@ -1584,7 +2428,6 @@ static void emit_prologue(CG *cg) {
   emit(cg, "  aghi %%r15,-%d", cg->frame_size);
   emit(cg, "  stg  %%r1,0(%%r15)");      // backchain
   emit(cg, "  lgr  %%r11,%%r15");        // frame base
-  emit(cg, "  la   %%r12,%d(%%r15)", cg->frame_size); // temp stack top
 }
 
 static void emit_epilogue(CG *cg) {
@@ -1595,32 +2438,46 @@ static void emit_epilogue(CG *cg) {
 }
 
 static void store_params_to_locals(CG *cg, const ASTNode *signature) {
-  // args in r2..r6; store each parameter into its local slot
-  if (!signature || !signature->label || strcmp(signature->label, "signature") != 0) return;
+  // args in r2..r6: memory params are stored to their slots first, the
+  // others are moved into their allocated registers in one parallel move
+  if (!signature || signature->kind != AST_SIGNATURE) return;
   if (signature->numChildren < 3) return;
 
-  const ASTNode *args = signature->children[2];
-  if (!args || !args->label || strcmp(args->label, "args") != 0) return;
+  const ASTNode *args = ast_child(signature, 2);
+  if (!args || args->kind != AST_ARGS) return;
   if (args->numChildren == 0) return;
 
-  const ASTNode *arglist = args->children[0];
-  if (!arglist || !arglist->label || strcmp(arglist->label, "arglist") != 0) return;
+  const ASTNode *arglist = ast_child(args, 0);
+  if (!arglist || arglist->kind != AST_ARGLIST) return;
 
+  PMove mv[5];
+  int nmv = 0;
+  memset(mv, 0, sizeof(mv));
   int reg = 2;
   for (int i = 0; i < arglist->numChildren && reg <= 6; i++, reg++) {
-    const ASTNode *arg = arglist->children[i];
-    if (!arg || !arg->label || strcmp(arg->label, "arg") != 0) continue;
+    const ASTNode *arg = ast_child(arglist, i);
+    if (!arg || arg->kind != AST_ARG) continue;
     if (arg->numChildren < 2) continue;
 
-    const ASTNode *idn = arg->children[1];
-    if (idn && is_token_kind(idn, "id")) {
-      const char *name = after_colon(idn->label);
-      int off = 0;
-      if (locals_get_offset(&cg->locals, name, &off)) {
-        emit(cg, "  stg  %%r%d,%d(%%r11)", reg, off);
+    const ASTNode *idn = ast_child(arg, 1);
+    if (idn && idn->kind == AST_ID) {
+      const char *name = idn->lexeme;
+      int idx = locals_find(&cg->locals, name);
+      if (idx >= 0) {
+        ra_touch(cg, idx);
+        const Local *l = &cg->locals.v[idx];
+        if (l->reg != RA_NO_REG) {
+          mv[nmv].dst = l->reg;
+          mv[nmv].src.kind = OPND_REG;
+          mv[nmv].src.reg = reg;
+          nmv++;
+        } else {
+          emit(cg, "  stg  %%r%d,%d(%%r11)", reg, l->offset);
+        }
       }
     }
   }
+  emit_parallel_moves(cg, mv, nmv);
 
   if (arglist->numChildren > 5) {
     emit(cg, "  # WARN: >5 params not handled (need stack args)");
@@ -1670,12 +2527,15 @@ static void gen_function_stub(CG *cg, const ASTNode *fn) {
   emit(cg, "  .size %s, .-%s", name, name);
 }
 
+// name — интернированный символ (get_func_name)
 static void gen_function_with_name(CG *cg, const ASTNode *fn, const char *name) {
-  if (!name) name = "unknown";
+  if (!name) name = intern_cstr("unknown");
   cg->cur_func = name;
 
   locals_free(&cg->locals);
   locals_init(&cg->locals);
+  cg->frame_blocks = 0;
+  cg->frame_objs_n = 0;
 
   // layout locals:
   // header area: 160 bytes (we keep ABI-friendly convention)
@@ -1683,24 +2543,30 @@ static void gen_function_with_name(CG *cg, const ASTNode *fn, const char *name)
   int next_off = 160;
 
   // parameters as locals first:
-  const ASTNode *sig = (fn->numChildren > 0) ? fn->children[0] : NULL;
+  const ASTNode *sig = (fn->numChildren > 0) ? ast_child(fn, 0) : NULL;
   collect_params_as_locals(cg, sig, &next_off);
+  int nparams = cg->locals.n;
+  // методы получают неявный 'this' с типом своего класса
+  cg->cur_class = locals_get_type(&cg->locals, cg->sym_this);
 
   // then locals from body:
-  const ASTNode *body = (fn->numChildren > 1) ? fn->children[1] : NULL;
+  const ASTNode *body = (fn->numChildren > 1) ? ast_child(fn, 1) : NULL;
   collect_locals_from_block(cg, body, &next_off);
+  mark_address_taken(cg, body);
+  mark_scalar_objects(cg, body, nparams, &next_off);
+  collect_frame_objects(cg, body);
 
-  cg->locals_size = next_off - 160;
+  int is_def = fn->kind == AST_FUNC_DEF && fn->numChildren >= 2;
 
-  // scratch for expression temp pushes
-  cg->scratch_size = 512;
-
-  cg->frame_size = align16(160 + cg->locals_size + cg->scratch_size);
-  if (cg->frame_size > 4000) {
-    // чтобы la disp не вышел за 4095
-    cg->scratch_size = 256;
-    cg->frame_size = align16(160 + cg->locals_size + cg->scratch_size);
-  }
+  // dry pass: number program points and build live intervals, then run
+  // linear scan; ra_allocate() also lays out the frame (offsets above are
+  // provisional). Labels are handed out again by the real pass.
+  int label_mark = cg->next_label;
+  ra_begin_function(cg);
+  store_params_to_locals(cg, sig);
+  if (is_def) gen_stmt(cg, ast_child(fn, 1));
+  ra_allocate(cg);
+  cg->next_label = label_mark;
 
   cg->epilogue_label = new_label(cg);
 
@@ -1714,8 +2580,8 @@ static void gen_function_with_name(CG *cg, const ASTNode *fn, const char *name)
   store_params_to_locals(cg, sig);
 
   // если это funcDef, то есть тело block; если funcDecl — просто return 0
-  if (fn->label && strcmp(fn->label, "funcDef") == 0 && fn->numChildren >= 2) {
-    gen_stmt(cg, fn->children[1]);
+  if (is_def) {
+    gen_stmt(cg, ast_child(fn, 1));
   }
 
   // default return 0 if falls through
@@ -1727,13 +2593,12 @@ static void gen_function_with_name(CG *cg, const ASTNode *fn, const char *name)
 
   /* clear cur_func to avoid dangling pointer usage outside this function */
   cg->cur_func = NULL;
+  cg->cur_class = NULL;
 }
 
-/* Wrapper kept for compatibility: allocates name, calls the generator and frees name */
+/* Wrapper kept for compatibility */
 static void gen_function(CG *cg, const ASTNode *fn) {
-  char *name = (char*)get_func_name(fn);
-  gen_function_with_name(cg, fn, name);
-  free(name);
+  gen_function_with_name(cg, fn, get_func_name(fn));
 }
 
 // ------------------------- top-level generation -------------------------
@@ -1760,226 +2625,97 @@ static void emit_rodata(CG *cg) {
 // Helper to extract class name from class node
 static const char *extract_class_name_from_ast(const ASTNode *class_node) {
   if (!class_node || class_node->numChildren < 1) return NULL;
-  const ASTNode *idn = class_node->children[0];
-  if (idn && is_token_kind(idn, "id")) {
-    return after_colon(idn->label);
-  }
-  return NULL;
-}
-
-// Helper to extract base class name from class node
-static const char *extract_base_name_from_ast(const ASTNode *class_node) {
-  if (!class_node || class_node->numChildren < 2) return NULL;
-  // Look for "extends" child
-  for (int i = 0; i < class_node->numChildren; i++) {
-    const ASTNode *child = class_node->children[i];
-    if (child && child->label && !strcmp(child->label, "extends")) {
-      if (child->numChildren > 0) {
-        const ASTNode *base_id = child->children[0];
-        if (base_id && is_token_kind(base_id, "id")) {
-          return after_colon(base_id->label);
-        }
-      }
-    }
+  const ASTNode *idn = ast_child(class_node, 0);
+  if (idn && idn->kind == AST_ID) {
+    return idn->lexeme;
   }
   return NULL;
 }
 
-// Helper to collect field names from class node
-static void collect_fields_from_class(const ASTNode *class_node, const char ***field_names, int *n_fields) {
-  *field_names = NULL;
-  *n_fields = 0;
-  
-  if (!class_node) return;
-  
-  // Find members container
-  const ASTNode *members = NULL;
-  for (int i = 0; i < class_node->numChildren; i++) {
-    const ASTNode *child = class_node->children[i];
-    if (child && child->label && !strcmp(child->label, "members")) {
-      members = child;
-      break;
-    }
-  }
-  
-  if (!members) return;
-  
-  // Collect fields from members
-  for (int i = 0; i < members->numChildren; i++) {
-    const ASTNode *member = members->children[i];
-    if (!member || !member->label) continue;
-    
-    // Look for field nodes
-    const ASTNode *field_node = NULL;
-    if (!strcmp(member->label, "member") && member->numChildren > 0) {
-      // member can have modifier and then field
-      for (int j = 0; j < member->numChildren; j++) {
-        const ASTNode *child = member->children[j];
-        if (child && child->label && !strcmp(child->label, "field")) {
-          field_node = child;
-          break;
-        }
-      }
-    } else if (!strcmp(member->label, "field")) {
-      field_node = member;
-    }
-    
-    if (field_node && field_node->numChildren >= 2) {
-      // field: optTypeRef, fieldList
-      const ASTNode *field_list = field_node->children[1];
-      if (field_list && field_list->label && !strcmp(field_list->label, "fieldlist")) {
-        for (int j = 0; j < field_list->numChildren; j++) {
-          const ASTNode *field_id = field_list->children[j];
-          if (field_id && is_token_kind(field_id, "id")) {
-            const char *field_name = after_colon(field_id->label);
-            if (field_name) {
-              int new_cap = (*n_fields == 0) ? 4 : (*n_fields * 2);
-              const char **new_names = (const char **)realloc(*field_names, new_cap * sizeof(const char*));
-              if (new_names) {
-                *field_names = new_names;
-                (*field_names)[*n_fields] = field_name;
-                (*n_fields)++;
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-}
-
 // Generate type information section
-static void emit_type_info(CG *cg, const ASTNode *root) {
-  if (!root || strcmp(root->label, "source") != 0 || root->numChildren < 1) return;
-  
-  const ASTNode *items = root->children[0];
-  if (!items || !items->label || strcmp(items->label, "items") != 0) return;
-  
+static void emit_type_info(CG *cg) {
+  int n_classes = types_num_classes(cg->types);
+
   emit(cg, "");
   emit(cg, "  .section .data.typeinfo");
   emit(cg, "  .align 8");
-  
-  // Collect all classes
-  for (int i = 0; i < items->numChildren; i++) {
-    const ASTNode *item = items->children[i];
-    if (!item || !item->label || strcmp(item->label, "class") != 0) continue;
-    
-    const char *class_name = extract_class_name_from_ast(item);
-    const char *base_name = extract_base_name_from_ast(item);
-    
-    if (!class_name) continue;
-    
-    const char **field_names = NULL;
-    int n_fields = 0;
-    collect_fields_from_class(item, &field_names, &n_fields);
 
-    /* populate cg field map entries for this class */
-    for (int j = 0; j < n_fields; j++) {
-      int new_n = cg->field_n + 1;
-      const char **nc = (const char **)realloc((void*)cg->field_class_names, (size_t)new_n * sizeof(char*));
-      if (nc) cg->field_class_names = nc;
-      const char **nn = (const char **)realloc((void*)cg->field_names, (size_t)new_n * sizeof(char*));
-      if (nn) cg->field_names = nn;
-      int *no = (int *)realloc(cg->field_offsets, (size_t)new_n * sizeof(int));
-      if (no) cg->field_offsets = no;
-      if (cg->field_class_names && cg->field_names && cg->field_offsets) {
-        cg->field_class_names[cg->field_n] = dup_cstr(class_name);
-        cg->field_names[cg->field_n] = dup_cstr(field_names[j]);
-        cg->field_offsets[cg->field_n] = 8 + j * 8;
-        cg->field_n = new_n;
-      }
-    }
-    
-    // Emit type info structure
+  for (int i = 0; i < n_classes; i++) {
+    const ClassInfo *ci = types_class_at(cg->types, i);
+    const char *class_name = ci->name;
+    /* повторное объявление класса: символы уже выпущены для первого */
+    if (types_find_class(cg->types, class_name) != ci) continue;
+
+    // Emit type info structure (fields include inherited ones)
+    int n_fields = ci->n_fields;
     emit(cg, "");
     emit(cg, "  .type %s_typeinfo,@object", class_name);
-    emit(cg, "  .size %s_typeinfo, %d", class_name, 8 + 8 + 8 + 8 * n_fields); // name_ptr, base_ptr, size, fields...
+    emit(cg, "  .size %s_typeinfo, %d", class_name, 8 + 8 + 8 + 8 + 16 * n_fields); // name_ptr, base_ptr, size, n_fields, fields...
     emit(cg, "%s_typeinfo:", class_name);
     emit(cg, "  .quad .LC_type_%s_name", class_name); // pointer to type name string
-    if (base_name) {
-      emit(cg, "  .quad %s_typeinfo", base_name); // pointer to base class typeinfo
+    if (ci->base) {
+      emit(cg, "  .quad %s_typeinfo", ci->base->name); // pointer to base class typeinfo
     } else {
       emit(cg, "  .quad 0"); // no base class
     }
-    emit(cg, "  .quad %d", 8 + 8 * n_fields); // size in bytes (vptr + fields)
+    emit(cg, "  .quad %d", ci->size_bytes); // size in bytes (vptr + fields)
     emit(cg, "  .quad %d", n_fields); // number of fields
-    
-    // Emit field information: offset and name pointer for each field
+
+    // Emit field information: offset and name pointer for each field;
+    // labels by index — a field may shadow an inherited one of the same name
     for (int j = 0; j < n_fields; j++) {
-      emit(cg, "  .quad %d", 8 + j * 8); // field offset
-      if (field_names && j < n_fields && field_names[j]) {
-        emit(cg, "  .quad .LC_field_%s_%s", class_name, field_names[j]); // pointer to field name string
-      } else {
-        emit(cg, "  .quad 0"); // no field name
-      }
+      emit(cg, "  .quad %d", ci->fields[j].offset); // field offset
+      emit(cg, "  .quad .LC_field_%s_%d", class_name, j); // pointer to field name string
     }
-    
+
     // Emit type name string and field name strings
     emit(cg, "");
     emit(cg, "  .section .rodata");
     emit(cg, ".LC_type_%s_name:", class_name);
     emit(cg, "  .asciz \"%s\"", class_name);
-    
-    // Emit field name strings
+
     for (int j = 0; j < n_fields; j++) {
-      if (field_names && j < n_fields && field_names[j]) {
-        emit(cg, ".LC_field_%s_%s:", class_name, field_names[j]);
-        emit(cg, "  .asciz \"%s\"", field_names[j]);
-      }
+      emit(cg, ".LC_field_%s_%d:", class_name, j);
+      emit(cg, "  .asciz \"%s\"", ci->fields[j].name);
     }
-    
-    free(field_names);
-   /* Note: vtable placeholders are emitted later in a single pass
-     from cg->required_vtables. Do not emit per-class vtable here to
-     avoid duplicate symbol definitions. If this class needs a vtable
-     (e.g. an object of this class is instantiated), gen_new will
-     register it via cg_add_required_vtable and it will be emitted
-     once at the end of codegen. */
-  }
-  /* Emit placeholder vtables for any classes that were requested during
-     codegen (via gen_new) but which did not exist as class definitions in
-     the AST. This ensures symbols like List_vtable are defined. */
-  if (cg->required_vtables && cg->req_vtables_n > 0) {
-    // Build a set of class_names we already emitted (from items loop)
-    // We used cg_add_required_vtable above for emitted classes too, so
-    // to avoid duplicating, just iterate required_vtables and emit
-    // those that were not already emitted by this function. To track
-    // emitted ones we can use a temporary array of emitted names built
-    // earlier; but since we already ensured required_vtables contains
-    // all names, we'll emit placeholders only for those entries that do
-    // not currently have a symbol in the file — simple approach: emit
-    // vtable for every required_vtables entry but guard by local
-    // duplication prevention by tracking what we output here.
-    const char **emitted_local = NULL;
-    int emitted_local_n = 0, emitted_local_cap = 0;
-    for (int i = 0; i < cg->req_vtables_n; i++) {
-      const char *vn = cg->required_vtables[i];
-      // skip duplicates in this emission pass
-      int dup = 0;
-      for (int j = 0; j < emitted_local_n; j++) if (!strcmp(emitted_local[j], vn)) { dup = 1; break; }
-      if (dup) continue;
-      // Emit placeholder vtable
-      emit(cg, "");
-      emit(cg, "  .section .data.vtables");
-      emit(cg, "  .align 8");
-      emit(cg, "%s_vtable:", vn);
-      emit(cg, "  .quad 0");
-      // record in emitted_local
-      if (emitted_local_n == emitted_local_cap) {
-        int nc = emitted_local_cap ? emitted_local_cap * 2 : 8;
-        const char **nv = (const char **)realloc((void*)emitted_local, (size_t)nc * sizeof(char*));
-        if (!nv) break;
-        emitted_local = nv; emitted_local_cap = nc;
-      }
-      emitted_local[emitted_local_n++] = vn;
+    emit(cg, "  .section .data.typeinfo");
+  }
+
+  /* vtables: one entry per slot (ClassInfo.vtable), overrides already
+     substituted by types.c; a method without a body gets a null entry */
+  for (int i = 0; i < n_classes; i++) {
+    const ClassInfo *ci = types_class_at(cg->types, i);
+    if (types_find_class(cg->types, ci->name) != ci) continue;
+    emit(cg, "");
+    emit(cg, "  .section .data.vtables");
+    emit(cg, "  .align 8");
+    emit(cg, "%s_vtable:", ci->name);
+    for (int j = 0; j < ci->n_slots; j++) {
+      int k = symmap_get(&cg->method_impl, ci->vtable[j].impl_label);
+      if (k >= 0) emit(cg, "  .quad %s", cg->defined_names[k]);
+      else emit(cg, "  .quad 0");
     }
-    free((void*)emitted_local);
+    if (ci->n_slots == 0) emit(cg, "  .quad 0");
+  }
+
+  /* Emit placeholder vtables for classes that were instantiated (gen_new)
+     but have no definition in the AST. This ensures symbols like
+     List_vtable are defined. */
+  for (int i = 0; i < cg->req_vtables_n; i++) {
+    emit(cg, "");
+    emit(cg, "  .section .data.vtables");
+    emit(cg, "  .align 8");
+    emit(cg, "%s_vtable:", cg->required_vtables[i]);
+    emit(cg, "  .quad 0");
   }
 }
 
 // публичная функция: сгенерить asm из AST root
 int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
-  if (!out || !root || !root->label) return 0;
+  if (!out || !root ) return 0;
+
+  // экземпляры шаблонов — обычные классы до всех остальных проходов
+  if (mono_instantiate((ASTNode *)root) < 0) return 0;
 
   CG cg;
   cg_init(&cg, out);
@@ -1988,19 +2724,25 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
   collect_literals(&cg, root);
 
   // ожидаем: source -> items -> (funcDef|funcDecl)*
-  if (strcmp(root->label, "source") != 0 || root->numChildren < 1) {
+  if (root->kind != AST_SOURCE || root->numChildren < 1) {
     fprintf(stderr, "codegen: expected root 'source'\n");
     cg_free(&cg);
     return 0;
   }
 
-  const ASTNode *items = root->children[0];
-  if (!items || !items->label || strcmp(items->label, "items") != 0) {
+  const ASTNode *items = ast_child(root, 0);
+  if (!items || items->kind != AST_ITEMS) {
     fprintf(stderr, "codegen: expected 'items'\n");
     cg_free(&cg);
     return 0;
   }
 
+  // классы: размеры и смещения полей до понижения методов
+  cg_build_types(&cg, root);
+  cg.etypes = typeinfer_run(root, cg.types);
+  cg.escapes = escape_run(root, cg.types, cg.etypes);
+  cg.this_id = ast_create_leaf(items->arena, AST_ID, "this");
+
   // First pass: collect defined function names
   typedef struct {
     const char **names;
@@ -2012,20 +2754,20 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
   memset(&defined, 0, sizeof(defined));
   
   for (int i = 0; i < items->numChildren; i++) {
-    const ASTNode *fn = items->children[i];
-    if (!fn || !fn->label) continue;
+    const ASTNode *fn = ast_child(items, i);
+    if (!fn) continue;
 
-    if (!strcmp(fn->label, "funcDef")) {
+    if (fn->kind == AST_FUNC_DEF) {
       const char *nm = get_func_name(fn);
       /* compute arity (number of args) from signature if available */
       int ar = 0;
       if (fn->numChildren > 0) {
-        const ASTNode *sig = fn->children[0];
-        if (sig && sig->label && strcmp(sig->label, "signature") == 0 && sig->numChildren >= 3) {
-          const ASTNode *args = sig->children[2];
-          if (args && args->label && strcmp(args->label, "args") == 0 && args->numChildren > 0) {
-            const ASTNode *arglist = args->children[0];
-            if (arglist && arglist->label && strcmp(arglist->label, "arglist") == 0) ar = arglist->numChildren;
+        const ASTNode *sig = ast_child(fn, 0);
+        if (sig && sig->kind == AST_SIGNATURE && sig->numChildren >= 3) {
+          const ASTNode *args = ast_child(sig, 2);
+          if (args && args->kind == AST_ARGS && args->numChildren > 0) {
+            const ASTNode *arglist = ast_child(args, 0);
+            if (arglist && arglist->kind == AST_ARGLIST) ar = arglist->numChildren;
           }
         }
       }
@@ -2055,6 +2797,7 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
     cg.defined_names = defined.names;
     cg.defined_arity = defined.arity;
     cg.defined_n = defined.n;
+    for (int k = 0; k < cg.defined_n; k++) cg_index_defined(&cg, k);
     defined.names = NULL;
     defined.arity = NULL;
     defined.n = 0;
@@ -2065,9 +2808,9 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
   // so they are emitted by the existing function generator. The
   // convention used here is: <ClassName>__<methodName>
   for (int i = 0; i < items->numChildren; i++) {
-    const ASTNode *item = items->children[i];
-    if (!item || !item->label) continue;
-    if (strcmp(item->label, "class") != 0) continue;
+    const ASTNode *item = ast_child(items, i);
+    if (!item) continue;
+    if (item->kind != AST_CLASS) continue;
 
     const char *class_name = extract_class_name_from_ast(item);
     if (!class_name) continue;
@@ -2075,56 +2818,34 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
     // Find members node
     const ASTNode *members = NULL;
     for (int j = 0; j < item->numChildren; j++) {
-      const ASTNode *c = item->children[j];
-      if (c && c->label && strcmp(c->label, "members") == 0) { members = c; break; }
+      const ASTNode *c = ast_child(item, j);
+      if (c && c->kind == AST_MEMBERS) { members = c; break; }
     }
     if (!members) continue;
 
-    /* populate cg field map entries for this class early so generators
-       can consult field offsets while emitting functions */
-    const char **cls_field_names = NULL;
-    int cls_n_fields = 0;
-    collect_fields_from_class(item, &cls_field_names, &cls_n_fields);
-    for (int j = 0; j < cls_n_fields; j++) {
-      int new_n = cg.field_n + 1;
-      const char **nc = (const char **)realloc((void*)cg.field_class_names, (size_t)new_n * sizeof(char*));
-      if (nc) cg.field_class_names = nc;
-      const char **nn = (const char **)realloc((void*)cg.field_names, (size_t)new_n * sizeof(char*));
-      if (nn) cg.field_names = nn;
-      int *no = (int *)realloc(cg.field_offsets, (size_t)new_n * sizeof(int));
-      if (no) cg.field_offsets = no;
-      if (cg.field_class_names && cg.field_names && cg.field_offsets) {
-        cg.field_class_names[cg.field_n] = dup_cstr(class_name);
-        cg.field_names[cg.field_n] = dup_cstr(cls_field_names[j]);
-        cg.field_offsets[cg.field_n] = 8 + j * 8;
-        cg.field_n = new_n;
-      }
-    }
-    free((void*)cls_field_names);
-
     // For each member, if it contains an inner funcDef, create a top-level
     // funcDef with a mangled name and the same body. We prepend an implicit
     // 'this' parameter of type <ClassName> so the generated function will
     // receive the object pointer in r2 as gen_method_call expects.
     for (int m = 0; m < members->numChildren; m++) {
-      const ASTNode *member = members->children[m];
-      if (!member || !member->label) continue;
+      const ASTNode *member = ast_child(members, m);
+      if (!member) continue;
 
       // Look for a nested funcDef inside this member
       for (int k = 0; k < member->numChildren; k++) {
-        const ASTNode *child = member->children[k];
-        if (!child || !child->label) continue;
-        if (strcmp(child->label, "funcDef") != 0) continue;
+        const ASTNode *child = ast_child(member, k);
+        if (!child) continue;
+        if (child->kind != AST_FUNC_DEF) continue;
 
         const ASTNode *orig_fn = child;
-        const ASTNode *orig_sig = (orig_fn->numChildren > 0) ? orig_fn->children[0] : NULL;
-        if (!orig_sig || !orig_sig->label || strcmp(orig_sig->label, "signature") != 0) continue;
+        const ASTNode *orig_sig = (orig_fn->numChildren > 0) ? ast_child(orig_fn, 0) : NULL;
+        if (!orig_sig || orig_sig->kind != AST_SIGNATURE) continue;
 
         // Extract method name from signature (if present)
         const char *method_name = "unknown";
         if (orig_sig->numChildren >= 2) {
-          const ASTNode *idn = orig_sig->children[1];
-          if (idn && is_token_kind(idn, "id")) method_name = after_colon(idn->label);
+          const ASTNode *idn = ast_child(orig_sig, 1);
+          if (idn && idn->kind == AST_ID) method_name = idn->lexeme;
         }
 
         // Build mangled name: Class__method
@@ -2132,33 +2853,33 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
         snprintf(mangled, sizeof(mangled), "%s__%s", class_name, method_name);
 
         // Build new signature: [0]=returnType (reuse), [1]=mangled id, [2]=args
-        ASTNode *new_sig = ast_create_node("signature");
+        ASTNode *new_sig = ast_create_node(items->arena, AST_SIGNATURE);
         if (orig_sig->numChildren >= 1) {
-          ast_add_child(new_sig, (ASTNode*)orig_sig->children[0]); // return type (reuse)
+          ast_add_child(new_sig, ast_child(orig_sig, 0)); // return type (reuse)
         }
-        ASTNode *idnode = ast_create_leaf_token("id", mangled);
+        ASTNode *idnode = ast_create_leaf(items->arena, AST_ID, mangled);
         ast_add_child(new_sig, idnode);
 
         // Build args: create arglist with implicit 'this' arg first
-        ASTNode *args_node = ast_create_node("args");
-        ASTNode *arglist = ast_create_node("arglist");
+        ASTNode *args_node = ast_create_node(items->arena, AST_ARGS);
+        ASTNode *arglist = ast_create_node(items->arena, AST_ARGLIST);
 
         // implicit this: arg -> [ typeRef(class_name), id(this) ]
-        ASTNode *this_arg = ast_create_node("arg");
-        ASTNode *this_type = ast_create_leaf_token("typeRef", (char*)class_name);
-        ASTNode *this_id = ast_create_leaf_token("id", "this");
+        ASTNode *this_arg = ast_create_node(items->arena, AST_ARG);
+        ASTNode *this_type = ast_create_leaf(items->arena, AST_TYPE_REF, (char*)class_name);
+        ASTNode *this_id = ast_create_leaf(items->arena, AST_ID, "this");
         ast_add_child(this_arg, this_type);
         ast_add_child(this_arg, this_id);
         ast_add_child(arglist, this_arg);
 
         // Append original args (if any)
         if (orig_sig->numChildren >= 3) {
-          const ASTNode *old_args = orig_sig->children[2];
-          if (old_args && old_args->label && strcmp(old_args->label, "args") == 0 && old_args->numChildren > 0) {
-            const ASTNode *old_arglist = old_args->children[0];
-            if (old_arglist && old_arglist->label && strcmp(old_arglist->label, "arglist") == 0) {
+          const ASTNode *old_args = ast_child(orig_sig, 2);
+          if (old_args && old_args->kind == AST_ARGS && old_args->numChildren > 0) {
+            const ASTNode *old_arglist = ast_child(old_args, 0);
+            if (old_arglist && old_arglist->kind == AST_ARGLIST) {
               for (int a = 0; a < old_arglist->numChildren; a++) {
-                ast_add_child(arglist, (ASTNode*)old_arglist->children[a]); // reuse
+                ast_add_child(arglist, ast_child(old_arglist, a)); // reuse
               }
             }
           }
@@ -2168,23 +2889,23 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
         ast_add_child(new_sig, args_node);
 
         // Create new top-level funcDef and attach signature + body
-        ASTNode *new_fn = ast_create_node("funcDef");
+        ASTNode *new_fn = ast_create_node(items->arena, AST_FUNC_DEF);
         ast_add_child(new_fn, new_sig);
-        if (orig_fn->numChildren >= 2) ast_add_child(new_fn, (ASTNode*)orig_fn->children[1]); // reuse body
+        if (orig_fn->numChildren >= 2) ast_add_child(new_fn, ast_child(orig_fn, 1)); // reuse body
 
         // Append to top-level items so the normal function emitter will generate it
         ast_add_child((ASTNode*)items, new_fn);
         /* Register the newly created mangled function name in cg->defined_names
            so subsequent call-site resolution can find it. */
         {
-          const char *nm_new = get_func_name(new_fn); /* allocated */
+          const char *nm_new = get_func_name(new_fn);
           int ar_new = 0;
           /* compute arity from new_sig (args list) */
           if (new_sig && new_sig->numChildren >= 3) {
-            const ASTNode *argsn = new_sig->children[2];
-            if (argsn && argsn->label && strcmp(argsn->label, "args") == 0 && argsn->numChildren > 0) {
-              const ASTNode *argl = argsn->children[0];
-              if (argl && argl->label && strcmp(argl->label, "arglist") == 0) ar_new = argl->numChildren;
+            const ASTNode *argsn = ast_child(new_sig, 2);
+            if (argsn && argsn->kind == AST_ARGS && argsn->numChildren > 0) {
+              const ASTNode *argl = ast_child(argsn, 0);
+              if (argl && argl->kind == AST_ARGLIST) ar_new = argl->numChildren;
             }
           }
           int new_count = cg.defined_n + 1;
@@ -2193,11 +2914,13 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
           if (nn) cg.defined_names = nn;
           if (na) cg.defined_arity = na;
           if (cg.defined_names && cg.defined_arity) {
+            const char *impl = intern_cstr(mangled);
+            if (symmap_get(&cg.method_impl, impl) < 0)
+              symmap_put(&cg.method_impl, impl, cg.defined_n);
             cg.defined_names[cg.defined_n] = nm_new;
             cg.defined_arity[cg.defined_n] = ar_new;
+            cg_index_defined(&cg, cg.defined_n);
             cg.defined_n = new_count;
-          } else {
-            free((void*)nm_new);
           }
         }
       }
@@ -2205,35 +2928,37 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
   }
   
   // Second pass: generate code (deduplicate functions with identical mangled names)
-  char **emitted = NULL;
+  const char **emitted = NULL;
   int emitted_n = 0;
 
   for (int i = 0; i < items->numChildren; i++) {
-    const ASTNode *fn = items->children[i];
-    if (!fn || !fn->label) continue;
+    const ASTNode *fn = ast_child(items, i);
+    if (!fn) continue;
 
-    if (!strcmp(fn->label, "funcDef")) {
-      char *nm = (char*)get_func_name(fn); // allocated
+    if (fn->kind == AST_FUNC_DEF) {
+      const char *nm = get_func_name(fn);
       int dup = 0;
       for (int k = 0; k < emitted_n; k++) {
-        if (emitted[k] && !strcmp(emitted[k], nm)) { dup = 1; break; }
+        if (emitted[k] == nm) { dup = 1; break; }
       }
       if (dup) {
         emit(&cg, "  # duplicate function '%s' skipped", nm);
-        free(nm);
         continue;
       }
       // record and emit
-      emitted = (char**)realloc(emitted, (size_t)(emitted_n + 1) * sizeof(char*));
+      emitted = (const char **)realloc((void*)emitted, (size_t)(emitted_n + 1) * sizeof(char*));
       if (emitted) emitted[emitted_n++] = nm;
+      TraceSpan fspan;
+      trace_begin(&fspan, "gen_function", nm);
       gen_function_with_name(&cg, fn, nm);
+      trace_end(&fspan);
 
-    } else if (!strcmp(fn->label, "funcDecl")) {
+    } else if (fn->kind == AST_FUNC_DECL) {
       const char *nm = get_func_name(fn);
       // Check if function is defined (by earlier collected defined.names)
       int found = 0;
       for (int j = 0; j < defined.n; j++) {
-        if (defined.names[j] && !strcmp(defined.names[j], nm)) {
+        if (defined.names[j] == nm) {
           found = 1;
           break;
         }
@@ -2261,13 +2986,10 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
         // Keep as extern for standard library functions (use base name)
         emit(&cg, "  .extern %s", base);
       }
-      free((void*)nm);
     }
   }
 
-  // free emitted names
-  for (int i = 0; i < emitted_n; i++) free(emitted[i]);
-  free(emitted);
+  free((void*)emitted);
   
   // defined.names memory has been moved into cg.defined_names above; do not free here
 
@@ -2276,8 +2998,13 @@ int codegen_s390x_from_ast(FILE *out, const ASTNode *root) {
   emit(&cg, "  .extern stdout");
   emit(&cg, "  .extern fflush");
 
-  emit_type_info(&cg, root);
+  TraceSpan span;
+  trace_begin(&span, "emit_type_info", NULL);
+  emit_type_info(&cg);
+  trace_end(&span);
+  trace_begin(&span, "emit_rodata", NULL);
   emit_rodata(&cg);
+  trace_end(&span);
 
   cg_free(&cg);
   return 1;
@@ -6,73 +6,112 @@
 #include <stdlib.h>
 
 /* Parser generated in build directory */
-#include "../../build/parser.tab.h"
+#include "parser.tab.h"
+#include "../parser/parse.h"
+#include "../trace/trace.h"
 
-extern FILE *yyin;
-extern int yyparse(void);
 /* expose bison debug flag (available when %debug is used in grammar) */
 extern int yydebug;
 
-/* Skip UTF-8 BOM if present at the start of the file. Leaves the file
-   position after the BOM (or rewound to start if no BOM). */
-static void skip_utf8_bom(FILE *f) {
-  if (!f) return;
-  unsigned char bom[3];
-  size_t n = fread(bom, 1, 3, f);
-  if (n != 3 || bom[0] != 0xEF || bom[1] != 0xBB || bom[2] != 0xBF) {
-    /* No BOM: rewind to start */
-    fseek(f, 0, SEEK_SET);
+/* Склеить элементы нескольких единиц трансляции в один source/items
+   в новой арене; арены исходных файлов освобождаются. */
+static ASTNode *merge_roots(ParseCtx *parsed, int n) {
+  if (n == 1)
+    return parsed[0].root;
+  ASTArena *arena = ast_arena_create();
+  ASTNode *root = ast_create_node(arena, AST_SOURCE);
+  ASTNode *items = ast_create_node(arena, AST_ITEMS);
+  if (!root || !items) {
+    ast_arena_free(arena);
+    return NULL;
   }
+  ast_add_child(root, items);
+  for (int i = 0; i < n; i++) {
+    ASTNode *src = parsed[i].root;
+    ASTNode *src_items = src && src->numChildren > 0 ? ast_child(src, 0) : NULL;
+    if (src_items) {
+      for (int j = 0; j < src_items->numChildren; j++)
+        ast_add_child(items, ast_clone(arena, ast_child(src_items, j)));
+    }
+    parse_ctx_release(&parsed[i]);
+  }
+  return root;
 }
 
 int main(int argc, char **argv) {
-  const char *input_file = NULL;
   const char *output_file = NULL;
+  const char *const *inputs = NULL;
+  int num_inputs = 0;
+
+  /* --time-report / --trace=FILE can appear anywhere */
+  if (trace_parse_args(&argc, argv) != 0)
+    return 1;
 
-  /* Parse arguments: support both <input> <output> and <input> -o <output> */
-  if (argc == 3) {
+  /* Parse arguments: support <input> <output> and <input>... -o <output> */
+  if (argc == 3 && strcmp(argv[1], "-o") != 0 && strcmp(argv[2], "-o") != 0) {
     /* Simple format: input output */
-    input_file = argv[1];
+    inputs = (const char *const *)&argv[1];
+    num_inputs = 1;
     output_file = argv[2];
-  } else if (argc == 4 && strcmp(argv[2], "-o") == 0) {
-    /* Flag format: input -o output */
-    input_file = argv[1];
-    output_file = argv[3];
+  } else if (argc >= 4 && strcmp(argv[argc - 2], "-o") == 0) {
+    /* Flag format: input... -o output (several files form one program) */
+    inputs = (const char *const *)&argv[1];
+    num_inputs = argc - 3;
+    output_file = argv[argc - 1];
   } else {
-    fprintf(stderr, "usage: %s <input-file> <output-file>\n", argv[0]);
-    fprintf(stderr, "   or: %s <input-file> -o <output-file>\n", argv[0]);
-    return 1;
-  }
-
-  /* Open input file */
-  errno = 0;
-  FILE *input_f = fopen(input_file, "rb");
-  if (!input_f) {
-    fprintf(stderr, "Error: cannot open input file '%s': %s\n", input_file,
-            strerror(errno));
+    fprintf(stderr, "usage: %s [--time-report] [--trace=out.json] <input-file> <output-file>\n", argv[0]);
+    fprintf(stderr, "   or: %s [--time-report] [--trace=out.json] <input-file>... -o <output-file>\n", argv[0]);
     return 1;
   }
 
-  /* Parse input file */
-  /* Be tolerant of optional UTF-8 BOM at the start of input files */
-  skip_utf8_bom(input_f);
-  yyin = input_f;
   /* Enable parser debug when requested via environment (helps debugging) */
   if (getenv("PARSER_DEBUG") != NULL) {
     yydebug = 1;
   }
-  int parse_result = yyparse();
-  fclose(input_f);
 
-  if (parse_result != 0) {
-    fprintf(stderr, "Error: syntax errors in '%s'\n", input_file);
+  /* Parse input files in parallel (BOM is skipped by parse_file) */
+  ParseCtx *parsed = (ParseCtx *)calloc((size_t)num_inputs, sizeof(ParseCtx));
+  if (!parsed) {
+    fprintf(stderr, "Error: out of memory\n");
+    return 1;
+  }
+  parse_files(inputs, num_inputs, parsed, 0);
+
+  int parse_errors = 0;
+  for (int i = 0; i < num_inputs; i++) {
+    switch (parsed[i].status) {
+    case PARSE_OK:
+      break;
+    case PARSE_ERR_OPEN:
+      fprintf(stderr, "Error: cannot open input file '%s': %s\n", inputs[i],
+              strerror(parsed[i].sys_errno));
+      parse_errors = 1;
+      break;
+    case PARSE_ERR_NO_ROOT:
+      fprintf(stderr, "Error: no AST root produced for '%s'\n", inputs[i]);
+      parse_errors = 1;
+      break;
+    default:
+      fprintf(stderr, "Error: syntax errors in '%s'\n", inputs[i]);
+      parse_errors = 1;
+      break;
+    }
+  }
+  if (parse_errors) {
+    for (int i = 0; i < num_inputs; i++)
+      parse_ctx_release(&parsed[i]);
+    free(parsed);
     return 1;
   }
 
   /* Get AST root */
-  ASTNode *root = ast_get_root();
+  TraceSpan merge_span;
+  trace_begin(&merge_span, "merge", NULL);
+  ASTNode *root = merge_roots(parsed, num_inputs);
+  trace_end(&merge_span);
+  free(parsed);
   if (!root) {
-    fprintf(stderr, "Error: no AST root produced for '%s'\n", input_file);
+    fprintf(stderr, "Error: out of memory\n");
     return 1;
   }
 
@@ -82,12 +121,19 @@ int main(int argc, char **argv) {
   if (!output_f) {
     fprintf(stderr, "Error: cannot open output file '%s': %s\n", output_file,
             strerror(errno));
+    ast_arena_free(root->arena);
     return 1;
   }
 
   /* Generate code */
+  TraceSpan cg_span;
+  trace_begin(&cg_span, "codegen", NULL);
   int codegen_result = codegen_s390x_from_ast(output_f, root);
   fclose(output_f);
+  trace_end(&cg_span);
+  /* узлы методов, добавленные codegen, разделяют поддеревья с исходными —
+     арена освобождает всё разом, без обхода */
+  ast_arena_free(root->arena);
 
   if (!codegen_result) {
     fprintf(stderr, "Error: code generation failed\n");
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "regalloc.h"
+
+// ------------------------- interval ordering -------------------------
+
+static const LiveInterval *g_sort_iv; // qsort has no context argument in C99
+
+static int cmp_by_start(const void *a, const void *b) {
+  const LiveInterval *x = &g_sort_iv[*(const int *)a];
+  const LiveInterval *y = &g_sort_iv[*(const int *)b];
+  if (x->start != y->start) return x->start < y->start ? -1 : 1;
+  if (x->end != y->end) return x->end < y->end ? -1 : 1;
+  return *(const int *)a - *(const int *)b;
+}
+
+// ------------------------- active set -------------------------
+
+// active: interval indices that currently hold a register, kept sorted by end
+typedef struct {
+  int *v;
+  int n;
+} ActiveSet;
+
+static void active_insert(ActiveSet *a, const LiveInterval *iv, int idx) {
+  int pos = a->n;
+  while (pos > 0 && iv[a->v[pos - 1]].end > iv[idx].end) {
+    a->v[pos] = a->v[pos - 1];
+    pos--;
+  }
+  a->v[pos] = idx;
+  a->n++;
+}
+
+static void active_remove_at(ActiveSet *a, int pos) {
+  memmove(&a->v[pos], &a->v[pos + 1], (size_t)(a->n - pos - 1) * sizeof(int));
+  a->n--;
+}
+
+static int pool_index_of(const RegPool *pool, int reg) {
+  for (int i = 0; i < pool->n; i++) {
+    if (pool->regs[i] == reg) return i;
+  }
+  return -1;
+}
+
+// Free register for `cur`. Intervals that cross a call may only use
+// callee-saved registers; the others prefer caller-saved ones so the
+// callee-saved registers stay available for long-lived values.
+static int pick_free_reg(const RegPool *pool, const int *in_use, const LiveInterval *cur) {
+  if (!cur->crosses_call) {
+    for (int i = 0; i < pool->n; i++) {
+      if (!in_use[i] && !pool->callee_saved[i]) return i;
+    }
+  }
+  for (int i = 0; i < pool->n; i++) {
+    if (!in_use[i] && pool->callee_saved[i]) return i;
+  }
+  return -1;
+}
+
+// ------------------------- linear scan -------------------------
+
+void ra_linear_scan(LiveInterval *iv, int n, const RegPool *pool) {
+  if (!iv || n <= 0 || !pool) return;
+
+  int *order = (int *)malloc((size_t)n * sizeof(int));
+  int *active_buf = (int *)malloc((size_t)n * sizeof(int));
+  if (!order || !active_buf) {
+    free(order);
+    free(active_buf);
+    for (int i = 0; i < n; i++) iv[i].reg = RA_NO_REG;
+    return;
+  }
+
+  for (int i = 0; i < n; i++) {
+    order[i] = i;
+    iv[i].reg = RA_NO_REG;
+  }
+  g_sort_iv = iv;
+  qsort(order, (size_t)n, sizeof(int), cmp_by_start);
+  g_sort_iv = NULL;
+
+  int in_use[RA_MAX_POOL];
+  memset(in_use, 0, sizeof(in_use));
+  ActiveSet active = {active_buf, 0};
+
+  for (int k = 0; k < n; k++) {
+    int cur = order[k];
+    LiveInterval *ci = &iv[cur];
+    if (ci->fixed_mem) continue;
+
+    // expire old intervals
+    while (active.n > 0 && iv[active.v[0]].end < ci->start) {
+      int pi = pool_index_of(pool, iv[active.v[0]].reg);
+      if (pi >= 0) in_use[pi] = 0;
+      active_remove_at(&active, 0);
+    }
+
+    int pi = pick_free_reg(pool, in_use, ci);
+    if (pi >= 0) {
+      in_use[pi] = 1;
+      ci->reg = pool->regs[pi];
+      active_insert(&active, iv, cur);
+      continue;
+    }
+
+    // No free register: spill the cheapest interval among `cur` and the
+    // active ones whose register `cur` could take over. Ties go to the
+    // one that ends last (classic linear-scan heuristic).
+    int victim_pos = -1;
+    for (int a = 0; a < active.n; a++) {
+      const LiveInterval *ai = &iv[active.v[a]];
+      int api = pool_index_of(pool, ai->reg);
+      if (api < 0) continue;
+      if (ci->crosses_call && !pool->callee_saved[api]) continue;
+      if (victim_pos < 0) {
+        victim_pos = a;
+        continue;
+      }
+      const LiveInterval *vi = &iv[active.v[victim_pos]];
+      if (ai->weight < vi->weight || (ai->weight == vi->weight && ai->end > vi->end)) {
+        victim_pos = a;
+      }
+    }
+
+    if (victim_pos >= 0) {
+      LiveInterval *vi = &iv[active.v[victim_pos]];
+      if (vi->weight < ci->weight || (vi->weight == ci->weight && vi->end > ci->end)) {
+        ci->reg = vi->reg;
+        vi->reg = RA_NO_REG;
+        active_remove_at(&active, victim_pos);
+        active_insert(&active, iv, cur);
+        continue;
+      }
+    }
+    // cur stays spilled
+  }
+
+  free(order);
+  free(active_buf);
+}
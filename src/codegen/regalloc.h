@@ -0,0 +1,31 @@
+#pragma once
+
+/*
+ * Linear-scan register allocation (Poletto & Sarkar) over live intervals.
+ *
+ * Codegen numbers program points while walking a function body once in
+ * "dry run" mode, builds one interval per local and per expression
+ * temporary, and then asks ra_linear_scan() to map intervals onto the
+ * physical registers of the pool. Intervals that do not get a register
+ * are spilled and live in a frame slot for their whole lifetime.
+ */
+
+#define RA_NO_REG (-1)
+#define RA_MAX_POOL 16
+
+typedef struct {
+  int start, end;   /* first/last program point (inclusive) */
+  int weight;       /* use count scaled by loop depth (spill cost) */
+  int crosses_call; /* live across a call: needs a callee-saved register */
+  int fixed_mem;    /* address taken: never allocated to a register */
+  int reg;          /* assigned register or RA_NO_REG */
+} LiveInterval;
+
+typedef struct {
+  int regs[RA_MAX_POOL];         /* physical register numbers */
+  int callee_saved[RA_MAX_POOL]; /* 1 if preserved across calls */
+  int n;
+} RegPool;
+
+/* Assign registers to iv[0..n). Fills iv[i].reg. */
+void ra_linear_scan(LiveInterval *iv, int n, const RegPool *pool);
@@ -0,0 +1,939 @@
+#include "analysis.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "../trace/memstat.h"
+
+/* Scratch and result arrays of the analyses, counted under MEM_DATAFLOW */
+static void *df_alloc(size_t bytes) {
+  void *p = malloc(bytes ? bytes : 1);
+  if (p)
+    mem_note_alloc(MEM_DATAFLOW, bytes ? bytes : 1);
+  return p;
+}
+
+static void df_free(void *p, size_t bytes) {
+  if (!p)
+    return;
+  free(p);
+  mem_note_free(MEM_DATAFLOW, bytes ? bytes : 1);
+}
+
+/* 1 at the global registers: read in a block before any definition there,
+   or phi operands. NULL on failure; release with df_free(g, num_regs). */
+static unsigned char *global_regs(IRFunction *f) {
+  CFGFunction *func = f->cfg;
+  int nr = f->num_regs;
+  unsigned char *g = (unsigned char *)df_alloc((size_t)nr);
+  int *def_block = (int *)df_alloc((size_t)nr * sizeof(int));
+  if (!g || !def_block) {
+    df_free(g, (size_t)nr);
+    df_free(def_block, (size_t)nr * sizeof(int));
+    return NULL;
+  }
+  memset(g, 0, (size_t)nr);
+  for (int r = 0; r < nr; r++)
+    def_block[r] = -1;
+
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    const IRBlock *b = &f->blocks[bi];
+    for (int j = 0; j < b->num_instrs; j++) {
+      const IRInstr *ins = &b->instrs[j];
+      const IRReg *a = f->arg_pool + ins->args;
+      for (int i = 0; i < ins->num_args; i++)
+        if (a[i] > 0 && a[i] < nr &&
+            (ins->op == IR_PHI || def_block[a[i]] != bi))
+          g[a[i]] = 1;
+      if (ins->dst > 0 && ins->dst < nr)
+        def_block[ins->dst] = bi;
+    }
+  }
+  df_free(def_block, (size_t)nr * sizeof(int));
+  return g;
+}
+
+/* ============================================================================
+ * LIVENESS
+ * ============================================================================
+ */
+
+void ir_liveness_free(IRLiveness *live) {
+  if (!live)
+    return;
+  df_free(live->reg_of_bit, (size_t)live->df.num_bits * sizeof(IRReg));
+  df_free(live->bit_of_reg, (size_t)live->num_regs * sizeof(int));
+  cfg_dataflow_free(&live->df);
+  memset(live, 0, sizeof(*live));
+}
+
+int ir_liveness(IRFunction *f, IRLiveness *live) {
+  if (!live)
+    return -1;
+  memset(live, 0, sizeof(*live));
+  if (!f)
+    return -1;
+  CFGFunction *func = f->cfg;
+  int nr = f->num_regs;
+  unsigned char *g = global_regs(f);
+  live->bit_of_reg = (int *)df_alloc((size_t)nr * sizeof(int));
+  if (live->bit_of_reg)
+    live->num_regs = nr;
+  if (!g || !live->bit_of_reg) {
+    df_free(g, (size_t)nr);
+    ir_liveness_free(live);
+    return -1;
+  }
+  int nbits = 0;
+  for (int r = 0; r < nr; r++)
+    live->bit_of_reg[r] = g[r] ? nbits++ : -1;
+  df_free(g, (size_t)nr);
+
+  /* df.num_bits also sizes reg_of_bit on free */
+  if (cfg_dataflow_init(&live->df, func, CFG_DF_BACKWARD, CFG_DF_UNION,
+                        nbits, 1) != 0) {
+    ir_liveness_free(live);
+    return -1;
+  }
+  live->reg_of_bit = (IRReg *)df_alloc((size_t)nbits * sizeof(IRReg));
+  if (!live->reg_of_bit) {
+    ir_liveness_free(live);
+    return -1;
+  }
+  for (int r = 0; r < nr; r++)
+    if (live->bit_of_reg[r] >= 0)
+      live->reg_of_bit[live->bit_of_reg[r]] = r;
+
+  const int *bit = live->bit_of_reg;
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    const IRBlock *b = &f->blocks[bi];
+    CFGBitWord *gen = cfg_dataflow_gen(&live->df, bi);
+    CFGBitWord *kill = cfg_dataflow_kill(&live->df, bi);
+    int np = cfg_function_get_num_preds(func, bi);
+    const int *preds = cfg_function_get_preds(func, bi);
+    /* Backwards, so gen ends up with the upward-exposed uses */
+    for (int j = b->num_instrs - 1; j >= 0; j--) {
+      const IRInstr *ins = &b->instrs[j];
+      const IRReg *a = f->arg_pool + ins->args;
+      if (ins->dst > 0 && ins->dst < nr && bit[ins->dst] >= 0) {
+        cfg_bits_set(kill, bit[ins->dst]);
+        cfg_bits_clear(gen, bit[ins->dst]);
+      }
+      if (ins->op == IR_PHI) {
+        for (int i = 0; i < ins->num_args && i < np; i++)
+          if (a[i] > 0 && a[i] < nr)
+            cfg_bits_set(cfg_dataflow_meet_gen(&live->df, preds[i]),
+                         bit[a[i]]);
+        continue;
+      }
+      for (int i = 0; i < ins->num_args; i++)
+        if (a[i] > 0 && a[i] < nr && bit[a[i]] >= 0)
+          cfg_bits_set(gen, bit[a[i]]);
+    }
+  }
+
+  if (cfg_dataflow_solve(&live->df) != 0) {
+    ir_liveness_free(live);
+    return -1;
+  }
+  return 0;
+}
+
+static int live_test(const IRLiveness *live, const CFGBitWord *s, IRReg r) {
+  if (!s || r <= 0 || r >= live->num_regs || live->bit_of_reg[r] < 0)
+    return 0;
+  return cfg_bits_test(s, live->bit_of_reg[r]);
+}
+
+int ir_liveness_live_in(const IRLiveness *live, int block, IRReg r) {
+  return live ? live_test(live, cfg_dataflow_in(&live->df, block), r) : 0;
+}
+
+int ir_liveness_live_out(const IRLiveness *live, int block, IRReg r) {
+  return live ? live_test(live, cfg_dataflow_out(&live->df, block), r) : 0;
+}
+
+/* ============================================================================
+ * REACHING DEFINITIONS
+ * ============================================================================
+ */
+
+void ir_reaching_defs_free(IRReachingDefs *rd) {
+  if (!rd)
+    return;
+  cfg_dataflow_free(&rd->df);
+  df_free(rd->defs, (size_t)rd->num_defs * sizeof(IRDefSite));
+  df_free(rd->reg_start, ((size_t)rd->num_regs + 1) * sizeof(int));
+  memset(rd, 0, sizeof(*rd));
+}
+
+int ir_reaching_defs(IRFunction *f, IRReachingDefs *rd) {
+  if (!rd)
+    return -1;
+  memset(rd, 0, sizeof(*rd));
+  if (!f)
+    return -1;
+  CFGFunction *func = f->cfg;
+  int nr = f->num_regs;
+  rd->reg_start = (int *)df_alloc(((size_t)nr + 1) * sizeof(int));
+  if (rd->reg_start)
+    rd->num_regs = nr;
+  unsigned char *g = global_regs(f);
+  /* cursor: next number per register; last: latest definition of a
+     register in the current block, -1 if none */
+  int *cursor = (int *)df_alloc(2 * (size_t)nr * sizeof(int));
+  if (!rd->reg_start || !g || !cursor) {
+    df_free(g, (size_t)nr);
+    df_free(cursor, 2 * (size_t)nr * sizeof(int));
+    ir_reaching_defs_free(rd);
+    return -1;
+  }
+  int *last = cursor + nr;
+
+  /* Count per global register, then prefix sums */
+  memset(rd->reg_start, 0, ((size_t)nr + 1) * sizeof(int));
+  for (int k = 0; k < func->num_reachable; k++) {
+    const IRBlock *b = &f->blocks[func->rpo[k]];
+    for (int j = 0; j < b->num_instrs; j++) {
+      IRReg r = b->instrs[j].dst;
+      if (r > 0 && r < nr && g[r])
+        rd->reg_start[r + 1]++;
+    }
+  }
+  df_free(g, (size_t)nr);
+  for (int r = 0; r < nr; r++)
+    rd->reg_start[r + 1] += rd->reg_start[r];
+
+  int nd = rd->reg_start[nr];
+  rd->defs = (IRDefSite *)df_alloc((size_t)nd * sizeof(IRDefSite));
+  if (rd->defs)
+    rd->num_defs = nd;
+  if (!rd->defs || cfg_dataflow_init(&rd->df, func, CFG_DF_FORWARD,
+                                     CFG_DF_UNION, nd, 0) != 0) {
+    df_free(cursor, 2 * (size_t)nr * sizeof(int));
+    ir_reaching_defs_free(rd);
+    return -1;
+  }
+
+  memcpy(cursor, rd->reg_start, (size_t)nr * sizeof(int));
+  for (int r = 0; r < nr; r++)
+    last[r] = -1;
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    const IRBlock *b = &f->blocks[bi];
+    CFGBitWord *gen = cfg_dataflow_gen(&rd->df, bi);
+    CFGBitWord *kill = cfg_dataflow_kill(&rd->df, bi);
+    for (int j = 0; j < b->num_instrs; j++) {
+      IRReg r = b->instrs[j].dst;
+      if (r <= 0 || r >= nr || rd->reg_start[r] == rd->reg_start[r + 1])
+        continue;
+      int d = cursor[r]++;
+      rd->defs[d].block = bi;
+      rd->defs[d].instr = j;
+      rd->defs[d].reg = r;
+      /* The first definition of r here kills all of r's */
+      if (last[r] < 0)
+        cfg_bits_set_range(kill, rd->reg_start[r], rd->reg_start[r + 1]);
+      last[r] = d;
+    }
+    /* Only the last definition of each register leaves the block */
+    for (int j = 0; j < b->num_instrs; j++) {
+      IRReg r = b->instrs[j].dst;
+      if (r <= 0 || r >= nr || last[r] < 0)
+        continue;
+      cfg_bits_set(gen, last[r]);
+      last[r] = -1;
+    }
+  }
+  df_free(cursor, 2 * (size_t)nr * sizeof(int));
+
+  if (cfg_dataflow_solve(&rd->df) != 0) {
+    ir_reaching_defs_free(rd);
+    return -1;
+  }
+  return 0;
+}
+
+/* ============================================================================
+ * AVAILABLE EXPRESSIONS
+ * ============================================================================
+ */
+
+/* Operand r of an expression: a register, or (0, value) for a constant */
+static void expr_operand(const IRAvailExprs *ae, IRReg r, IRReg *reg,
+                         int64_t *k) {
+  if (ae->is_const[r]) {
+    *reg = 0;
+    *k = ae->const_value[r];
+  } else {
+    *reg = r;
+    *k = 0;
+  }
+}
+
+/* Key of the expression ins computes; 0 if it is not a pure one */
+static int expr_key(const IRAvailExprs *ae, IRFunction *f, const IRInstr *ins,
+                    IRExpr *key) {
+  if (ins->op < IR_ADD || ins->op > IR_NEG)
+    return 0;
+  int unary = ins->op == IR_NEG;
+  if (ins->num_args != (unary ? 1 : 2))
+    return 0;
+  const IRReg *a = f->arg_pool + ins->args;
+  for (int i = 0; i < ins->num_args; i++)
+    if (a[i] <= 0 || a[i] >= ae->num_regs)
+      return 0;
+  memset(key, 0, sizeof(*key));
+  key->op = ins->op;
+  expr_operand(ae, a[0], &key->a, &key->ka);
+  if (unary)
+    return 1;
+  expr_operand(ae, a[1], &key->b, &key->kb);
+
+  /* Commutative: registers ascending, constants last */
+  int commutative = ins->op == IR_ADD || ins->op == IR_MUL ||
+                    ins->op == IR_EQ || ins->op == IR_NE;
+  int swap = key->a == 0 ? (key->b != 0 || key->ka > key->kb)
+                         : (key->b != 0 && key->a > key->b);
+  if (commutative && swap) {
+    IRReg r = key->a;
+    int64_t k = key->ka;
+    key->a = key->b;
+    key->ka = key->kb;
+    key->b = r;
+    key->kb = k;
+  }
+  return 1;
+}
+
+/* Mix as symmap does (fmix64) */
+static uint32_t expr_hash(const IRExpr *e) {
+  uint64_t h = (uint64_t)e->op * 0x9e3779b97f4a7c15ull;
+  h ^= (uint64_t)(uint32_t)e->a << 32 | (uint32_t)e->b;
+  h = (h ^ (uint64_t)e->ka) * 0x9e3779b97f4a7c15ull;
+  h ^= (uint64_t)e->kb;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
+
+static int expr_equal(const IRExpr *x, const IRExpr *y) {
+  return x->op == y->op && x->a == y->a && x->b == y->b && x->ka == y->ka &&
+         x->kb == y->kb;
+}
+
+/* Slot holding key, or the empty slot where it would go */
+static uint32_t expr_slot(const IRAvailExprs *ae, const IRExpr *key) {
+  uint32_t mask = ae->slots_capacity - 1;
+  uint32_t j = expr_hash(key) & mask;
+  for (;; j = (j + 1) & mask) {
+    int e = ae->slots[j] - 1;
+    if (e < 0 || expr_equal(&ae->exprs[e], key))
+      return j;
+  }
+}
+
+int ir_available_exprs_find(const IRAvailExprs *ae, IRFunction *f,
+                            const IRInstr *ins) {
+  IRExpr key;
+  if (!ae || !f || !ins || ae->slots_capacity == 0 ||
+      !expr_key(ae, f, ins, &key))
+    return -1;
+  return ae->slots[expr_slot(ae, &key)] - 1;
+}
+
+void ir_available_exprs_free(IRAvailExprs *ae) {
+  if (!ae)
+    return;
+  cfg_dataflow_free(&ae->df);
+  df_free(ae->exprs, (size_t)ae->num_exprs * sizeof(IRExpr));
+  df_free(ae->slots, (size_t)ae->slots_capacity * sizeof(int));
+  df_free(ae->is_const, (size_t)ae->num_regs);
+  df_free(ae->const_value, (size_t)ae->num_regs * sizeof(int64_t));
+  memset(ae, 0, sizeof(*ae));
+}
+
+/* Number the distinct expressions of reachable blocks into ae->exprs and
+   keep those computed more than once; 0 on success */
+static int collect_exprs(IRAvailExprs *ae, IRFunction *f) {
+  CFGFunction *func = f->cfg;
+  int candidates = 0;
+  for (int k = 0; k < func->num_reachable; k++) {
+    const IRBlock *b = &f->blocks[func->rpo[k]];
+    for (int j = 0; j < b->num_instrs; j++)
+      candidates += b->instrs[j].op >= IR_ADD && b->instrs[j].op <= IR_NEG;
+  }
+  /* Candidates bound the table size, so it never grows */
+  uint32_t cap = 16;
+  while (cap < 2 * (uint32_t)candidates)
+    cap *= 2;
+  ae->slots = (int *)df_alloc((size_t)cap * sizeof(int));
+  if (!ae->slots)
+    return -1;
+  ae->slots_capacity = cap;
+  ae->exprs = (IRExpr *)df_alloc((size_t)candidates * sizeof(IRExpr));
+  if (ae->exprs)
+    ae->num_exprs = candidates; /* sizes exprs on free until shrunk below */
+  int *count = (int *)df_alloc((size_t)candidates * sizeof(int));
+  if (!ae->exprs || !count) {
+    df_free(count, (size_t)candidates * sizeof(int));
+    return -1;
+  }
+  memset(ae->slots, 0, (size_t)cap * sizeof(int));
+
+  int n = 0;
+  IRExpr key;
+  for (int k = 0; k < func->num_reachable; k++) {
+    const IRBlock *b = &f->blocks[func->rpo[k]];
+    for (int j = 0; j < b->num_instrs; j++) {
+      if (!expr_key(ae, f, &b->instrs[j], &key))
+        continue;
+      uint32_t s = expr_slot(ae, &key);
+      if (ae->slots[s] == 0) {
+        ae->exprs[n] = key;
+        count[n] = 0;
+        ae->slots[s] = ++n;
+      }
+      count[ae->slots[s] - 1]++;
+    }
+  }
+
+  /* Drop the single computations and rebuild the table */
+  int kept = 0;
+  for (int e = 0; e < n; e++)
+    if (count[e] > 1)
+      ae->exprs[kept++] = ae->exprs[e];
+  df_free(count, (size_t)candidates * sizeof(int));
+  memset(ae->slots, 0, (size_t)cap * sizeof(int));
+  for (int e = 0; e < kept; e++)
+    ae->slots[expr_slot(ae, &ae->exprs[e])] = e + 1;
+  if (kept < candidates) {
+    IRExpr *shrunk = (IRExpr *)realloc(
+        ae->exprs, (size_t)(kept ? kept : 1) * sizeof(IRExpr));
+    if (shrunk)
+      ae->exprs = shrunk;
+    size_t bytes = (size_t)kept * sizeof(IRExpr);
+    mem_note_resize(MEM_DATAFLOW, (size_t)candidates * sizeof(IRExpr),
+                    bytes ? bytes : 1);
+  }
+  ae->num_exprs = kept;
+  return 0;
+}
+
+int ir_available_exprs(IRFunction *f, IRAvailExprs *ae) {
+  if (!ae)
+    return -1;
+  memset(ae, 0, sizeof(*ae));
+  if (!f)
+    return -1;
+  CFGFunction *func = f->cfg;
+  int nr = f->num_regs;
+
+  ae->is_const = (unsigned char *)df_alloc((size_t)nr);
+  ae->const_value = (int64_t *)df_alloc((size_t)nr * sizeof(int64_t));
+  if (!ae->is_const || !ae->const_value) {
+    df_free(ae->is_const, (size_t)nr);
+    df_free(ae->const_value, (size_t)nr * sizeof(int64_t));
+    ae->is_const = NULL;
+    ae->const_value = NULL;
+    return -1;
+  }
+  ae->num_regs = nr;
+  memset(ae->is_const, 0, (size_t)nr);
+  for (int k = 0; k < func->num_reachable; k++) {
+    const IRBlock *b = &f->blocks[func->rpo[k]];
+    for (int j = 0; j < b->num_instrs; j++) {
+      const IRInstr *ins = &b->instrs[j];
+      if (ins->op == IR_CONST && ins->dst > 0 && ins->dst < nr) {
+        ae->is_const[ins->dst] = 1;
+        ae->const_value[ins->dst] = ins->imm;
+      }
+    }
+  }
+  if (collect_exprs(ae, f) != 0) {
+    ir_available_exprs_free(ae);
+    return -1;
+  }
+
+  /* Register -> expressions reading it: use[use_start[r] ..] */
+  int ne = ae->num_exprs;
+  int *use_start = (int *)df_alloc(((size_t)nr + 1) * sizeof(int));
+  int *use = (int *)df_alloc(2 * (size_t)ne * sizeof(int));
+  int *stamp = (int *)df_alloc((size_t)nr * sizeof(int));
+  if (!use_start || !use || !stamp ||
+      cfg_dataflow_init(&ae->df, func, CFG_DF_FORWARD, CFG_DF_INTERSECT, ne,
+                        0) != 0) {
+    df_free(use_start, ((size_t)nr + 1) * sizeof(int));
+    df_free(use, 2 * (size_t)ne * sizeof(int));
+    df_free(stamp, (size_t)nr * sizeof(int));
+    ir_available_exprs_free(ae);
+    return -1;
+  }
+  memset(use_start, 0, ((size_t)nr + 1) * sizeof(int));
+  for (int e = 0; e < ne; e++) {
+    const IRExpr *x = &ae->exprs[e];
+    if (x->a)
+      use_start[x->a + 1]++;
+    if (x->b && x->b != x->a)
+      use_start[x->b + 1]++;
+  }
+  for (int r = 0; r < nr; r++)
+    use_start[r + 1] += use_start[r];
+  /* stamp doubles as the fill cursor */
+  memcpy(stamp, use_start, (size_t)nr * sizeof(int));
+  for (int e = 0; e < ne; e++) {
+    const IRExpr *x = &ae->exprs[e];
+    if (x->a)
+      use[stamp[x->a]++] = e;
+    if (x->b && x->b != x->a)
+      use[stamp[x->b]++] = e;
+  }
+
+  /* Backwards through each block: stamp[r] == block once r is defined
+     later in it, which keeps an evaluation out of gen */
+  for (int r = 0; r < nr; r++)
+    stamp[r] = -1;
+  IRExpr key;
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    const IRBlock *b = &f->blocks[bi];
+    CFGBitWord *gen = cfg_dataflow_gen(&ae->df, bi);
+    CFGBitWord *kill = cfg_dataflow_kill(&ae->df, bi);
+    for (int j = b->num_instrs - 1; j >= 0; j--) {
+      const IRInstr *ins = &b->instrs[j];
+      IRReg d = ins->dst;
+      if (d > 0 && d < nr && stamp[d] != bi) {
+        stamp[d] = bi;
+        for (int u = use_start[d]; u < use_start[d + 1]; u++)
+          cfg_bits_set(kill, use[u]);
+      }
+      if (ne == 0 || !expr_key(ae, f, ins, &key))
+        continue;
+      int e = ae->slots[expr_slot(ae, &key)] - 1;
+      if (e >= 0 && (key.a == 0 || stamp[key.a] != bi) &&
+          (key.b == 0 || stamp[key.b] != bi))
+        cfg_bits_set(gen, e);
+    }
+  }
+  df_free(use_start, ((size_t)nr + 1) * sizeof(int));
+  df_free(use, 2 * (size_t)ne * sizeof(int));
+  df_free(stamp, (size_t)nr * sizeof(int));
+
+  if (cfg_dataflow_solve(&ae->df) != 0) {
+    ir_available_exprs_free(ae);
+    return -1;
+  }
+  return 0;
+}
+
+/* ============================================================================
+ * TEXT DUMP
+ * ============================================================================
+ */
+
+/* Before SSA registers 1 .. num_vars are the variables: print their names */
+static void print_analysis_reg(FILE *out, IRFunction *f, IRReg r) {
+  if (!f->is_ssa && r >= 1 && r <= f->num_vars)
+    fputs(f->var_names[r - 1], out);
+  else
+    fprintf(out, "%%%d", r);
+}
+
+static void print_live(FILE *out, IRFunction *f, const IRLiveness *live,
+                       const char *label, const CFGBitWord *s) {
+  fprintf(out, "  %s:", label);
+  for (int i = cfg_bits_next(s, live->df.words, 0); i >= 0;
+       i = cfg_bits_next(s, live->df.words, i + 1)) {
+    fputc(' ', out);
+    print_analysis_reg(out, f, live->reg_of_bit[i]);
+  }
+  fputc('\n', out);
+}
+
+static void print_expr_operand(FILE *out, IRFunction *f, IRReg r, int64_t k) {
+  if (r)
+    print_analysis_reg(out, f, r);
+  else
+    fprintf(out, "%lld", (long long)k);
+}
+
+void ir_analysis_print(FILE *out, IRFunction *f, IRLiveness *live,
+                       IRReachingDefs *rd, IRAvailExprs *ae) {
+  if (!out || !f)
+    return;
+  CFGFunction *func = f->cfg;
+  fprintf(out, "function %s {\n", func->name ? func->name : "?");
+  fprintf(out, "  ; %d blocks, solver visits:", func->num_reachable);
+  if (live)
+    fprintf(out, " liveness %d", live->df.visits);
+  if (rd)
+    fprintf(out, " reaching %d", rd->df.visits);
+  if (ae)
+    fprintf(out, " available %d", ae->df.visits);
+  fputc('\n', out);
+
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    fprintf(out, "b%d:\n", bi);
+    if (live) {
+      print_live(out, f, live, "live in", cfg_dataflow_in(&live->df, bi));
+      print_live(out, f, live, "live out", cfg_dataflow_out(&live->df, bi));
+    }
+    if (rd) {
+      const CFGBitWord *s = cfg_dataflow_in(&rd->df, bi);
+      fputs("  reaching:", out);
+      for (int d = cfg_bits_next(s, rd->df.words, 0); d >= 0;
+           d = cfg_bits_next(s, rd->df.words, d + 1)) {
+        fputc(' ', out);
+        print_analysis_reg(out, f, rd->defs[d].reg);
+        fprintf(out, "@b%d", rd->defs[d].block);
+      }
+      fputc('\n', out);
+    }
+    if (ae) {
+      const CFGBitWord *s = cfg_dataflow_in(&ae->df, bi);
+      const char *sep = " ";
+      fputs("  available:", out);
+      for (int e = cfg_bits_next(s, ae->df.words, 0); e >= 0;
+           e = cfg_bits_next(s, ae->df.words, e + 1)) {
+        const IRExpr *x = &ae->exprs[e];
+        fprintf(out, "%s%s ", sep, ir_opcode_name(x->op));
+        print_expr_operand(out, f, x->a, x->ka);
+        if (x->op != IR_NEG) {
+          fputc(' ', out);
+          print_expr_operand(out, f, x->b, x->kb);
+        }
+        sep = ", ";
+      }
+      fputc('\n', out);
+    }
+  }
+  fputs("}\n", out);
+}
+
+/* ============================================================================
+ * CROSS-CHECK - naive iterative solver
+ * ============================================================================
+ *
+ * Each analysis again with one byte per block and fact, iterated in RPO to
+ * the fixpoint by walking every instruction on every visit: no gen/kill
+ * summaries, no bitvectors, and liveness over all registers rather than
+ * just the global ones. Only the numbering of definitions and expressions
+ * is taken from the results being checked.
+ */
+
+#define DF_MISMATCH(...)                                                      \
+  do {                                                                        \
+    if (err && bad < 10) {                                                    \
+      fprintf(err, "%s: %s: ", name, what);                                   \
+      fprintf(err, __VA_ARGS__);                                              \
+      fputc('\n', err);                                                       \
+    }                                                                         \
+    bad++;                                                                    \
+  } while (0)
+
+/* 1 if a set has bits past nbits in its last word */
+static int stray_bits(const CFGBitWord *s, int words, int nbits) {
+  return nbits % CFG_BITS_PER_WORD && words > 0 &&
+         s[words - 1] >> (nbits % CFG_BITS_PER_WORD) != 0;
+}
+
+/* Adds the mismatches between a solver set and the naive bytes to bad */
+static int check_set(IRFunction *f, const char *what, int block,
+                     const char *side, const CFGBitWord *s, int words,
+                     const unsigned char *naive, int nbits, int bad,
+                     FILE *err) {
+  const char *name = f->cfg->name ? f->cfg->name : "?";
+  for (int i = 0; i < nbits; i++)
+    if (cfg_bits_test(s, i) != naive[i])
+      DF_MISMATCH("b%d %s: fact %d is %d, expected %d", block, side, i,
+                  cfg_bits_test(s, i), naive[i]);
+  if (stray_bits(s, words, nbits))
+    DF_MISMATCH("b%d %s: bits set past %d", block, side, nbits);
+  return bad;
+}
+
+static int check_liveness(IRFunction *f, const IRLiveness *live,
+                          unsigned char *in, unsigned char *out,
+                          unsigned char *t, FILE *err) {
+  CFGFunction *func = f->cfg;
+  const char *name = func->name ? func->name : "?";
+  const char *what = "liveness";
+  size_t nr = (size_t)f->num_regs;
+  memset(in, 0, (size_t)func->num_nodes * nr);
+  memset(out, 0, (size_t)func->num_nodes * nr);
+
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (int k = 0; k < func->num_reachable; k++) {
+      int bi = func->rpo[k];
+      const IRBlock *b = &f->blocks[bi];
+      int ns = cfg_function_get_num_succs(func, bi);
+      const int *succs = cfg_function_get_succs(func, bi);
+
+      /* out: live-in of the successors without their phi results, plus
+         the phi operands coming from this block */
+      memset(t, 0, nr);
+      for (int q = 0; q < ns; q++) {
+        int si = succs[q];
+        if (func->rpo_index[si] < 0)
+          continue;
+        const IRBlock *s = &f->blocks[si];
+        for (size_t r = 0; r < nr; r++)
+          t[r] |= in[(size_t)si * nr + r];
+        for (int j = 0; j < s->num_instrs; j++)
+          if (s->instrs[j].op == IR_PHI && s->instrs[j].dst > 0)
+            t[s->instrs[j].dst] = 0;
+      }
+      for (int q = 0; q < ns; q++) {
+        int si = succs[q];
+        if (func->rpo_index[si] < 0)
+          continue;
+        const IRBlock *s = &f->blocks[si];
+        int np = cfg_function_get_num_preds(func, si);
+        const int *preds = cfg_function_get_preds(func, si);
+        for (int j = 0; j < s->num_instrs; j++) {
+          const IRInstr *ins = &s->instrs[j];
+          if (ins->op != IR_PHI)
+            continue;
+          const IRReg *a = f->arg_pool + ins->args;
+          for (int i = 0; i < ins->num_args && i < np; i++)
+            if (preds[i] == bi && a[i] > 0 && a[i] < f->num_regs)
+              t[a[i]] = 1;
+        }
+      }
+      if (memcmp(t, out + (size_t)bi * nr, nr) != 0) {
+        memcpy(out + (size_t)bi * nr, t, nr);
+        changed = 1;
+      }
+
+      /* in: back through the block; phi results are defined on entry */
+      for (int j = b->num_instrs - 1; j >= 0; j--) {
+        const IRInstr *ins = &b->instrs[j];
+        const IRReg *a = f->arg_pool + ins->args;
+        if (ins->dst > 0 && ins->dst < f->num_regs)
+          t[ins->dst] = 0;
+        if (ins->op == IR_PHI)
+          continue;
+        for (int i = 0; i < ins->num_args; i++)
+          if (a[i] > 0 && a[i] < f->num_regs)
+            t[a[i]] = 1;
+      }
+      if (memcmp(t, in + (size_t)bi * nr, nr) != 0) {
+        memcpy(in + (size_t)bi * nr, t, nr);
+        changed = 1;
+      }
+    }
+  }
+
+  int bad = 0;
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    for (IRReg r = 1; r < f->num_regs; r++) {
+      if (ir_liveness_live_in(live, bi, r) != in[(size_t)bi * nr + r])
+        DF_MISMATCH("b%d live in: %%%d is %d, expected %d", bi, r,
+                    ir_liveness_live_in(live, bi, r), in[(size_t)bi * nr + r]);
+      if (ir_liveness_live_out(live, bi, r) != out[(size_t)bi * nr + r])
+        DF_MISMATCH("b%d live out: %%%d is %d, expected %d", bi, r,
+                    ir_liveness_live_out(live, bi, r),
+                    out[(size_t)bi * nr + r]);
+    }
+    if (stray_bits(cfg_dataflow_in(&live->df, bi), live->df.words,
+                   live->df.num_bits) ||
+        stray_bits(cfg_dataflow_out(&live->df, bi), live->df.words,
+                   live->df.num_bits))
+      DF_MISMATCH("b%d: bits set past %d", bi, live->df.num_bits);
+  }
+  return bad;
+}
+
+static int check_reaching_defs(IRFunction *f, const IRReachingDefs *rd,
+                               unsigned char *in, unsigned char *out,
+                               unsigned char *t, FILE *err) {
+  CFGFunction *func = f->cfg;
+  const char *name = func->name ? func->name : "?";
+  const char *what = "reaching definitions";
+  size_t nd = (size_t)rd->num_defs;
+  int entry = func->entry ? func->entry->index : -1;
+  int bad = 0;
+
+  /* Every definition of a tracked register is numbered exactly once */
+  int found = 0;
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    const IRBlock *b = &f->blocks[bi];
+    for (int j = 0; j < b->num_instrs; j++) {
+      IRReg r = b->instrs[j].dst;
+      if (r <= 0 || r >= rd->num_regs)
+        continue;
+      int n = 0;
+      for (int d = rd->reg_start[r]; d < rd->reg_start[r + 1]; d++)
+        n += rd->defs[d].block == bi && rd->defs[d].instr == j &&
+             rd->defs[d].reg == r;
+      if (n > 1 || (n == 0 && rd->reg_start[r] != rd->reg_start[r + 1]))
+        DF_MISMATCH("b%d: instruction %d numbered %d times", bi, j, n);
+      found += n;
+    }
+  }
+  if (found != rd->num_defs)
+    DF_MISMATCH("%d definitions numbered, %d found", rd->num_defs, found);
+
+  memset(in, 0, (size_t)func->num_nodes * nd);
+  memset(out, 0, (size_t)func->num_nodes * nd);
+
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (int k = 0; k < func->num_reachable; k++) {
+      int bi = func->rpo[k];
+      const IRBlock *b = &f->blocks[bi];
+      int np = cfg_function_get_num_preds(func, bi);
+      const int *preds = cfg_function_get_preds(func, bi);
+
+      memset(t, 0, nd);
+      for (int q = 0; q < np && bi != entry; q++)
+        if (func->rpo_index[preds[q]] >= 0)
+          for (size_t d = 0; d < nd; d++)
+            t[d] |= out[(size_t)preds[q] * nd + d];
+      if (memcmp(t, in + (size_t)bi * nd, nd) != 0) {
+        memcpy(in + (size_t)bi * nd, t, nd);
+        changed = 1;
+      }
+
+      /* A definition replaces every other one of its register */
+      for (int j = 0; j < b->num_instrs; j++) {
+        IRReg r = b->instrs[j].dst;
+        if (r <= 0 || r >= rd->num_regs ||
+            rd->reg_start[r] == rd->reg_start[r + 1])
+          continue;
+        int self = -1;
+        for (int d = rd->reg_start[r]; d < rd->reg_start[r + 1]; d++) {
+          t[d] = 0;
+          if (rd->defs[d].block == bi && rd->defs[d].instr == j)
+            self = d;
+        }
+        if (self >= 0)
+          t[self] = 1;
+      }
+      if (memcmp(t, out + (size_t)bi * nd, nd) != 0) {
+        memcpy(out + (size_t)bi * nd, t, nd);
+        changed = 1;
+      }
+    }
+  }
+
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    bad = check_set(f, what, bi, "in", cfg_dataflow_in(&rd->df, bi),
+                    rd->df.words, in + (size_t)bi * nd, rd->num_defs, bad,
+                    err);
+    bad = check_set(f, what, bi, "out", cfg_dataflow_out(&rd->df, bi),
+                    rd->df.words, out + (size_t)bi * nd, rd->num_defs, bad,
+                    err);
+  }
+  return bad;
+}
+
+static int check_available_exprs(IRFunction *f, const IRAvailExprs *ae,
+                                 unsigned char *in, unsigned char *out,
+                                 unsigned char *t, FILE *err) {
+  CFGFunction *func = f->cfg;
+  size_t ne = (size_t)ae->num_exprs;
+  int entry = func->entry ? func->entry->index : -1;
+  memset(in, 0, (size_t)func->num_nodes * ne);
+  memset(out, 1, (size_t)func->num_nodes * ne);
+
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (int k = 0; k < func->num_reachable; k++) {
+      int bi = func->rpo[k];
+      const IRBlock *b = &f->blocks[bi];
+      int np = cfg_function_get_num_preds(func, bi);
+      const int *preds = cfg_function_get_preds(func, bi);
+
+      memset(t, bi != entry, ne);
+      for (int q = 0; q < np && bi != entry; q++)
+        if (func->rpo_index[preds[q]] >= 0)
+          for (size_t e = 0; e < ne; e++)
+            t[e] &= out[(size_t)preds[q] * ne + e];
+      if (memcmp(t, in + (size_t)bi * ne, ne) != 0) {
+        memcpy(in + (size_t)bi * ne, t, ne);
+        changed = 1;
+      }
+
+      /* Evaluated, then killed if the result overwrites an operand */
+      for (int j = 0; j < b->num_instrs; j++) {
+        const IRInstr *ins = &b->instrs[j];
+        int e = ir_available_exprs_find(ae, f, ins);
+        if (e >= 0)
+          t[e] = 1;
+        if (ins->dst > 0)
+          for (size_t x = 0; x < ne; x++)
+            if (ae->exprs[x].a == ins->dst || ae->exprs[x].b == ins->dst)
+              t[x] = 0;
+      }
+      if (memcmp(t, out + (size_t)bi * ne, ne) != 0) {
+        memcpy(out + (size_t)bi * ne, t, ne);
+        changed = 1;
+      }
+    }
+  }
+
+  int bad = 0;
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    bad = check_set(f, "available expressions", bi, "in",
+                    cfg_dataflow_in(&ae->df, bi), ae->df.words,
+                    in + (size_t)bi * ne, ae->num_exprs, bad, err);
+    bad = check_set(f, "available expressions", bi, "out",
+                    cfg_dataflow_out(&ae->df, bi), ae->df.words,
+                    out + (size_t)bi * ne, ae->num_exprs, bad, err);
+  }
+  return bad;
+}
+#undef DF_MISMATCH
+
+int ir_analysis_check(IRFunction *f, FILE *err) {
+  if (!f)
+    return 0;
+  CFGFunction *func = f->cfg;
+  const char *name = func->name ? func->name : "?";
+  IRLiveness live;
+  IRReachingDefs rd;
+  IRAvailExprs ae;
+  int failed = ir_liveness(f, &live) != 0;
+  failed |= ir_reaching_defs(f, &rd) != 0;
+  failed |= ir_available_exprs(f, &ae) != 0;
+
+  /* One fact matrix per direction plus a block's worth of scratch, sized
+     for the widest of the three problems */
+  size_t width = (size_t)f->num_regs;
+  if (!failed && (size_t)rd.num_defs > width)
+    width = (size_t)rd.num_defs;
+  if (!failed && (size_t)ae.num_exprs > width)
+    width = (size_t)ae.num_exprs;
+  size_t cells = (size_t)func->num_nodes * width;
+  unsigned char *in = (unsigned char *)malloc(cells ? cells : 1);
+  unsigned char *out = (unsigned char *)malloc(cells ? cells : 1);
+  unsigned char *t = (unsigned char *)malloc(width ? width : 1);
+
+  int bad = 0;
+  if (failed || !in || !out || !t) {
+    if (err)
+      fprintf(err, "%s: dataflow check: %s\n", name,
+              failed ? "analysis failed" : "out of memory");
+    bad = 1;
+  } else {
+    bad += check_liveness(f, &live, in, out, t, err);
+    bad += check_reaching_defs(f, &rd, in, out, t, err);
+    bad += check_available_exprs(f, &ae, in, out, t, err);
+  }
+  free(in);
+  free(out);
+  free(t);
+  ir_liveness_free(&live);
+  ir_reaching_defs_free(&rd);
+  ir_available_exprs_free(&ae);
+  return bad;
+}
@@ -0,0 +1,123 @@
+#ifndef IR_ANALYSIS_H
+#define IR_ANALYSIS_H
+
+#include "ir.h"
+#include "../cfg/dataflow.h"
+
+/* Classic dataflow analyses over an IRFunction, solved with the bitvector
+   framework of dataflow.h. They work before SSA (ir_function_lower, where
+   a variable keeps one register across its definitions) and after it.
+   The IR must not change while a result is in use.
+
+   Most registers are temporaries used only in the block that defines
+   them. Liveness and reaching definitions track the others, the global
+   registers: those read in some block before (or without) a definition
+   there, and phi operands. Nothing else is ever live across a block
+   boundary, so the sets lose nothing and stay small. */
+
+/* ============================================================================
+ * LIVENESS - backward, union; bit i is global register reg_of_bit[i]
+ * ============================================================================ */
+
+/* in(b): registers live on entry to block b, out(b): on exit. A phi
+   operand is live out of the predecessor it comes from, not into the phi
+   block. */
+typedef struct {
+    CFGDataflow df;
+    IRReg *reg_of_bit;
+    int *bit_of_reg;            /* -1 for block-local registers */
+    int num_regs;
+} IRLiveness;
+
+/* 0 on success, -1 on failure */
+int ir_liveness(IRFunction *f, IRLiveness *live);
+void ir_liveness_free(IRLiveness *live);
+
+/* 1 if r is live on entry to / exit from block */
+int ir_liveness_live_in(const IRLiveness *live, int block, IRReg r);
+int ir_liveness_live_out(const IRLiveness *live, int block, IRReg r);
+
+/* ============================================================================
+ * REACHING DEFINITIONS - forward, union; bit d is definition d
+ * ============================================================================ */
+
+/* A definition is an instruction with a destination register; only those
+   of global registers are numbered */
+typedef struct {
+    int block;
+    int instr;                  /* index in block.instrs */
+    IRReg reg;
+} IRDefSite;
+
+/* Definitions are numbered by register, so those of register r are
+   reg_start[r] .. reg_start[r + 1] - 1 and a kill is a bit range */
+typedef struct {
+    CFGDataflow df;
+    IRDefSite *defs;
+    int num_defs;
+    int *reg_start;             /* num_regs + 1 entries */
+    int num_regs;
+} IRReachingDefs;
+
+int ir_reaching_defs(IRFunction *f, IRReachingDefs *rd);
+void ir_reaching_defs_free(IRReachingDefs *rd);
+
+/* ============================================================================
+ * AVAILABLE EXPRESSIONS - forward, intersection; bit e is expression e
+ * ============================================================================ */
+
+/* Expressions are the pure instructions (arithmetic, comparisons, neg)
+   keyed by opcode and operands. An operand defined by const is keyed by
+   its value, so each `i + 1` is the same expression; commutative operands
+   are ordered. Only expressions computed by more than one instruction are
+   tracked: a single computation has nothing to be redundant with.
+
+   Expression e is available at a point when every path from entry
+   computes it and redefines none of its operands afterwards. */
+typedef struct {
+    IROpcode op;
+    IRReg a;                    /* 0: the operand is the constant ka */
+    IRReg b;                    /* 0: the constant kb (or none, for neg) */
+    int64_t ka;
+    int64_t kb;
+} IRExpr;
+
+typedef struct {
+    CFGDataflow df;
+    IRExpr *exprs;
+    int num_exprs;
+    /* key -> index into exprs: open addressing, slot holds index + 1,
+       0 is empty, load <= 1/2 */
+    int *slots;
+    uint32_t slots_capacity;    /* power of two or 0 */
+    /* registers defined by const and their values, copied out of the IR
+       so keys are O(1) */
+    unsigned char *is_const;
+    int64_t *const_value;
+    int num_regs;
+} IRAvailExprs;
+
+int ir_available_exprs(IRFunction *f, IRAvailExprs *ae);
+void ir_available_exprs_free(IRAvailExprs *ae);
+
+/* Tracked expression computed by ins, -1 if none */
+int ir_available_exprs_find(const IRAvailExprs *ae, IRFunction *f,
+                            const IRInstr *ins);
+
+/* ============================================================================
+ * TEXT DUMP
+ * ============================================================================ */
+
+/* Per reachable block, for whichever results are non-NULL: live-in and
+   live-out, definitions reaching and expressions available on entry
+   ("live in: a i", "reaching: i@b2 i@b5", "available: sub i 1") */
+void ir_analysis_print(FILE *out, IRFunction *f, IRLiveness *live,
+                       IRReachingDefs *rd, IRAvailExprs *ae);
+
+/* Run the three analyses on f and compare every in and out set with a
+   naive per-instruction fixpoint. Quadratic memory, for tests (cfg
+   --check-dataflow). Prints up to ten mismatches per analysis to err (may
+   be NULL) and returns their number. */
+int ir_analysis_check(IRFunction *f, FILE *err);
+
+#endif /* IR_ANALYSIS_H */
@@ -0,0 +1,729 @@
+#include "ir.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "../ast/intern.h"
+#include "../ast/symmap.h"
+#include "../trace/memstat.h"
+
+/* ============================================================================
+ * STORAGE
+ * ============================================================================
+ */
+
+int ir_function_reserve_args(IRFunction *f, int n) {
+  if (n <= 0)
+    return f->num_args;
+  if (f->num_args + n > f->args_capacity) {
+    int newcap = f->args_capacity == 0 ? 64 : f->args_capacity * 2;
+    while (newcap < f->num_args + n)
+      newcap *= 2;
+    IRReg *na =
+        (IRReg *)realloc(f->arg_pool, (size_t)newcap * sizeof(IRReg));
+    if (!na)
+      return -1;
+    mem_note_resize(MEM_IR, (size_t)f->args_capacity * sizeof(IRReg),
+                    (size_t)newcap * sizeof(IRReg));
+    f->arg_pool = na;
+    f->args_capacity = newcap;
+  }
+  int at = f->num_args;
+  memset(f->arg_pool + at, 0, (size_t)n * sizeof(IRReg));
+  f->num_args += n;
+  return at;
+}
+
+int ir_block_reserve(IRBlock *b, int n) {
+  if (b->num_instrs + n <= b->instrs_capacity)
+    return 0;
+  int newcap = b->instrs_capacity == 0 ? 8 : b->instrs_capacity * 2;
+  while (newcap < b->num_instrs + n)
+    newcap *= 2;
+  IRInstr *ni = (IRInstr *)realloc(b->instrs, (size_t)newcap * sizeof(IRInstr));
+  if (!ni)
+    return -1;
+  mem_note_resize(MEM_IR, (size_t)b->instrs_capacity * sizeof(IRInstr),
+                  (size_t)newcap * sizeof(IRInstr));
+  b->instrs = ni;
+  b->instrs_capacity = newcap;
+  return 0;
+}
+
+/* Append an instruction with n operands copied from args (NULL: zeroes) */
+static IRInstr *ir_emit(IRFunction *f, IRBlock *b, IROpcode op, IRReg dst,
+                        const IRReg *args, int n) {
+  int at = ir_function_reserve_args(f, n);
+  if (at < 0 || ir_block_reserve(b, 1) != 0)
+    return NULL;
+  if (args)
+    memcpy(f->arg_pool + at, args, (size_t)n * sizeof(IRReg));
+  IRInstr *ins = &b->instrs[b->num_instrs++];
+  memset(ins, 0, sizeof(*ins));
+  ins->op = op;
+  ins->dst = dst;
+  ins->args = at;
+  ins->num_args = n;
+  return ins;
+}
+
+static int ir_add_var(IRFunction *f, const char *name) {
+  if (f->num_vars == f->vars_capacity) {
+    int newcap = f->vars_capacity == 0 ? 8 : f->vars_capacity * 2;
+    const char **nv =
+        (const char **)realloc(f->var_names, (size_t)newcap * sizeof(char *));
+    if (!nv)
+      return -1;
+    mem_note_resize(MEM_IR, (size_t)f->vars_capacity * sizeof(char *),
+                    (size_t)newcap * sizeof(char *));
+    f->var_names = nv;
+    f->vars_capacity = newcap;
+  }
+  f->var_names[f->num_vars] = name;
+  return f->num_vars++;
+}
+
+void ir_function_free(IRFunction *f) {
+  if (!f)
+    return;
+  if (f->blocks) {
+    for (int i = 0; i < f->num_blocks; i++) {
+      if (f->blocks[i].instrs) {
+        free(f->blocks[i].instrs);
+        mem_note_resize(MEM_IR, (size_t)f->blocks[i].instrs_capacity * sizeof(IRInstr), 0);
+      }
+    }
+    free(f->blocks);
+    mem_note_free(MEM_IR, (size_t)f->num_blocks * sizeof(IRBlock));
+  }
+  if (f->arg_pool) {
+    free(f->arg_pool);
+    mem_note_resize(MEM_IR, (size_t)f->args_capacity * sizeof(IRReg), 0);
+  }
+  if (f->var_names) {
+    free(f->var_names);
+    mem_note_resize(MEM_IR, (size_t)f->vars_capacity * sizeof(char *), 0);
+  }
+  free(f);
+  mem_note_free(MEM_IR, sizeof(IRFunction));
+}
+
+/* ============================================================================
+ * LOWERING - CFGOperation trees to three-address code
+ * ============================================================================
+ */
+
+/* Before SSA, variable v lives in register v + 1 */
+#define VAR_REG(v) ((v) + 1)
+
+/* Value in the vars map for names kept in memory (address taken) */
+#define VAR_IN_MEMORY (-2)
+
+typedef struct {
+  IRFunction *f;
+  IRBlock *cur;
+  SymMap vars;      /* name -> variable id, or VAR_IN_MEMORY */
+  int failed;
+} IRLower;
+
+static IRReg lower_expr(IRLower *L, CFGOperation *op);
+
+static IRReg new_reg(IRLower *L) { return L->f->num_regs++; }
+
+/* Emit op into the current block; dst is a fresh register unless void */
+static IRReg emit_value(IRLower *L, IROpcode op, const IRReg *args, int n,
+                        const char *sym, int64_t imm) {
+  IRReg dst = new_reg(L);
+  IRInstr *ins = ir_emit(L->f, L->cur, op, dst, args, n);
+  if (!ins) {
+    L->failed = 1;
+    return 0;
+  }
+  ins->sym = sym;
+  ins->imm = imm;
+  return dst;
+}
+
+static void emit_void(IRLower *L, IROpcode op, const IRReg *args, int n,
+                      const char *sym) {
+  IRInstr *ins = ir_emit(L->f, L->cur, op, 0, args, n);
+  if (!ins) {
+    L->failed = 1;
+    return;
+  }
+  ins->sym = sym;
+}
+
+static IRReg read_var(IRLower *L, const char *sym) {
+  int v = symmap_get(&L->vars, sym);
+  if (v >= 0)
+    return VAR_REG(v);
+  return emit_value(L, IR_LOAD_VAR, NULL, 0, sym, 0);
+}
+
+static void write_var(IRLower *L, const char *sym, IRReg value) {
+  int v = symmap_get(&L->vars, sym);
+  if (v >= 0) {
+    IRInstr *ins = ir_emit(L->f, L->cur, IR_COPY, VAR_REG(v), &value, 1);
+    if (!ins)
+      L->failed = 1;
+    return;
+  }
+  emit_void(L, IR_STORE_VAR, &value, 1, sym);
+}
+
+/* "+" -> IR_ADD, ...; only the first len bytes of name are compared */
+static IROpcode binop_opcode(const char *name, size_t len) {
+  static const struct {
+    const char *text;
+    IROpcode op;
+  } ops[] = {
+      {"+", IR_ADD}, {"-", IR_SUB}, {"*", IR_MUL}, {"/", IR_DIV},
+      {"%", IR_MOD}, {"<", IR_LT},  {">", IR_GT},  {"<=", IR_LE},
+      {">=", IR_GE}, {"==", IR_EQ}, {"!=", IR_NE},
+  };
+  if (!name)
+    return IR_NUM_OPCODES;
+  for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+    if (strlen(ops[i].text) == len && memcmp(ops[i].text, name, len) == 0)
+      return ops[i].op;
+  return IR_NUM_OPCODES;
+}
+
+static int64_t literal_value(const CFGOperation *op) {
+  const char *v = op->op_name;
+  ASTKind kind = op->ast_node ? op->ast_node->kind : AST_DEC;
+  if (!v)
+    return 0;
+  switch (kind) {
+  case AST_BITS: {
+    int64_t r = 0;
+    for (const char *p = v + 2; *p == '0' || *p == '1'; p++)
+      r = (r << 1) | (*p - '0');
+    return r;
+  }
+  case AST_BOOL:
+    return strcmp(v, "true") == 0;
+  case AST_CHAR: {
+    size_t len = strlen(v);
+    return len >= 3 && v[0] == '\'' ? (unsigned char)v[1] : 0;
+  }
+  default:
+    /* base 0 handles 123 and 0x... */
+    return (int64_t)strtoll(v, NULL, 0);
+  }
+}
+
+/* Lower operands first .. n - 1 of op into regs[] */
+static IRReg *lower_operands(IRLower *L, CFGOperation *op, int first,
+                             IRReg *small, int small_n, int *n) {
+  *n = op->num_operands > first ? op->num_operands - first : 0;
+  IRReg *regs = small;
+  if (*n > small_n) {
+    regs = (IRReg *)malloc((size_t)*n * sizeof(IRReg));
+    if (!regs) {
+      L->failed = 1;
+      *n = 0;
+      return small;
+    }
+  }
+  for (int i = 0; i < *n; i++)
+    regs[i] = lower_expr(L, op->operands[first + i]);
+  return regs;
+}
+
+static IRReg lower_call(IRLower *L, CFGOperation *op, IROpcode opc,
+                        int first) {
+  IRReg small[8];
+  int n;
+  IRReg *args = lower_operands(L, op, first, small, 8, &n);
+  IRReg r = emit_value(L, opc, args, n, intern_cstr(op->op_name), 0);
+  if (args != small)
+    free(args);
+  return r;
+}
+
+static CFGOperation *operand(CFGOperation *op, int i) {
+  return i < op->num_operands ? op->operands[i] : NULL;
+}
+
+/* Store value through an INDEX / FIELD_ACCESS lvalue whose address parts
+   are already in base (and index) */
+static void store_lvalue(IRLower *L, CFGOperation *target, IRReg base,
+                         IRReg index, IRReg value) {
+  if (target->kind == CFG_OP_INDEX) {
+    IRReg a[3] = {base, index, value};
+    emit_void(L, IR_STORE_INDEX, a, 3, NULL);
+  } else {
+    IRReg a[2] = {base, value};
+    emit_void(L, IR_STORE_FIELD, a, 2, intern_cstr(target->op_name));
+  }
+}
+
+/* target = value, target op= value, name[index] = value */
+static IRReg lower_assign(IRLower *L, CFGOperation *op) {
+  ASTNode *ast = op->ast_node;
+  ASTKind kind = ast ? ast->kind : AST_ASSIGN;
+  const char *name = intern_cstr(op->op_name);
+
+  IROpcode arith = IR_NUM_OPCODES;
+  if (kind == AST_COMPOUND_ASSIGN && ast->numChildren > 1) {
+    const char *text = ast_child(ast, 1)->lexeme;
+    if (text)
+      arith = binop_opcode(text, strlen(text) - 1); /* "+=" -> "+" */
+  }
+
+  if (kind == AST_ASSIGN_INDEX) {
+    IRReg base = read_var(L, name);
+    IRReg index = lower_expr(L, operand(op, 0));
+    IRReg value = lower_expr(L, operand(op, 1));
+    IRReg a[3] = {base, index, value};
+    emit_void(L, IR_STORE_INDEX, a, 3, NULL);
+    return value;
+  }
+
+  /* The target was an identifier: only the value is an operand */
+  if (op->num_operands == 1) {
+    IRReg value = lower_expr(L, operand(op, 0));
+    if (arith != IR_NUM_OPCODES) {
+      IRReg a[2] = {read_var(L, name), value};
+      value = emit_value(L, arith, a, 2, NULL, 0);
+    }
+    write_var(L, name, value);
+    return value;
+  }
+
+  CFGOperation *target = operand(op, 0);
+  if (!target ||
+      (target->kind != CFG_OP_INDEX && target->kind != CFG_OP_FIELD_ACCESS)) {
+    /* Not an lvalue the IR can store to: keep the side effects */
+    lower_expr(L, target);
+    return lower_expr(L, operand(op, 1));
+  }
+  IRReg base = lower_expr(L, operand(target, 0));
+  IRReg index = target->kind == CFG_OP_INDEX
+                    ? lower_expr(L, operand(target, 1))
+                    : 0;
+  IRReg value = lower_expr(L, operand(op, 1));
+  if (arith != IR_NUM_OPCODES) {
+    IRReg cur;
+    if (target->kind == CFG_OP_INDEX) {
+      IRReg a[2] = {base, index};
+      cur = emit_value(L, IR_LOAD_INDEX, a, 2, NULL, 0);
+    } else {
+      cur = emit_value(L, IR_LOAD_FIELD, &base, 1,
+                       intern_cstr(target->op_name), 0);
+    }
+    IRReg a[2] = {cur, value};
+    value = emit_value(L, arith, a, 2, NULL, 0);
+  }
+  store_lvalue(L, target, base, index, value);
+  return value;
+}
+
+static IRReg lower_expr(IRLower *L, CFGOperation *op) {
+  if (!op)
+    return 0;
+
+  switch (op->kind) {
+  case CFG_OP_LITERAL:
+    if (op->ast_node && op->ast_node->kind == AST_STRING)
+      return emit_value(L, IR_STR, NULL, 0, intern_cstr(op->op_name), 0);
+    return emit_value(L, IR_CONST, NULL, 0, NULL, literal_value(op));
+  case CFG_OP_VAR:
+    if (!op->op_name)
+      return 0;
+    if (op->op_name[0] == '&')
+      return emit_value(L, IR_ADDR, NULL, 0, intern_cstr(op->op_name + 1), 0);
+    /* Expressions the CFG has no operation for come out as VAR named
+       after their AST kind */
+    if (op->ast_node && op->ast_node->kind != AST_ID)
+      return 0;
+    return read_var(L, intern_cstr(op->op_name));
+  case CFG_OP_BINOP: {
+    IRReg a[2] = {lower_expr(L, operand(op, 0)), lower_expr(L, operand(op, 1))};
+    IROpcode opc =
+        binop_opcode(op->op_name, op->op_name ? strlen(op->op_name) : 0);
+    if (opc == IR_NUM_OPCODES)
+      return 0;
+    return emit_value(L, opc, a, 2, NULL, 0);
+  }
+  case CFG_OP_UNOP: {
+    IRReg a = lower_expr(L, operand(op, 0));
+    if (op->op_name && strcmp(op->op_name, "-") == 0)
+      return emit_value(L, IR_NEG, &a, 1, NULL, 0);
+    return a;
+  }
+  case CFG_OP_CALL:
+    /* operand 0 is the callee name */
+    return lower_call(L, op, IR_CALL, 1);
+  case CFG_OP_METHOD_CALL:
+    return lower_call(L, op, IR_CALL_METHOD, 0);
+  case CFG_OP_NEW:
+    return lower_call(L, op, IR_NEW, 0);
+  case CFG_OP_INDEX: {
+    IRReg a[2] = {lower_expr(L, operand(op, 0)), lower_expr(L, operand(op, 1))};
+    return emit_value(L, IR_LOAD_INDEX, a, 2, NULL, 0);
+  }
+  case CFG_OP_FIELD_ACCESS: {
+    IRReg a = lower_expr(L, operand(op, 0));
+    return emit_value(L, IR_LOAD_FIELD, &a, 1, intern_cstr(op->op_name), 0);
+  }
+  case CFG_OP_ASSIGN:
+    return lower_assign(L, op);
+  case CFG_OP_COND:
+    return lower_expr(L, operand(op, 0));
+  default:
+    return 0;
+  }
+}
+
+/* 1 if the declaration `op` (VARDECL of name) is T name[N] */
+static int decl_is_array(const CFGOperation *op, const char *name) {
+  ASTNode *decl = op->ast_node;
+  if (!decl || decl->kind != AST_VARDECL || decl->numChildren < 2)
+    return 0;
+  ASTNode *vars = ast_child(decl, 1);
+  if (vars->kind != AST_VARS)
+    return 0;
+  for (int i = 0; i + 1 < vars->numChildren; i += 2)
+    if (ast_child(vars, i)->lexeme == name)
+      return ast_child(vars, i + 1)->kind == AST_ARRAY;
+  return 0;
+}
+
+static void lower_statement(IRLower *L, CFGOperation *op) {
+  switch (op->kind) {
+  case CFG_OP_VARDECL: {
+    const char *name = intern_cstr(op->op_name);
+    if (decl_is_array(op, name)) {
+      IRReg size = lower_expr(L, operand(op, 0));
+      write_var(L, name, emit_value(L, IR_ARRAY, &size, 1, name, 0));
+    } else if (op->num_operands > 0) {
+      write_var(L, name, lower_expr(L, operand(op, 0)));
+    }
+    break;
+  }
+  case CFG_OP_RETURN: {
+    IRReg value = lower_expr(L, operand(op, 0));
+    if (op->num_operands > 0 && L->f->ret_var >= 0)
+      write_var(L, L->f->var_names[L->f->ret_var], value);
+    break;
+  }
+  case CFG_OP_BREAK:
+    break;
+  default:
+    lower_expr(L, op);
+    break;
+  }
+}
+
+/* Collect names that have their address taken (&x) */
+static void scan_address_taken(IRLower *L, CFGOperation *op) {
+  if (!op)
+    return;
+  if (op->kind == CFG_OP_VAR && op->op_name && op->op_name[0] == '&')
+    symmap_put(&L->vars, intern_cstr(op->op_name + 1), VAR_IN_MEMORY);
+  for (int i = 0; i < op->num_operands; i++)
+    scan_address_taken(L, op->operands[i]);
+}
+
+/* Variables: parameters, declared locals and the return value, unless
+   their address is taken */
+static int collect_vars(IRLower *L) {
+  IRFunction *f = L->f;
+  CFGFunction *func = f->cfg;
+  for (int i = 0; i < func->num_nodes; i++) {
+    CFGNode *node = func->all_nodes[i];
+    for (int j = 0; j < node->num_operations; j++)
+      scan_address_taken(L, node->operations[j]);
+  }
+
+  for (int i = 0; i < func->num_parameters; i++) {
+    const char *name = intern_cstr(func->parameters[i].name);
+    if (symmap_get(&L->vars, name) == -1 &&
+        symmap_put(&L->vars, name, ir_add_var(f, name)) != 0)
+      return -1;
+  }
+  for (int i = 0; i < func->num_nodes; i++) {
+    CFGNode *node = func->all_nodes[i];
+    for (int j = 0; j < node->num_operations; j++) {
+      CFGOperation *op = node->operations[j];
+      if (op->kind != CFG_OP_VARDECL || !op->op_name)
+        continue;
+      const char *name = intern_cstr(op->op_name);
+      if (symmap_get(&L->vars, name) == -1 &&
+          symmap_put(&L->vars, name, ir_add_var(f, name)) != 0)
+        return -1;
+    }
+  }
+
+  f->ret_var = -1;
+  if (func->return_type && strcmp(func->return_type, "void") != 0) {
+    /* "return" is a keyword, so it cannot clash with a local */
+    const char *name = intern_cstr("return");
+    f->ret_var = ir_add_var(f, name);
+    if (f->ret_var < 0 || symmap_put(&L->vars, name, f->ret_var) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+/* Lower the operations of one reachable node and its terminator */
+static void lower_block(IRLower *L, CFGNode *node) {
+  IRFunction *f = L->f;
+  CFGFunction *func = f->cfg;
+  IRBlock *b = &f->blocks[node->index];
+  L->cur = b;
+
+  if (node->is_entry) {
+    for (int i = 0; i < func->num_parameters; i++) {
+      IRReg p = emit_value(L, IR_PARAM, NULL, 0, NULL, i);
+      write_var(L, intern_cstr(func->parameters[i].name), p);
+    }
+  }
+
+  IRReg cond = 0;
+  for (int j = 0; j < node->num_operations; j++) {
+    CFGOperation *op = node->operations[j];
+    if (op->kind == CFG_OP_COND)
+      cond = lower_expr(L, op);
+    else
+      lower_statement(L, op);
+  }
+
+  int n = cfg_function_get_num_succs(func, node->index);
+  const int *succs = cfg_function_get_succs(func, node->index);
+  if (node->is_exit || n == 0) {
+    if (f->ret_var >= 0) {
+      IRReg r = read_var(L, f->var_names[f->ret_var]);
+      emit_void(L, IR_RET, &r, 1, NULL);
+    } else {
+      emit_void(L, IR_RET, NULL, 0, NULL);
+    }
+    return;
+  }
+  if (n == 2) {
+    /* Distinct successors are listed true edge first */
+    emit_void(L, IR_BR, &cond, 1, NULL);
+    b->succ[0] = succs[0];
+    b->succ[1] = succs[1];
+    b->num_succs = 2;
+    return;
+  }
+  emit_void(L, IR_JMP, NULL, 0, NULL);
+  b->succ[0] = succs[0];
+  b->num_succs = 1;
+}
+
+IRFunction *ir_function_lower(CFGFunction *func) {
+  if (!func || !func->graph_block)
+    return NULL;
+  IRFunction *f = (IRFunction *)calloc(1, sizeof(IRFunction));
+  if (!f)
+    return NULL;
+  mem_note_alloc(MEM_IR, sizeof(IRFunction));
+  f->cfg = func;
+  f->num_blocks = func->num_nodes;
+  f->blocks = (IRBlock *)calloc((size_t)f->num_blocks, sizeof(IRBlock));
+  if (!f->blocks) {
+    ir_function_free(f);
+    return NULL;
+  }
+  mem_note_alloc(MEM_IR, (size_t)f->num_blocks * sizeof(IRBlock));
+
+  IRLower L;
+  memset(&L, 0, sizeof(L));
+  L.f = f;
+  symmap_init(&L.vars, MEM_IR);
+  if (collect_vars(&L) != 0) {
+    symmap_free(&L.vars);
+    ir_function_free(f);
+    return NULL;
+  }
+  f->num_regs = VAR_REG(f->num_vars);
+
+  for (int i = 0; i < f->num_blocks; i++)
+    f->blocks[i].index = i;
+  /* Reverse postorder keeps register numbers roughly in program order */
+  for (int k = 0; k < func->num_reachable && !L.failed; k++) {
+    CFGNode *node = func->all_nodes[func->rpo[k]];
+    f->blocks[node->index].reachable = 1;
+    lower_block(&L, node);
+  }
+
+  symmap_free(&L.vars);
+  if (L.failed) {
+    ir_function_free(f);
+    return NULL;
+  }
+  return f;
+}
+
+IRFunction *ir_function_build(CFGFunction *func) {
+  IRFunction *f = ir_function_lower(func);
+  if (f && ir_function_to_ssa(f) != 0) {
+    ir_function_free(f);
+    return NULL;
+  }
+  return f;
+}
+
+/* ============================================================================
+ * TEXT DUMP
+ * ============================================================================
+ */
+
+static const char *const g_opcode_names[IR_NUM_OPCODES] = {
+    [IR_CONST] = "const",       [IR_STR] = "str",
+    [IR_PARAM] = "param",       [IR_COPY] = "copy",
+    [IR_ADD] = "add",           [IR_SUB] = "sub",
+    [IR_MUL] = "mul",           [IR_DIV] = "div",
+    [IR_MOD] = "mod",           [IR_LT] = "lt",
+    [IR_GT] = "gt",             [IR_LE] = "le",
+    [IR_GE] = "ge",             [IR_EQ] = "eq",
+    [IR_NE] = "ne",             [IR_NEG] = "neg",
+    [IR_ADDR] = "addr",         [IR_LOAD_VAR] = "load_var",
+    [IR_STORE_VAR] = "store_var", [IR_LOAD_INDEX] = "load_index",
+    [IR_STORE_INDEX] = "store_index", [IR_LOAD_FIELD] = "load_field",
+    [IR_STORE_FIELD] = "store_field", [IR_ARRAY] = "array",
+    [IR_CALL] = "call",         [IR_CALL_METHOD] = "call_method",
+    [IR_NEW] = "new",           [IR_PHI] = "phi",
+    [IR_JMP] = "jmp",           [IR_BR] = "br",
+    [IR_RET] = "ret",
+};
+
+const char *ir_opcode_name(IROpcode op) {
+  return op >= 0 && op < IR_NUM_OPCODES ? g_opcode_names[op] : "?";
+}
+
+static void print_reg(FILE *out, IRReg r) {
+  if (r)
+    fprintf(out, "%%%d", r);
+  else
+    fputs("undef", out);
+}
+
+static void print_instr(FILE *out, IRFunction *f, const IRInstr *ins) {
+  const IRReg *a = f->arg_pool + ins->args;
+  fputs("  ", out);
+  if (ins->dst) {
+    print_reg(out, ins->dst);
+    fputs(" = ", out);
+  }
+  fputs(ir_opcode_name(ins->op), out);
+
+  switch (ins->op) {
+  case IR_CONST:
+  case IR_PARAM:
+    fprintf(out, " %lld", (long long)ins->imm);
+    return;
+  case IR_STR:
+  case IR_ADDR:
+  case IR_LOAD_VAR:
+    fprintf(out, " %s", ins->sym ? ins->sym : "?");
+    return;
+  default:
+    break;
+  }
+
+  int first = 0;
+  if (ins->op == IR_STORE_VAR || ins->op == IR_ARRAY || ins->op == IR_CALL ||
+      ins->op == IR_NEW) {
+    fprintf(out, " %s", ins->sym ? ins->sym : "?");
+    first = 1;
+  }
+  if (ins->op == IR_LOAD_FIELD || ins->op == IR_STORE_FIELD ||
+      ins->op == IR_CALL_METHOD) {
+    fputc(' ', out);
+    print_reg(out, ins->num_args > 0 ? a[0] : 0);
+    fprintf(out, ".%s", ins->sym ? ins->sym : "?");
+    for (int i = 1; i < ins->num_args; i++) {
+      fputs(", ", out);
+      print_reg(out, a[i]);
+    }
+    return;
+  }
+  for (int i = 0; i < ins->num_args; i++) {
+    fputs(i == 0 && !first ? " " : ", ", out);
+    print_reg(out, a[i]);
+  }
+}
+
+void ir_function_print(FILE *out, IRFunction *f) {
+  if (!out || !f)
+    return;
+  CFGFunction *func = f->cfg;
+  fprintf(out, "function %s(", func->name ? func->name : "?");
+  for (int i = 0; i < func->num_parameters; i++)
+    fprintf(out, "%s%s", i ? ", " : "", func->parameters[i].name);
+  fprintf(out, ")%s {\n", f->is_ssa ? " ssa" : "");
+
+  for (int k = 0; k < func->num_reachable; k++) {
+    int bi = func->rpo[k];
+    IRBlock *b = &f->blocks[bi];
+    int np = cfg_function_get_num_preds(func, bi);
+    const int *preds = cfg_function_get_preds(func, bi);
+    fprintf(out, "b%d:", bi);
+    if (np > 0) {
+      fputs("  ; preds", out);
+      for (int i = 0; i < np; i++)
+        fprintf(out, " b%d", preds[i]);
+    }
+    fputc('\n', out);
+
+    for (int j = 0; j < b->num_instrs; j++) {
+      const IRInstr *ins = &b->instrs[j];
+      if (ins->op == IR_PHI) {
+        fputs("  ", out);
+        print_reg(out, ins->dst);
+        fputs(" = phi", out);
+        for (int i = 0; i < ins->num_args; i++) {
+          fputs(i ? ", [" : " [", out);
+          print_reg(out, f->arg_pool[ins->args + i]);
+          fprintf(out, ", b%d]", preds[i]);
+        }
+        if (ins->imm >= 0 && ins->imm < f->num_vars)
+          fprintf(out, "  ; %s", f->var_names[ins->imm]);
+      } else {
+        print_instr(out, f, ins);
+        if (ins->op == IR_JMP)
+          fprintf(out, " b%d", b->succ[0]);
+        else if (ins->op == IR_BR)
+          fprintf(out, ", b%d, b%d", b->succ[0], b->succ[1]);
+      }
+      fputc('\n', out);
+    }
+  }
+  fputs("}\n", out);
+}
+
+/* ============================================================================
+ * ACCESSORS
+ * ============================================================================
+ */
+
+int ir_function_get_num_blocks(IRFunction *f) { return f ? f->num_blocks : 0; }
+
+IRBlock *ir_function_get_block(IRFunction *f, int index) {
+  if (!f || index < 0 || index >= f->num_blocks)
+    return NULL;
+  return &f->blocks[index];
+}
+
+int ir_function_get_num_regs(IRFunction *f) { return f ? f->num_regs : 0; }
+
+int ir_block_get_num_instrs(IRBlock *b) { return b ? b->num_instrs : 0; }
+
+IRInstr *ir_block_get_instr(IRBlock *b, int index) {
+  if (!b || index < 0 || index >= b->num_instrs)
+    return NULL;
+  return &b->instrs[index];
+}
+
+int ir_block_get_num_phis(IRBlock *b) { return b ? b->num_phis : 0; }
+
+IRReg ir_instr_get_arg(IRFunction *f, const IRInstr *ins, int i) {
+  if (!f || !ins || i < 0 || i >= ins->num_args)
+    return 0;
+  return f->arg_pool[ins->args + i];
+}
@@ -0,0 +1,159 @@
+#ifndef IR_IR_H
+#define IR_IR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "../cfg/cfg.h"
+
+/* Forward declarations */
+typedef struct IRInstr IRInstr;
+typedef struct IRBlock IRBlock;
+typedef struct IRFunction IRFunction;
+
+/* Virtual register. 0 is "no value": an undefined variable, or an operand
+   the lowering could not express */
+typedef int IRReg;
+
+/* ============================================================================
+ * IR INSTRUCTION - three-address code over virtual registers
+ * ============================================================================ */
+
+/* Operands a, b, c below are args[0], args[1], args[2] */
+typedef enum {
+    IR_CONST,           /* dst = imm */
+    IR_STR,             /* dst = address of string literal sym */
+    IR_PARAM,           /* dst = parameter number imm */
+    IR_COPY,            /* dst = a */
+    IR_ADD,             /* dst = a + b */
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_MOD,
+    IR_LT,              /* dst = a < b ? 1 : 0 */
+    IR_GT,
+    IR_LE,
+    IR_GE,
+    IR_EQ,
+    IR_NE,
+    IR_NEG,             /* dst = -a */
+    IR_ADDR,            /* dst = &sym */
+    IR_LOAD_VAR,        /* dst = sym, a variable kept in memory */
+    IR_STORE_VAR,       /* sym = a */
+    IR_LOAD_INDEX,      /* dst = a[b] */
+    IR_STORE_INDEX,     /* a[b] = c */
+    IR_LOAD_FIELD,      /* dst = a.sym */
+    IR_STORE_FIELD,     /* a.sym = b */
+    IR_ARRAY,           /* dst = local array sym of a elements */
+    IR_CALL,            /* dst = sym(args...) */
+    IR_CALL_METHOD,     /* dst = a.sym(args[1] ...) */
+    IR_NEW,             /* dst = new sym(args...) */
+    IR_PHI,             /* dst = args[k] when entered from pred k */
+    IR_JMP,             /* goto succ[0] */
+    IR_BR,              /* if a goto succ[0] else succ[1] */
+    IR_RET,             /* return a; no operands for void */
+    IR_NUM_OPCODES
+} IROpcode;
+
+struct IRInstr {
+    IROpcode op;
+    IRReg dst;          /* defined register, 0 if none */
+    int args;           /* operands: arg_pool[args .. args + num_args) */
+    int num_args;
+    int64_t imm;        /* CONST value, PARAM number; PHI: variable id */
+    const char *sym;    /* callee, field, class, variable or string text
+                           (interned, see intern.h) */
+};
+
+/* ============================================================================
+ * IR BLOCK - one per CFG node, same dense index
+ * ============================================================================ */
+
+/* Predecessors are the CFG ones (cfg_function_get_preds); phi operand k
+   comes from predecessor k. */
+struct IRBlock {
+    int index;          /* = CFGNode.index */
+    int reachable;      /* 0: not reachable from entry, left empty */
+    IRInstr *instrs;    /* phis first, terminator last */
+    int num_instrs;
+    int instrs_capacity;
+    int num_phis;
+    int succ[2];        /* JMP: succ[0]; BR: true, false */
+    int num_succs;
+};
+
+/* ============================================================================
+ * IR FUNCTION
+ * ============================================================================ */
+
+/* Locals, parameters and the return value that never have their address
+   taken are variables: the lowering defines them through a fixed register
+   per variable, ir_function_to_ssa then renames every definition.
+   Other names (globals, &x) go through LOAD_VAR / STORE_VAR. */
+struct IRFunction {
+    CFGFunction *cfg;           /* source CFG (borrowed; must outlive this) */
+    IRBlock *blocks;            /* by CFG node index */
+    int num_blocks;
+
+    IRReg *arg_pool;            /* operands of all instructions */
+    int num_args;
+    int args_capacity;
+
+    int num_regs;               /* registers are 1 .. num_regs - 1 */
+
+    const char **var_names;     /* variable id -> name (interned) */
+    int num_vars;
+    int vars_capacity;
+    int ret_var;                /* variable holding the result, -1 if void */
+
+    int is_ssa;
+};
+
+/* ============================================================================
+ * IR API
+ * ============================================================================ */
+
+/* Lower a built CFG (cfg_prog_build) to three-address code, not yet SSA */
+IRFunction *ir_function_lower(CFGFunction *func);
+
+/* Place phis on iterated dominance frontiers (semi-pruned: only variables
+   live across blocks) and rename along the dominator tree (ssa.c).
+   0 on success, -1 on failure. */
+int ir_function_to_ssa(IRFunction *f);
+
+/* ir_function_lower + ir_function_to_ssa; NULL on failure */
+IRFunction *ir_function_build(CFGFunction *func);
+
+void ir_function_free(IRFunction *f);
+
+/* For passes that add code: n zeroed operand slots in arg_pool (returns
+   their offset, -1 on failure); room for n more instructions in b (0 on
+   success). Offsets stay valid, IRInstr pointers into b may move. */
+int ir_function_reserve_args(IRFunction *f, int n);
+int ir_block_reserve(IRBlock *b, int n);
+
+/* Check SSA form: one definition per register, definitions dominate uses,
+   phi arity matches the predecessors. Reports problems to err (may be
+   NULL); returns their number. */
+int ir_function_verify(IRFunction *f, FILE *err);
+
+/* Text dump: "b3:", "  %7 = add %5, %6", ... */
+void ir_function_print(FILE *out, IRFunction *f);
+
+/* ============================================================================
+ * ACCESSORS
+ * ============================================================================ */
+
+const char *ir_opcode_name(IROpcode op);
+
+int ir_function_get_num_blocks(IRFunction *f);
+IRBlock *ir_function_get_block(IRFunction *f, int index);
+int ir_function_get_num_regs(IRFunction *f);
+
+int ir_block_get_num_instrs(IRBlock *b);
+IRInstr *ir_block_get_instr(IRBlock *b, int index);
+int ir_block_get_num_phis(IRBlock *b);
+
+/* i-th operand of an instruction of f */
+IRReg ir_instr_get_arg(IRFunction *f, const IRInstr *ins, int i);
+
+#endif /* IR_IR_H */
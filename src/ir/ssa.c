@@ -0,0 +1,428 @@
+#include "ir.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "../trace/memstat.h"
+
+/* ============================================================================
+ * SSA CONSTRUCTION - Cytron et al. on the dominator tree from dom.c
+ * ============================================================================
+ *
+ * Before SSA, variable v is read and written through register v + 1
+ * (see ir.c). Phis go on the iterated dominance frontier of the blocks
+ * defining v, for variables read before being written in some block
+ * (semi-pruned form). Renaming walks the dominator tree with one current
+ * value per variable and an undo log; copies into variables are folded
+ * away on the fly, so `x = t` just makes t the current value of x.
+ */
+
+#define IS_VAR_REG(f, r) ((r) >= 1 && (r) <= (f)->num_vars)
+#define REG_VAR(r) ((r) - 1)
+
+typedef struct {
+  int block;
+  int var;
+} PhiSite;
+
+/* Scratch arrays over variables (V) and blocks (n) */
+typedef struct {
+  int *global;      /* V: read before written in some block */
+  int *stamp;       /* V: last block that wrote / counted the variable */
+  int *def_start;   /* V + 1: blocks defining v: defs[def_start[v] ..] */
+  int *defs;
+  int *has_phi;     /* n: last variable given a phi here */
+  int *on_work;     /* n: last variable that queued the block */
+  int *work;        /* n */
+  int *phi_start;   /* n + 1 */
+} SSAScratch;
+
+/* Blocks defining each variable (once per block), and global variables */
+static int find_defs(IRFunction *f, SSAScratch *s, int *num_var_defs) {
+  int V = f->num_vars;
+  memset(s->def_start, 0, ((size_t)V + 1) * sizeof(int));
+  for (int v = 0; v < V; v++)
+    s->stamp[v] = -1;
+  int total_defs = 0;
+  for (int b = 0; b < f->num_blocks; b++) {
+    IRBlock *blk = &f->blocks[b];
+    for (int i = 0; i < blk->num_instrs; i++) {
+      IRInstr *ins = &blk->instrs[i];
+      const IRReg *a = f->arg_pool + ins->args;
+      for (int k = 0; k < ins->num_args; k++)
+        if (IS_VAR_REG(f, a[k]) && s->stamp[REG_VAR(a[k])] != b)
+          s->global[REG_VAR(a[k])] = 1;
+      if (IS_VAR_REG(f, ins->dst)) {
+        int v = REG_VAR(ins->dst);
+        total_defs++;
+        if (s->stamp[v] != b) {
+          s->stamp[v] = b;
+          s->def_start[v + 1]++;
+        }
+      }
+    }
+  }
+  for (int v = 0; v < V; v++)
+    s->def_start[v + 1] += s->def_start[v];
+
+  s->defs = (int *)malloc(((size_t)s->def_start[V] + 1) * sizeof(int));
+  if (!s->defs)
+    return -1;
+  mem_note_alloc(MEM_IR, ((size_t)s->def_start[V] + 1) * sizeof(int));
+  int *cursor = (int *)malloc(((size_t)V + 1) * sizeof(int));
+  if (!cursor)
+    return -1;
+  memcpy(cursor, s->def_start, (size_t)V * sizeof(int));
+  for (int v = 0; v < V; v++)
+    s->stamp[v] = -1;
+  for (int b = 0; b < f->num_blocks; b++) {
+    IRBlock *blk = &f->blocks[b];
+    for (int i = 0; i < blk->num_instrs; i++) {
+      IRReg d = blk->instrs[i].dst;
+      if (IS_VAR_REG(f, d) && s->stamp[REG_VAR(d)] != b) {
+        s->stamp[REG_VAR(d)] = b;
+        s->defs[cursor[REG_VAR(d)]++] = b;
+      }
+    }
+  }
+  free(cursor);
+  *num_var_defs = total_defs;
+  return 0;
+}
+
+/* Iterated dominance frontier of each global variable's defining blocks */
+static PhiSite *place_phis(IRFunction *f, SSAScratch *s, int *num_sites) {
+  CFGFunction *func = f->cfg;
+  int n = f->num_blocks;
+  int cap = 16, count = 0;
+  PhiSite *sites = (PhiSite *)malloc((size_t)cap * sizeof(PhiSite));
+  if (!sites)
+    return NULL;
+  for (int b = 0; b < n; b++)
+    s->has_phi[b] = s->on_work[b] = -1;
+
+  for (int v = 0; v < f->num_vars; v++) {
+    if (!s->global[v])
+      continue;
+    int top = 0;
+    for (int d = s->def_start[v]; d < s->def_start[v + 1]; d++) {
+      s->work[top++] = s->defs[d];
+      s->on_work[s->defs[d]] = v;
+    }
+    while (top > 0) {
+      int x = s->work[--top];
+      int m = cfg_function_get_num_dom_frontier(func, x);
+      const int *df = cfg_function_get_dom_frontier(func, x);
+      for (int k = 0; k < m; k++) {
+        int y = df[k];
+        if (s->has_phi[y] == v)
+          continue;
+        s->has_phi[y] = v;
+        if (count == cap) {
+          cap *= 2;
+          PhiSite *ns = (PhiSite *)realloc(sites, (size_t)cap * sizeof(PhiSite));
+          if (!ns) {
+            free(sites);
+            return NULL;
+          }
+          sites = ns;
+        }
+        sites[count].block = y;
+        sites[count++].var = v;
+        if (s->on_work[y] != v) {
+          s->on_work[y] = v;
+          s->work[top++] = y;
+        }
+      }
+    }
+  }
+  *num_sites = count;
+  return sites;
+}
+
+/* Put the phis of each block in front of its instructions */
+static int insert_phis(IRFunction *f, SSAScratch *s, const PhiSite *sites,
+                       int num_sites) {
+  int n = f->num_blocks;
+  memset(s->phi_start, 0, ((size_t)n + 1) * sizeof(int));
+  for (int i = 0; i < num_sites; i++)
+    s->phi_start[sites[i].block + 1]++;
+  for (int b = 0; b < n; b++)
+    s->phi_start[b + 1] += s->phi_start[b];
+
+  /* Group sites by block (counting sort into the work array's cursor) */
+  int *order = (int *)malloc(((size_t)num_sites + 1) * sizeof(int));
+  if (!order)
+    return -1;
+  memcpy(s->work, s->phi_start, (size_t)n * sizeof(int));
+  for (int i = 0; i < num_sites; i++)
+    order[s->work[sites[i].block]++] = sites[i].var;
+
+  for (int b = 0; b < n; b++) {
+    int k = s->phi_start[b + 1] - s->phi_start[b];
+    if (k == 0)
+      continue;
+    IRBlock *blk = &f->blocks[b];
+    if (ir_block_reserve(blk, k) != 0) {
+      free(order);
+      return -1;
+    }
+    memmove(blk->instrs + k, blk->instrs,
+            (size_t)blk->num_instrs * sizeof(IRInstr));
+    blk->num_instrs += k;
+    blk->num_phis = k;
+    int npreds = cfg_function_get_num_preds(f->cfg, b);
+    for (int i = 0; i < k; i++) {
+      int v = order[s->phi_start[b] + i];
+      int at = ir_function_reserve_args(f, npreds);
+      if (at < 0) {
+        free(order);
+        return -1;
+      }
+      IRInstr *phi = &blk->instrs[i];
+      memset(phi, 0, sizeof(*phi));
+      phi->op = IR_PHI;
+      phi->dst = v + 1;
+      phi->args = at;
+      phi->num_args = npreds;
+      phi->imm = v;
+    }
+  }
+  free(order);
+  return 0;
+}
+
+/* Rename one block: uses get the current value, definitions a fresh
+   register (logged for undo), copies into variables disappear. Then fill
+   this block's operand in the phis of its successors. */
+static void rename_block(IRFunction *f, int b, IRReg *value, int *log_var,
+                         IRReg *log_prev, int *log_len) {
+  IRBlock *blk = &f->blocks[b];
+  int w = 0;
+  for (int i = 0; i < blk->num_instrs; i++) {
+    IRInstr ins = blk->instrs[i];
+    IRReg *a = f->arg_pool + ins.args;
+    if (ins.op != IR_PHI)
+      for (int k = 0; k < ins.num_args; k++)
+        if (IS_VAR_REG(f, a[k]))
+          a[k] = value[REG_VAR(a[k])];
+    if (IS_VAR_REG(f, ins.dst)) {
+      int v = REG_VAR(ins.dst);
+      log_var[*log_len] = v;
+      log_prev[(*log_len)++] = value[v];
+      if (ins.op == IR_COPY) {
+        value[v] = a[0];
+        continue;
+      }
+      ins.dst = f->num_regs++;
+      value[v] = ins.dst;
+    }
+    blk->instrs[w++] = ins;
+  }
+  blk->num_instrs = w;
+
+  CFGFunction *func = f->cfg;
+  int ns = cfg_function_get_num_succs(func, b);
+  const int *succs = cfg_function_get_succs(func, b);
+  for (int k = 0; k < ns; k++) {
+    IRBlock *sb = &f->blocks[succs[k]];
+    if (sb->num_phis == 0)
+      continue;
+    int np = cfg_function_get_num_preds(func, succs[k]);
+    const int *preds = cfg_function_get_preds(func, succs[k]);
+    int j = 0;
+    while (j < np && preds[j] != b)
+      j++;
+    for (int p = 0; p < sb->num_phis; p++)
+      f->arg_pool[sb->instrs[p].args + j] = value[sb->instrs[p].imm];
+  }
+}
+
+static int rename_vars(IRFunction *f, int log_cap) {
+  CFGFunction *func = f->cfg;
+  int n = f->num_blocks;
+  size_t ints = (size_t)f->num_vars + 2 * (size_t)log_cap + 3 * (size_t)n;
+  int *scratch = (int *)calloc(ints + 1, sizeof(int));
+  if (!scratch)
+    return -1;
+  mem_note_alloc(MEM_IR, (ints + 1) * sizeof(int));
+  IRReg *value = scratch;               /* variable -> current register */
+  int *log_var = value + f->num_vars;
+  IRReg *log_prev = log_var + log_cap;
+  int *stack = log_prev + log_cap;
+  int *cursor = stack + n;
+  int *mark = cursor + n;
+  int log_len = 0, sp = 0;
+
+  /* Iterative preorder walk of the dominator tree */
+  int root = func->entry->index;
+  rename_block(f, root, value, log_var, log_prev, &log_len);
+  stack[sp] = root;
+  cursor[sp] = 0;
+  mark[sp++] = 0;
+  while (sp > 0) {
+    int b = stack[sp - 1];
+    int nc = cfg_function_get_num_dom_children(func, b);
+    if (cursor[sp - 1] < nc) {
+      int c = cfg_function_get_dom_children(func, b)[cursor[sp - 1]++];
+      stack[sp] = c;
+      cursor[sp] = 0;
+      mark[sp++] = log_len;
+      rename_block(f, c, value, log_var, log_prev, &log_len);
+    } else {
+      sp--;
+      while (log_len > mark[sp]) {
+        log_len--;
+        value[log_var[log_len]] = log_prev[log_len];
+      }
+    }
+  }
+
+  free(scratch);
+  mem_note_free(MEM_IR, (ints + 1) * sizeof(int));
+  return 0;
+}
+
+int ir_function_to_ssa(IRFunction *f) {
+  if (!f || !f->cfg || !f->cfg->dom.block || !f->cfg->entry)
+    return -1;
+  if (f->is_ssa)
+    return 0;
+
+  int V = f->num_vars, n = f->num_blocks;
+  size_t ints = 3 * (size_t)V + 1 + 4 * (size_t)n + 1;
+  int *scratch = (int *)calloc(ints, sizeof(int));
+  if (!scratch)
+    return -1;
+  mem_note_alloc(MEM_IR, ints * sizeof(int));
+  SSAScratch s;
+  memset(&s, 0, sizeof(s));
+  s.global = scratch;
+  s.stamp = s.global + V;
+  s.def_start = s.stamp + V;
+  s.has_phi = s.def_start + V + 1;
+  s.on_work = s.has_phi + n;
+  s.work = s.on_work + n;
+  s.phi_start = s.work + n;
+
+  int rc = -1, num_sites = 0, num_var_defs = 0;
+  PhiSite *sites = NULL;
+  if (find_defs(f, &s, &num_var_defs) == 0 &&
+      (sites = place_phis(f, &s, &num_sites)) != NULL &&
+      insert_phis(f, &s, sites, num_sites) == 0 &&
+      rename_vars(f, num_var_defs + num_sites) == 0) {
+    f->is_ssa = 1;
+    rc = 0;
+  }
+
+  free(sites);
+  if (s.defs) {
+    free(s.defs);
+    mem_note_free(MEM_IR, ((size_t)s.def_start[V] + 1) * sizeof(int));
+  }
+  free(scratch);
+  mem_note_free(MEM_IR, ints * sizeof(int));
+  return rc;
+}
+
+/* ============================================================================
+ * VERIFIER
+ * ============================================================================
+ */
+
+static int is_terminator(IROpcode op) {
+  return op == IR_JMP || op == IR_BR || op == IR_RET;
+}
+
+int ir_function_verify(IRFunction *f, FILE *err) {
+  if (!f)
+    return 0;
+  const char *fname = f->cfg && f->cfg->name ? f->cfg->name : "?";
+  if (!f->is_ssa) {
+    if (err)
+      fprintf(err, "ir %s: not in SSA form\n", fname);
+    return 1;
+  }
+  CFGFunction *func = f->cfg;
+  int *def_block = (int *)malloc(2 * (size_t)f->num_regs * sizeof(int));
+  if (!def_block)
+    return 1;
+  int *def_pos = def_block + f->num_regs;
+  for (int r = 0; r < f->num_regs; r++)
+    def_block[r] = -1;
+
+  int problems = 0;
+#define IR_PROBLEM(...)                                                      \
+  do {                                                                       \
+    problems++;                                                              \
+    if (err) {                                                               \
+      fprintf(err, "ir %s: ", fname);                                        \
+      fprintf(err, __VA_ARGS__);                                             \
+      fputc('\n', err);                                                      \
+    }                                                                        \
+  } while (0)
+
+  for (int b = 0; b < f->num_blocks; b++) {
+    IRBlock *blk = &f->blocks[b];
+    if (!blk->reachable)
+      continue;
+    if (blk->num_instrs == 0 || !is_terminator(blk->instrs[blk->num_instrs - 1].op))
+      IR_PROBLEM("b%d does not end in a terminator", b);
+    for (int i = 0; i < blk->num_instrs; i++) {
+      IRInstr *ins = &blk->instrs[i];
+      if ((ins->op == IR_PHI) != (i < blk->num_phis))
+        IR_PROBLEM("b%d: phi out of place at %d", b, i);
+      if (i + 1 < blk->num_instrs && is_terminator(ins->op))
+        IR_PROBLEM("b%d: terminator in the middle", b);
+      if (!ins->dst)
+        continue;
+      if (ins->dst < 0 || ins->dst >= f->num_regs) {
+        IR_PROBLEM("b%d: bad register %%%d", b, ins->dst);
+      } else if (def_block[ins->dst] >= 0) {
+        IR_PROBLEM("%%%d defined twice (b%d, b%d)", ins->dst,
+                   def_block[ins->dst], b);
+      } else {
+        def_block[ins->dst] = b;
+        def_pos[ins->dst] = i;
+      }
+    }
+  }
+
+  for (int b = 0; b < f->num_blocks; b++) {
+    IRBlock *blk = &f->blocks[b];
+    if (!blk->reachable)
+      continue;
+    int np = cfg_function_get_num_preds(func, b);
+    const int *preds = cfg_function_get_preds(func, b);
+    for (int i = 0; i < blk->num_instrs; i++) {
+      IRInstr *ins = &blk->instrs[i];
+      const IRReg *a = f->arg_pool + ins->args;
+      if (ins->op == IR_PHI && ins->num_args != np)
+        IR_PROBLEM("b%d: phi %%%d has %d operands for %d preds", b, ins->dst,
+                   ins->num_args, np);
+      for (int k = 0; k < ins->num_args; k++) {
+        IRReg r = a[k];
+        if (!r)
+          continue;
+        if (r < 0 || r >= f->num_regs || def_block[r] < 0) {
+          IR_PROBLEM("b%d: use of undefined %%%d", b, r);
+          continue;
+        }
+        int db = def_block[r];
+        int ok;
+        if (ins->op == IR_PHI)
+          ok = k >= np || !f->blocks[preds[k]].reachable ||
+               cfg_function_dominates(func, db, preds[k]);
+        else if (db == b)
+          ok = def_pos[r] < i;
+        else
+          ok = cfg_function_dominates(func, db, b);
+        if (!ok)
+          IR_PROBLEM("b%d: %%%d does not dominate its use", b, r);
+      }
+    }
+  }
+#undef IR_PROBLEM
+
+  free(def_block);
+  return problems;
+}
@@ -0,0 +1,458 @@
+#include "lexer.h"
+#include "../ast/ast.h"
+#include "../ast/intern.h"
+#include "parser.tab.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ширина SIMD: AVX2 (32 байта) при -mavx2, иначе SSE2 (16 байт),
+   на прочих архитектурах — только скалярный код */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LEX_SIMD 1
+typedef __m256i lvec;
+#define LV_W 32
+#define LV_FULL 0xFFFFFFFFu
+#define lv_load(p) _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define lv_set1(c) _mm256_set1_epi8((char)(c))
+#define lv_eq(a, b) _mm256_cmpeq_epi8((a), (b))
+#define lv_gt(a, b) _mm256_cmpgt_epi8((a), (b))
+#define lv_or(a, b) _mm256_or_si256((a), (b))
+#define lv_and(a, b) _mm256_and_si256((a), (b))
+#define lv_mask(v) ((uint32_t)_mm256_movemask_epi8(v))
+#elif defined(__SSE2__) || defined(_M_X64) ||                                \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LEX_SIMD 1
+typedef __m128i lvec;
+#define LV_W 16
+#define LV_FULL 0xFFFFu
+#define lv_load(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define lv_set1(c) _mm_set1_epi8((char)(c))
+#define lv_eq(a, b) _mm_cmpeq_epi8((a), (b))
+#define lv_gt(a, b) _mm_cmpgt_epi8((a), (b))
+#define lv_or(a, b) _mm_or_si128((a), (b))
+#define lv_and(a, b) _mm_and_si128((a), (b))
+#define lv_mask(v) ((uint32_t)_mm_movemask_epi8(v))
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static int lex_ctz(uint32_t x) {
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return (int)i;
+}
+#define lex_popcount(x) ((int)__popcnt(x))
+#else
+#define lex_ctz(x) __builtin_ctz(x)
+#define lex_popcount(x) __builtin_popcount(x)
+#endif
+
+struct Lexer {
+  const char *buf; /* входной буфер (не обязательно 0-terminated) */
+  size_t len;
+  size_t pos;
+  char *owned;     /* буфер, прочитанный из потока (иначе NULL) */
+  FILE *in;        /* поток, ещё не прочитанный */
+  int lineno;
+  size_t tok_off;  /* последняя лексема — срез buf */
+  size_t tok_len;
+  char *text;      /* 0-terminated копия лексемы для lexer_text */
+  size_t text_cap;
+};
+
+Lexer *lexer_create(void) {
+  Lexer *lx = (Lexer *)calloc(1, sizeof(Lexer));
+  if (lx)
+    lx->lineno = 1;
+  return lx;
+}
+
+void lexer_destroy(Lexer *lx) {
+  if (!lx)
+    return;
+  free(lx->owned);
+  free(lx->text);
+  free(lx);
+}
+
+void lexer_set_input(Lexer *lx, FILE *in) {
+  free(lx->owned);
+  lx->owned = NULL;
+  lx->buf = NULL;
+  lx->len = lx->pos = 0;
+  lx->tok_off = lx->tok_len = 0;
+  lx->lineno = 1;
+  lx->in = in;
+}
+
+void lexer_set_buffer(Lexer *lx, const char *buf, size_t len) {
+  lexer_set_input(lx, NULL);
+  lx->buf = buf ? buf : "";
+  lx->len = buf ? len : 0;
+}
+
+int lexer_lineno(const Lexer *lx) { return lx->lineno; }
+
+const char *lexer_text(Lexer *lx) {
+  size_t n = lx->tok_len;
+  if (n + 1 > lx->text_cap) {
+    char *t = (char *)realloc(lx->text, n + 1);
+    if (!t)
+      return "";
+    lx->text = t;
+    lx->text_cap = n + 1;
+  }
+  if (n)
+    memcpy(lx->text, lx->buf + lx->tok_off, n);
+  lx->text[n] = '\0';
+  return lx->text;
+}
+
+/* прочитать поток целиком */
+static int load_stream(Lexer *lx) {
+  size_t cap = 1 << 16, len = 0, n;
+  char *b = (char *)malloc(cap);
+  if (!b)
+    return -1;
+  while ((n = fread(b + len, 1, cap - len, lx->in)) > 0) {
+    len += n;
+    if (len == cap) {
+      char *nb = (char *)realloc(b, cap * 2);
+      if (!nb) {
+        free(b);
+        return -1;
+      }
+      b = nb;
+      cap *= 2;
+    }
+  }
+  lx->owned = b;
+  lx->buf = b;
+  lx->len = len;
+  lx->pos = 0;
+  lx->in = NULL;
+  return 0;
+}
+
+static void print_escaped(const char *s, size_t n) {
+  fputs("Unknown symbol: '", stderr);
+  for (size_t i = 0; i < n; ++i) {
+    unsigned char c = (unsigned char)s[i];
+    switch (c) {
+      case '\\': fputs("\\\\", stderr); break;
+      case '\n': fputs("\\n", stderr); break;
+      case '\r': fputs("\\r", stderr); break;
+      case '\t': fputs("\\t", stderr); break;
+      default:
+        if (c >= 32 && c < 127) fputc(c, stderr);
+        else fprintf(stderr, "\\x%02x", c);
+    }
+  }
+  fputs("'\n", stderr);
+}
+
+/* ---- классы символов ---- */
+
+static int is_ws(unsigned char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+static int is_ident_start(unsigned char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+static int is_ident_char(unsigned char c) {
+  return is_ident_start(c) || (c >= '0' && c <= '9');
+}
+static int is_digit(unsigned char c) { return c >= '0' && c <= '9'; }
+static int is_hex(unsigned char c) {
+  return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+#ifdef LEX_SIMD
+/* lo <= c <= hi для ASCII-границ; байты >= 0x80 отрицательны и не проходят */
+static lvec lv_range(lvec v, char lo, char hi) {
+  return lv_and(lv_gt(v, lv_set1(lo - 1)), lv_gt(lv_set1(hi + 1), v));
+}
+#endif
+
+/* пропустить [ \t\r\n]*, считая переводы строк */
+static size_t skip_ws(const char *s, size_t pos, size_t len, int *lines) {
+#ifdef LEX_SIMD
+  const lvec sp = lv_set1(' '), tab = lv_set1('\t');
+  const lvec cr = lv_set1('\r'), nl = lv_set1('\n');
+  while (pos + LV_W <= len) {
+    lvec v = lv_load(s + pos);
+    lvec eqnl = lv_eq(v, nl);
+    uint32_t ws = lv_mask(lv_or(lv_or(lv_eq(v, sp), lv_eq(v, tab)),
+                                lv_or(lv_eq(v, cr), eqnl)));
+    uint32_t nls = lv_mask(eqnl);
+    if (ws != LV_FULL) {
+      int k = lex_ctz(~ws & LV_FULL);
+      *lines += lex_popcount(nls & ((1u << k) - 1u));
+      return pos + (size_t)k;
+    }
+    *lines += lex_popcount(nls);
+    pos += LV_W;
+  }
+#endif
+  while (pos < len && is_ws((unsigned char)s[pos])) {
+    if (s[pos] == '\n')
+      (*lines)++;
+    pos++;
+  }
+  return pos;
+}
+
+/* до '\n' (не включая) или конца буфера */
+static size_t scan_to_eol(const char *s, size_t pos, size_t len) {
+#ifdef LEX_SIMD
+  const lvec nl = lv_set1('\n');
+  while (pos + LV_W <= len) {
+    uint32_t m = lv_mask(lv_eq(lv_load(s + pos), nl));
+    if (m)
+      return pos + (size_t)lex_ctz(m);
+    pos += LV_W;
+  }
+#endif
+  while (pos < len && s[pos] != '\n')
+    pos++;
+  return pos;
+}
+
+/* [A-Za-z0-9_]* */
+static size_t scan_ident(const char *s, size_t pos, size_t len) {
+#ifdef LEX_SIMD
+  const lvec fold = lv_set1(0x20), us = lv_set1('_');
+  while (pos + LV_W <= len) {
+    lvec v = lv_load(s + pos);
+    /* c | 0x20 попадает в a..z только для букв */
+    lvec ok = lv_or(lv_range(lv_or(v, fold), 'a', 'z'),
+                    lv_or(lv_range(v, '0', '9'), lv_eq(v, us)));
+    uint32_t m = lv_mask(ok);
+    if (m != LV_FULL)
+      return pos + (size_t)lex_ctz(~m & LV_FULL);
+    pos += LV_W;
+  }
+#endif
+  while (pos < len && is_ident_char((unsigned char)s[pos]))
+    pos++;
+  return pos;
+}
+
+/* [0-9]* */
+static size_t scan_digits(const char *s, size_t pos, size_t len) {
+#ifdef LEX_SIMD
+  while (pos + LV_W <= len) {
+    uint32_t m = lv_mask(lv_range(lv_load(s + pos), '0', '9'));
+    if (m != LV_FULL)
+      return pos + (size_t)lex_ctz(~m & LV_FULL);
+    pos += LV_W;
+  }
+#endif
+  while (pos < len && is_digit((unsigned char)s[pos]))
+    pos++;
+  return pos;
+}
+
+/* ---- ключевые слова: совершенный хеш ----
+   h = (s[0]*5 + s[n-1]*33 + n) & 63 без коллизий на этом наборе;
+   при изменении набора константы нужно подобрать заново. */
+
+typedef struct {
+  const char *word;
+  unsigned char len;
+  int token;
+  int has_value; /* передавать ли текст в yylval (BUILTIN_TYPE, BOOL_LITERAL) */
+} Keyword;
+
+static const Keyword g_keywords[64] = {
+    [0] = {"new", 3, NEW, 0},
+    [1] = {"uint", 4, BUILTIN_TYPE, 1},
+    [2] = {"else", 4, ELSE, 0},
+    [4] = {"int", 3, BUILTIN_TYPE, 1},
+    [5] = {"do", 2, DO, 0},
+    [7] = {"class", 5, CLASS, 0},
+    [8] = {"false", 5, BOOL_LITERAL, 1},
+    [12] = {"string", 6, BUILTIN_TYPE, 1},
+    [13] = {"true", 4, BOOL_LITERAL, 1},
+    [17] = {"template", 8, TEMPLATE, 0},
+    [21] = {"ulong", 5, BUILTIN_TYPE, 1},
+    [26] = {"bool", 4, BUILTIN_TYPE, 1},
+    [29] = {"while", 5, WHILE, 0},
+    [37] = {"char", 4, BUILTIN_TYPE, 1},
+    [39] = {"long", 4, BUILTIN_TYPE, 1},
+    [45] = {"extern", 6, EXTERN, 0},
+    [46] = {"return", 6, RETURN, 0},
+    [51] = {"byte", 4, BUILTIN_TYPE, 1},
+    [53] = {"if", 2, IF, 0},
+    [54] = {"void", 4, BUILTIN_TYPE, 1},
+    [57] = {"public", 6, PUBLIC, 0},
+    [58] = {"break", 5, BREAK, 0},
+    [60] = {"private", 7, PRIVATE, 0},
+};
+
+static const Keyword *keyword_lookup(const char *s, size_t n) {
+  if (n < 2 || n > 8)
+    return NULL;
+  unsigned h = ((unsigned char)s[0] * 5u + (unsigned char)s[n - 1] * 33u +
+                (unsigned)n) & 63u;
+  const Keyword *kw = &g_keywords[h];
+  if (kw->len == n && memcmp(kw->word, s, n) == 0)
+    return kw;
+  return NULL;
+}
+
+/* ---- операторы и разделители ---- */
+
+typedef struct {
+  int token;
+  int has_value;
+} Punct;
+
+/* односимвольные; token == 0 — символ не является оператором */
+static const Punct g_punct1[128] = {
+    ['<'] = {LT, 1},        ['>'] = {GT, 1},        ['+'] = {PLUS, 1},
+    ['-'] = {MINUS, 1},     ['*'] = {STAR, 1},      ['/'] = {SLASH, 1},
+    ['%'] = {PERCENT, 1},   ['='] = {ASSIGN, 0},    ['&'] = {AMPERSAND, 0},
+    ['{'] = {LBRACE, 0},    ['}'] = {RBRACE, 0},    ['('] = {LPAREN, 0},
+    [')'] = {RPAREN, 0},    [';'] = {SEMICOLON, 0}, [','] = {COMMA, 0},
+    ['['] = {LBRACKET, 0},  [']'] = {RBRACKET, 0},  ['.'] = {DOT, 0},
+    [':'] = {COLON, 0},
+};
+
+/* двухсимвольные вида "X=" */
+static int punct_eq(unsigned char c) {
+  switch (c) {
+    case '=': return EQEQ;
+    case '!': return NEQ;
+    case '<': return LE;
+    case '>': return GE;
+    case '+': return PLUS_ASSIGN;
+    case '-': return MINUS_ASSIGN;
+    case '*': return STAR_ASSIGN;
+    case '/': return SLASH_ASSIGN;
+    case '%': return PERCENT_ASSIGN;
+    default: return 0;
+  }
+}
+
+/* длина строкового литерала "..." или 0. Как и правило flex
+   \"([^\\\n]|\\.)*\", берётся самое длинное совпадение в пределах строки. */
+static size_t match_string(const char *s, size_t pos, size_t len) {
+  size_t i = pos + 1, last = 0;
+  while (i < len && s[i] != '\n') {
+    if (s[i] == '\\') {
+      if (i + 1 >= len || s[i + 1] == '\n')
+        break;
+      i += 2;
+      continue;
+    }
+    if (s[i] == '"')
+      last = i;
+    i++;
+  }
+  return last ? last + 1 - pos : 0;
+}
+
+/* длина символьного литерала 'c' / '\c' или 0 */
+static size_t match_char(const char *s, size_t pos, size_t len) {
+  size_t r = len - pos;
+  if (r >= 3 && s[pos + 1] != '\\' && s[pos + 1] != '\n' && s[pos + 2] == '\'')
+    return 3;
+  if (r >= 4 && s[pos + 1] == '\\' && s[pos + 2] != '\n' && s[pos + 3] == '\'')
+    return 4;
+  return 0;
+}
+
+int yylex(YYSTYPE *lvalp, struct Lexer *lx) {
+  if (!lx->buf && lx->in && load_stream(lx) != 0)
+    return 0;
+  const char *s = lx->buf;
+  size_t len = lx->len;
+
+  for (;;) {
+    size_t pos = skip_ws(s, lx->pos, len, &lx->lineno);
+    if (pos >= len) {
+      lx->pos = lx->tok_off = len;
+      lx->tok_len = 0;
+      return 0;
+    }
+
+    unsigned char c = (unsigned char)s[pos];
+    size_t n = 0;
+    int token = 0, has_value = 0;
+
+    if (is_ident_start(c)) {
+      n = scan_ident(s, pos + 1, len) - pos;
+      if (pos + n + 1 < len && s[pos + n] == '[' && s[pos + n + 1] == ']') {
+        /* T[] (без пробелов) — в значении имя без [] */
+        lx->tok_off = pos;
+        lx->tok_len = n + 2;
+        lx->pos = pos + n + 2;
+        lvalp->str = intern_cstrn(s + pos, n);
+        return IDENT_ARRAY;
+      }
+      const Keyword *kw = keyword_lookup(s + pos, n);
+      token = kw ? kw->token : IDENTIFIER;
+      has_value = kw ? kw->has_value : 1;
+    } else if (is_digit(c)) {
+      size_t r = len - pos;
+      n = scan_digits(s, pos + 1, len) - pos;
+      token = DEC_LITERAL;
+      has_value = 1;
+      if (c == '0' && r > 2 && (s[pos + 1] == 'x' || s[pos + 1] == 'X') &&
+          is_hex((unsigned char)s[pos + 2])) {
+        n = 3;
+        while (n < r && is_hex((unsigned char)s[pos + n]))
+          n++;
+        token = HEX_LITERAL;
+      } else if (c == '0' && r > 2 && (s[pos + 1] == 'b' || s[pos + 1] == 'B') &&
+                 (s[pos + 2] == '0' || s[pos + 2] == '1')) {
+        n = 3;
+        while (n < r && (s[pos + n] == '0' || s[pos + n] == '1'))
+          n++;
+        token = BITS_LITERAL;
+      }
+    } else if (c == '"') {
+      n = match_string(s, pos, len);
+      token = n ? STRING_LITERAL : 0;
+      has_value = 1;
+    } else if (c == '\'') {
+      n = match_char(s, pos, len);
+      token = n ? CHAR_LITERAL : 0;
+      has_value = 1;
+    } else if (c == '/' && pos + 1 < len && s[pos + 1] == '/') {
+      /* комментарий до конца строки */
+      lx->pos = scan_to_eol(s, pos + 2, len);
+      continue;
+    } else if (c == '.' && pos + 2 < len && s[pos + 1] == '.' && s[pos + 2] == '.') {
+      n = 3;
+      token = ELLIPSIS;
+      has_value = 1;
+    } else if (pos + 1 < len && s[pos + 1] == '=' && punct_eq(c)) {
+      n = 2;
+      token = punct_eq(c);
+      has_value = 1;
+    } else if (c < 128 && g_punct1[c].token) {
+      n = 1;
+      token = g_punct1[c].token;
+      has_value = g_punct1[c].has_value;
+    }
+
+    lx->tok_off = pos;
+    if (!token) {
+      /* неизвестный символ: сообщить и продолжить */
+      lx->tok_len = 1;
+      lx->pos = pos + 1;
+      print_escaped(s + pos, 1);
+      continue;
+    }
+    lx->tok_len = n;
+    lx->pos = pos + n;
+    if (has_value)
+      lvalp->str = intern_cstrn(s + pos, n);
+    return token;
+  }
+}
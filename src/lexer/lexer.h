@@ -0,0 +1,31 @@
+#ifndef LEXER_LEXER_H
+#define LEXER_LEXER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* Рукописный реентерабельный сканер (вместо flex).
+   Лексемы — срезы (offset, length) входного буфера; значения для парсера
+   интернируются прямо из среза, без промежуточной копии yytext.
+   Пробелы, комментарии, идентификаторы и числа сканируются SSE2/AVX2,
+   ключевые слова и имена встроенных типов — совершенным хешем.
+
+   Сам yylex(YYSTYPE *, struct Lexer *) объявлен в parser.y. */
+
+typedef struct Lexer Lexer;
+
+Lexer *lexer_create(void);
+void lexer_destroy(Lexer *lx);
+
+/* поток читается целиком при первом вызове yylex */
+void lexer_set_input(Lexer *lx, FILE *in);
+/* сканировать готовый буфер без копирования (как yy_scan_buffer);
+   буфер не обязан быть 0-terminated и должен жить до lexer_destroy */
+void lexer_set_buffer(Lexer *lx, const char *buf, size_t len);
+
+/* номер строки текущей позиции (с 1) */
+int lexer_lineno(const Lexer *lx);
+/* текст последней лексемы (0-terminated копия, для сообщений об ошибках) */
+const char *lexer_text(Lexer *lx);
+
+#endif /* LEXER_LEXER_H */
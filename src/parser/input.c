@@ -0,0 +1,105 @@
+#include "input.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* сдвинуть начало за UTF-8 BOM (EF BB BF), если он есть */
+static void skip_utf8_bom(SourceBuf *sb) {
+  const unsigned char *p = (const unsigned char *)sb->data;
+  if (sb->size >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+    sb->data += 3;
+    sb->size -= 3;
+  }
+}
+
+/* запасной путь: прочитать поток целиком */
+static int read_all(FILE *f, SourceBuf *sb) {
+  size_t cap = 1 << 16, len = 0, n;
+  char *b = (char *)malloc(cap);
+  if (!b) {
+    errno = ENOMEM;
+    return -1;
+  }
+  while ((n = fread(b + len, 1, cap - len, f)) > 0) {
+    len += n;
+    if (len == cap) {
+      char *nb = (char *)realloc(b, cap * 2);
+      if (!nb) {
+        free(b);
+        errno = ENOMEM;
+        return -1;
+      }
+      b = nb;
+      cap *= 2;
+    }
+  }
+  sb->heap = b;
+  sb->data = b;
+  sb->size = len;
+  return 0;
+}
+
+int source_open(const char *path, SourceBuf *sb) {
+  memset(sb, 0, sizeof(*sb));
+  sb->data = "";
+
+#ifndef _WIN32
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+      madvise(map, size, MADV_SEQUENTIAL);
+#endif
+      close(fd);
+      sb->map = map;
+      sb->map_size = size;
+      sb->data = (const char *)map;
+      sb->size = size;
+      skip_utf8_bom(sb);
+      return 0;
+    }
+  }
+  FILE *f = fdopen(fd, "rb");
+  if (!f) {
+    int e = errno;
+    close(fd);
+    errno = e;
+    return -1;
+  }
+#else
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return -1;
+#endif
+  int rc = read_all(f, sb);
+  int e = errno;
+  fclose(f);
+  if (rc != 0) {
+    errno = e;
+    return -1;
+  }
+  skip_utf8_bom(sb);
+  return 0;
+}
+
+void source_close(SourceBuf *sb) {
+#ifndef _WIN32
+  if (sb->map)
+    munmap(sb->map, sb->map_size);
+#endif
+  free(sb->heap);
+  memset(sb, 0, sizeof(*sb));
+}
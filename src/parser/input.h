@@ -0,0 +1,22 @@
+#ifndef PARSER_INPUT_H
+#define PARSER_INPUT_H
+
+#include <stddef.h>
+
+/* Входной файл целиком в памяти. На POSIX файл отображается через mmap
+   (без копий stdio); UTF-8 BOM пропускается сдвигом указателя.
+   Если mmap неприменим (пайп, пустой файл, windows), файл читается
+   в malloc-буфер. */
+typedef struct {
+    const char *data; /* содержимое без BOM */
+    size_t size;
+    void *map;        /* отображение (для munmap), иначе NULL */
+    size_t map_size;
+    char *heap;       /* буфер при чтении без mmap, иначе NULL */
+} SourceBuf;
+
+/* 0 — успех; -1 — ошибка, errno установлен */
+int source_open(const char *path, SourceBuf *sb);
+void source_close(SourceBuf *sb);
+
+#endif /* PARSER_INPUT_H */
@@ -1,14 +1,20 @@
 #include "../ast/ast.h"
-#include "../../build/parser.tab.h"
+#include "parser.tab.h"
+#include "parse.h"
 #include <stdio.h>
+#include <string.h>
 
-extern int parse_error;
-extern int yyparse(void);
 extern int yydebug;
 
-int main() {
-  printf("Parser started. Enter input (Ctrl+D to exit):\n");
-  yydebug = 1; /* enable bison debug traces */
-  yyparse();
-  return parse_error;
+int main(int argc, char **argv) {
+  /* -q: только разбор, без трассы bison (для замеров) */
+  int quiet = argc > 1 && strcmp(argv[1], "-q") == 0;
+  if (!quiet) {
+    printf("Parser started. Enter input (Ctrl+D to exit):\n");
+    yydebug = 1; /* enable bison debug traces */
+  }
+  ParseCtx ctx = {0};
+  int rc = parse_stream_ctx(stdin, &ctx);
+  parse_ctx_release(&ctx);
+  return rc != 0;
 }
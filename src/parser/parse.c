@@ -0,0 +1,170 @@
+#include "parse.h"
+#include "input.h"
+#include "../lexer/lexer.h"
+#include "parser.tab.h"
+#include "../trace/trace.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#define PARSE_NO_THREADS 1
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* общий разбор: вход уже передан сканеру (или будет, через set_input) */
+static int parse_run(FILE *in, const char *buf, size_t len, ParseCtx *ctx) {
+  Lexer *scanner = NULL;
+  ctx->root = NULL;
+  ctx->errors = 0;
+  ctx->status = PARSE_OK;
+  ctx->sys_errno = 0;
+  ctx->arena = ast_arena_create();
+
+  if (ctx->arena)
+    scanner = lexer_create();
+  if (!scanner) {
+    parse_ctx_release(ctx);
+    ctx->status = PARSE_ERR_INTERNAL;
+    return -1;
+  }
+  if (in)
+    lexer_set_input(scanner, in);
+  else
+    lexer_set_buffer(scanner, buf, len);
+  int rc = yyparse(scanner, ctx);
+  lexer_destroy(scanner);
+
+  if (rc != 0 || ctx->errors) {
+    /* вместе с ареной уходят и узлы, брошенные парсером при ошибке */
+    parse_ctx_release(ctx);
+    ctx->status = PARSE_ERR_SYNTAX;
+    return -1;
+  }
+  if (!ctx->root) {
+    parse_ctx_release(ctx);
+    ctx->status = PARSE_ERR_NO_ROOT;
+    return -1;
+  }
+  return 0;
+}
+
+int parse_stream_ctx(FILE *in, ParseCtx *ctx) {
+  return parse_run(in, NULL, 0, ctx);
+}
+
+int parse_buffer_ctx(const char *buf, size_t len, ParseCtx *ctx) {
+  return parse_run(NULL, buf, len, ctx);
+}
+
+void parse_ctx_release(ParseCtx *ctx) {
+  ast_arena_free(ctx->arena);
+  ctx->arena = NULL;
+  ctx->root = NULL;
+}
+
+int parse_file(const char *path, ParseCtx *ctx) {
+  SourceBuf sb;
+  TraceSpan span;
+  ctx->filename = path;
+  trace_begin(&span, "parse", path);
+  errno = 0;
+  if (source_open(path, &sb) != 0) {
+    ctx->arena = NULL;
+    ctx->root = NULL;
+    ctx->errors = 0;
+    ctx->status = PARSE_ERR_OPEN;
+    ctx->sys_errno = errno;
+    trace_end(&span);
+    return -1;
+  }
+  /* лексемы интернируются, поэтому отображение можно снять сразу */
+  int rc = parse_buffer_ctx(sb.data, sb.size, ctx);
+  source_close(&sb);
+  trace_end(&span);
+  return rc;
+}
+
+static int default_jobs(int n) {
+  int jobs = 0;
+  const char *env = getenv("PARSE_JOBS");
+  if (env && *env)
+    jobs = atoi(env);
+#ifndef PARSE_NO_THREADS
+  if (jobs <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = cpus > 0 ? (int)cpus : 1;
+  }
+#endif
+  if (jobs <= 0)
+    jobs = 1;
+  return jobs < n ? jobs : n;
+}
+
+#ifndef PARSE_NO_THREADS
+typedef struct {
+  const char *const *paths;
+  ParseCtx *results;
+  int n;
+  int next; /* следующий неразобранный файл, под mu */
+  pthread_mutex_t mu;
+} ParsePool;
+
+static void *parse_worker(void *arg) {
+  ParsePool *pool = (ParsePool *)arg;
+  for (;;) {
+    pthread_mutex_lock(&pool->mu);
+    int i = pool->next++;
+    pthread_mutex_unlock(&pool->mu);
+    if (i >= pool->n)
+      break;
+    parse_file(pool->paths[i], &pool->results[i]);
+  }
+  return NULL;
+}
+#endif
+
+int parse_files(const char *const *paths, int n, ParseCtx *results, int nthreads) {
+  if (n <= 0)
+    return 0;
+  int jobs = nthreads > 0 ? (nthreads < n ? nthreads : n) : default_jobs(n);
+
+#ifndef PARSE_NO_THREADS
+  if (jobs > 1) {
+    ParsePool pool;
+    pool.paths = paths;
+    pool.results = results;
+    pool.n = n;
+    pool.next = 0;
+    pthread_mutex_init(&pool.mu, NULL);
+
+    pthread_t *threads = (pthread_t *)calloc((size_t)jobs, sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+      for (; started < jobs; started++) {
+        if (pthread_create(&threads[started], NULL, parse_worker, &pool) != 0)
+          break;
+      }
+    }
+    /* не удалось запустить ни одного потока — разбираем в текущем */
+    if (started == 0)
+      parse_worker(&pool);
+    for (int t = 0; t < started; t++)
+      pthread_join(threads[t], NULL);
+    free(threads);
+    pthread_mutex_destroy(&pool.mu);
+  } else
+#endif
+  {
+    for (int i = 0; i < n; i++)
+      parse_file(paths[i], &results[i]);
+  }
+
+  int failed = 0;
+  for (int i = 0; i < n; i++)
+    if (results[i].status != PARSE_OK)
+      failed++;
+  return failed;
+}
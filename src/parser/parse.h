@@ -0,0 +1,46 @@
+#ifndef PARSER_PARSE_H
+#define PARSER_PARSE_H
+
+#include <stdio.h>
+#include "../ast/ast.h"
+
+/* Результат разбора одного файла */
+typedef enum {
+    PARSE_OK = 0,
+    PARSE_ERR_OPEN,     /* не удалось открыть файл (см. sys_errno) */
+    PARSE_ERR_SYNTAX,   /* синтаксические ошибки */
+    PARSE_ERR_NO_ROOT,  /* парсер не построил корень */
+    PARSE_ERR_INTERNAL  /* не удалось создать сканер */
+} ParseStatus;
+
+/* Контекст разбора. Всё состояние парсера и лексера живёт здесь и в
+   сканере, глобальных переменных нет, поэтому разные файлы можно
+   разбирать одновременно из разных потоков. */
+typedef struct ParseCtx {
+    const char *filename; /* для сообщений об ошибках (может быть NULL) */
+    ASTArena *arena;      /* арена, в которой построено дерево (владеет им) */
+    ASTNode *root;        /* корень AST (source) после успешного разбора */
+    int errors;           /* число синтаксических ошибок */
+    ParseStatus status;
+    int sys_errno;        /* errno для PARSE_ERR_OPEN */
+} ParseCtx;
+
+/* разобрать уже открытый поток; 0 — успех (ctx->root заполнен).
+   При ошибке арена уже освобождена. */
+int parse_stream_ctx(FILE *in, ParseCtx *ctx);
+
+/* разобрать буфер в памяти (без копирования); 0 — успех */
+int parse_buffer_ctx(const char *buf, size_t len, ParseCtx *ctx);
+
+/* отобразить файл в память (пропуская UTF-8 BOM) и разобрать; 0 — успех */
+int parse_file(const char *path, ParseCtx *ctx);
+
+/* Разобрать n файлов пулом из nthreads потоков (<= 0 — переменная
+   окружения PARSE_JOBS или число процессоров). results[i] соответствует
+   paths[i]. Возвращает число файлов с ошибками. */
+int parse_files(const char *const *paths, int n, ParseCtx *results, int nthreads);
+
+/* освободить дерево (арену) контекста */
+void parse_ctx_release(ParseCtx *ctx);
+
+#endif /* PARSER_PARSE_H */
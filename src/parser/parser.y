@@ -2,15 +2,28 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "../ast/ast.h"
-
-void yyerror(const char *s);
-int yylex(void);
+#include "ast.h"
+#include "../lexer/lexer.h"
+#include "../parser/parse.h"
 %}
 
+/* Реентерабельный парсер: состояние — в сканере и ParseCtx, не в глобалах */
+%define api.pure full
+%code requires {
+struct ParseCtx;
+struct Lexer;
+}
+%param {struct Lexer *scanner}
+%parse-param {struct ParseCtx *ctx}
+
+%code {
+int yylex(YYSTYPE *yylvalp, struct Lexer *scanner);
+void yyerror(struct Lexer *scanner, struct ParseCtx *ctx, const char *s);
+}
+
 /* Семантические типы */
 %union {
-    char* str;
+    const char* str; /* интернированная строка, не освобождается */
     ASTNode* node;
 }
 
@@ -51,12 +64,12 @@ int yylex(void);
 
 source
     : sourceItemList
-      { $$ = ast_create_node("source"); ast_add_child($$, $1); ast_set_root($$); }
+      { $$ = ast_create_node(ctx->arena, AST_SOURCE); ast_add_child($$, $1); ctx->root = $$; }
     ;
 
 sourceItemList
     : /* пусто */
-      { $$ = ast_create_node("items"); }
+      { $$ = ast_create_node(ctx->arena, AST_ITEMS); }
     | sourceItemList sourceItem
       { $$ = $1; ast_add_child($$, $2); }
     ;
@@ -70,11 +83,11 @@ sourceItem
 
 funcDef
     : optImportSpec funcSignature statementBlock
-      { $$ = ast_create_node("funcDef");
+      { $$ = ast_create_node(ctx->arena, AST_FUNC_DEF);
         if ($1) ast_add_child($$, $1);
         ast_add_child($$, $2); ast_add_child($$, $3); }
     | optImportSpec funcSignature SEMICOLON
-      { $$ = ast_create_node("funcDecl");
+      { $$ = ast_create_node(ctx->arena, AST_FUNC_DECL);
         if ($1) ast_add_child($$, $1);
         ast_add_child($$, $2); }
     ;
@@ -88,21 +101,21 @@ optImportSpec
 
 importSpec
     : EXTERN LPAREN STRING_LITERAL RPAREN
-      { $$ = ast_create_node("import");
-        ASTNode* dll = ast_create_leaf_token("dll", $3); free($3);
+      { $$ = ast_create_node(ctx->arena, AST_IMPORT);
+        ASTNode* dll = ast_create_leaf(ctx->arena, AST_DLL, $3);
         ast_add_child($$, dll); }
     | EXTERN LPAREN STRING_LITERAL COMMA STRING_LITERAL RPAREN
-      { $$ = ast_create_node("import");
-        ASTNode* dll = ast_create_leaf_token("dll", $3); free($3);
-        ASTNode* entry = ast_create_leaf_token("entry", $5); free($5);
+      { $$ = ast_create_node(ctx->arena, AST_IMPORT);
+        ASTNode* dll = ast_create_leaf(ctx->arena, AST_DLL, $3);
+        ASTNode* entry = ast_create_leaf(ctx->arena, AST_ENTRY, $5);
         ast_add_child($$, dll); ast_add_child($$, entry); }
     ;
 
 funcSignature
     : typeRef IDENTIFIER LPAREN argList RPAREN
-      { $$ = ast_create_node("signature");
+      { $$ = ast_create_node(ctx->arena, AST_SIGNATURE);
         ast_add_child($$, $1);
-        ASTNode* id = ast_create_leaf_token("id", $2); free($2);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $2);
         ast_add_child($$, id);
         ast_add_child($$, $4);
       }
@@ -110,72 +123,72 @@ funcSignature
 
 argList
     : /* пусто */
-      { $$ = ast_create_node("args"); }
+      { $$ = ast_create_node(ctx->arena, AST_ARGS); }
     | argDefList
-      { $$ = ast_create_node("args"); ast_add_child($$, $1); }
+      { $$ = ast_create_node(ctx->arena, AST_ARGS); ast_add_child($$, $1); }
     | argDefList COMMA ELLIPSIS
-      { $$ = ast_create_node("args"); ast_add_child($$, $1);
-        ASTNode* va = ast_create_leaf_token("varargs", $3); free($3); ast_add_child($$, va); }
+      { $$ = ast_create_node(ctx->arena, AST_ARGS); ast_add_child($$, $1);
+        ASTNode* va = ast_create_leaf(ctx->arena, AST_VARARGS, $3); ast_add_child($$, va); }
     | ELLIPSIS
-      { $$ = ast_create_node("args"); ASTNode* va = ast_create_leaf_token("varargs", $1); free($1); ast_add_child($$, va); }
+      { $$ = ast_create_node(ctx->arena, AST_ARGS); ASTNode* va = ast_create_leaf(ctx->arena, AST_VARARGS, $1); ast_add_child($$, va); }
     ;
 
 argDefList
     : argDef
-      { $$ = ast_create_node("arglist"); ast_add_child($$, $1); }
+      { $$ = ast_create_node(ctx->arena, AST_ARGLIST); ast_add_child($$, $1); }
     | argDefList COMMA argDef
       { $$ = $1; ast_add_child($$, $3); }
     ;
 
 argDef
     : typeRef IDENTIFIER
-      { $$ = ast_create_node("arg");
+      { $$ = ast_create_node(ctx->arena, AST_ARG);
         ast_add_child($$, $1);
-        ASTNode* id = ast_create_leaf_token("id", $2); free($2);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $2);
         ast_add_child($$, id);
       }
     ;
 
 typeRef
     : BUILTIN_TYPE
-      { $$ = ast_create_leaf_token("type", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_TYPE, $1); }
     | IDENTIFIER
-      { $$ = ast_create_leaf_token("typeRef", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_TYPE_REF, $1); }
     /* identifier with [] lexed as a single token by the scanner (IDENT_ARRAY) */
     | IDENT_ARRAY
-      { $$ = ast_create_node("array");
+      { $$ = ast_create_node(ctx->arena, AST_ARRAY);
         /* create child typeRef node from the identifier name */
-        ASTNode* t = ast_create_leaf_token("typeRef", $1); free($1);
+        ASTNode* t = ast_create_leaf(ctx->arena, AST_TYPE_REF, $1);
         ast_add_child($$, t);
       }
     /* identifier followed by [] (space-separated tokens) e.g. 'T [ ]' or 'T [ ]' */
     | IDENTIFIER LBRACKET RBRACKET
-      { $$ = ast_create_node("array");
-        ASTNode* t = ast_create_leaf_token("typeRef", $1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_ARRAY);
+        ASTNode* t = ast_create_leaf(ctx->arena, AST_TYPE_REF, $1);
         ast_add_child($$, t);
       }
     | IDENTIFIER LT typeRef GT
-      { $$ = ast_create_node("genType");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_GEN_TYPE);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
         ast_add_child($$, id);
         ast_add_child($$, $3);
       }
     /* pointer type: e.g. void* or MyType* */
     | typeRef STAR
-      { $$ = ast_create_node("ptr"); ast_add_child($$, $1);
-        ASTNode* p = ast_create_leaf_token("ptrsym", $2); free($2); ast_add_child($$, p); }
+      { $$ = ast_create_node(ctx->arena, AST_PTR); ast_add_child($$, $1);
+        ASTNode* p = ast_create_leaf(ctx->arena, AST_PTRSYM, $2); ast_add_child($$, p); }
     | typeRef LBRACKET RBRACKET
-      { $$ = ast_create_node("array"); ast_add_child($$, $1); }
+      { $$ = ast_create_node(ctx->arena, AST_ARRAY); ast_add_child($$, $1); }
     ;
 
 statementBlock
     : LBRACE statementList RBRACE
-      { $$ = ast_create_node("block"); ast_add_child($$, $2); }
+      { $$ = ast_create_node(ctx->arena, AST_BLOCK); ast_add_child($$, $2); }
     ;
 
 statementList
     : /* пусто */
-      { $$ = ast_create_node("stmts"); }
+      { $$ = ast_create_node(ctx->arena, AST_STMTS); }
     | statementList statement
       { $$ = $1; ast_add_child($$, $2); }
     ;
@@ -201,7 +214,7 @@ statement
 
 varDecl
     : typeRef varList SEMICOLON
-      { $$ = ast_create_node("vardecl"); ast_add_child($$, $1); ast_add_child($$, $2); }
+      { $$ = ast_create_node(ctx->arena, AST_VARDECL); ast_add_child($$, $1); ast_add_child($$, $2); }
     ;
 
 varList
@@ -211,210 +224,225 @@ varList
 
 varItemList
     : IDENTIFIER optAssign
-      { $$ = ast_create_node("vars");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_VARS);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
         ast_add_child($$, id); ast_add_child($$, $2);
       }
     | varItemList COMMA IDENTIFIER optAssign
       { $$ = $1;
-        ASTNode* id = ast_create_leaf_token("id", $3); free($3);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $3);
         ast_add_child($$, id); ast_add_child($$, $4);
       }
+    /* массив с размером: T name[N] -> id, array(N) вместо optAssign */
+    | IDENTIFIER LBRACKET expr RBRACKET
+      { $$ = ast_create_node(ctx->arena, AST_VARS);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
+        ASTNode* dim = ast_create_node(ctx->arena, AST_ARRAY);
+        ast_add_child(dim, $3);
+        ast_add_child($$, id); ast_add_child($$, dim);
+      }
+    | varItemList COMMA IDENTIFIER LBRACKET expr RBRACKET
+      { $$ = $1;
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $3);
+        ASTNode* dim = ast_create_node(ctx->arena, AST_ARRAY);
+        ast_add_child(dim, $5);
+        ast_add_child($$, id); ast_add_child($$, dim);
+      }
     ;
 
 optAssign
     : /* пусто */
-      { $$ = ast_create_node("noinit"); }
+      { $$ = ast_create_node(ctx->arena, AST_NOINIT); }
     | ASSIGN expr
-      { $$ = ast_create_node("assign"); ast_add_child($$, $2); }
+      { $$ = ast_create_node(ctx->arena, AST_ASSIGN); ast_add_child($$, $2); }
     ;
 
 ifStmt
     : IF LPAREN expr RPAREN statement optElse
-      { $$ = ast_create_node("if"); ast_add_child($$, $3); ast_add_child($$, $5); ast_add_child($$, $6); }
+      { $$ = ast_create_node(ctx->arena, AST_IF); ast_add_child($$, $3); ast_add_child($$, $5); ast_add_child($$, $6); }
     ;
 
 optElse
     : /* пусто */
-      { $$ = ast_create_node("noelse"); }
+      { $$ = ast_create_node(ctx->arena, AST_NOELSE); }
     | ELSE statement
-      { $$ = ast_create_node("else"); ast_add_child($$, $2); }
+      { $$ = ast_create_node(ctx->arena, AST_ELSE); ast_add_child($$, $2); }
     ;
 
 whileStmt
     : WHILE LPAREN expr RPAREN statement
-      { $$ = ast_create_node("while"); ast_add_child($$, $3); ast_add_child($$, $5); }
+      { $$ = ast_create_node(ctx->arena, AST_WHILE); ast_add_child($$, $3); ast_add_child($$, $5); }
     ;
 
 doWhileStmt
     : DO statementBlock WHILE LPAREN expr RPAREN SEMICOLON
-      { $$ = ast_create_node("doWhile"); ast_add_child($$, $2); ast_add_child($$, $5); }
+      { $$ = ast_create_node(ctx->arena, AST_DO_WHILE); ast_add_child($$, $2); ast_add_child($$, $5); }
     ;
 
 breakStmt
     : BREAK SEMICOLON
-      { $$ = ast_create_node("break"); }
+      { $$ = ast_create_node(ctx->arena, AST_BREAK); }
     ;
 
 returnStmt
     : RETURN expr SEMICOLON
-      { $$ = ast_create_node("return"); ast_add_child($$, $2); }
+      { $$ = ast_create_node(ctx->arena, AST_RETURN); ast_add_child($$, $2); }
     | RETURN SEMICOLON
-      { $$ = ast_create_node("return"); }
+      { $$ = ast_create_node(ctx->arena, AST_RETURN); }
     ;
 
 exprStmt
     : expr SEMICOLON
-      { $$ = ast_create_node("exprstmt"); ast_add_child($$, $1); }
+      { $$ = ast_create_node(ctx->arena, AST_EXPRSTMT); ast_add_child($$, $1); }
     ;
 
 /* --- выражения --- */
 expr
     /* присваивание */
     : IDENTIFIER ASSIGN expr
-      { $$ = ast_create_node("assign");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_ASSIGN);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
         ast_add_child($$, id); ast_add_child($$, $3); }
 
     /* assign to indexed lvalue: a[expr] = expr */
     | IDENTIFIER LBRACKET expr RBRACKET ASSIGN expr
-      { $$ = ast_create_node("assign_index");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_ASSIGN_INDEX);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
         ast_add_child($$, id); ast_add_child($$, $3); ast_add_child($$, $6); }
 
     /* составные присваивания */
     | IDENTIFIER PLUS_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, id); ast_add_child($$, op); ast_add_child($$, $3); }
 
     /* allow assignment where LHS is any expression (e.g., a[i], obj.field) */
     | expr ASSIGN expr
-      { $$ = ast_create_node("assign");
+      { $$ = ast_create_node(ctx->arena, AST_ASSIGN);
         ast_add_child($$, $1); ast_add_child($$, $3); }
     /* compound assigns for general lvalues */
     | expr PLUS_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
         ast_add_child($$, $1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr MINUS_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
         ast_add_child($$, $1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr STAR_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
         ast_add_child($$, $1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr SLASH_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
         ast_add_child($$, $1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr PERCENT_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
         ast_add_child($$, $1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | IDENTIFIER MINUS_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, id); ast_add_child($$, op); ast_add_child($$, $3); }
     | IDENTIFIER STAR_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, id); ast_add_child($$, op); ast_add_child($$, $3); }
     | IDENTIFIER SLASH_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, id); ast_add_child($$, op); ast_add_child($$, $3); }
     | IDENTIFIER PERCENT_ASSIGN expr
-      { $$ = ast_create_node("compound_assign");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
-        ASTNode* op = ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_COMPOUND_ASSIGN);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
+        ASTNode* op = ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, id); ast_add_child($$, op); ast_add_child($$, $3); }
 
     /* арифметика */
     | expr STAR    expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr SLASH   expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr PERCENT expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
 
     | expr PLUS    expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr MINUS   expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
 
     /* сравнения */
     | expr LT   expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr GT   expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr LE   expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr GE   expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr EQEQ expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
     | expr NEQ  expr
-      { $$ = ast_create_node("binop"); ast_add_child($$, $1);
-        ASTNode* op=ast_create_leaf_token("op", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_BINOP); ast_add_child($$, $1);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $2);
         ast_add_child($$, op); ast_add_child($$, $3); }
 
     /* унарные + и - */
     | MINUS expr %prec UMINUS
-      { $$ = ast_create_node("unop");
-        ASTNode* op=ast_create_leaf_token("op", $1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_UNOP);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $1);
         ast_add_child($$, op); ast_add_child($$, $2); }
     | PLUS  expr %prec UPLUS
-      { $$ = ast_create_node("unop");
-        ASTNode* op=ast_create_leaf_token("op", $1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_UNOP);
+        ASTNode* op=ast_create_leaf(ctx->arena, AST_OP, $1);
         ast_add_child($$, op); ast_add_child($$, $2); }
     /* адрес переменной &var */
     | AMPERSAND IDENTIFIER
-      { $$ = ast_create_node("address");
-        ASTNode* id = ast_create_leaf_token("id", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_ADDRESS);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $2);
         ast_add_child($$, id); }
 
     /* new ClassName(...) */
     | NEW IDENTIFIER LPAREN argExprList RPAREN
-      { $$ = ast_create_node("new");
-        ASTNode* id=ast_create_leaf_token("id", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_NEW);
+        ASTNode* id=ast_create_leaf(ctx->arena, AST_ID, $2);
         ast_add_child($$, id);
         ast_add_child($$, $4);
       }
     /* new ClassName<Type>(...) */
     | NEW IDENTIFIER LT typeRef GT LPAREN argExprList RPAREN
-      { $$ = ast_create_node("new");
-        ASTNode* id=ast_create_leaf_token("id", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_NEW);
+        ASTNode* id=ast_create_leaf(ctx->arena, AST_ID, $2);
         ast_add_child($$, id);
         /* attach generic type parameter */
         ast_add_child($$, $4);
@@ -422,39 +450,46 @@ expr
       }
     /* new Type[expr] - array allocation form */
     | NEW IDENTIFIER LBRACKET expr RBRACKET
-      { $$ = ast_create_node("new");
-        ASTNode* id = ast_create_leaf_token("id", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_NEW);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $2);
+        ast_add_child($$, id);
+        ast_add_child($$, $4);
+      }
+    /* new int[expr] - array of a builtin type */
+    | NEW BUILTIN_TYPE LBRACKET expr RBRACKET
+      { $$ = ast_create_node(ctx->arena, AST_NEW);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $2);
         ast_add_child($$, id);
         ast_add_child($$, $4);
       }
     /* new ClassName<Type>[expr] - generic array allocation */
     | NEW IDENTIFIER LT typeRef GT LBRACKET expr RBRACKET
-      { $$ = ast_create_node("new");
-        ASTNode* id = ast_create_leaf_token("id", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_NEW);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $2);
         ast_add_child($$, id);
         ast_add_child($$, $4);
         ast_add_child($$, $7);
       }
     | NEW IDENTIFIER
-      { $$ = ast_create_node("new");
-        ASTNode* id=ast_create_leaf_token("id", $2); free($2);
-        ASTNode* args=ast_create_node("args");
+      { $$ = ast_create_node(ctx->arena, AST_NEW);
+        ASTNode* id=ast_create_leaf(ctx->arena, AST_ID, $2);
+        ASTNode* args=ast_create_node(ctx->arena, AST_ARGS);
         ast_add_child($$, id);
         ast_add_child($$, args);
       }
 
     /* доступ к членам: obj.field */
     | expr DOT IDENTIFIER
-      { $$ = ast_create_node("fieldAccess");
-        ASTNode* id=ast_create_leaf_token("id", $3); free($3);
+      { $$ = ast_create_node(ctx->arena, AST_FIELD_ACCESS);
+        ASTNode* id=ast_create_leaf(ctx->arena, AST_ID, $3);
         ast_add_child($$, $1);
         ast_add_child($$, id);
       }
 
     /* вызов метода: obj.method(args) */
     | expr DOT IDENTIFIER LPAREN argExprList RPAREN
-      { $$ = ast_create_node("methodCall");
-        ASTNode* id=ast_create_leaf_token("id", $3); free($3);
+      { $$ = ast_create_node(ctx->arena, AST_METHOD_CALL);
+        ASTNode* id=ast_create_leaf(ctx->arena, AST_ID, $3);
         ast_add_child($$, $1);
         ast_add_child($$, id);
         ast_add_child($$, $5);
@@ -462,8 +497,8 @@ expr
 
     /* индекс после точки (если вдруг понадобится): obj.arr[idx] */
     | expr DOT IDENTIFIER LBRACKET expr RBRACKET
-      { $$ = ast_create_node("memberIndex");
-        ASTNode* id=ast_create_leaf_token("id", $3); free($3);
+      { $$ = ast_create_node(ctx->arena, AST_MEMBER_INDEX);
+        ASTNode* id=ast_create_leaf(ctx->arena, AST_ID, $3);
         ast_add_child($$, $1);
         ast_add_child($$, id);
         ast_add_child($$, $5);
@@ -473,46 +508,46 @@ expr
     | LPAREN expr RPAREN
       { $$ = $2; }
     | IDENTIFIER
-      { $$ = ast_create_leaf_token("id", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_ID, $1); }
     | literal
       { $$ = $1; }
     | IDENTIFIER LPAREN argExprList RPAREN
-      { $$ = ast_create_node("call");
-        ASTNode* id=ast_create_leaf_token("id",$1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_CALL);
+        ASTNode* id=ast_create_leaf(ctx->arena, AST_ID,$1);
         ast_add_child($$, id); ast_add_child($$, $3); }
     | IDENTIFIER LBRACKET expr RBRACKET
-      { $$ = ast_create_node("index");
-        ASTNode* id=ast_create_leaf_token("id",$1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_INDEX);
+        ASTNode* id=ast_create_leaf(ctx->arena, AST_ID,$1);
         ast_add_child($$, id); ast_add_child($$, $3); }
     ;
 
 argExprList
     : /* пусто */
-      { $$ = ast_create_node("args"); }
+      { $$ = ast_create_node(ctx->arena, AST_ARGS); }
     | exprList
-      { $$ = ast_create_node("args"); ast_add_child($$, $1); }
+      { $$ = ast_create_node(ctx->arena, AST_ARGS); ast_add_child($$, $1); }
     ;
 
 exprList
     : expr
-      { $$ = ast_create_node("list"); ast_add_child($$, $1); }
+      { $$ = ast_create_node(ctx->arena, AST_LIST); ast_add_child($$, $1); }
     | exprList COMMA expr
       { $$ = $1; ast_add_child($$, $3); }
     ;
 
 literal
     : BOOL_LITERAL
-      { $$ = ast_create_leaf_token("bool", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_BOOL, $1); }
     | STRING_LITERAL
-      { $$ = ast_create_leaf_token("string", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_STRING, $1); }
     | CHAR_LITERAL
-      { $$ = ast_create_leaf_token("char", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_CHAR, $1); }
     | HEX_LITERAL
-      { $$ = ast_create_leaf_token("hex", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_HEX, $1); }
     | BITS_LITERAL
-      { $$ = ast_create_leaf_token("bits", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_BITS, $1); }
     | DEC_LITERAL
-      { $$ = ast_create_leaf_token("dec", $1); free($1); }
+      { $$ = ast_create_leaf(ctx->arena, AST_DEC, $1); }
     ;
 
 /* --------- КЛАССЫ / НАСЛЕДОВАНИЕ --------- */
@@ -522,17 +557,17 @@ optTemplate
     : /* пусто */
       { $$ = NULL; }
     | TEMPLATE LT IDENTIFIER GT
-      { $$ = ast_create_node("template");
-        ASTNode* id = ast_create_leaf_token("id", $3); free($3);
+      { $$ = ast_create_node(ctx->arena, AST_TEMPLATE);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $3);
         ast_add_child($$, id);
       }
     ;
 
 classDef
     : optTemplate CLASS IDENTIFIER optBase LBRACE memberList RBRACE
-      { $$ = ast_create_node("class");
+      { $$ = ast_create_node(ctx->arena, AST_CLASS);
         if ($1) ast_add_child($$, $1); /* template param, if any */
-        ASTNode* id = ast_create_leaf_token("id", $3); free($3);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $3);
         ast_add_child($$, id);
         if ($4) ast_add_child($$, $4);
         ast_add_child($$, $6);
@@ -544,41 +579,41 @@ optBase
     : /* пусто */
       { $$ = NULL; }
     | COLON IDENTIFIER
-      { $$ = ast_create_node("extends");
-        ASTNode* base = ast_create_leaf_token("id", $2); free($2);
+      { $$ = ast_create_node(ctx->arena, AST_EXTENDS);
+        ASTNode* base = ast_create_leaf(ctx->arena, AST_ID, $2);
         ast_add_child($$, base);
       }
     ;
 
 memberList
     : /* пусто */
-      { $$ = ast_create_node("members"); }
+      { $$ = ast_create_node(ctx->arena, AST_MEMBERS); }
     | memberList member
       { $$ = $1; ast_add_child($$, $2); }
     ;
 
 member
     : optModifier funcDef
-      { $$ = ast_create_node("member");
+      { $$ = ast_create_node(ctx->arena, AST_MEMBER);
         if ($1) ast_add_child($$, $1);
         ast_add_child($$, $2); }
     | optModifier typeRef IDENTIFIER LPAREN argList RPAREN statement
-      { $$ = ast_create_node("member");
+      { $$ = ast_create_node(ctx->arena, AST_MEMBER);
         if ($1) ast_add_child($$, $1);
         /* build signature */
-        ASTNode* sig = ast_create_node("signature");
+        ASTNode* sig = ast_create_node(ctx->arena, AST_SIGNATURE);
         ast_add_child(sig, $2);
-        ASTNode* id = ast_create_leaf_token("id", $3); free($3);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $3);
         ast_add_child(sig, id);
         ast_add_child(sig, $5);
         /* create funcDef node and attach body */
-        ASTNode* f = ast_create_node("funcDef");
+        ASTNode* f = ast_create_node(ctx->arena, AST_FUNC_DEF);
         ast_add_child(f, sig);
         ast_add_child(f, $7);
         ast_add_child($$, f);
       }
     | optModifier field
-      { $$ = ast_create_node("member");
+      { $$ = ast_create_node(ctx->arena, AST_MEMBER);
         if ($1) ast_add_child($$, $1);
         ast_add_child($$, $2); }
     ;
@@ -587,14 +622,14 @@ optModifier
     : /* пусто */
       { $$ = NULL; }
     | PUBLIC
-      { $$ = ast_create_leaf_token("modifier", "public"); }
+      { $$ = ast_create_leaf(ctx->arena, AST_MODIFIER, "public"); }
     | PRIVATE
-      { $$ = ast_create_leaf_token("modifier", "private"); }
+      { $$ = ast_create_leaf(ctx->arena, AST_MODIFIER, "private"); }
     ;
 
 field
     : typeRef fieldList SEMICOLON
-      { $$ = ast_create_node("field");
+      { $$ = ast_create_node(ctx->arena, AST_FIELD);
         ast_add_child($$, $1);
         ast_add_child($$, $2); }
     ;
@@ -608,28 +643,28 @@ optTypeRef
 
 fieldList
     : IDENTIFIER
-      { $$ = ast_create_node("fieldlist");
-        ASTNode* id = ast_create_leaf_token("id", $1); free($1);
+      { $$ = ast_create_node(ctx->arena, AST_FIELDLIST);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $1);
         ast_add_child($$, id); }
     | fieldList COMMA IDENTIFIER
       { $$ = $1;
-        ASTNode* id = ast_create_leaf_token("id", $3); free($3);
+        ASTNode* id = ast_create_leaf(ctx->arena, AST_ID, $3);
         ast_add_child($$, id); }
     ;
 
 %%
 
-int parse_error = 0;
-
-/* Expose lexer state for better error messages */
-extern int yylineno;
-extern char *yytext;
-
-void yyerror(const char *s) {
-  if (yytext) {
-    fprintf(stderr, "Error: %s at line %d near '%s'\n", s, yylineno, yytext);
+void yyerror(struct Lexer *scanner, struct ParseCtx *ctx, const char *s) {
+  /* lexer state for better error messages */
+  const char *text = lexer_text(scanner);
+  const char *file = ctx && ctx->filename ? ctx->filename : NULL;
+  if (file)
+    fprintf(stderr, "%s: ", file);
+  if (text) {
+    fprintf(stderr, "Error: %s at line %d near '%s'\n", s, lexer_lineno(scanner), text);
   } else {
-    fprintf(stderr, "Error: %s at line %d\n", s, yylineno);
+    fprintf(stderr, "Error: %s at line %d\n", s, lexer_lineno(scanner));
   }
-  parse_error = 1;
+  if (ctx)
+    ctx->errors++;
 }
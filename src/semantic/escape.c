@@ -0,0 +1,441 @@
+#include "escape.h"
+#include "mono.h"
+#include "../ast/intern.h"
+#include "../ast/symmap.h"
+#include "../trace/trace.h"
+#include "../trace/memstat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct EscapeInfo {
+  const ASTArena *arena;
+  unsigned char *local; /* индекс узла new -> 1, если объект не убегает */
+  uint32_t n;
+};
+
+typedef struct {
+  const ASTNode *fn;
+  const ClassInfo *cls; /* класс метода или NULL */
+  int first;            /* первый слот в Escape.slots */
+  int n_params;         /* включая this у методов */
+  int n_vars;           /* параметры, затем локалы */
+} FnInfo;
+
+typedef struct {
+  const char *name; /* NULL у безымянного параметра */
+  int escapes;
+} Slot;
+
+typedef struct {
+  EscapeInfo *ei;
+  const TypeEnv *env;
+  const ExprTypes *et;
+
+  /* символ функции (как get_func_name в codegen) или Class__method ->
+     индекс в fns */
+  SymMap funcs;
+  FnInfo *fns;
+  int n_fns, cap_fns;
+
+  /* переменные всех функций подряд */
+  Slot *slots;
+  int n_slots, cap_slots;
+
+  /* текущая функция: имя -> слот (плоско, как LocalMap в codegen) */
+  const FnInfo *cur;
+  SymMap scope;
+  int changed;
+
+  const char *s_this;
+} Escape;
+
+/* ========================= функции и слоты ========================= */
+
+static int grow(void **v, int *cap, int need, size_t elem) {
+  if (need <= *cap) return 0;
+  int nc = *cap ? *cap * 2 : 64;
+  while (nc < need) nc *= 2;
+  void *nv = realloc(*v, (size_t)nc * elem);
+  if (!nv) return -1;
+  mem_note_resize(MEM_ESCAPE, (size_t)*cap * elem, (size_t)nc * elem);
+  *v = nv;
+  *cap = nc;
+  return 0;
+}
+
+static int add_slot(Escape *es, const char *name) {
+  if (grow((void **)&es->slots, &es->cap_slots, es->n_slots + 1, sizeof(*es->slots))) return -1;
+  es->slots[es->n_slots].name = name;
+  es->slots[es->n_slots].escapes = 0;
+  return es->n_slots++;
+}
+
+/* имя уже объявлено в функции — тот же слот (повторное объявление в
+   codegen не создаёт нового локала) */
+static void declare(Escape *es, FnInfo *f, const char *name) {
+  if (!name || symmap_get(&es->scope, name) >= 0) return;
+  int s = add_slot(es, name);
+  if (s < 0) return;
+  symmap_put(&es->scope, name, s);
+  f->n_vars++;
+}
+
+static void declare_locals(Escape *es, FnInfo *f, const ASTNode *n) {
+  if (n->kind == AST_VARDECL && n->numChildren >= 2) {
+    const ASTNode *vars = ast_child(n, 1);
+    if (vars->kind != AST_VARS) return;
+    for (int i = 0; i < vars->numChildren; i += 2) {
+      const ASTNode *idn = ast_child(vars, i);
+      if (idn->kind == AST_ID) declare(es, f, idn->lexeme);
+    }
+    return;
+  }
+  for (int i = 0; i < n->numChildren; i++) declare_locals(es, f, ast_child(n, i));
+}
+
+static const ASTNode *sig_arglist(const ASTNode *sig) {
+  if (!sig || sig->kind != AST_SIGNATURE || sig->numChildren < 3) return NULL;
+  const ASTNode *args = ast_child(sig, 2);
+  if (args->kind != AST_ARGS || args->numChildren == 0) return NULL;
+  const ASTNode *list = ast_child(args, 0);
+  return list->kind == AST_ARGLIST ? list : NULL;
+}
+
+/* name или name__T1_T2 (get_func_name в codegen); Class__method у методов */
+static const char *func_symbol(const ASTNode *fn, const ClassInfo *cls) {
+  const ASTNode *sig = ast_child(fn, 0);
+  const ASTNode *idn = ast_child(sig, 1);
+  char buf[256];
+  if (cls) {
+    snprintf(buf, sizeof(buf), "%s__%s", cls->name, idn->lexeme);
+    return intern_cstr(buf);
+  }
+  const ASTNode *list = sig_arglist(sig);
+  if (!list || list->numChildren == 0) return idn->lexeme;
+  int n = snprintf(buf, sizeof(buf), "%s_", idn->lexeme);
+  for (int i = 0; i < list->numChildren && n > 0 && n < (int)sizeof(buf); i++) {
+    const ASTNode *arg = ast_child(list, i);
+    const ASTNode *t = arg->numChildren > 0 ? ast_child(arg, 0) : NULL;
+    n += snprintf(buf + n, sizeof(buf) - (size_t)n, "_%s", mono_type_name(t));
+  }
+  return n > 0 && n < (int)sizeof(buf) ? intern_cstr(buf) : NULL;
+}
+
+static void add_function(Escape *es, const ASTNode *fn, const ClassInfo *cls) {
+  if (fn->numChildren < 2) return;
+  const ASTNode *sig = ast_child(fn, 0);
+  if (sig->kind != AST_SIGNATURE || sig->numChildren < 2 || ast_child(sig, 1)->kind != AST_ID)
+    return;
+  if (grow((void **)&es->fns, &es->cap_fns, es->n_fns + 1, sizeof(*es->fns))) return;
+
+  FnInfo *f = &es->fns[es->n_fns];
+  memset(f, 0, sizeof(*f));
+  f->fn = fn;
+  f->cls = cls;
+  f->first = es->n_slots;
+
+  symmap_free(&es->scope);
+  symmap_init(&es->scope, MEM_ESCAPE);
+  if (cls) declare(es, f, es->s_this);
+  const ASTNode *list = sig_arglist(sig);
+  for (int i = 0; list && i < list->numChildren; i++) {
+    const ASTNode *arg = ast_child(list, i);
+    const ASTNode *idn = arg->numChildren >= 2 ? ast_child(arg, 1) : NULL;
+    /* безымянный параметр всё равно занимает место в списке */
+    if (idn && idn->kind == AST_ID && symmap_get(&es->scope, idn->lexeme) < 0) declare(es, f, idn->lexeme);
+    else if (add_slot(es, NULL) >= 0) f->n_vars++;
+  }
+  f->n_params = f->n_vars;
+  declare_locals(es, f, ast_child(fn, 1));
+
+  const char *sym = func_symbol(fn, cls);
+  if (sym && symmap_get(&es->funcs, sym) < 0) symmap_put(&es->funcs, sym, es->n_fns);
+  es->n_fns++;
+}
+
+static void add_members(Escape *es, const ASTNode *n, const ClassInfo *cls) {
+  for (int i = 0; i < n->numChildren; i++) {
+    const ASTNode *c = ast_child(n, i);
+    if (c->kind == AST_FUNC_DEF) add_function(es, c, cls);
+    else if (c->kind != AST_VARDECL && c->kind != AST_FIELD) add_members(es, c, cls);
+  }
+}
+
+static const ASTNode *find_child_kind(const ASTNode *n, ASTKind kind) {
+  for (int i = 0; i < n->numChildren; i++) {
+    const ASTNode *c = ast_child(n, i);
+    if (c->kind == kind) return c;
+  }
+  return NULL;
+}
+
+/* ========================= сводки вызовов ========================= */
+
+/* параметр i функции fi не убегает (fi < 0 — вызываемый неизвестен) */
+static int param_safe(const Escape *es, int fi, int i) {
+  if (fi < 0) return 0;
+  const FnInfo *f = &es->fns[fi];
+  return i < f->n_params && !es->slots[f->first + i].escapes;
+}
+
+/* реализация метода для получателя статического типа cls; -1, если
+   она не единственна (слот переопределён в подклассах) или неизвестна */
+static int method_fn(const Escape *es, const char *cls, const char *method) {
+  const ClassInfo *ci = cls ? types_find_class(es->env, cls) : NULL;
+  int slot = ci ? symmap_get(&ci->method_index, method) : -1;
+  if (slot < 0 || ci->vtable[slot].overridden) return -1;
+  return symmap_get(&es->funcs, ci->vtable[slot].impl_label);
+}
+
+static const ASTNode *args_list(const ASTNode *args) {
+  if (!args || args->kind != AST_ARGS || args->numChildren == 0) return NULL;
+  const ASTNode *list = ast_child(args, 0);
+  return list->kind == AST_LIST ? list : NULL;
+}
+
+/* fname(args): как resolve_call в codegen — имя, затем fname__T1_T2 */
+static int resolve_func(const Escape *es, const char *fname, const ASTNode *list) {
+  int fi = symmap_get(&es->funcs, fname);
+  if (fi >= 0 || !list || list->numChildren == 0) return fi;
+  char buf[256];
+  int n = snprintf(buf, sizeof(buf), "%s_", fname);
+  for (int i = 0; i < list->numChildren && n > 0 && n < (int)sizeof(buf); i++) {
+    const char *t = typeinfer_get(es->et, ast_child(list, i));
+    if (!t) return -1;
+    n += snprintf(buf + n, sizeof(buf) - (size_t)n, "_%s", t);
+  }
+  return n > 0 && n < (int)sizeof(buf) ? symmap_get(&es->funcs, intern_cstr(buf)) : -1;
+}
+
+/* ========================= использования ========================= */
+
+static void mark_slot(Escape *es, int s) {
+  if (s >= 0 && !es->slots[s].escapes) {
+    es->slots[s].escapes = 1;
+    es->changed = 1;
+  }
+}
+
+static void scan(Escape *es, const ASTNode *n);
+
+/* операнд в позиции, где имя переменной безопасно (safe) или нет */
+static void scan_operand(Escape *es, const ASTNode *e, int safe) {
+  if (e->kind == AST_ID) {
+    if (!safe) mark_slot(es, symmap_get(&es->scope, e->lexeme));
+    return;
+  }
+  scan(es, e);
+}
+
+static void scan_args(Escape *es, const ASTNode *list, int fi, int first_param) {
+  for (int i = 0; list && i < list->numChildren; i++)
+    scan_operand(es, ast_child(list, i), param_safe(es, fi, first_param + i));
+}
+
+static int is_comparison(const char *op) {
+  return op && (!strcmp(op, "==") || !strcmp(op, "!=") || !strcmp(op, "<") ||
+                !strcmp(op, "<=") || !strcmp(op, ">") || !strcmp(op, ">="));
+}
+
+static void scan_call(Escape *es, const ASTNode *e) {
+  const ASTNode *idn = ast_child(e, 0);
+  const ASTNode *list = e->numChildren > 1 ? args_list(ast_child(e, 1)) : NULL;
+  if (idn->kind != AST_ID) {
+    scan_args(es, list, -1, 0);
+    return;
+  }
+  /* неквалифицированный вызов метода своего класса: this — аргумент 0 */
+  const ClassInfo *cls = es->cur->cls;
+  if (cls && symmap_get(&cls->method_index, idn->lexeme) >= 0) {
+    int fi = method_fn(es, cls->name, idn->lexeme);
+    if (!param_safe(es, fi, 0)) mark_slot(es, symmap_get(&es->scope, es->s_this));
+    scan_args(es, list, fi, 1);
+    return;
+  }
+  scan_args(es, list, resolve_func(es, idn->lexeme, list), 0);
+}
+
+static void scan(Escape *es, const ASTNode *n) {
+  switch (n->kind) {
+  case AST_ID:
+    /* имя в любой другой позиции — значение уходит неизвестно куда */
+    mark_slot(es, symmap_get(&es->scope, n->lexeme));
+    return;
+  case AST_FIELD_ACCESS:
+  case AST_MEMBER_INDEX:
+    /* obj, id [, index] */
+    if (n->numChildren >= 1) scan_operand(es, ast_child(n, 0), 1);
+    if (n->numChildren > 2) scan(es, ast_child(n, 2));
+    return;
+  case AST_METHOD_CALL: {
+    /* obj, id, args */
+    if (n->numChildren < 2) return;
+    const ASTNode *obj = ast_child(n, 0);
+    int fi = method_fn(es, typeinfer_get(es->et, obj), ast_child(n, 1)->lexeme);
+    scan_operand(es, obj, param_safe(es, fi, 0));
+    if (n->numChildren > 2) scan_args(es, args_list(ast_child(n, 2)), fi, 1);
+    return;
+  }
+  case AST_CALL:
+    if (n->numChildren >= 1) scan_call(es, n);
+    return;
+  case AST_ASSIGN:
+  case AST_COMPOUND_ASSIGN:
+  case AST_ASSIGN_INDEX:
+  case AST_INDEX:
+    /* запись в саму переменную (или в элементы массива) её не выпускает */
+    if (n->numChildren >= 1) scan_operand(es, ast_child(n, 0), 1);
+    for (int i = 1; i < n->numChildren; i++) scan(es, ast_child(n, i));
+    return;
+  case AST_BINOP:
+    if (n->numChildren >= 3) {
+      int cmp = is_comparison(ast_child(n, 1)->lexeme);
+      scan_operand(es, ast_child(n, 0), cmp);
+      scan_operand(es, ast_child(n, 2), cmp);
+    }
+    return;
+  case AST_NEW:
+    /* class id, args | размер; аргументы конструктора — неизвестный вызов */
+    for (int i = 1; i < n->numChildren; i++) {
+      const ASTNode *c = ast_child(n, i);
+      if (c->kind == AST_ARGS) scan_args(es, args_list(c), -1, 0);
+      else if (c->kind != AST_TYPE_REF && c->kind != AST_TYPE && c->kind != AST_GEN_TYPE) scan(es, c);
+    }
+    return;
+  case AST_VARDECL:
+    /* typeRef, vars: id, optAssign | array(N), ... */
+    if (n->numChildren >= 2 && ast_child(n, 1)->kind == AST_VARS) {
+      const ASTNode *vars = ast_child(n, 1);
+      for (int i = 1; i < vars->numChildren; i += 2) {
+        const ASTNode *init = ast_child(vars, i);
+        if ((init->kind == AST_ASSIGN || init->kind == AST_ARRAY) && init->numChildren > 0)
+          scan(es, ast_child(init, 0));
+      }
+    }
+    return;
+  default:
+    for (int i = 0; i < n->numChildren; i++) scan(es, ast_child(n, i));
+    return;
+  }
+}
+
+static void enter(Escape *es, const FnInfo *f) {
+  es->cur = f;
+  symmap_free(&es->scope);
+  symmap_init(&es->scope, MEM_ESCAPE);
+  for (int s = f->first; s < f->first + f->n_vars; s++)
+    if (es->slots[s].name) symmap_put(&es->scope, es->slots[s].name, s);
+}
+
+/* ========================= места new ========================= */
+
+static int is_object_new(const Escape *es, const ASTNode *e) {
+  if (e->kind != AST_NEW || e->numChildren < 1 || ast_child(e, 0)->kind != AST_ID) return 0;
+  const ASTNode *last = ast_child(e, e->numChildren - 1);
+  if (e->numChildren > 1 && last->kind != AST_ARGS) return 0; /* new T[n] */
+  return types_find_class(es->env, ast_child(e, 0)->lexeme) != NULL;
+}
+
+static void site(Escape *es, const ASTNode *var, const ASTNode *e) {
+  if (var->kind != AST_ID || !is_object_new(es, e)) return;
+  int s = symmap_get(&es->scope, var->lexeme);
+  if (s >= 0 && !es->slots[s].escapes && e->index < es->ei->n) es->ei->local[e->index] = 1;
+}
+
+/* x = new C(...) только как оператор: значение присваивания внутри
+   выражения (return x = new C(), f(x = new C())) уходит мимо x */
+static void mark_sites(Escape *es, const ASTNode *n) {
+  const ASTNode *a = n->kind == AST_EXPRSTMT && n->numChildren == 1 ? ast_child(n, 0) : NULL;
+  if (a && a->kind == AST_ASSIGN && a->numChildren == 2) {
+    site(es, ast_child(a, 0), ast_child(a, 1));
+  } else if (n->kind == AST_VARDECL && n->numChildren >= 2 && ast_child(n, 1)->kind == AST_VARS) {
+    const ASTNode *vars = ast_child(n, 1);
+    for (int i = 0; i + 1 < vars->numChildren; i += 2) {
+      const ASTNode *init = ast_child(vars, i + 1);
+      if (init->kind == AST_ASSIGN && init->numChildren > 0)
+        site(es, ast_child(vars, i), ast_child(init, 0));
+    }
+  }
+  for (int i = 0; i < n->numChildren; i++) mark_sites(es, ast_child(n, i));
+}
+
+/* ========================= проход ========================= */
+
+EscapeInfo *escape_run(const ASTNode *root, const TypeEnv *env, const ExprTypes *et) {
+  EscapeInfo *ei = (EscapeInfo *)calloc(1, sizeof(*ei));
+  if (!ei) return NULL;
+  mem_note_alloc(MEM_ESCAPE, sizeof(*ei));
+  if (!root || root->kind != AST_SOURCE || root->numChildren < 1) return ei;
+  const ASTNode *items = ast_child(root, 0);
+  if (items->kind != AST_ITEMS) return ei;
+
+  TraceSpan span;
+  trace_begin(&span, "escape", NULL);
+
+  ei->arena = root->arena;
+  ei->n = root->arena->numNodes;
+  ei->local = (unsigned char *)calloc(ei->n ? ei->n : 1, 1);
+  if (!ei->local) {
+    ei->n = 0;
+    trace_end(&span);
+    return ei;
+  }
+  mem_note_alloc(MEM_ESCAPE, ei->n);
+
+  Escape es;
+  memset(&es, 0, sizeof(es));
+  es.ei = ei;
+  es.env = env;
+  es.et = et;
+  symmap_init(&es.funcs, MEM_ESCAPE);
+  symmap_init(&es.scope, MEM_ESCAPE);
+  es.s_this = intern_cstr("this");
+
+  for (int i = 0; i < items->numChildren; i++) {
+    const ASTNode *it = ast_child(items, i);
+    if (it->kind == AST_FUNC_DEF) {
+      add_function(&es, it, NULL);
+    } else if (it->kind == AST_CLASS && !find_child_kind(it, AST_TEMPLATE)) {
+      const ASTNode *idn = find_child_kind(it, AST_ID);
+      const ClassInfo *ci = idn ? types_find_class(env, idn->lexeme) : NULL;
+      if (ci) add_members(&es, it, ci);
+    }
+  }
+
+  /* флаги только растут: повторяем, пока сводки меняются */
+  do {
+    es.changed = 0;
+    for (int f = 0; f < es.n_fns; f++) {
+      enter(&es, &es.fns[f]);
+      scan(&es, ast_child(es.fns[f].fn, 1));
+    }
+  } while (es.changed);
+
+  for (int f = 0; f < es.n_fns; f++) {
+    enter(&es, &es.fns[f]);
+    mark_sites(&es, ast_child(es.fns[f].fn, 1));
+  }
+
+  mem_note_resize(MEM_ESCAPE, (size_t)es.cap_fns * sizeof(*es.fns), 0);
+  mem_note_resize(MEM_ESCAPE, (size_t)es.cap_slots * sizeof(*es.slots), 0);
+  free(es.fns);
+  free(es.slots);
+  symmap_free(&es.funcs);
+  symmap_free(&es.scope);
+  trace_end(&span);
+  return ei;
+}
+
+void escape_free(EscapeInfo *ei) {
+  if (!ei) return;
+  if (ei->local) mem_note_free(MEM_ESCAPE, ei->n);
+  mem_note_free(MEM_ESCAPE, sizeof(*ei));
+  free(ei->local);
+  free(ei);
+}
+
+int escape_new_is_local(const EscapeInfo *ei, const ASTNode *new_expr) {
+  if (!ei || !new_expr || new_expr->arena != ei->arena || new_expr->index >= ei->n) return 0;
+  return ei->local[new_expr->index];
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "../ast/ast.h"
+#include "types.h"
+#include "typeinfer.h"
+
+typedef struct EscapeInfo EscapeInfo;
+
+/* Анализ убегания объектов new.
+
+   Объект `new C(...)` не убегает из функции, если он присваивается
+   локалу (или параметру) x оператором `x = new C(...);` или
+   инициализатором `C x = new C(...);`, а x используется только как
+   получатель x.f / x.f = v / x.a[i], операнд сравнения и как аргумент
+   вызова, чей параметр сам не убегает. Убегает всё остальное: return x,
+   y = x, this.f = x, a[i] = x, &x, аргумент неизвестной функции или
+   конструктора, вызов метода, переопределённого в подклассах.
+
+   Для параметров функций и this методов считается сводка «параметр не
+   убегает» — неподвижная точка по всем телам (вызовы по тем же правилам,
+   что в codegen: имя, затем fname__T1_T2 по типам аргументов; методы —
+   Class__method статического типа получателя). Такой объект можно
+   разместить в кадре вызывающей функции: его единственная ссылка — x, и
+   повторное выполнение того же new (в цикле) затирает её. */
+
+EscapeInfo *escape_run(const ASTNode *root, const TypeEnv *env, const ExprTypes *et);
+void escape_free(EscapeInfo *ei);
+
+/* 1, если объект этого new не убегает из своей функции */
+int escape_new_is_local(const EscapeInfo *ei, const ASTNode *new_expr);
@@ -0,0 +1,253 @@
+#include "mono.h"
+#include "../ast/intern.h"
+#include "../ast/symmap.h"
+#include "../trace/trace.h"
+#include "../trace/memstat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MONO_MAX_INSTANCES 4096
+
+typedef struct {
+  ASTNode *items;
+  const ASTNode **templates; /* узлы шаблонных классов */
+  const char **params;       /* имя параметра шаблона (интернировано) */
+  int n_templates, cap_templates;
+  SymMap by_name;            /* имя шаблона -> индекс в templates */
+  SymMap instances;          /* ключ типа (List_int) -> номер экземпляра */
+  int n_instances;
+  int overflow;
+} Mono;
+
+/* ========================= имена типов ========================= */
+
+typedef struct {
+  char s[256];
+  size_t n;
+} NameBuf;
+
+static void nb_put(NameBuf *b, const char *s) {
+  size_t k = strlen(s);
+  if (b->n + k >= sizeof(b->s)) k = sizeof(b->s) - 1 - b->n;
+  memcpy(b->s + b->n, s, k);
+  b->n += k;
+  b->s[b->n] = '\0';
+}
+
+/* схема как у mangle_type в codegen: int, int_arr, List_int */
+static void nb_type(NameBuf *b, const ASTNode *t) {
+  if (!t) {
+    nb_put(b, "void");
+  } else if (t->kind == AST_TYPE || t->kind == AST_TYPE_REF) {
+    nb_put(b, t->lexeme);
+  } else if (t->kind == AST_GEN_TYPE && t->numChildren > 0) {
+    const ASTNode *idn = ast_child(t, 0);
+    nb_put(b, idn->kind == AST_ID ? idn->lexeme : "gen");
+    if (t->numChildren > 1) {
+      nb_put(b, "_");
+      nb_type(b, ast_child(t, 1));
+    }
+  } else if (t->kind == AST_ARRAY && t->numChildren > 0) {
+    nb_type(b, ast_child(t, 0));
+    nb_put(b, "_arr");
+  } else {
+    for (int i = 0; i < t->numChildren; i++) {
+      const ASTNode *c = ast_child(t, i);
+      if (c->lexeme) {
+        nb_put(b, c->lexeme);
+        return;
+      }
+    }
+    nb_put(b, ast_kind_name(t->kind));
+  }
+}
+
+const char *mono_type_name(const ASTNode *type_node) {
+  NameBuf b;
+  b.n = 0;
+  b.s[0] = '\0';
+  nb_type(&b, type_node);
+  return intern_cstr(b.s);
+}
+
+/* ключ экземпляра Name<arg> */
+static const char *instance_key(const char *tname, const ASTNode *arg) {
+  NameBuf b;
+  b.n = 0;
+  b.s[0] = '\0';
+  nb_put(&b, tname);
+  nb_put(&b, "_");
+  nb_type(&b, arg);
+  return intern_cstr(b.s);
+}
+
+static int is_type_node(const ASTNode *n) {
+  return n && (n->kind == AST_TYPE || n->kind == AST_TYPE_REF || n->kind == AST_GEN_TYPE ||
+               n->kind == AST_ARRAY || n->kind == AST_PTR);
+}
+
+/* ========================= шаблоны ========================= */
+
+static const ASTNode *find_child_kind(const ASTNode *n, ASTKind kind) {
+  for (int i = 0; i < n->numChildren; i++) {
+    const ASTNode *c = ast_child(n, i);
+    if (c->kind == kind) return c;
+  }
+  return NULL;
+}
+
+static void add_template(Mono *m, const ASTNode *cls) {
+  const ASTNode *tmpl = find_child_kind(cls, AST_TEMPLATE);
+  const ASTNode *idn = find_child_kind(cls, AST_ID);
+  if (!tmpl || !idn || tmpl->numChildren < 1) return;
+  if (symmap_get(&m->by_name, idn->lexeme) >= 0) return; /* первое объявление */
+
+  if (m->n_templates == m->cap_templates) {
+    int nc = m->cap_templates ? m->cap_templates * 2 : 8;
+    const ASTNode **nt = (const ASTNode **)realloc((void *)m->templates, (size_t)nc * sizeof(*nt));
+    if (!nt) return;
+    m->templates = nt;
+    const char **np = (const char **)realloc((void *)m->params, (size_t)nc * sizeof(*np));
+    if (!np) return;
+    m->params = np;
+    mem_note_resize(MEM_TYPES, (size_t)m->cap_templates * (sizeof(*nt) + sizeof(*np)),
+                    (size_t)nc * (sizeof(*nt) + sizeof(*np)));
+    m->cap_templates = nc;
+  }
+  symmap_put(&m->by_name, idn->lexeme, m->n_templates);
+  m->templates[m->n_templates] = cls;
+  m->params[m->n_templates] = ast_child(tmpl, 0)->lexeme;
+  m->n_templates++;
+}
+
+static const char *instantiate(Mono *m, const char *tname, const ASTNode *arg);
+
+/* лист `node` становится копией типа arg (узел сохраняет своё место в
+   дереве; дети копии переходят к нему) */
+static void become_type(Mono *m, ASTNode *node, const ASTNode *arg) {
+  ASTNode *c = ast_clone(m->items->arena, arg);
+  if (!c) return;
+  node->kind = c->kind;
+  node->lexeme = c->lexeme;
+  node->numChildren = c->numChildren;
+  node->kids = c->kids;
+}
+
+/* T -> arg во всём поддереве экземпляра */
+static void substitute(Mono *m, ASTNode *n, const char *param, const ASTNode *arg) {
+  if (n->kind == AST_TYPE_REF && n->lexeme == param) {
+    become_type(m, n, arg);
+    return;
+  }
+  /* new T(...) / new T[n]: имя класса — id */
+  if (n->kind == AST_NEW && n->numChildren > 0) {
+    ASTNode *idn = ast_child(n, 0);
+    if (idn->kind == AST_ID && idn->lexeme == param) {
+      const char *key = NULL;
+      if (arg->kind == AST_GEN_TYPE && arg->numChildren > 1)
+        key = instantiate(m, ast_child(arg, 0)->lexeme, ast_child(arg, 1));
+      idn->lexeme = key ? key : mono_type_name(arg);
+    }
+  }
+  for (int i = 0; i < n->numChildren; i++)
+    substitute(m, ast_child(n, i), param, arg);
+}
+
+/* экземпляр tname<arg>: создаётся при первом запросе, ключ — имя класса;
+   NULL, если tname не шаблон */
+static const char *instantiate(Mono *m, const char *tname, const ASTNode *arg) {
+  int ti = tname ? symmap_get(&m->by_name, tname) : -1;
+  if (ti < 0 || !arg) return NULL;
+
+  const char *key = instance_key(tname, arg);
+  if (symmap_get(&m->instances, key) >= 0) return key;
+  if (m->n_instances >= MONO_MAX_INSTANCES) {
+    m->overflow = 1;
+    return NULL;
+  }
+  symmap_put(&m->instances, key, m->n_instances++);
+
+  ASTNode *inst = ast_clone(m->items->arena, m->templates[ti]);
+  if (!inst) return key;
+  for (int i = 0; i < inst->numChildren; i++) {
+    ASTNode *c = ast_child(inst, i);
+    if (c->kind == AST_TEMPLATE) {
+      ast_remove_child(inst, i--);
+    } else if (c->kind == AST_ID) {
+      c->lexeme = key;
+      break;
+    }
+  }
+  substitute(m, inst, m->params[ti], arg);
+  ast_add_child(m->items, inst);
+  return key;
+}
+
+/* использования шаблонов вне шаблонных классов -> typeRef экземпляра */
+static void rewrite_uses(Mono *m, ASTNode *n) {
+  if (n->kind == AST_CLASS && find_child_kind(n, AST_TEMPLATE)) return;
+
+  if (n->kind == AST_GEN_TYPE && n->numChildren > 1) {
+    const char *key = instantiate(m, ast_child(n, 0)->lexeme, ast_child(n, 1));
+    if (key) {
+      n->kind = AST_TYPE_REF;
+      n->lexeme = key;
+      n->numChildren = 0;
+      return;
+    }
+  }
+
+  /* new List<int>(...): [id, typeRef, args] -> [id List_int, args] */
+  if (n->kind == AST_NEW && n->numChildren > 1 && is_type_node(ast_child(n, 1))) {
+    ASTNode *idn = ast_child(n, 0);
+    const char *key = idn->kind == AST_ID ? instantiate(m, idn->lexeme, ast_child(n, 1)) : NULL;
+    if (key) {
+      idn->lexeme = key;
+      ast_remove_child(n, 1);
+    }
+  }
+
+  for (int i = 0; i < n->numChildren; i++)
+    rewrite_uses(m, ast_child(n, i));
+}
+
+int mono_instantiate(ASTNode *root) {
+  if (!root || root->kind != AST_SOURCE || root->numChildren < 1) return 0;
+  ASTNode *items = ast_child(root, 0);
+  if (items->kind != AST_ITEMS) return 0;
+
+  TraceSpan span;
+  trace_begin(&span, "mono", NULL);
+
+  Mono m;
+  memset(&m, 0, sizeof(m));
+  m.items = items;
+  symmap_init(&m.by_name, MEM_TYPES);
+  symmap_init(&m.instances, MEM_TYPES);
+
+  for (int i = 0; i < items->numChildren; i++) {
+    const ASTNode *it = ast_child(items, i);
+    if (it->kind == AST_CLASS) add_template(&m, it);
+  }
+
+  /* экземпляры дописываются в конец items и обходятся тем же циклом */
+  if (m.n_templates > 0) {
+    for (int i = 0; i < items->numChildren; i++)
+      rewrite_uses(&m, ast_child(items, i));
+  }
+
+  if (m.overflow)
+    fprintf(stderr, "mono: more than %d template instances (recursive template?)\n",
+            MONO_MAX_INSTANCES);
+
+  int n = m.overflow ? -1 : m.n_instances;
+  free((void *)m.templates);
+  free((void *)m.params);
+  mem_note_resize(MEM_TYPES,
+                  (size_t)m.cap_templates * (sizeof(*m.templates) + sizeof(*m.params)), 0);
+  symmap_free(&m.by_name);
+  symmap_free(&m.instances);
+  trace_end(&span);
+  return n;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "../ast/ast.h"
+
+/* Мономорфизация шаблонов `template <T> class List { ... }`.
+
+   Каждое использование List<Arg> (genType в объявлениях, new List<Arg>())
+   инстанцирует класс один раз на ключ типа: копия класса с именем
+   List_Arg, где T заменён на Arg, добавляется в items. Сами использования
+   переписываются на typeRef List_Arg (new — на id List_Arg), так что
+   дальше (types.c, codegen) экземпляр — обычный класс со своей раскладкой
+   полей и своими методами. Шаблонные классы остаются в дереве как есть. */
+
+/* Имя типа в той же схеме, что имена перегрузок в codegen: int, int_arr,
+   List_int, List_List_int (интернировано). */
+const char *mono_type_name(const ASTNode *type_node);
+
+/* Возвращает число экземпляров или -1, если превышен предел (рекурсивные
+   шаблоны вида List<List<T>> внутри List<T>). */
+int mono_instantiate(ASTNode *root);
@@ -0,0 +1,430 @@
+#include "typeinfer.h"
+#include "mono.h"
+#include "../ast/intern.h"
+#include "../ast/symmap.h"
+#include "../trace/trace.h"
+#include "../trace/memstat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ExprTypes {
+  const ASTArena *arena;
+  const char **type_of; /* индекс узла -> тип или NULL */
+  uint32_t n;
+};
+
+/* одно имя функции с разными возвращаемыми типами у перегрузок */
+#define FN_AMBIGUOUS (-2)
+
+typedef struct {
+  ExprTypes *et;
+  const TypeEnv *env;
+
+  /* имя функции и fname__T1_T2 -> индекс в rets */
+  SymMap funcs;
+  const char **rets;
+  int n_rets, cap_rets;
+
+  /* локалы и параметры текущей функции (плоско, как LocalMap в codegen) */
+  SymMap scope;
+  const char **var_types;
+  int n_vars, cap_vars;
+
+  const ClassInfo *cls; /* класс метода или NULL */
+
+  const char *s_int, *s_char, *s_bool, *s_string, *s_this;
+} Infer;
+
+static int push_sym(const char ***v, int *n, int *cap, const char *s) {
+  if (*n == *cap) {
+    int nc = *cap ? *cap * 2 : 16;
+    const char **nv = (const char **)realloc((void *)*v, (size_t)nc * sizeof(*nv));
+    if (!nv) return -1;
+    mem_note_resize(MEM_EXPR_TYPES, (size_t)*cap * sizeof(*nv), (size_t)nc * sizeof(*nv));
+    *v = nv;
+    *cap = nc;
+  }
+  (*v)[*n] = s;
+  return (*n)++;
+}
+
+static const char *record(Infer *in, const ASTNode *e, const char *t) {
+  if (e->index < in->et->n) in->et->type_of[e->index] = t;
+  return t;
+}
+
+const char *typeinfer_elem_type(const char *t) {
+  if (!t) return NULL;
+  if (!strcmp(t, "string")) return intern_cstr("char");
+  size_t n = strlen(t);
+  if (n > 4 && !strcmp(t + n - 4, "_arr")) return intern_cstrn(t, n - 4);
+  return NULL;
+}
+
+/* ========================= функции и сигнатуры ========================= */
+
+static const ASTNode *sig_arglist(const ASTNode *sig) {
+  if (!sig || sig->kind != AST_SIGNATURE || sig->numChildren < 3) return NULL;
+  const ASTNode *args = ast_child(sig, 2);
+  if (args->kind != AST_ARGS || args->numChildren == 0) return NULL;
+  const ASTNode *list = ast_child(args, 0);
+  return list->kind == AST_ARGLIST ? list : NULL;
+}
+
+static void add_func(Infer *in, const char *name, const char *ret) {
+  int i = symmap_get(&in->funcs, name);
+  if (i == FN_AMBIGUOUS) return;
+  if (i >= 0) {
+    if (in->rets[i] != ret) symmap_put(&in->funcs, name, FN_AMBIGUOUS);
+    return;
+  }
+  i = push_sym(&in->rets, &in->n_rets, &in->cap_rets, ret);
+  if (i >= 0) symmap_put(&in->funcs, name, i);
+}
+
+/* имя и перегрузка fname__T1_T2 (та же схема, что get_func_name в codegen) */
+static void collect_func(Infer *in, const ASTNode *fn) {
+  const ASTNode *sig = fn->numChildren > 0 ? ast_child(fn, 0) : NULL;
+  if (!sig || sig->kind != AST_SIGNATURE || sig->numChildren < 2) return;
+  const ASTNode *idn = ast_child(sig, 1);
+  if (idn->kind != AST_ID) return;
+  const char *ret = mono_type_name(ast_child(sig, 0));
+  add_func(in, idn->lexeme, ret);
+
+  const ASTNode *list = sig_arglist(sig);
+  if (!list || list->numChildren == 0) return;
+  char buf[256];
+  int n = snprintf(buf, sizeof(buf), "%s_", idn->lexeme);
+  for (int i = 0; i < list->numChildren && n > 0 && n < (int)sizeof(buf); i++) {
+    const ASTNode *arg = ast_child(list, i);
+    const ASTNode *t = arg->numChildren > 0 ? ast_child(arg, 0) : NULL;
+    n += snprintf(buf + n, sizeof(buf) - (size_t)n, "_%s", mono_type_name(t));
+  }
+  if (n > 0 && n < (int)sizeof(buf)) add_func(in, intern_cstr(buf), ret);
+}
+
+static const char *func_ret(const Infer *in, const char *name) {
+  int i = symmap_get(&in->funcs, name);
+  return i >= 0 ? in->rets[i] : NULL;
+}
+
+/* ========================= выражения ========================= */
+
+static const char *var_type(const Infer *in, const char *name) {
+  int i = symmap_get(&in->scope, name);
+  if (i >= 0) return in->var_types[i];
+  if (in->cls) {
+    int f = symmap_get(&in->cls->field_index, name);
+    if (f >= 0) return in->cls->fields[f].type_name;
+  }
+  return NULL;
+}
+
+static void declare(Infer *in, const char *name, const char *type) {
+  int i = push_sym(&in->var_types, &in->n_vars, &in->cap_vars, type);
+  if (i >= 0) symmap_put(&in->scope, name, i);
+}
+
+static const FieldInfo *field_of(const Infer *in, const char *cls, const char *name) {
+  const ClassInfo *ci = types_find_class(in->env, cls);
+  int i = ci ? symmap_get(&ci->field_index, name) : -1;
+  return i >= 0 ? &ci->fields[i] : NULL;
+}
+
+static const char *method_ret(const ClassInfo *ci, const char *name) {
+  int i = ci ? symmap_get(&ci->method_index, name) : -1;
+  return i >= 0 ? ci->vtable[i].ret_type : NULL;
+}
+
+static const char *infer_expr(Infer *in, const ASTNode *e);
+
+/* args -> list: типы аргументов в arg_types (NULL — хотя бы один неизвестен) */
+static int infer_args(Infer *in, const ASTNode *args, const char **arg_types, int max) {
+  if (!args || args->kind != AST_ARGS || args->numChildren == 0) return 0;
+  const ASTNode *list = ast_child(args, 0);
+  if (list->kind != AST_LIST) return 0;
+  for (int i = 0; i < list->numChildren; i++) {
+    const char *t = infer_expr(in, ast_child(list, i));
+    if (i < max) arg_types[i] = t;
+  }
+  return list->numChildren;
+}
+
+static const char *call_type(Infer *in, const ASTNode *e) {
+  const ASTNode *idn = ast_child(e, 0);
+  const char *arg_types[8];
+  int nargs = infer_args(in, e->numChildren > 1 ? ast_child(e, 1) : NULL, arg_types, 8);
+  if (idn->kind != AST_ID) return NULL;
+
+  /* неквалифицированный вызов метода своего класса */
+  const char *mret = method_ret(in->cls, idn->lexeme);
+  if (mret) return mret;
+
+  if (nargs > 0 && nargs <= 8) {
+    char buf[256];
+    int n = snprintf(buf, sizeof(buf), "%s_", idn->lexeme);
+    for (int i = 0; i < nargs && n > 0 && n < (int)sizeof(buf); i++) {
+      if (!arg_types[i]) { n = -1; break; }
+      n += snprintf(buf + n, sizeof(buf) - (size_t)n, "_%s", arg_types[i]);
+    }
+    const char *r = n > 0 && n < (int)sizeof(buf) ? func_ret(in, intern_cstr(buf)) : NULL;
+    if (r) return r;
+  }
+  return func_ret(in, idn->lexeme);
+}
+
+static const char *array_of(const char *elem) {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s_arr", elem);
+  return intern_cstr(buf);
+}
+
+static const char *new_type(const ASTNode *e) {
+  const ASTNode *idn = ast_child(e, 0);
+  if (idn->kind != AST_ID) return NULL;
+  const ASTNode *last = ast_child(e, e->numChildren - 1);
+  if (e->numChildren > 1 && last->kind != AST_ARGS) return array_of(idn->lexeme); /* new T[n] */
+  return idn->lexeme;
+}
+
+static const char *infer_expr(Infer *in, const ASTNode *e) {
+  const char *t = NULL;
+  switch (e->kind) {
+  case AST_DEC:
+  case AST_HEX:
+  case AST_BITS:
+    t = in->s_int;
+    break;
+  case AST_CHAR:
+    t = in->s_char;
+    break;
+  case AST_BOOL:
+    t = in->s_bool;
+    break;
+  case AST_STRING:
+    t = in->s_string;
+    break;
+  case AST_ID:
+    t = var_type(in, e->lexeme);
+    break;
+  case AST_BINOP: {
+    if (e->numChildren < 3) break;
+    const char *l = infer_expr(in, ast_child(e, 0));
+    const char *r = infer_expr(in, ast_child(e, 2));
+    const char *op = ast_child(e, 1)->lexeme;
+    if (op && (op[0] == '<' || op[0] == '>' || op[0] == '=' || op[0] == '!'))
+      t = in->s_bool;
+    else
+      t = l ? l : r;
+    break;
+  }
+  case AST_UNOP:
+    if (e->numChildren >= 2) t = infer_expr(in, ast_child(e, 1));
+    break;
+  case AST_ASSIGN:
+  case AST_COMPOUND_ASSIGN:
+    /* lhs, rhs / lhs, op, rhs */
+    if (e->numChildren >= 2) {
+      t = infer_expr(in, ast_child(e, 0));
+      infer_expr(in, ast_child(e, e->numChildren - 1));
+    }
+    break;
+  case AST_ASSIGN_INDEX:
+    /* id, index, value */
+    if (e->numChildren >= 3) {
+      t = typeinfer_elem_type(infer_expr(in, ast_child(e, 0)));
+      infer_expr(in, ast_child(e, 1));
+      infer_expr(in, ast_child(e, 2));
+    }
+    break;
+  case AST_INDEX:
+    if (e->numChildren >= 2) {
+      t = typeinfer_elem_type(infer_expr(in, ast_child(e, 0)));
+      infer_expr(in, ast_child(e, 1));
+    }
+    break;
+  case AST_ADDRESS:
+    if (e->numChildren >= 1) infer_expr(in, ast_child(e, 0));
+    break;
+  case AST_NEW:
+    if (e->numChildren < 1) break;
+    t = new_type(e);
+    for (int i = 1; i < e->numChildren; i++) {
+      const ASTNode *c = ast_child(e, i);
+      if (c->kind == AST_ARGS) infer_args(in, c, NULL, 0);
+      else if (c->kind != AST_TYPE_REF && c->kind != AST_TYPE && c->kind != AST_GEN_TYPE) infer_expr(in, c);
+    }
+    break;
+  case AST_FIELD_ACCESS:
+  case AST_MEMBER_INDEX: {
+    /* obj, id [, index] */
+    if (e->numChildren < 2) break;
+    const char *cls = infer_expr(in, ast_child(e, 0));
+    const FieldInfo *f = cls ? field_of(in, cls, ast_child(e, 1)->lexeme) : NULL;
+    t = f ? f->type_name : NULL;
+    if (e->kind == AST_MEMBER_INDEX && e->numChildren > 2) {
+      t = typeinfer_elem_type(t);
+      infer_expr(in, ast_child(e, 2));
+    }
+    break;
+  }
+  case AST_METHOD_CALL: {
+    /* obj, id, args */
+    if (e->numChildren < 2) break;
+    const char *cls = infer_expr(in, ast_child(e, 0));
+    t = method_ret(types_find_class(in->env, cls), ast_child(e, 1)->lexeme);
+    if (e->numChildren > 2) infer_args(in, ast_child(e, 2), NULL, 0);
+    break;
+  }
+  case AST_CALL:
+    if (e->numChildren >= 1) t = call_type(in, e);
+    break;
+  default:
+    break;
+  }
+  return record(in, e, t);
+}
+
+/* ========================= операторы ========================= */
+
+static int is_expr_kind(ASTKind k) {
+  switch (k) {
+  case AST_BINOP: case AST_UNOP: case AST_ASSIGN: case AST_COMPOUND_ASSIGN:
+  case AST_ASSIGN_INDEX: case AST_INDEX: case AST_ADDRESS: case AST_NEW:
+  case AST_FIELD_ACCESS: case AST_MEMBER_INDEX: case AST_METHOD_CALL: case AST_CALL:
+  case AST_ID: case AST_DEC: case AST_HEX: case AST_BITS: case AST_CHAR:
+  case AST_BOOL: case AST_STRING:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static void infer_stmt(Infer *in, const ASTNode *n) {
+  if (is_expr_kind(n->kind)) {
+    infer_expr(in, n);
+    return;
+  }
+  if (n->kind == AST_VARDECL && n->numChildren >= 2) {
+    /* typeRef, vars: id, optAssign, ... — инициализатор видит прежние имена */
+    const char *type = mono_type_name(ast_child(n, 0));
+    const ASTNode *vars = ast_child(n, 1);
+    if (vars->kind != AST_VARS) return;
+    for (int i = 0; i + 1 < vars->numChildren; i += 2) {
+      /* optAssign или array(N) у T name[N] */
+      const ASTNode *init = ast_child(vars, i + 1);
+      if ((init->kind == AST_ASSIGN || init->kind == AST_ARRAY) && init->numChildren > 0)
+        infer_expr(in, ast_child(init, 0));
+      declare(in, ast_child(vars, i)->lexeme, init->kind == AST_ARRAY ? array_of(type) : type);
+    }
+    return;
+  }
+  for (int i = 0; i < n->numChildren; i++) infer_stmt(in, ast_child(n, i));
+}
+
+static void infer_function(Infer *in, const ASTNode *fn, const ClassInfo *cls) {
+  if (fn->numChildren < 2) return;
+  symmap_free(&in->scope);
+  symmap_init(&in->scope, MEM_EXPR_TYPES);
+  in->n_vars = 0;
+  in->cls = cls;
+
+  if (cls) declare(in, in->s_this, cls->name);
+  const ASTNode *list = sig_arglist(ast_child(fn, 0));
+  for (int i = 0; list && i < list->numChildren; i++) {
+    const ASTNode *arg = ast_child(list, i);
+    if (arg->kind == AST_ARG && arg->numChildren >= 2 && ast_child(arg, 1)->kind == AST_ID)
+      declare(in, ast_child(arg, 1)->lexeme, mono_type_name(ast_child(arg, 0)));
+  }
+  infer_stmt(in, ast_child(fn, 1));
+}
+
+/* методы: funcDef где-то внутри members */
+static void infer_members(Infer *in, const ASTNode *n, const ClassInfo *cls) {
+  for (int i = 0; i < n->numChildren; i++) {
+    const ASTNode *c = ast_child(n, i);
+    if (c->kind == AST_FUNC_DEF) infer_function(in, c, cls);
+    else if (c->kind != AST_VARDECL && c->kind != AST_FIELD) infer_members(in, c, cls);
+  }
+}
+
+static const ASTNode *find_child_kind(const ASTNode *n, ASTKind kind) {
+  for (int i = 0; i < n->numChildren; i++) {
+    const ASTNode *c = ast_child(n, i);
+    if (c->kind == kind) return c;
+  }
+  return NULL;
+}
+
+ExprTypes *typeinfer_run(const ASTNode *root, const TypeEnv *env) {
+  ExprTypes *et = (ExprTypes *)calloc(1, sizeof(*et));
+  if (!et) return NULL;
+  mem_note_alloc(MEM_EXPR_TYPES, sizeof(*et));
+  if (!root || root->kind != AST_SOURCE || root->numChildren < 1) return et;
+  const ASTNode *items = ast_child(root, 0);
+  if (items->kind != AST_ITEMS) return et;
+
+  TraceSpan span;
+  trace_begin(&span, "typeinfer", NULL);
+
+  et->arena = root->arena;
+  et->n = root->arena->numNodes;
+  et->type_of = (const char **)calloc(et->n ? et->n : 1, sizeof(*et->type_of));
+  if (!et->type_of) {
+    et->n = 0;
+    trace_end(&span);
+    return et;
+  }
+  mem_note_alloc(MEM_EXPR_TYPES, (size_t)et->n * sizeof(*et->type_of));
+
+  Infer in;
+  memset(&in, 0, sizeof(in));
+  in.et = et;
+  in.env = env;
+  symmap_init(&in.funcs, MEM_EXPR_TYPES);
+  symmap_init(&in.scope, MEM_EXPR_TYPES);
+  in.s_int = intern_cstr("int");
+  in.s_char = intern_cstr("char");
+  in.s_bool = intern_cstr("bool");
+  in.s_string = intern_cstr("string");
+  in.s_this = intern_cstr("this");
+
+  for (int i = 0; i < items->numChildren; i++) {
+    const ASTNode *it = ast_child(items, i);
+    if (it->kind == AST_FUNC_DEF || it->kind == AST_FUNC_DECL) collect_func(&in, it);
+  }
+
+  for (int i = 0; i < items->numChildren; i++) {
+    const ASTNode *it = ast_child(items, i);
+    if (it->kind == AST_FUNC_DEF) {
+      infer_function(&in, it, NULL);
+    } else if (it->kind == AST_CLASS && !find_child_kind(it, AST_TEMPLATE)) {
+      const ASTNode *idn = find_child_kind(it, AST_ID);
+      const ClassInfo *ci = idn ? types_find_class(env, idn->lexeme) : NULL;
+      if (ci) infer_members(&in, it, ci);
+    }
+  }
+
+  mem_note_resize(MEM_EXPR_TYPES, (size_t)in.cap_rets * sizeof(*in.rets), 0);
+  mem_note_resize(MEM_EXPR_TYPES, (size_t)in.cap_vars * sizeof(*in.var_types), 0);
+  free((void *)in.rets);
+  free((void *)in.var_types);
+  symmap_free(&in.funcs);
+  symmap_free(&in.scope);
+  trace_end(&span);
+  return et;
+}
+
+void typeinfer_free(ExprTypes *et) {
+  if (!et) return;
+  if (et->type_of) mem_note_free(MEM_EXPR_TYPES, (size_t)et->n * sizeof(*et->type_of));
+  mem_note_free(MEM_EXPR_TYPES, sizeof(*et));
+  free((void *)et->type_of);
+  free(et);
+}
+
+const char *typeinfer_get(const ExprTypes *et, const ASTNode *expr) {
+  if (!et || !expr || expr->arena != et->arena || expr->index >= et->n) return NULL;
+  return et->type_of[expr->index];
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "../ast/ast.h"
+#include "types.h"
+
+typedef struct ExprTypes ExprTypes;
+
+/* Статические типы выражений.
+
+   Один проход по телам функций и методов (шаблонные классы пропускаются —
+   их экземпляры к этому моменту уже есть, mono.h). Тип каждого узла-
+   выражения кладётся в боковую таблицу по индексу узла в арене: локалы и
+   параметры, поля this и объектов, возвращаемые типы функций (с учётом
+   перегрузок fname__T1_T2) и методов, new, индексация, литералы.
+
+   Имена типов — интернированные символы в схеме mono_type_name: int,
+   char, bool, string, Vec2i, int_arr, List_int. */
+
+ExprTypes *typeinfer_run(const ASTNode *root, const TypeEnv *env);
+void typeinfer_free(ExprTypes *et);
+
+/* тип выражения или NULL, если он не выводится (или узел создан после
+   прохода) */
+const char *typeinfer_get(const ExprTypes *et, const ASTNode *expr);
+
+/* T_arr -> T, string -> char; иначе NULL */
+const char *typeinfer_elem_type(const char *type_name);
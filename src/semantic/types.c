@@ -1,95 +1,58 @@
 #include "types.h"
+#include "mono.h"
+#include "../ast/intern.h"
+#include "../trace/trace.h"
+#include "../trace/memstat.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* ========================= small utils ========================= */
-
-static char *dup_cstr(const char *s) {
-  if (!s) return NULL;
-  size_t n = strlen(s) + 1;
-  char *d = (char *)malloc(n);
-  if (d) memcpy(d, s, n);
-  return d;
-}
-
-static const char *after_colon(const char *label) {
-  if (!label) return "";
-  const char *c = strchr(label, ':');
-  return c ? (c + 1) : label;
-}
-
-static int is_token_kind(const ASTNode *n, const char *kind) {
-  if (!n || !n->label || !kind) return 0;
-  size_t k = strlen(kind);
-  return (strncmp(n->label, kind, k) == 0 && n->label[k] == ':');
-}
-
-static int streq(const char *a, const char *b) {
-  if (a == b) return 1;
-  if (!a || !b) return 0;
-  return strcmp(a, b) == 0;
-}
+/* свои поля класса — от больших к меньшим (CMake: TYPES_REORDER_FIELDS) */
+#ifndef TYPES_REORDER_FIELDS
+#define TYPES_REORDER_FIELDS 1
+#endif
 
-static char *extract_type_name(const ASTNode *type_node) {
-  if (!type_node || !type_node->label) return dup_cstr("void");
-  if (strchr(type_node->label, ':')) return dup_cstr(after_colon(type_node->label));
+/* ========================= small utils ========================= */
 
-  /* часто typeRef -> child leaf */
-  if (type_node->numChildren > 0) {
-    for (int i = 0; i < type_node->numChildren; i++) {
-      const ASTNode *c = type_node->children[i];
-      if (c && c->label && strchr(c->label, ':')) {
-        return dup_cstr(after_colon(c->label));
-      }
+/* все имена в TypeEnv — интернированные символы: сравнение по указателю,
+   освобождать не нужно */
+
+/* int, Vec2i, int_arr, List_int (mono.h) */
+static const char *extract_type_name(const ASTNode *type_node) {
+  if (!type_node) return intern_cstr("void");
+  if (type_node->lexeme) return type_node->lexeme;
+  return mono_type_name(type_node);
+}
+
+int types_size_of(const char *type_name, int *is_signed) {
+  int size = 8, sign = 1;
+  if (type_name) {
+    if (!strcmp(type_name, "byte") || !strcmp(type_name, "bool") || !strcmp(type_name, "char")) {
+      size = 1;
+      sign = 0;
+    } else if (!strcmp(type_name, "int")) {
+      size = 4;
+    } else if (!strcmp(type_name, "uint")) {
+      size = 4;
+      sign = 0;
     }
   }
-
-  return dup_cstr(type_node->label);
-}
-
-static int is_class_node(const ASTNode *n) {
-  if (!n || !n->label) return 0;
-  return streq(n->label, "class") || streq(n->label, "classDef");
-}
-
-static int is_func_node(const ASTNode *n) {
-  if (!n || !n->label) return 0;
-  return streq(n->label, "funcDef") || streq(n->label, "funcDecl") ||
-         streq(n->label, "methodDef") || streq(n->label, "methodDecl");
-}
-
-/* Ищем среди прямых детей токен kind:* */
-static const ASTNode *find_child_token(const ASTNode *n, const char *kind) {
-  if (!n || !kind) return NULL;
-  for (int i = 0; i < n->numChildren; i++) {
-    const ASTNode *c = n->children[i];
-    if (c && is_token_kind(c, kind)) return c;
-  }
-  return NULL;
+  if (is_signed) *is_signed = sign;
+  return size;
 }
 
-/* Ищем в одном уровне ребёнка с label == name */
-static const ASTNode *find_child_label(const ASTNode *n, const char *label) {
-  if (!n || !label) return NULL;
+/* Ищем в одном уровне ребёнка вида kind */
+static const ASTNode *find_child_kind(const ASTNode *n, ASTKind kind) {
+  if (!n) return NULL;
   for (int i = 0; i < n->numChildren; i++) {
-    const ASTNode *c = n->children[i];
-    if (c && c->label && streq(c->label, label)) return c;
-  }
-  return NULL;
-}
-
-/* Ищем сигнатуру у func/method ноды (обычно child[0] == "signature") */
-static const ASTNode *find_signature_node(const ASTNode *fn) {
-  if (!fn) return NULL;
-  for (int i = 0; i < fn->numChildren; i++) {
-    const ASTNode *c = fn->children[i];
-    if (c && c->label && streq(c->label, "signature")) return c;
+    const ASTNode *c = ast_child(n, i);
+    if (c && c->kind == kind) return c;
   }
   return NULL;
 }
 
-static char *make_impl_label(const char *class_name, const char *method_name) {
-  if (!class_name || !method_name) return dup_cstr("unknown");
+static const char *make_impl_label(const char *class_name, const char *method_name) {
+  if (!class_name || !method_name) return intern_cstr("unknown");
   size_t a = strlen(class_name), b = strlen(method_name);
   size_t n = a + 2 + b + 1; /* Class__method */
   char *s = (char *)malloc(n);
@@ -99,7 +62,9 @@ static char *make_impl_label(const char *class_name, const char *method_name) {
   s[a + 1] = '_';
   memcpy(s + a + 2, method_name, b);
   s[a + 2 + b] = '\0';
-  return s;
+  const char *sym = intern_cstr(s);
+  free(s);
+  return sym;
 }
 
 /* ========================= env structs ========================= */
@@ -107,6 +72,7 @@ static char *make_impl_label(const char *class_name, const char *method_name) {
 struct TypeEnv {
   ClassInfo **classes;
   int n, cap;
+  SymMap by_name; /* имя класса -> индекс в classes (первое объявление) */
 };
 
 /* Временные declared-списки (то, что объявлено в самом классе, без наследования) */
@@ -126,7 +92,8 @@ typedef struct {
 typedef struct {
   TypeEnv *env;
   ClassBuild **builds;
-  int n_builds;
+  int n_builds, cap_builds;
+  SymMap by_name; /* имя класса -> индекс в builds */
 } BuildCtx;
 
 /* ========================= dyn arrays ========================= */
@@ -137,9 +104,13 @@ static void env_add_class(TypeEnv *env, ClassInfo *ci) {
     int nc = env->cap ? env->cap * 2 : 16;
     void *np = realloc(env->classes, (size_t)nc * sizeof(env->classes[0]));
     if (!np) return;
+    mem_note_resize(MEM_TYPES, (size_t)env->cap * sizeof(env->classes[0]),
+                    (size_t)nc * sizeof(env->classes[0]));
     env->classes = (ClassInfo **)np;
     env->cap = nc;
   }
+  if (symmap_get(&env->by_name, ci->name) < 0)
+    symmap_put(&env->by_name, ci->name, env->n);
   env->classes[env->n++] = ci;
 }
 
@@ -149,13 +120,15 @@ static void cb_add_decl_field(ClassBuild *cb, const char *name, const char *type
     int nc = cb->cap_decl_fields ? cb->cap_decl_fields * 2 : 16;
     void *np = realloc(cb->decl_fields, (size_t)nc * sizeof(cb->decl_fields[0]));
     if (!np) return;
+    mem_note_resize(MEM_TYPES, (size_t)cb->cap_decl_fields * sizeof(cb->decl_fields[0]),
+                    (size_t)nc * sizeof(cb->decl_fields[0]));
     cb->decl_fields = (FieldInfo *)np;
     cb->cap_decl_fields = nc;
   }
   FieldInfo *f = &cb->decl_fields[cb->n_decl_fields++];
   memset(f, 0, sizeof(*f));
-  f->name = dup_cstr(name);
-  f->type_name = dup_cstr(type_name ? type_name : "void");
+  f->name = name;
+  f->type_name = type_name ? type_name : intern_cstr("void");
   f->offset = 0; /* заполним на этапе layout */
 }
 
@@ -168,33 +141,27 @@ static void cb_add_decl_method(ClassBuild *cb,
     int nc = cb->cap_decl_methods ? cb->cap_decl_methods * 2 : 16;
     void *np = realloc(cb->decl_methods, (size_t)nc * sizeof(cb->decl_methods[0]));
     if (!np) return;
+    mem_note_resize(MEM_TYPES, (size_t)cb->cap_decl_methods * sizeof(cb->decl_methods[0]),
+                    (size_t)nc * sizeof(cb->decl_methods[0]));
     cb->decl_methods = (MethodInfo *)np;
     cb->cap_decl_methods = nc;
   }
   MethodInfo *m = &cb->decl_methods[cb->n_decl_methods++];
   memset(m, 0, sizeof(*m));
-  m->name = dup_cstr(name);
-  m->ret_type = dup_cstr(ret_type ? ret_type : "void");
+  m->name = name;
+  m->ret_type = ret_type ? ret_type : intern_cstr("void");
   m->slot = -1; /* заполним на этапе vtable */
-  m->impl_label = dup_cstr(impl_label ? impl_label : "unknown");
+  m->impl_label = impl_label ? impl_label : intern_cstr("unknown");
 }
 
+/* строки интернированы — освобождаем только массивы (n — ёмкость) */
 static void free_fieldinfo_array(FieldInfo *arr, int n) {
-  if (!arr) return;
-  for (int i = 0; i < n; i++) {
-    free(arr[i].name);
-    free(arr[i].type_name);
-  }
+  if (arr) mem_note_free(MEM_TYPES, (size_t)n * sizeof(FieldInfo));
   free(arr);
 }
 
 static void free_methodinfo_array(MethodInfo *arr, int n) {
-  if (!arr) return;
-  for (int i = 0; i < n; i++) {
-    free(arr[i].name);
-    free(arr[i].ret_type);
-    free(arr[i].impl_label);
-  }
+  if (arr) mem_note_free(MEM_TYPES, (size_t)n * sizeof(MethodInfo));
   free(arr);
 }
 
@@ -202,121 +169,96 @@ static void free_methodinfo_array(MethodInfo *arr, int n) {
 
 static ClassBuild *ctx_find_build(BuildCtx *ctx, const char *class_name) {
   if (!ctx || !class_name) return NULL;
-  for (int i = 0; i < ctx->n_builds; i++) {
-    ClassBuild *cb = ctx->builds[i];
-    if (cb && cb->ci && cb->ci->name && streq(cb->ci->name, class_name)) return cb;
-  }
-  return NULL;
+  int i = symmap_get(&ctx->by_name, class_name);
+  return i >= 0 ? ctx->builds[i] : NULL;
 }
 
 const ClassInfo *types_find_class(const TypeEnv *env, const char *name) {
   if (!env || !name) return NULL;
-  for (int i = 0; i < env->n; i++) {
-    ClassInfo *c = env->classes[i];
-    if (c && c->name && streq(c->name, name)) return c;
-  }
-  return NULL;
+  const char *sym = intern_cstr(name); /* для уже интернированной — тот же указатель */
+  int i = symmap_get(&env->by_name, sym);
+  return i >= 0 ? env->classes[i] : NULL;
+}
+
+int types_num_classes(const TypeEnv *env) { return env ? env->n : 0; }
+
+const ClassInfo *types_class_at(const TypeEnv *env, int i) {
+  if (!env || i < 0 || i >= env->n) return NULL;
+  return env->classes[i];
 }
 
 /* ========================= AST extraction ========================= */
 
-/* Вытаскиваем имя класса:
-   - пробуем прямого ребёнка id:*
-   - иначе NULL */
-static char *extract_class_name(const ASTNode *class_node) {
-  const ASTNode *id = find_child_token(class_node, "id");
-  if (id) return dup_cstr(after_colon(id->label));
-  /* иногда парсер делает kind IDENTIFIER -> "IDENTIFIER:Name" */
-  id = find_child_token(class_node, "IDENTIFIER");
-  if (id) return dup_cstr(after_colon(id->label));
+/* Вытаскиваем имя класса: прямой ребёнок id, иначе NULL */
+static const char *extract_class_name(const ASTNode *class_node) {
+  const ASTNode *id = find_child_kind(class_node, AST_ID);
+  if (id) return id->lexeme;
   return NULL;
 }
 
-/* Вытаскиваем base:
-   - пробуем leaf base:Base
-   - пробуем child label "base" -> внутри id:* */
-static char *extract_base_name(const ASTNode *class_node) {
-  const ASTNode *b = find_child_token(class_node, "base");
-  if (b) return dup_cstr(after_colon(b->label));
-
-  const ASTNode *base_node = find_child_label(class_node, "base");
-  if (base_node) {
-    const ASTNode *id = find_child_token(base_node, "id");
-    if (id) return dup_cstr(after_colon(id->label));
-    id = find_child_token(base_node, "IDENTIFIER");
-    if (id) return dup_cstr(after_colon(id->label));
-  }
-
-  /* иногда label "extends" */
-  const ASTNode *ext = find_child_label(class_node, "extends");
+/* Вытаскиваем base: extends -> id */
+static const char *extract_base_name(const ASTNode *class_node) {
+  const ASTNode *ext = find_child_kind(class_node, AST_EXTENDS);
   if (ext) {
-    const ASTNode *id = find_child_token(ext, "id");
-    if (id) return dup_cstr(after_colon(id->label));
-    id = find_child_token(ext, "IDENTIFIER");
-    if (id) return dup_cstr(after_colon(id->label));
+    const ASTNode *id = find_child_kind(ext, AST_ID);
+    if (id) return id->lexeme;
   }
-
   return NULL;
 }
 
-/* Собираем поля из vardecl: typeRef vars */
+/* Собираем поля из vardecl (typeRef vars) или field (typeRef fieldlist) */
 static void collect_fields_from_vardecl(ClassBuild *cb, const ASTNode *vardecl) {
   if (!cb || !vardecl) return;
   if (vardecl->numChildren < 2) return;
 
-  const ASTNode *type_node = vardecl->children[0];
-  const ASTNode *vars = vardecl->children[1];
-
-  char *type_name = extract_type_name(type_node);
-  if (!vars || !vars->label || !streq(vars->label, "vars")) {
-    free(type_name);
-    return;
-  }
-
-  /* vars: id, optAssign, id, optAssign ... */
-  for (int i = 0; i < vars->numChildren; i += 2) {
-    const ASTNode *idn = vars->children[i];
-    if (!idn || !idn->label) continue;
-
-    const char *nm = NULL;
-    if (is_token_kind(idn, "id") || is_token_kind(idn, "IDENTIFIER")) {
-      nm = after_colon(idn->label);
+  const ASTNode *type_node = ast_child(vardecl, 0);
+  const ASTNode *vars = ast_child(vardecl, 1);
+
+  const char *type_name = extract_type_name(type_node);
+  if (!vars) return;
+
+  /* vars: id, optAssign, id, optAssign ...; fieldlist: id, id, ... */
+  int step;
+  if (vars->kind == AST_VARS) step = 2;
+  else if (vars->kind == AST_FIELDLIST) step = 1;
+  else return;
+
+  for (int i = 0; i < vars->numChildren; i += step) {
+    const ASTNode *idn = ast_child(vars, i);
+    if (!idn || idn->kind != AST_ID) continue;
+
+    const char *nm = idn->lexeme;
+    /* T name[N] в классе — поле-ссылка на массив */
+    const char *t = type_name;
+    if (step == 2 && i + 1 < vars->numChildren && ast_child(vars, i + 1)->kind == AST_ARRAY) {
+      char buf[256];
+      snprintf(buf, sizeof(buf), "%s_arr", type_name);
+      t = intern_cstr(buf);
     }
-    if (nm && *nm) cb_add_decl_field(cb, nm, type_name);
+    if (nm && *nm) cb_add_decl_field(cb, nm, t);
   }
-
-  free(type_name);
 }
 
-/* Собираем метод из funcDef/funcDecl (или methodDef/methodDecl):
+/* Собираем метод из funcDef/funcDecl:
    signature: [0]=retType, [1]=id, [2]=args... (в твоих модулях так) */
 static void collect_method_from_func(ClassBuild *cb, const ASTNode *fn) {
   if (!cb || !fn || !cb->ci || !cb->ci->name) return;
 
-  const ASTNode *sig = find_signature_node(fn);
+  const ASTNode *sig = find_child_kind(fn, AST_SIGNATURE);
   if (!sig || sig->numChildren < 2) return;
 
-  const ASTNode *ret = sig->children[0];
-  const ASTNode *idn = sig->children[1];
+  const ASTNode *ret = ast_child(sig, 0);
+  const ASTNode *idn = ast_child(sig, 1);
 
-  if (!idn || !idn->label) return;
-
-  const char *mname = NULL;
-  if (is_token_kind(idn, "id") || is_token_kind(idn, "IDENTIFIER")) {
-    mname = after_colon(idn->label);
-  } else if (idn->label && strchr(idn->label, ':')) {
-    mname = after_colon(idn->label);
-  }
+  if (!idn) return;
 
+  const char *mname = idn->lexeme;
   if (!mname || !*mname) return;
 
-  char *ret_type = extract_type_name(ret);
-  char *impl = make_impl_label(cb->ci->name, mname);
+  const char *ret_type = extract_type_name(ret);
+  const char *impl = make_impl_label(cb->ci->name, mname);
 
   cb_add_decl_method(cb, mname, ret_type, impl);
-
-  free(ret_type);
-  free(impl);
 }
 
 /* Рекурсивно собираем члены класса, но:
@@ -324,33 +266,33 @@ static void collect_method_from_func(ClassBuild *cb, const ASTNode *fn) {
    - если встретили vardecl — собираем поля и НЕ идём глубже (локальные init не нужны)
 */
 static void collect_members_from_node(ClassBuild *cb, const ASTNode *n) {
-  if (!cb || !n || !n->label) return;
+  if (!cb || !n) return;
 
-  if (is_func_node(n)) {
+  switch (n->kind) {
+  case AST_FUNC_DEF:
+  case AST_FUNC_DECL:
     collect_method_from_func(cb, n);
     return; /* не лезем внутрь тела */
-  }
-
-  if (streq(n->label, "vardecl") || streq(n->label, "fieldDecl") || streq(n->label, "field")) {
+  case AST_VARDECL:
+  case AST_FIELD:
     /* если это не vardecl-форма — всё равно попробуем как vardecl, если структура похожа */
     collect_fields_from_vardecl(cb, n);
     return;
+  default:
+    break;
   }
 
-  /* wrappers типа public/private — просто рекурсивно */
+  /* wrappers типа member/public/private — просто рекурсивно */
   for (int i = 0; i < n->numChildren; i++) {
-    collect_members_from_node(cb, n->children[i]);
+    collect_members_from_node(cb, ast_child(n, i));
   }
 }
 
 /* ========================= layout + vtable ========================= */
 
-static int find_method_slot_by_name(const MethodInfo *vt, int n, const char *name) {
-  if (!vt || !name) return -1;
-  for (int i = 0; i < n; i++) {
-    if (vt[i].name && streq(vt[i].name, name)) return i;
-  }
-  return -1;
+/* индекс имён: при повторе имени остаётся первый (унаследованный) */
+static void index_first(SymMap *m, const char *name, int idx) {
+  if (symmap_get(m, name) < 0) symmap_put(m, name, idx);
 }
 
 static void compute_layout(BuildCtx *ctx, ClassBuild *cb) {
@@ -394,25 +336,42 @@ static void compute_layout(BuildCtx *ctx, ClassBuild *cb) {
       cb->done = 1;
       return;
     }
+    mem_note_alloc(MEM_TYPES, (size_t)total_fields * sizeof(FieldInfo));
   }
 
-  /* копия inherited */
-  for (int i = 0; i < inherited_fields; i++) {
-    fields[i].name = dup_cstr(base_ci->fields[i].name);
-    fields[i].type_name = dup_cstr(base_ci->fields[i].type_name);
-    fields[i].offset = base_ci->fields[i].offset;
-  }
+  /* копия inherited (смещения не меняются) */
+  for (int i = 0; i < inherited_fields; i++) fields[i] = base_ci->fields[i];
 
   int off = base_ci ? base_ci->size_bytes : 8; /* 0..7 = vptr */
   if (off < 8) off = 8;
 
   for (int i = 0; i < cb->n_decl_fields; i++) {
     FieldInfo *dst = &fields[inherited_fields + i];
-    dst->name = dup_cstr(cb->decl_fields[i].name);
-    dst->type_name = dup_cstr(cb->decl_fields[i].type_name);
-    dst->offset = off;
-    off += 8; /* упрощение: каждое поле 8 байт */
+    dst->name = cb->decl_fields[i].name;
+    dst->type_name = cb->decl_fields[i].type_name;
+    dst->size = types_size_of(dst->type_name, &dst->is_signed);
+  }
+
+  /* порядок в fields — порядок объявления; раскладка — по проходу на
+     размер (8, 4, 1), внутри размера в порядке объявления */
+  static const int k_sizes[] = {8, 4, 1};
+  for (int pass = 0; pass < (TYPES_REORDER_FIELDS ? 3 : 1); pass++) {
+    for (int i = inherited_fields; i < total_fields; i++) {
+      FieldInfo *f = &fields[i];
+      if (TYPES_REORDER_FIELDS && f->size != k_sizes[pass]) continue;
+      off = (off + f->size - 1) & ~(f->size - 1);
+      f->offset = off;
+      off += f->size;
+    }
   }
+  off = (off + 7) & ~7;
+
+  /* индексы базового класса копируются целиком, дальше — только свои имена */
+  SymMap field_index;
+  symmap_init(&field_index, MEM_TYPES);
+  if (base_ci) symmap_copy(&field_index, &base_ci->field_index);
+  for (int i = inherited_fields; i < total_fields; i++)
+    index_first(&field_index, fields[i].name, i);
 
   /* 3) vtable: копируем базовую + override/append */
   int inherited_slots = base_ci ? base_ci->n_slots : 0;
@@ -423,50 +382,74 @@ static void compute_layout(BuildCtx *ctx, ClassBuild *cb) {
     vt = (MethodInfo *)calloc((size_t)max_slots, sizeof(MethodInfo));
     if (!vt) {
       free_fieldinfo_array(fields, total_fields);
+      symmap_free(&field_index);
       cb->visiting = 0;
       cb->done = 1;
       return;
     }
+    mem_note_alloc(MEM_TYPES, (size_t)max_slots * sizeof(MethodInfo));
   }
 
+  SymMap method_index;
+  symmap_init(&method_index, MEM_TYPES);
+  if (base_ci) symmap_copy(&method_index, &base_ci->method_index);
+
   int nslots = inherited_slots;
   for (int i = 0; i < inherited_slots; i++) {
-    vt[i].name = dup_cstr(base_ci->vtable[i].name);
-    vt[i].ret_type = dup_cstr(base_ci->vtable[i].ret_type);
+    vt[i].name = base_ci->vtable[i].name;
+    vt[i].ret_type = base_ci->vtable[i].ret_type;
     vt[i].slot = base_ci->vtable[i].slot;
-    vt[i].impl_label = dup_cstr(base_ci->vtable[i].impl_label);
+    vt[i].impl_label = base_ci->vtable[i].impl_label;
   }
 
   for (int i = 0; i < cb->n_decl_methods; i++) {
     const char *mname = cb->decl_methods[i].name;
-    int idx = find_method_slot_by_name(vt, nslots, mname);
+    int idx = symmap_get(&method_index, mname);
     if (idx >= 0) {
       /* override: слот сохраняем, impl заменяем */
-      free(vt[idx].ret_type);
-      free(vt[idx].impl_label);
-      vt[idx].ret_type = dup_cstr(cb->decl_methods[i].ret_type);
-      vt[idx].impl_label = dup_cstr(cb->decl_methods[i].impl_label);
+      vt[idx].ret_type = cb->decl_methods[i].ret_type;
+      vt[idx].impl_label = cb->decl_methods[i].impl_label;
       /* имя оставляем тем же */
     } else {
       /* append new method */
-      vt[nslots].name = dup_cstr(cb->decl_methods[i].name);
-      vt[nslots].ret_type = dup_cstr(cb->decl_methods[i].ret_type);
+      vt[nslots].name = cb->decl_methods[i].name;
+      vt[nslots].ret_type = cb->decl_methods[i].ret_type;
       vt[nslots].slot = nslots;
-      vt[nslots].impl_label = dup_cstr(cb->decl_methods[i].impl_label);
+      vt[nslots].impl_label = cb->decl_methods[i].impl_label;
+      symmap_put(&method_index, mname, nslots);
       nslots++;
     }
   }
 
+  /* overrides не занимают новых слотов — ужимаем до фактического размера */
+  if (nslots < max_slots) {
+    if (nslots == 0) {
+      free_methodinfo_array(vt, max_slots);
+      vt = NULL;
+    } else {
+      MethodInfo *nv = (MethodInfo *)realloc(vt, (size_t)nslots * sizeof(MethodInfo));
+      if (nv) {
+        mem_note_resize(MEM_TYPES, (size_t)max_slots * sizeof(MethodInfo),
+                        (size_t)nslots * sizeof(MethodInfo));
+        vt = nv;
+      }
+    }
+  }
+
   /* 4) сохраняем в ClassInfo */
   /* если вдруг пересборка — подчистим старое */
   if (cb->ci->fields) free_fieldinfo_array(cb->ci->fields, cb->ci->n_fields);
   if (cb->ci->vtable) free_methodinfo_array(cb->ci->vtable, cb->ci->n_slots);
+  symmap_free(&cb->ci->field_index);
+  symmap_free(&cb->ci->method_index);
 
   cb->ci->fields = fields;
   cb->ci->n_fields = total_fields;
+  cb->ci->field_index = field_index;
 
   cb->ci->vtable = vt;
   cb->ci->n_slots = nslots;
+  cb->ci->method_index = method_index;
 
   cb->ci->size_bytes = off;
   if (cb->ci->size_bytes < 8) cb->ci->size_bytes = 8;
@@ -480,43 +463,37 @@ static void compute_layout(BuildCtx *ctx, ClassBuild *cb) {
 static void builds_add(BuildCtx *ctx, ClassBuild *cb) {
   if (!ctx || !cb) return;
   int n = ctx->n_builds;
-  ClassBuild **nb = (ClassBuild **)realloc(ctx->builds, (size_t)(n + 1) * sizeof(ctx->builds[0]));
-  if (!nb) return;
-  ctx->builds = nb;
+  if (n == ctx->cap_builds) {
+    int nc = ctx->cap_builds ? ctx->cap_builds * 2 : 16;
+    ClassBuild **nb = (ClassBuild **)realloc(ctx->builds, (size_t)nc * sizeof(ctx->builds[0]));
+    if (!nb) return;
+    mem_note_resize(MEM_TYPES, (size_t)ctx->cap_builds * sizeof(ctx->builds[0]),
+                    (size_t)nc * sizeof(ctx->builds[0]));
+    ctx->builds = nb;
+    ctx->cap_builds = nc;
+  }
+  if (symmap_get(&ctx->by_name, cb->ci->name) < 0)
+    symmap_put(&ctx->by_name, cb->ci->name, n);
   ctx->builds[n] = cb;
   ctx->n_builds = n + 1;
 }
 
-/* Берём "контейнер членов": если есть child с label "members"/"memberList"/"membersList" — используем.
+/* Берём "контейнер членов": child members, если есть.
    Иначе — просто рекурсивно по всему class_node, но осторожно:
    мы собираем только vardecl/func на верхних уровнях, а внутрь методов не полезем. */
 static const ASTNode *pick_members_container(const ASTNode *class_node) {
-  const ASTNode *m = NULL;
-  m = find_child_label(class_node, "members");
-  if (m) return m;
-  m = find_child_label(class_node, "memberList");
-  if (m) return m;
-  m = find_child_label(class_node, "membersList");
-  if (m) return m;
-  m = find_child_label(class_node, "classMembers");
-  if (m) return m;
-  return NULL;
+  return find_child_kind(class_node, AST_MEMBERS);
 }
 
 static void collect_one_class(BuildCtx *ctx, const ASTNode *class_node) {
   if (!ctx || !class_node) return;
 
-  char *cname = extract_class_name(class_node);
-  if (!cname || !*cname) {
-    free(cname);
-    return;
-  }
+  const char *cname = extract_class_name(class_node);
+  if (!cname || !*cname) return;
 
   ClassInfo *ci = (ClassInfo *)calloc(1, sizeof(ClassInfo));
-  if (!ci) {
-    free(cname);
-    return;
-  }
+  if (!ci) return;
+  mem_note_alloc(MEM_TYPES, sizeof(ClassInfo));
 
   ci->name = cname;
   ci->base_name = extract_base_name(class_node);
@@ -526,15 +503,16 @@ static void collect_one_class(BuildCtx *ctx, const ASTNode *class_node) {
   ci->vtable = NULL;
   ci->n_slots = 0;
   ci->size_bytes = 0;
+  symmap_init(&ci->field_index, MEM_TYPES);
+  symmap_init(&ci->method_index, MEM_TYPES);
 
   ClassBuild *cb = (ClassBuild *)calloc(1, sizeof(ClassBuild));
   if (!cb) {
-    /* free ci */
-    free(ci->name);
-    free(ci->base_name);
     free(ci);
+    mem_note_free(MEM_TYPES, sizeof(ClassInfo));
     return;
   }
+  mem_note_alloc(MEM_TYPES, sizeof(ClassBuild));
   cb->ci = ci;
 
   /* Собираем declared members */
@@ -544,7 +522,7 @@ static void collect_one_class(BuildCtx *ctx, const ASTNode *class_node) {
   } else {
     /* fallback: по всем детям class_node (но это может захватить base/id тоже — они не vardecl/func, ок) */
     for (int i = 0; i < class_node->numChildren; i++) {
-      collect_members_from_node(cb, class_node->children[i]);
+      collect_members_from_node(cb, ast_child(class_node, i));
     }
   }
 
@@ -556,25 +534,49 @@ static void collect_one_class(BuildCtx *ctx, const ASTNode *class_node) {
 static void walk_find_classes(BuildCtx *ctx, const ASTNode *n) {
   if (!ctx || !n) return;
 
-  if (is_class_node(n)) {
-    collect_one_class(ctx, n);
+  if (n->kind == AST_CLASS) {
+    /* шаблон — не тип, типами станут его экземпляры (mono.c) */
+    if (!find_child_kind(n, AST_TEMPLATE)) collect_one_class(ctx, n);
     return; /* не ищем вложенные классы внутри этого узла (можно убрать, если нужно) */
   }
 
   for (int i = 0; i < n->numChildren; i++) {
-    walk_find_classes(ctx, n->children[i]);
+    walk_find_classes(ctx, ast_child(n, i));
+  }
+}
+
+/* CHA: класс, объявивший свою реализацию слота, делает этот слот
+   полиморфным у всех предков, где он есть. Если предок уже помечен, то
+   помечены и его предки — дальше не идём. */
+static void mark_overrides(TypeEnv *env) {
+  for (int i = 0; i < env->n; i++) {
+    const ClassInfo *d = env->classes[i];
+    const ClassInfo *b = d->base;
+    if (!b) continue;
+    for (int j = 0; j < b->n_slots && j < d->n_slots; j++) {
+      if (d->vtable[j].impl_label == b->vtable[j].impl_label) continue;
+      for (ClassInfo *a = d->base; a && j < a->n_slots && !a->vtable[j].overridden; a = a->base)
+        a->vtable[j].overridden = 1;
+    }
   }
 }
 
 /* ========================= public API ========================= */
 
-TypeEnv *types_build_from_ast(ASTNode *root) {
+TypeEnv *types_build_from_ast(const ASTNode *root) {
   TypeEnv *env = (TypeEnv *)calloc(1, sizeof(TypeEnv));
   if (!env) return NULL;
+  mem_note_alloc(MEM_TYPES, sizeof(TypeEnv));
+
+  TraceSpan span;
+  trace_begin(&span, "types_build", NULL);
+
+  symmap_init(&env->by_name, MEM_TYPES);
 
   BuildCtx ctx;
   memset(&ctx, 0, sizeof(ctx));
   ctx.env = env;
+  symmap_init(&ctx.by_name, MEM_TYPES);
 
   walk_find_classes(&ctx, root);
 
@@ -584,18 +586,23 @@ TypeEnv *types_build_from_ast(ASTNode *root) {
   for (int i = 0; i < ctx.n_builds; i++) {
     compute_layout(&ctx, ctx.builds[i]);
   }
+  mark_overrides(env);
 
   /* cleanup declared buffers */
   for (int i = 0; i < ctx.n_builds; i++) {
     ClassBuild *cb = ctx.builds[i];
     if (!cb) continue;
 
-    free_fieldinfo_array(cb->decl_fields, cb->n_decl_fields);
-    free_methodinfo_array(cb->decl_methods, cb->n_decl_methods);
+    free_fieldinfo_array(cb->decl_fields, cb->cap_decl_fields);
+    free_methodinfo_array(cb->decl_methods, cb->cap_decl_methods);
     free(cb);
+    mem_note_free(MEM_TYPES, sizeof(ClassBuild));
   }
   free(ctx.builds);
+  mem_note_resize(MEM_TYPES, (size_t)ctx.cap_builds * sizeof(ctx.builds[0]), 0);
+  symmap_free(&ctx.by_name);
 
+  trace_end(&span);
   return env;
 }
 
@@ -607,18 +614,21 @@ void types_free(TypeEnv *env) {
       ClassInfo *c = env->classes[i];
       if (!c) continue;
 
-      free(c->name);
-      free(c->base_name);
-
       if (c->fields) free_fieldinfo_array(c->fields, c->n_fields);
       if (c->vtable) free_methodinfo_array(c->vtable, c->n_slots);
+      symmap_free(&c->field_index);
+      symmap_free(&c->method_index);
 
       free(c);
+      mem_note_free(MEM_TYPES, sizeof(ClassInfo));
     }
     free(env->classes);
+    mem_note_resize(MEM_TYPES, (size_t)env->cap * sizeof(env->classes[0]), 0);
   }
+  symmap_free(&env->by_name);
 
   free(env);
+  mem_note_free(MEM_TYPES, sizeof(TypeEnv));
 }
 
 int types_field_offset(const TypeEnv *env,
@@ -630,15 +640,10 @@ int types_field_offset(const TypeEnv *env,
 
   const ClassInfo *ci = types_find_class(env, class_name);
   if (!ci) return 0;
-
-  for (int i = 0; i < ci->n_fields; i++) {
-    const FieldInfo *f = &ci->fields[i];
-    if (f->name && streq(f->name, field_name)) {
-      if (out_off) *out_off = f->offset;
-      return 1;
-    }
-  }
-  return 0;
+  int i = symmap_get(&ci->field_index, intern_cstr(field_name));
+  if (i < 0) return 0;
+  if (out_off) *out_off = ci->fields[i].offset;
+  return 1;
 }
 
 int types_method_slot_and_label(const TypeEnv *env,
@@ -652,14 +657,9 @@ int types_method_slot_and_label(const TypeEnv *env,
 
   const ClassInfo *ci = types_find_class(env, class_name);
   if (!ci) return 0;
-
-  for (int i = 0; i < ci->n_slots; i++) {
-    const MethodInfo *m = &ci->vtable[i];
-    if (m->name && streq(m->name, method_name)) {
-      if (out_slot) *out_slot = m->slot;
-      if (out_impl_label) *out_impl_label = m->impl_label;
-      return 1;
-    }
-  }
-  return 0;
+  int i = symmap_get(&ci->method_index, intern_cstr(method_name));
+  if (i < 0) return 0;
+  if (out_slot) *out_slot = ci->vtable[i].slot;
+  if (out_impl_label) *out_impl_label = ci->vtable[i].impl_label;
+  return 1;
 }
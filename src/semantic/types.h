@@ -1,24 +1,31 @@
 #pragma once
 #include "../ast/ast.h"
+#include "../ast/symmap.h"
 
 typedef struct TypeEnv TypeEnv;
 
+/* Все строки ниже — интернированные символы (ast/intern.h):
+   сравниваются по указателю и не освобождаются. */
+
 typedef struct FieldInfo {
-    char *name;
-    char *type_name;
+    const char *name;
+    const char *type_name;
     int offset;
+    int size;       /* 1, 4 или 8 байт (types_size_of) */
+    int is_signed;  /* узкое поле загружается со знаковым расширением */
 } FieldInfo;
 
 typedef struct MethodInfo {
-    char *name;
-    char *ret_type;
+    const char *name;
+    const char *ret_type;
     int slot;
-    char *impl_label;
+    const char *impl_label;
+    int overridden; /* в каком-то подклассе слот указывает на другую реализацию */
 } MethodInfo;
 
 typedef struct ClassInfo {
-    char *name;
-    char *base_name;
+    const char *name;
+    const char *base_name;
     struct ClassInfo *base;
 
     FieldInfo *fields;
@@ -28,13 +35,30 @@ typedef struct ClassInfo {
     int n_slots;
 
     int size_bytes;
+
+    /* имя -> индекс в fields / vtable (поля базового класса при совпадении
+       имён приоритетнее) */
+    SymMap field_index;
+    SymMap method_index;
 } ClassInfo;
 
-TypeEnv *types_build_from_ast(ASTNode *root);
+/* Раскладка объекта: vptr в 0..7, затем поля базового класса, затем свои.
+   Поля встроенных типов занимают свой естественный размер и выравнивание
+   (byte/bool/char — 1, int/uint — 4, остальное — 8); при
+   TYPES_REORDER_FIELDS свои поля класса кладутся от больших к меньшим,
+   чтобы не было дыр на выравнивание. Размер объекта кратен 8. */
+TypeEnv *types_build_from_ast(const ASTNode *root);
 void types_free(TypeEnv *env);
 
 const ClassInfo *types_find_class(const TypeEnv *env, const char *name);
 
+/* классы в порядке объявления */
+int types_num_classes(const TypeEnv *env);
+const ClassInfo *types_class_at(const TypeEnv *env, int i);
+
+/* размер поля типа type_name в байтах; is_signed — может быть NULL */
+int types_size_of(const char *type_name, int *is_signed);
+
 int types_field_offset(const TypeEnv *env, const char *class_name,
                        const char *field_name, int *out_off);
 
@@ -0,0 +1,117 @@
+#include "memstat.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <windows.h>
+#define MEM_ADD(p, v) ((int64_t)InterlockedExchangeAdd64((volatile LONG64 *)(p), (LONG64)(v)) + (int64_t)(v))
+#define MEM_LOAD(p) ((int64_t)InterlockedCompareExchange64((volatile LONG64 *)(p), 0, 0))
+#define MEM_CAS(p, expected, desired)                                                         \
+  (InterlockedCompareExchange64((volatile LONG64 *)(p), (LONG64)(desired), (LONG64)(expected)) == \
+   (LONG64)(expected))
+#else
+#define MEM_ADD(p, v) __atomic_add_fetch((p), (int64_t)(v), __ATOMIC_RELAXED)
+#define MEM_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define MEM_CAS(p, expected, desired)                                                       \
+  __extension__({                                                                           \
+    int64_t mem_exp_ = (expected);                                                          \
+    __atomic_compare_exchange_n((p), &mem_exp_, (desired), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED); \
+  })
+#endif
+
+typedef struct {
+  int64_t bytes, peak_bytes;
+  int64_t blocks, peak_blocks;
+  int64_t allocs; /* всего выделений (включая рост realloc) */
+} MemCounter;
+
+static const char *const g_owner_names[MEM_NUM_OWNERS] = {
+    [MEM_AST_NODES] = "ast nodes",
+    [MEM_AST_LABELS] = "ast labels (intern)",
+    [MEM_CFG_NODES] = "cfg nodes",
+    [MEM_CFG_OPS] = "cfg operations",
+    [MEM_CG_STRPOOL] = "codegen StrPool",
+    [MEM_CG_CONSTPOOL] = "codegen ConstPool",
+    [MEM_CG_LOCALS] = "codegen LocalMap",
+    [MEM_CG_FIELDS] = "codegen field map",
+    [MEM_TYPES] = "TypeEnv",
+    [MEM_EXPR_TYPES] = "expression types",
+    [MEM_ESCAPE] = "escape analysis",
+    [MEM_IR] = "SSA IR",
+    [MEM_DATAFLOW] = "dataflow",
+};
+
+static int g_enabled = 0;
+static MemCounter g_mem[MEM_NUM_OWNERS];
+static MemCounter g_total;
+
+static void raise_peak(int64_t *peak, int64_t v) {
+  int64_t cur = MEM_LOAD(peak);
+  while (v > cur && !MEM_CAS(peak, cur, v))
+    cur = MEM_LOAD(peak);
+}
+
+static void account(MemCounter *c, int64_t dbytes, int64_t dblocks, int64_t dallocs) {
+  int64_t b = MEM_ADD(&c->bytes, dbytes);
+  int64_t n = MEM_ADD(&c->blocks, dblocks);
+  if (dallocs)
+    MEM_ADD(&c->allocs, dallocs);
+  if (dbytes > 0)
+    raise_peak(&c->peak_bytes, b);
+  if (dblocks > 0)
+    raise_peak(&c->peak_blocks, n);
+}
+
+static void note(MemOwner owner, int64_t dbytes, int64_t dblocks, int64_t dallocs) {
+  if (!g_enabled || (unsigned)owner >= MEM_NUM_OWNERS)
+    return;
+  account(&g_mem[owner], dbytes, dblocks, dallocs);
+  account(&g_total, dbytes, dblocks, dallocs);
+}
+
+void mem_note_alloc(MemOwner owner, size_t bytes) {
+  note(owner, (int64_t)bytes, 1, 1);
+}
+
+void mem_note_free(MemOwner owner, size_t bytes) {
+  note(owner, -(int64_t)bytes, -1, 0);
+}
+
+void mem_note_resize(MemOwner owner, size_t old_bytes, size_t new_bytes) {
+  if (old_bytes == new_bytes)
+    return;
+  int64_t dblocks = old_bytes == 0 ? 1 : new_bytes == 0 ? -1 : 0;
+  note(owner, (int64_t)new_bytes - (int64_t)old_bytes, dblocks, new_bytes > 0);
+}
+
+/* ---- отчёт ---- */
+
+static void print_row(FILE *out, const char *name, const MemCounter *c) {
+  fprintf(out, "%-22s %14.1f %14.1f %10lld %10lld %10lld\n", name,
+          (double)c->peak_bytes / 1024.0, (double)c->bytes / 1024.0, (long long)c->peak_blocks,
+          (long long)c->blocks, (long long)c->allocs);
+}
+
+static void mem_atexit(void) {
+  if (!g_enabled)
+    return;
+  g_enabled = 0;
+  FILE *out = stderr;
+  fprintf(out, "\n=== memory report ===\n");
+  fprintf(out, "%-22s %14s %14s %10s %10s %10s\n", "owner", "peak KiB", "final KiB",
+          "peak blk", "final blk", "allocs");
+  for (int i = 0; i < MEM_NUM_OWNERS; i++)
+    print_row(out, g_owner_names[i], &g_mem[i]);
+  print_row(out, "total", &g_total);
+  fprintf(out, "(final = still allocated at exit; total peak is the peak of the sum)\n");
+}
+
+void mem_report_enable(void) {
+  if (g_enabled)
+    return;
+  atexit(mem_atexit);
+  g_enabled = 1;
+}
+
+int mem_report_enabled(void) { return g_enabled; }
@@ -0,0 +1,41 @@
+#ifndef TRACE_MEMSTAT_H
+#define TRACE_MEMSTAT_H
+
+#include <stddef.h>
+
+/* Учёт памяти по владельцам (--mem-report). Модули сами сообщают о
+   выделении и освобождении своих структур; при выключенном учёте вызовы
+   сводятся к проверке флага. Счётчики атомарные: AST и intern
+   заполняются из нескольких потоков разбора.
+
+   Отчёт при выходе: пик и остаток (то, что так и не освобождено) в байтах
+   и блоках для каждого владельца. */
+
+typedef enum {
+    MEM_AST_NODES,    /* слэбы узлов и срезы детей арены AST */
+    MEM_AST_LABELS,   /* интернированные лексемы и таблица intern */
+    MEM_CFG_NODES,    /* CFGNode и массивы блоков/операций блока */
+    MEM_CFG_OPS,      /* CFGOperation и массивы операндов */
+    MEM_CG_STRPOOL,   /* codegen: StrPool */
+    MEM_CG_CONSTPOOL, /* codegen: ConstPool */
+    MEM_CG_LOCALS,    /* codegen: LocalMap */
+    MEM_CG_FIELDS,    /* codegen: карта смещений полей */
+    MEM_TYPES,        /* TypeEnv: классы, поля, vtable */
+    MEM_EXPR_TYPES,   /* типы выражений (typeinfer) */
+    MEM_ESCAPE,       /* анализ убегания (escape) */
+    MEM_IR,           /* SSA IR: блоки, инструкции, пул операндов */
+    MEM_DATAFLOW,     /* битовые множества анализов потока данных */
+    MEM_NUM_OWNERS
+} MemOwner;
+
+void mem_report_enable(void);
+int mem_report_enabled(void);
+
+/* новый блок bytes байт */
+void mem_note_alloc(MemOwner owner, size_t bytes);
+/* освобождён блок bytes байт */
+void mem_note_free(MemOwner owner, size_t bytes);
+/* realloc: old_bytes == 0 — новый блок, new_bytes == 0 — освобождение */
+void mem_note_resize(MemOwner owner, size_t old_bytes, size_t new_bytes);
+
+#endif /* TRACE_MEMSTAT_H */
@@ -0,0 +1,404 @@
+#include "trace.h"
+#include "memstat.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32) && !defined(__MINGW32__)
+#include <windows.h>
+static SRWLOCK g_lock = SRWLOCK_INIT;
+#define TRACE_LOCK() AcquireSRWLockExclusive(&g_lock)
+#define TRACE_UNLOCK() ReleaseSRWLockExclusive(&g_lock)
+#define TRACE_TLS __declspec(thread)
+#else
+#include <pthread.h>
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+#define TRACE_LOCK() pthread_mutex_lock(&g_lock)
+#define TRACE_UNLOCK() pthread_mutex_unlock(&g_lock)
+#define TRACE_TLS __thread
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define TRACE_HAVE_PERF 1
+#endif
+
+typedef struct {
+  const char *name;
+  char *detail;
+  int tid;
+  uint64_t start_ns; /* от trace_enable */
+  uint64_t dur_ns;
+  uint64_t counters[TRACE_NUM_COUNTERS];
+  int have_counters;
+} TraceRecord;
+
+static int g_enabled = 0;
+static int g_report = 0;
+static char *g_json_path = NULL;
+static uint64_t g_t0 = 0;
+
+static TraceRecord *g_recs = NULL;
+static int g_nrecs = 0, g_caprecs = 0;
+static int g_next_tid = 0;
+static int g_perf_errno = 0; /* причина, если счётчики не открылись */
+
+static TRACE_TLS int t_tid = -1;
+
+static const char *const g_counter_names[TRACE_NUM_COUNTERS] = {
+    "cycles", "instructions", "cache-misses", "branch-misses"};
+
+static uint64_t now_ns(void) {
+#ifdef _WIN32
+  LARGE_INTEGER f, c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+  return (uint64_t)((double)c.QuadPart * 1e9 / (double)f.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* ---- аппаратные счётчики: группа perf на поток ---- */
+
+#ifdef TRACE_HAVE_PERF
+static TRACE_TLS int t_perf_state = 0; /* 0 — не открывали, 1 — есть, -1 — нет */
+static TRACE_TLS int t_perf_leader = -1;
+static TRACE_TLS int t_perf_n = 0;
+static TRACE_TLS int t_perf_kind[TRACE_NUM_COUNTERS]; /* порядок в группе */
+static TRACE_TLS int t_perf_fd[TRACE_NUM_COUNTERS];
+
+/* деструктор ключа закрывает группу, когда поток с интервалами завершается */
+static pthread_key_t g_perf_key;
+static pthread_once_t g_perf_key_once = PTHREAD_ONCE_INIT;
+
+static void perf_thread_close(void) {
+  for (int i = 0; i < t_perf_n; i++)
+    close(t_perf_fd[i]);
+  t_perf_n = 0;
+  t_perf_leader = -1;
+  t_perf_state = 0;
+}
+
+static void perf_thread_exit(void *arg) {
+  (void)arg;
+  perf_thread_close();
+}
+
+static void perf_key_create(void) {
+  pthread_key_create(&g_perf_key, perf_thread_exit);
+}
+
+static int perf_open(uint64_t config, int group) {
+  struct perf_event_attr pe;
+  memset(&pe, 0, sizeof(pe));
+  pe.type = PERF_TYPE_HARDWARE;
+  pe.size = sizeof(pe);
+  pe.config = config;
+  pe.exclude_kernel = 1;
+  pe.exclude_hv = 1;
+  pe.read_format = PERF_FORMAT_GROUP;
+  return (int)syscall(__NR_perf_event_open, &pe, 0, -1, group, 0);
+}
+
+static void perf_thread_init(void) {
+  static const uint64_t configs[TRACE_NUM_COUNTERS] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  t_perf_state = -1;
+  for (int k = 0; k < TRACE_NUM_COUNTERS; k++) {
+    int fd = perf_open(configs[k], t_perf_leader);
+    if (fd < 0) {
+      if (t_perf_leader < 0) {
+        TRACE_LOCK();
+        g_perf_errno = errno;
+        TRACE_UNLOCK();
+        return;
+      }
+      continue; /* счётчик не поддерживается — без него */
+    }
+    if (t_perf_leader < 0)
+      t_perf_leader = fd;
+    t_perf_fd[t_perf_n] = fd;
+    t_perf_kind[t_perf_n++] = k;
+  }
+  t_perf_state = 1;
+  /* значение ключа лишь включает деструктор при выходе из потока */
+  pthread_once(&g_perf_key_once, perf_key_create);
+  pthread_setspecific(g_perf_key, &t_perf_state);
+}
+
+/* 1 — значения прочитаны */
+static int perf_read(uint64_t out[TRACE_NUM_COUNTERS]) {
+  if (t_perf_state == 0)
+    perf_thread_init();
+  if (t_perf_state < 0)
+    return 0;
+  uint64_t buf[1 + TRACE_NUM_COUNTERS];
+  ssize_t n = read(t_perf_leader, buf, sizeof(buf));
+  if (n < (ssize_t)sizeof(uint64_t))
+    return 0;
+  memset(out, 0, TRACE_NUM_COUNTERS * sizeof(uint64_t));
+  for (uint64_t i = 0; i < buf[0] && (int)i < t_perf_n; i++)
+    out[t_perf_kind[i]] = buf[1 + i];
+  return 1;
+}
+#else
+static int perf_read(uint64_t out[TRACE_NUM_COUNTERS]) {
+  (void)out;
+  return 0;
+}
+
+static void perf_thread_close(void) {}
+#endif
+
+/* ---- интервалы ---- */
+
+int trace_enabled(void) { return g_enabled; }
+
+void trace_begin(TraceSpan *sp, const char *name, const char *detail) {
+  sp->active = g_enabled;
+  if (!sp->active)
+    return;
+  sp->name = name;
+  sp->detail = detail;
+  sp->have_counters = perf_read(sp->counters);
+  sp->start_ns = now_ns();
+}
+
+void trace_end(TraceSpan *sp) {
+  if (!sp->active)
+    return;
+  uint64_t end = now_ns();
+  uint64_t c[TRACE_NUM_COUNTERS];
+  int have = sp->have_counters && perf_read(c);
+
+  TraceRecord r;
+  memset(&r, 0, sizeof(r));
+  r.name = sp->name;
+  if (sp->detail) {
+    size_t n = strlen(sp->detail) + 1;
+    r.detail = (char *)malloc(n);
+    if (r.detail)
+      memcpy(r.detail, sp->detail, n);
+  }
+  r.start_ns = sp->start_ns - g_t0;
+  r.dur_ns = end - sp->start_ns;
+  r.have_counters = have;
+  for (int k = 0; have && k < TRACE_NUM_COUNTERS; k++)
+    r.counters[k] = c[k] - sp->counters[k];
+
+  TRACE_LOCK();
+  if (t_tid < 0)
+    t_tid = g_next_tid++;
+  r.tid = t_tid;
+  if (g_nrecs == g_caprecs) {
+    int nc = g_caprecs ? g_caprecs * 2 : 64;
+    TraceRecord *nr = (TraceRecord *)realloc(g_recs, (size_t)nc * sizeof(TraceRecord));
+    if (nr) {
+      g_recs = nr;
+      g_caprecs = nc;
+    }
+  }
+  if (g_nrecs < g_caprecs)
+    g_recs[g_nrecs++] = r;
+  else
+    free(r.detail);
+  TRACE_UNLOCK();
+  sp->active = 0;
+}
+
+/* ---- вывод ---- */
+
+static void print_counters(FILE *out, const uint64_t *c, int have) {
+  if (!have) {
+    fprintf(out, " %14s %14s %6s %12s %12s", "-", "-", "-", "-", "-");
+    return;
+  }
+  double ipc = c[TRACE_CYCLES] ? (double)c[TRACE_INSTRUCTIONS] / (double)c[TRACE_CYCLES] : 0.0;
+  fprintf(out, " %14llu %14llu %6.2f %12llu %12llu",
+          (unsigned long long)c[TRACE_CYCLES], (unsigned long long)c[TRACE_INSTRUCTIONS], ipc,
+          (unsigned long long)c[TRACE_CACHE_MISSES], (unsigned long long)c[TRACE_BRANCH_MISSES]);
+}
+
+static int cmp_dur_desc(const void *a, const void *b) {
+  const TraceRecord *x = *(const TraceRecord *const *)a;
+  const TraceRecord *y = *(const TraceRecord *const *)b;
+  return x->dur_ns < y->dur_ns ? 1 : x->dur_ns > y->dur_ns ? -1 : 0;
+}
+
+#define TRACE_REPORT_TOP 30
+
+static void print_report(FILE *out, uint64_t total_ns) {
+  fprintf(out, "\n=== time report ===\n");
+  fprintf(out, "%-24s %6s %10s %14s %14s %6s %12s %12s\n", "stage", "calls", "wall ms",
+          "cycles", "instructions", "IPC", "cache-miss", "branch-miss");
+
+  /* по стадиям, в порядке первого появления */
+  for (int i = 0; i < g_nrecs; i++) {
+    int seen = 0;
+    for (int j = 0; j < i && !seen; j++)
+      seen = g_recs[j].name == g_recs[i].name || !strcmp(g_recs[j].name, g_recs[i].name);
+    if (seen)
+      continue;
+    uint64_t dur = 0, c[TRACE_NUM_COUNTERS] = {0};
+    int calls = 0, have = 1;
+    for (int j = i; j < g_nrecs; j++) {
+      if (strcmp(g_recs[j].name, g_recs[i].name) != 0)
+        continue;
+      calls++;
+      dur += g_recs[j].dur_ns;
+      have &= g_recs[j].have_counters;
+      for (int k = 0; k < TRACE_NUM_COUNTERS; k++)
+        c[k] += g_recs[j].counters[k];
+    }
+    fprintf(out, "%-24s %6d %10.3f", g_recs[i].name, calls, (double)dur / 1e6);
+    print_counters(out, c, have);
+    fputc('\n', out);
+  }
+  fprintf(out, "%-24s %6s %10.3f\n", "total (wall)", "", (double)total_ns / 1e6);
+
+  /* самые долгие интервалы с деталью (файлы, функции) */
+  int nd = 0;
+  for (int i = 0; i < g_nrecs; i++)
+    nd += g_recs[i].detail != NULL;
+  if (nd > 0) {
+    const TraceRecord **v = (const TraceRecord **)malloc((size_t)nd * sizeof(*v));
+    if (v) {
+      nd = 0;
+      for (int i = 0; i < g_nrecs; i++)
+        if (g_recs[i].detail)
+          v[nd++] = &g_recs[i];
+      qsort(v, (size_t)nd, sizeof(*v), cmp_dur_desc);
+      fprintf(out, "\n%-24s %-24s %10s\n", "stage", "item", "wall ms");
+      for (int i = 0; i < nd && i < TRACE_REPORT_TOP; i++) {
+        fprintf(out, "%-24s %-24s %10.3f", v[i]->name, v[i]->detail, (double)v[i]->dur_ns / 1e6);
+        print_counters(out, v[i]->counters, v[i]->have_counters);
+        fputc('\n', out);
+      }
+      if (nd > TRACE_REPORT_TOP)
+        fprintf(out, "(%d more)\n", nd - TRACE_REPORT_TOP);
+      free(v);
+    }
+  }
+#ifdef TRACE_HAVE_PERF
+  if (g_perf_errno)
+    fprintf(out, "hardware counters unavailable: perf_event_open: %s\n", strerror(g_perf_errno));
+#else
+  fprintf(out, "hardware counters unavailable on this platform\n");
+#endif
+}
+
+static void json_string(FILE *f, const char *s) {
+  fputc('"', f);
+  for (const unsigned char *p = (const unsigned char *)s; *p; ++p) {
+    if (*p == '"' || *p == '\\')
+      fprintf(f, "\\%c", *p);
+    else if (*p < 0x20)
+      fprintf(f, "\\u%04x", *p);
+    else
+      fputc(*p, f);
+  }
+  fputc('"', f);
+}
+
+static int write_json(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "Error: cannot write trace '%s': %s\n", path, strerror(errno));
+    return -1;
+  }
+  fprintf(f, "{\"traceEvents\":[\n");
+  for (int i = 0; i < g_nrecs; i++) {
+    const TraceRecord *r = &g_recs[i];
+    fprintf(f, "%s{\"name\":", i ? ",\n" : "");
+    json_string(f, r->name);
+    fprintf(f, ",\"cat\":\"compiler\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{",
+            (double)r->start_ns / 1e3, (double)r->dur_ns / 1e3, r->tid);
+    int first = 1;
+    if (r->detail) {
+      fprintf(f, "\"detail\":");
+      json_string(f, r->detail);
+      first = 0;
+    }
+    for (int k = 0; r->have_counters && k < TRACE_NUM_COUNTERS; k++) {
+      fprintf(f, "%s\"%s\":%llu", first ? "" : ",", g_counter_names[k],
+              (unsigned long long)r->counters[k]);
+      first = 0;
+    }
+    fprintf(f, "}}");
+  }
+  fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+static void trace_atexit(void) {
+  if (!g_enabled)
+    return;
+  uint64_t total = now_ns() - g_t0;
+  g_enabled = 0;
+  TRACE_LOCK();
+  if (g_report)
+    print_report(stderr, total);
+  if (g_json_path)
+    write_json(g_json_path);
+  for (int i = 0; i < g_nrecs; i++)
+    free(g_recs[i].detail);
+  free(g_recs);
+  g_recs = NULL;
+  g_nrecs = g_caprecs = 0;
+  free(g_json_path);
+  g_json_path = NULL;
+  TRACE_UNLOCK();
+  /* группа основного потока; у рабочих её закрыл деструктор ключа */
+  perf_thread_close();
+}
+
+void trace_enable(int report, const char *json_path) {
+  if (!report && !json_path)
+    return;
+  if (!g_enabled)
+    atexit(trace_atexit);
+  g_report = report;
+  free(g_json_path);
+  g_json_path = NULL;
+  if (json_path) {
+    size_t n = strlen(json_path) + 1;
+    g_json_path = (char *)malloc(n);
+    if (g_json_path)
+      memcpy(g_json_path, json_path, n);
+  }
+  g_t0 = now_ns();
+  g_enabled = 1;
+}
+
+int trace_parse_args(int *argc, char **argv) {
+  int report = 0;
+  const char *json = NULL;
+  int out = 1;
+  for (int i = 1; i < *argc; i++) {
+    if (strcmp(argv[i], "--time-report") == 0) {
+      report = 1;
+    } else if (strcmp(argv[i], "--mem-report") == 0) {
+      mem_report_enable();
+    } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+      json = argv[i] + 8;
+      if (!*json) {
+        fprintf(stderr, "Error: --trace requires a file name (--trace=out.json)\n");
+        return -1;
+      }
+    } else {
+      argv[out++] = argv[i];
+    }
+  }
+  argv[out] = NULL;
+  *argc = out;
+  trace_enable(report, json);
+  return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef TRACE_TRACE_H
+#define TRACE_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Замеры стадий компилятора: время и аппаратные счётчики (perf_event_open
+   на linux) для каждого интервала. Выключено по умолчанию; тогда
+   trace_begin/trace_end сводятся к проверке флага.
+
+   --time-report      сводка в stderr при выходе
+   --trace=out.json   те же интервалы в формате Chrome trace-event
+   (--mem-report разбирается здесь же, см. memstat.h) */
+
+enum {
+    TRACE_CYCLES,
+    TRACE_INSTRUCTIONS,
+    TRACE_CACHE_MISSES,
+    TRACE_BRANCH_MISSES,
+    TRACE_NUM_COUNTERS
+};
+
+typedef struct {
+    const char *name;   /* стадия (статическая строка) */
+    const char *detail; /* файл/функция или NULL; копируется при записи */
+    uint64_t start_ns;
+    uint64_t counters[TRACE_NUM_COUNTERS];
+    int have_counters;
+    int active;
+} TraceSpan;
+
+/* включить сбор; отчёт и json пишутся при выходе из процесса */
+void trace_enable(int report, const char *json_path);
+int trace_enabled(void);
+
+void trace_begin(TraceSpan *sp, const char *name, const char *detail);
+void trace_end(TraceSpan *sp);
+
+/* Разобрать --time-report, --trace=FILE и --mem-report, убрав их из argv.
+   Возвращает 0 или -1 при неверном флаге (сообщение уже напечатано). */
+int trace_parse_args(int *argc, char **argv);
+
+#endif /* TRACE_TRACE_H */